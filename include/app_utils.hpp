@@ -7,6 +7,7 @@
 #ifndef APP_UTILS_HPP
 #define APP_UTILS_HPP
 
+#include "configuration.hpp"
 #include "log.hpp"
 
 namespace app_utils
@@ -15,6 +16,23 @@ namespace app_utils
     /// @param p_logger The logger instance
     void output_copyright_message(Log* p_logger);
 
+    /// @brief Initialise the logger
+    /// @param p_logger The logger to initialise
+    /// @param config Container of the configuration file parameters
+    /// @return True if configured to use a file, else false
+    bool initialise_logger(Log* p_logger, const Configuration& config);
+
+    /// @brief Read the configuration file again and apply the log settings
+    /// @param p_logger The logger to initialise again
+    /// @return True if the new configuration was applied, false if the current one is kept
+    bool reload_configuration(Log* p_logger);
+
+    /// @brief Start generating key pairs in the background when the configuration asks for a key pool
+    /// @param p_logger The logger instance
+    /// @param config Container of the configuration file parameters
+    /// @return True if the key pool was started, else false
+    bool start_key_pool(Log* p_logger, const Configuration& config);
+
 } // namespace app_utils
 
 #endif // #ifndef APP_UTILS_HPP
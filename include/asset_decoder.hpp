@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Decodes the fields of a received asset in a single pass over its members
+ */
+#ifndef ASSET_DECODER_HPP
+#define ASSET_DECODER_HPP
+
+#include <string>
+#include <vector>
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/document.h>
+
+/**
+ * @brief Maps the members of an asset's JSON object onto typed variables.
+ *
+ * @details The fields are declared first, then decode() visits each member of the object once, storing the
+ * value of each declared field that it finds. A null value is treated as if the member was absent. Every
+ * member of the wrong type, unless its field is lenient, and every missing required field is reported,
+ * rather than only the first.
+ *
+ * @code
+ *     AssetDecoder decoder;
+ *     decoder.field("filePath", file_path, "No file path specified (was expected).")
+ *            .field("autoRotate", auto_rotate);
+ *     if (!decoder.decode(json))
+ *     {
+ *         m_error_message = decoder.errorMessage();
+ *     }
+ * @endcode
+ */
+class AssetDecoder
+{
+public:
+    AssetDecoder();
+
+    /**
+     * @brief Declare a string field
+     *
+     * @param name The member name, which must outlive the decoder
+     * @param value [out] Set to the value when the member is present
+     * @param missing_message The error when the member is missing or empty, nullptr if the field is optional
+     */
+    AssetDecoder &field(const char *name, std::string &value, const char *missing_message = nullptr);
+
+    /// @brief Declare a boolean field, see the string field
+    AssetDecoder &field(const char *name, bool &value, const char *missing_message = nullptr);
+
+    /// @brief Declare an integer field, see the string field
+    AssetDecoder &field(const char *name, int &value, const char *missing_message = nullptr);
+
+    /// @brief Declare an array field, set to point at the array in the JSON, see the string field
+    AssetDecoder &field(const char *name, const rapidjson::Value *&p_value, const char *missing_message = nullptr);
+
+    /// @brief Ignore a member of the wrong type for the field declared last, which is then treated as absent
+    AssetDecoder &lenient();
+
+    /**
+     * @brief Decode the declared fields from an object, in one pass over its members
+     *
+     * @return True if every member was of its field's type and every required field was present
+     */
+    bool decode(const rapidjson::Value &json);
+
+    /// @brief Get whether the member of a declared field was present and not null in the last decode
+    bool present(const char *name) const;
+
+    /// @brief Get the errors from the last decode, in the order of the declared fields
+    const std::vector<std::string> &errors() const
+    {
+        return m_errors;
+    }
+
+    /// @brief Get the errors from the last decode as one message
+    std::string errorMessage(const char *separator = " ") const;
+
+private:
+    enum Type
+    {
+        String,
+        Bool,
+        Int,
+        Array
+    };
+
+    struct Field
+    {
+        const char *name;
+        rapidjson::SizeType name_length;
+        Type type;
+        void *p_value;
+        const char *missing_message;
+        bool lenient;
+        bool present;
+        bool type_error;
+    };
+
+    std::vector<Field> m_fields;
+    std::vector<std::string> m_errors;
+
+    AssetDecoder &add(const char *name, Type type, void *p_value, const char *missing_message);
+    bool store(const Field &field, const rapidjson::Value &value);
+};
+
+#endif // #ifndef ASSET_DECODER_HPP
@@ -0,0 +1,131 @@
+/**
+ * \file
+ *
+ * \brief Unit test of decoding the fields of a received asset
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef ASSET_DECODER_UNITTEST_HPP
+#define ASSET_DECODER_UNITTEST_HPP
+
+#include <string>
+#include "gtest/gtest.h"
+#include "asset_decoder.hpp"
+
+TEST(AssetDecoder, Decode_ExpectTypedValues)
+{
+    rapidjson::Document document;
+    document.Parse("{\"filePath\":\"/tmp/certs\",\"storeEncrypted\":true,\"pollingRate\":30,\"apmPasswords\":[{},{}],\"unknown\":1}");
+    ASSERT_FALSE(document.HasParseError());
+
+    std::string file_path;
+    bool store_encrypted = false;
+    int polling_rate = 0;
+    const rapidjson::Value *p_accounts = nullptr;
+    std::string key_type = "unchanged";
+    AssetDecoder decoder;
+    decoder.field("filePath", file_path, "No file path.")
+        .field("storeEncrypted", store_encrypted, "No store encrypted flag.")
+        .field("pollingRate", polling_rate)
+        .field("apmPasswords", p_accounts)
+        .field("keyType", key_type);
+
+    ASSERT_TRUE(decoder.decode(document));
+    ASSERT_TRUE(decoder.errors().empty());
+    ASSERT_EQ("/tmp/certs", file_path);
+    ASSERT_TRUE(store_encrypted);
+    ASSERT_EQ(30, polling_rate);
+    ASSERT_TRUE(p_accounts != nullptr);
+    ASSERT_EQ(2u, p_accounts->Size());
+    ASSERT_EQ("unchanged", key_type);
+    ASSERT_TRUE(decoder.present("pollingRate"));
+    ASSERT_FALSE(decoder.present("keyType"));
+}
+
+TEST(AssetDecoder, Decode_ExpectAllErrorsReported)
+{
+    rapidjson::Document document;
+    document.Parse("{\"filePath\":\"\",\"storeEncrypted\":\"yes\",\"commonName\":null,\"pollingRate\":1.5}");
+    ASSERT_FALSE(document.HasParseError());
+
+    std::string file_path;
+    bool store_encrypted = false;
+    std::string common_name;
+    std::string certificate_id;
+    int polling_rate = 0;
+    AssetDecoder decoder;
+    decoder.field("filePath", file_path, "No file path.")
+        .field("storeEncrypted", store_encrypted, "No store encrypted flag.")
+        .field("commonName", common_name, "No commonName.")
+        .field("certificateId", certificate_id)
+        .field("pollingRate", polling_rate);
+
+    ASSERT_FALSE(decoder.decode(document));
+    ASSERT_EQ(4u, decoder.errors().size());
+    ASSERT_EQ("No file path. storeEncrypted is not a boolean. No commonName. pollingRate is not an integer.", decoder.errorMessage());
+    ASSERT_FALSE(decoder.present("commonName"));
+    ASSERT_FALSE(decoder.present("pollingRate"));
+}
+
+TEST(AssetDecoder, Decode_ExpectResetBetweenDecodes)
+{
+    std::string name;
+    AssetDecoder decoder;
+    decoder.field("account", name, "Name is missing");
+
+    rapidjson::Document document;
+    document.Parse("[{\"account\":\"root\"},{\"salt\":\"abc\"},42]");
+    ASSERT_FALSE(document.HasParseError());
+
+    ASSERT_TRUE(decoder.decode(document[0]));
+    ASSERT_EQ("root", name);
+
+    name.clear();
+    ASSERT_FALSE(decoder.decode(document[1]));
+    ASSERT_EQ("Name is missing", decoder.errorMessage(", "));
+
+    ASSERT_FALSE(decoder.decode(document[2]));
+    ASSERT_EQ(1u, decoder.errors().size());
+}
+
+TEST(AssetDecoder, Decode_ExpectLenientFieldsIgnoredWhenMistyped)
+{
+    rapidjson::Document document;
+    document.Parse("{\"autoRotate\":false,\"pollingRate\":\"30\",\"keyType\":256,\"commonName\":\"device\"}");
+    ASSERT_FALSE(document.HasParseError());
+
+    bool auto_rotate = true;
+    int polling_rate = 0;
+    std::string key_type = "unchanged";
+    std::string common_name;
+    AssetDecoder decoder;
+    decoder.field("autoRotate", auto_rotate)
+        .field("pollingRate", polling_rate).lenient()
+        .field("keyType", key_type).lenient()
+        .field("commonName", common_name, "No commonName.");
+
+    ASSERT_TRUE(decoder.decode(document));
+    ASSERT_TRUE(decoder.errors().empty());
+    ASSERT_FALSE(auto_rotate);
+    ASSERT_EQ(0, polling_rate);
+    ASSERT_EQ("unchanged", key_type);
+    ASSERT_EQ("device", common_name);
+    ASSERT_FALSE(decoder.present("pollingRate"));
+    ASSERT_FALSE(decoder.present("keyType"));
+
+    document.Parse("{\"pollingRate\":45,\"keyType\":\"RSA-2048\"}");
+    ASSERT_FALSE(document.HasParseError());
+    ASSERT_FALSE(decoder.decode(document));
+    ASSERT_EQ("No commonName.", decoder.errorMessage());
+    ASSERT_EQ(45, polling_rate);
+    ASSERT_EQ("RSA-2048", key_type);
+}
+
+#endif // #ifndef ASSET_DECODER_UNITTEST_HPP
@@ -29,7 +29,15 @@ public:
 
     virtual bool submitCSRForSigning(const std::string &auth_json, const std::string &certificate_id, const std::string &generated_csr, std::string &message) = 0;
 
-    virtual bool fetchFile(const std::string &apiurl, const std::string &response_file_path) = 0;
+    /**
+     * @brief Downloads a file, resuming the download if it is interrupted
+     *
+     * @param apiurl The URL of the file
+     * @param response_file_path The path to write the file to
+     * @param sha256 The SHA-256 digest of the file as a hex string, computed while it was downloaded
+     * @return True on success, else false
+     */
+    virtual bool fetchFile(const std::string &apiurl, const std::string &response_file_path, std::string &sha256) = 0;
 
     virtual bool sendScriptOutput(const std::string &script_id, const std::string &device_specific_topic, const std::string &script_output) = 0;
 
@@ -5,32 +5,96 @@
 #define ASYNC_EXEC_SCRIPT_HPP
 
 #include <pthread.h>
+#include <deque>
+#include <memory>
 #include <string>
-#include "async_exec_script.hpp"
+#include "script_utils.hpp"
 
-typedef struct ThreadResult
+/// @brief A script queued on, or running in, the script execution pool
+class ScriptJob
 {
-	ThreadResult(const std::string& script)
-		: m_script(script), m_finished(false), m_success(false)
-	{
-	}
+public:
+    /// @brief Constructor
+    /// @param script The script to execute
+    /// @param limits The limits applied to the script
+    /// @param sink If set, receives the script output as it is produced instead of it being collected
+    ScriptJob(const std::string &script, const script_utils::ExecLimits &limits, const script_utils::OutputSink &sink);
+    ~ScriptJob();
+
+    /// @brief Run the script on the calling thread and record the result
+    void run();
+
+    /// @brief Finish the script as failed without running it
+    /// @param message The reason, returned as the output
+    void fail(const std::string &message);
+
+    /// @brief Kill the script if running, or prevent it from starting if still queued
+    void cancel();
+
+    /// @brief Get whether the script has finished running
+    bool isFinished() const;
 
-    const std::string m_script;
+    /// @brief Get whether the script exited with a success exit code, only valid once finished
+    bool isSuccess() const;
+
+    /// @brief Get the output from the script, only valid once finished
+    const std::string &getLogOutput() const;
+
+    /// @brief Get whether output was discarded for exceeding the output limit, only valid once finished
+    bool isTruncated() const;
+
+private:
+    script_utils::ScriptProcess m_process;
+    const script_utils::OutputSink m_sink;
+    mutable pthread_mutex_t m_lock;
     bool m_finished;
     bool m_success;
     std::string m_log_output;
-} ThreadResult;
+
+    ScriptJob(const ScriptJob &);
+    ScriptJob &operator=(const ScriptJob &);
+};
+
+/// @brief Bounded pool of threads executing scripts, so that a burst of script assets can not start an
+/// unbounded number of processes. Worker threads are created on demand up to the configured maximum.
+class ScriptExecPool
+{
+public:
+    /// @brief Get the pool instance, sized from SCRIPT_MAX_CONCURRENT on first use
+    static ScriptExecPool *getInstance();
+
+    /// @brief Queue a script for execution
+    /// @param job The script job, shared with the caller so either side can outlive the other
+    void submit(const std::shared_ptr<ScriptJob> &job);
+
+private:
+    explicit ScriptExecPool(unsigned int max_concurrent);
+
+    static void *workerThread(void *p_data);
+
+    /// @brief The maximum number of scripts running at once
+    const unsigned int m_max_concurrent;
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_cond;
+    std::deque<std::shared_ptr<ScriptJob> > m_queue;
+    unsigned int m_workers;
+    unsigned int m_idle_workers;
+};
 
 class AsyncExecScript
 {
 public:
     /// @brief Constructor
     AsyncExecScript(const std::string &script);
-    /// @brief Destructor - reaps the thread if executing
+    /// @brief Constructor streaming the script output to a sink. The sink is called from a pool thread and
+    /// must own what it writes to, as it may be called after this object is destroyed. Once the script has
+    /// finished, getScriptOutput() only holds the failure details and the tail of the output.
+    AsyncExecScript(const std::string &script, const script_utils::OutputSink &sink);
+    /// @brief Destructor - kills the script if still executing
     ~AsyncExecScript();
 
-    /// @brief Attempts to consume thread, doing so if its execution has completed
-    /// @return True if the thread has completed, else false
+    /// @brief Checks whether the script has completed
+    /// @return True if the script has completed, else false
     bool tryJoin();
 
     /// @brief Get whether the script exited with a success exit code
@@ -41,13 +105,15 @@ public:
     /// @return The log returned from the script
     const std::string getScriptOutput() const;
 
-private:
-    ThreadResult m_thread_data;
+    /// @brief Get whether the script output was discarded for exceeding the output limit
+    /// @return True if the output was truncated, else false
+    bool isTruncated() const;
 
-    /// @brief Handle to pthread spawned by this class
-    pthread_t m_handle;
+private:
+    /// @brief The script job, shared with the pool thread running it
+    std::shared_ptr<ScriptJob> m_job;
 
-	/// @brief Flag indicating if the thread is running
+	/// @brief Flag indicating if the script is queued or running
 	bool m_thread_running;
 };
 
@@ -12,8 +12,14 @@ extern "C"
 {
 #endif
 
+/* Returns the number of characters written, null terminated when there is room, or 0 if the buffer is too small */
 unsigned int base64Encode( const unsigned char* bytesToEncode, unsigned int bytesToEncodeLength, char* encodedTextBuffer, unsigned int encodedTextBufferSize );
 unsigned int base64Decode( const char* textToDecode, unsigned char* decodedByteBuffer, unsigned int decodedByteBufferSize );
+/* Decode textToDecodeLength characters, which need not be null terminated, so that a long text can be decoded in blocks of 4 characters */
+unsigned int base64DecodeLength( const char* textToDecode, unsigned int textToDecodeLength, unsigned char* decodedByteBuffer, unsigned int decodedByteBufferSize );
+
+/* The name of the kernels in use, "AVX2", "SSSE3", "NEON" or "scalar" */
+const char* base64KernelName( void );
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Base64 encoding and decoding with exact output sizes, for C++ callers.
+ */
+#ifndef BASE64_HPP
+#define BASE64_HPP
+
+#include <stddef.h>
+#include <string>
+#include "base64.h"
+
+namespace base64
+{
+
+enum Status
+{
+    OK,
+    INVALID_INPUT,
+    BUFFER_TOO_SMALL
+};
+
+namespace detail
+{
+    /// @brief The largest amount passed to the C functions in one call, as they take unsigned int sizes
+    const size_t MAX_CHUNK_BYTES = (size_t)3 << 28;
+    const size_t MAX_CHUNK_CHARS = (size_t)4 << 28;
+} // namespace detail
+
+/// @brief Get the number of characters that size bytes encode to
+inline size_t encodedSize(size_t size)
+{
+    return (size + 2) / 3 * 4;
+}
+
+/// @brief Get the number of bytes the text decodes to, which is exact unless there is padding part way through
+inline size_t decodedSize(const char *p_text, size_t length)
+{
+    if (length == 0)
+    {
+        return 0;
+    }
+    // Each missing or padding character in the last two positions of the last group drops a byte
+    const size_t last_group = (length - 1) / 4 * 4;
+    size_t dropped = 0;
+    for (size_t i = last_group + 2; i < last_group + 4; ++i)
+    {
+        if (i >= length || p_text[i] == '=')
+        {
+            ++dropped;
+        }
+    }
+    return (last_group / 4 + 1) * 3 - dropped;
+}
+
+/**
+ * @brief Encode bytes into a buffer, which is not null terminated
+ *
+ * @param p_data The bytes to encode
+ * @param size The number of bytes
+ * @param p_out Receives the text
+ * @param out_size The size of p_out
+ * @param written Receives the number of characters written, or the number needed if the buffer is too small
+ * @return OK, or BUFFER_TOO_SMALL without writing anything
+ */
+inline Status encode(const void *p_data, size_t size, char *p_out, size_t out_size, size_t &written)
+{
+    written = encodedSize(size);
+    if (out_size < written)
+    {
+        return BUFFER_TOO_SMALL;
+    }
+    const unsigned char *p_in = (const unsigned char *)p_data;
+    for (size_t offset = 0; offset < size; offset += detail::MAX_CHUNK_BYTES)
+    {
+        const size_t chunk = size - offset < detail::MAX_CHUNK_BYTES ? size - offset : detail::MAX_CHUNK_BYTES;
+        base64Encode(p_in + offset, (unsigned int)chunk, p_out, (unsigned int)encodedSize(chunk));
+        p_out += encodedSize(chunk);
+    }
+    return OK;
+}
+
+/**
+ * @brief Decode text into a buffer
+ *
+ * @param p_text The text to decode, which need not be null terminated
+ * @param length The number of characters
+ * @param p_out Receives the bytes
+ * @param out_size The size of p_out
+ * @param written Receives the number of bytes written, or the number needed if the buffer is too small
+ * @return OK, INVALID_INPUT if the text is not base64, or BUFFER_TOO_SMALL without writing anything
+ */
+inline Status decode(const char *p_text, size_t length, void *p_out, size_t out_size, size_t &written)
+{
+    written = decodedSize(p_text, length);
+    if (out_size < written)
+    {
+        return BUFFER_TOO_SMALL;
+    }
+    unsigned char *p_bytes = (unsigned char *)p_out;
+    size_t decoded = 0;
+    for (size_t offset = 0; offset < length; offset += detail::MAX_CHUNK_CHARS)
+    {
+        const size_t chunk = length - offset < detail::MAX_CHUNK_CHARS ? length - offset : detail::MAX_CHUNK_CHARS;
+        const unsigned int room = (unsigned int)(written - decoded < detail::MAX_CHUNK_BYTES ? written - decoded : detail::MAX_CHUNK_BYTES);
+        const unsigned int n = base64DecodeLength(p_text + offset, (unsigned int)chunk, p_bytes + decoded, room);
+        if (n == 0)
+        {
+            written = 0;
+            return INVALID_INPUT;
+        }
+        decoded += n;
+    }
+    written = decoded;
+    return OK;
+}
+
+/// @brief Append the encoding of the bytes to text
+inline Status encodeAppend(const void *p_data, size_t size, std::string &text)
+{
+    const size_t old_size = text.size();
+    size_t written = 0;
+    text.resize(old_size + encodedSize(size));
+    return encode(p_data, size, &text[0] + old_size, text.size() - old_size, written);
+}
+
+/// @brief Append the encoding of data to text
+inline Status encodeAppend(const std::string &data, std::string &text)
+{
+    return encodeAppend(data.data(), data.size(), text);
+}
+
+/// @brief Append the bytes the text decodes to to data, which is left as it was if the text is not base64
+inline Status decodeAppend(const char *p_text, size_t length, std::string &data)
+{
+    const size_t old_size = data.size();
+    size_t written = 0;
+    data.resize(old_size + decodedSize(p_text, length));
+    const Status status = decode(p_text, length, &data[0] + old_size, data.size() - old_size, written);
+    data.resize(old_size + (status == OK ? written : 0));
+    return status;
+}
+
+/// @brief Append the bytes text decodes to to data, which is left as it was if the text is not base64
+inline Status decodeAppend(const std::string &text, std::string &data)
+{
+    return decodeAppend(text.data(), text.size(), data);
+}
+
+} // namespace base64
+
+#endif // #ifndef BASE64_HPP
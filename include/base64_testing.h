@@ -0,0 +1,22 @@
+#ifndef BASE64_TESTING_H
+#define BASE64_TESTING_H
+
+/*
+ * Copyright (c) 2024 deviceauthority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Hooks into the base64 functions for the unit tests and benchmarks only.
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Use only the scalar code instead of the SIMD kernels for this CPU, not to be called while other threads use base64 */
+void base64SetScalarOnly( int scalarOnly );
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
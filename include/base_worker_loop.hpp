@@ -7,18 +7,25 @@
 #ifndef BASE_WORKER_LOOP_HPP
 #define BASE_WORKER_LOOP_HPP
 
+#include <atomic>
+#include <memory>
+#include "app_utils.hpp"
+#include "config_watcher.hpp"
+#include "configuration.hpp"
+#include "constants.hpp"
 #include "log.hpp"
 
 class BaseWorkerLoop
 {
 public:
-    /// @brief The period to sleep between auth requests in seconds
-    const long m_sleep_period_s;
+    /// @brief The period to sleep between auth requests in seconds, updated by the worker on a reload
+    long m_sleep_period_s;
 
     /// @brief Constructor
     /// @param sleep_period_ms The sleep period in seconds
     explicit BaseWorkerLoop(long sleep_period_ms)
         : m_sleep_period_s(sleep_period_ms)
+        , m_reload_requested(false)
     {
 		m_interrupted = false;
 		m_exit_code = EXIT_SUCCESS;
@@ -57,11 +64,49 @@ public:
         return m_exit_code;
     }
 
+    /// @brief Ask the worker to read the configuration file again, safe to call from a signal handler
+    void requestReload()
+    {
+        m_reload_requested = true;
+    }
+
+    /// @brief Read the configuration file again whenever it is written
+    /// @param path The path of the configuration file
+    void watchConfiguration(const std::string &path)
+    {
+        mp_config_watcher.reset(new ConfigWatcher(path));
+    }
+
+    /// @brief Called by the worker between iterations to reload the configuration when requested or
+    /// when the file has changed, and apply it
+    /// @return True if a new configuration was applied
+    bool reloadConfigurationIfRequested()
+    {
+        const bool file_changed = mp_config_watcher && mp_config_watcher->changed();
+        const bool requested = m_reload_requested.exchange(false);
+        if ((!file_changed && !requested) || !app_utils::reload_configuration(Log::getInstance()))
+        {
+            return false;
+        }
+        applyConfiguration();
+        return true;
+    }
+
+protected:
+    /// @brief Apply the values the worker copied from the configuration, after a reload
+    virtual void applyConfiguration()
+    {
+        m_sleep_period_s = config.lookupAsLong(CFG_SLEEPPERIOD);
+    }
+
     private:
     /// @brief Flag indicating whether the loop should be interrupted and exit
     bool m_interrupted;
     /// @brief The exit code returned when the worker exited
     int m_exit_code;
+    /// @brief Flag set by requestReload()
+    std::atomic<bool> m_reload_requested;
+    std::unique_ptr<ConfigWatcher> mp_config_watcher;
 };
 
 #endif // #ifndef BASE_WORKER_LOOP_HPP
@@ -36,7 +36,35 @@ protected:
     void onUpdate() override;
 
 private:
+    /// @brief The fields of a certificate asset
+    struct CertificateAsset
+    {
+        std::string file_path;
+        bool store_encrypted;
+        std::string certificate;
+        std::string asset_id;
+        std::string key_id;
+        /// @brief Present if the CSR and private key were generated by DAE
+        std::string private_key;
+        bool sign_apphash;
+        /// @brief The key and IV to decrypt a private key stored encrypted on the device
+        std::string key;
+        std::string iv;
+
+        CertificateAsset() : store_encrypted(false), sign_apphash(false)
+        {
+        }
+    };
+
     bool handleCertificate(const rapidjson::Value &json, const std::string &key, const std::string &iv, const std::string &key_id, unsigned int &sleep_value_from_ks);
+
+    /**
+     * @brief Decode and validate a certificate asset
+     *
+     * @return True if the asset is valid, else false with every problem found in m_error_message
+     */
+    bool decodeCertificate(const rapidjson::Value &json, CertificateAsset &asset, unsigned int &sleep_value_from_ks);
+
     bool writeKeyAndCertificate(const std::string &pk_name, const std::string &private_key, const std::string &cert_name, const std::string &certificate, bool store_encrypted);
     bool decryptData(const std::string &key, const std::string &iv, const std::string &encrypted_data, std::string &decrypted_data) const;
 };
@@ -39,7 +39,13 @@ protected:
 private:
     bool m_waiting_for_certificate;
 
-    bool handleCSRData(const rapidjson::Value &json, CsrInstructions &csr_info, unsigned int &sleep_value_from_ks);
+    /**
+     * @brief Decode and validate the CSR generation instruction
+     *
+     * @param sign_apphash [out] Whether a private key stored in soft storage is signed with the app hash
+     * @return True if the instruction is valid, else false with every problem found in m_error_message
+     */
+    bool handleCSRData(const rapidjson::Value &json, CsrInstructions &csr_info, bool &sign_apphash, unsigned int &sleep_value_from_ks);
 
     bool submitCertificateForSigning(const CsrInstructions &csr_info, std::string &newkeyid, std::string &newkey, std::string &newiv, std::string &pk_output);
 };
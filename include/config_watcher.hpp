@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Watches the configuration file for changes
+ */
+#ifndef CONFIG_WATCHER_HPP
+#define CONFIG_WATCHER_HPP
+
+#include <string>
+
+/**
+ * @brief Notices when the configuration file is written or replaced, so that it can be reloaded.
+ *
+ * @details The directory holding the file is watched with inotify, as editors often write a new file and
+ * rename it over the old one. Where inotify is not available changed() always returns false and the
+ * configuration is only reloaded on request.
+ */
+class ConfigWatcher
+{
+public:
+    /**
+     * @brief Constructor - starts watching
+     *
+     * @param path The path of the configuration file
+     */
+    explicit ConfigWatcher(const std::string &path);
+
+    /// @brief Destructor - stops watching
+    ~ConfigWatcher();
+
+    /// @brief Get whether the file has been written or replaced since the last call, without blocking
+    bool changed();
+
+private:
+    /// @brief The name of the file within the directory watched
+    std::string m_name;
+    int m_fd;
+
+    ConfigWatcher(const ConfigWatcher &);
+    ConfigWatcher &operator=(const ConfigWatcher &);
+};
+
+#endif // #ifndef CONFIG_WATCHER_HPP
@@ -6,8 +6,12 @@
 #ifndef CONFIGURATION_HPP
 #define CONFIGURATION_HPP
 
+#include <atomic>
+#include <stddef.h>
+#include <memory>
 #include <string>
 #include <map>
+#include <vector>
 #if defined(USETHREADING)
 #include <pthread.h>
 #endif // #if defined(USETHREADING)
@@ -20,9 +24,28 @@
 #define TEXTLOWER_TYPE 5
 #define BOOL_TYPE      6
 
+/**
+ * @brief Configuration read from a file, with defaults.
+ *
+ * @details The values are published as an immutable snapshot, which parse() and override() replace as a
+ * whole. Reading through a Key takes no lock and does not allocate, so frequent callers resolve the key
+ * once with key() and keep it:
+ *
+ *     static const Configuration::Key sleepPeriod = config.key(CFG_SLEEPPERIOD);
+ *     const long period = config.lookupAsLong(sleepPeriod);
+ *
+ * Each call holds a reference to the snapshot it reads, so a snapshot that has been replaced is freed once the
+ * last call reading it returns. lookup() returns a copy of the value for the same reason.
+ *
+ * Subsystems that copy values when they start compare generation() to notice a reload and apply them again.
+ */
 class Configuration
 {
 public:
+    /// @brief Identifies a configuration item, see key()
+    typedef size_t Key;
+    static const Key INVALID_KEY = (size_t)-1;
+
     Configuration();
     virtual ~Configuration();
 
@@ -31,9 +54,33 @@ public:
     std::string lookup(const std::string& item) const;
     long lookupAsLong(const std::string& item) const;
 
+    /**
+     * @brief Resolve the name of an item to its key
+     *
+     * @param item The name of the item, in any case
+     * @return The key, or INVALID_KEY if the item is not known
+     */
+    Key key(const std::string& item) const;
+    bool exists(Key key) const;
+    std::string lookup(Key key) const;
+    long lookupAsLong(Key key) const;
+
     bool override(const std::string& item, const std::string& value);
     std::string path() const;
 
+    /**
+     * @brief Read the file given to parse() again, from the defaults
+     *
+     * @details Items that were overridden keep their overridden values. If the file can not be read or is
+     * not valid the current values are kept.
+     *
+     * @return True if the new values were applied
+     */
+    bool reload();
+
+    /// @brief Get a number that changes each time the values change
+    unsigned long generation() const;
+
 protected:
     void addValidationMap(std::map< std::string, int >& validationMap, const std::map< std::string, std::string >& defaults);
 
@@ -52,6 +99,26 @@ private:
     typedef std::map< std::string, Type > ValidationContainer;
     typedef std::map< std::string, std::string > DefaultsContainer;
     typedef std::map< std::string, std::string > ConfigurationContainer;
+    typedef std::map< std::string, Key > KeyContainer;
+
+    /// @brief The value of an item, checked and converted when the snapshot is published
+    struct Value
+    {
+        std::string name;
+        std::string text;
+        long number;
+        bool numeric;
+        /// @brief True if set in the file or overridden, rather than defaulted
+        bool set;
+        /// @brief True if not set and there is no default
+        bool missing;
+    };
+
+    /// @brief The values of all the items, indexed by Key
+    struct Snapshot
+    {
+        std::vector< Value > values;
+    };
 
     std::string escapeSpecialChars(const std::string& from) const;
     bool isNumeric(const std::string& value) const;
@@ -61,18 +128,35 @@ private:
     bool validate(const std::string& item, const std::string& value) const;
     std::string upperCase(const std::string& item) const;
 
-    void add(const std::string& item, const std::string& value);
-    void trimValue(std::string& value);
+    void add(ConfigurationContainer& data, const std::string& item, const std::string& value) const;
+    bool read(const std::string& fullPathOfFile, ConfigurationContainer& data) const;
+    void commit(ConfigurationContainer& data, const std::string& fullPathOfFile);
+    void trimValue(std::string& value) const;
+
+    void registerKeys();
+    void publish();
+    std::shared_ptr< const Snapshot > current() const;
+    const Value* find(const Snapshot& snapshot, Key key) const;
 
 private:
     static const std::string noDefault_;
     ConfigurationContainer data_;
+    /// @brief The items set with override(), which are applied again on a reload
+    ConfigurationContainer overrides_;
     ValidationContainer validationMap_;
     DefaultsContainer defaults_;
     std::string fullPathOfFile_;
+    KeyContainer keys_;
+    std::vector< std::string > keyNames_;
+    /// @brief The snapshot read, only accessed with std::atomic_load() and std::atomic_store()
+    std::shared_ptr< const Snapshot > snapshot_;
+    std::atomic< unsigned long > generation_;
 #if defined(USETHREADING)
     static pthread_mutex_t m_config_lock;
 #endif // #if defined(USETHREADING)
+
+    Configuration(const Configuration&);
+    Configuration& operator=(const Configuration&);
 };
 
 extern Configuration config;
@@ -42,6 +42,10 @@
 #define JSON_OPS                            "ops"
 #define JSON_PAYLOADTYPE                    "payLoadType"
 #define JSON_POLICIES                       "policies"
+#define JSON_POLICIES_ADDED                 "added"
+#define JSON_POLICIES_CHANGED               "changed"
+#define JSON_POLICIES_REMOVED               "removed"
+#define JSON_POLICY_VERSION                 "version"
 #define JSON_POLICYCRYPTOOPERATION          "policyCryptoOperation"
 #define JSON_POLICYDATADIRECTION            "policyDataDirection"
 #define JSON_POLICYMETHODTYPE               "policyMethodType"
@@ -184,11 +188,21 @@ metaDataJSON
 #define CFG_POLL_TIME_FOR_REQUESTED_DATA	"POLL_TIME_FOR_REQUESTED_DATA"
 #define CFG_HEARTBEAT_INTERVAL_S            "HEARTBEAT_INTERVAL_S"
 #define CFG_EVENT_NOTIFICATION_LIBRARIES    "EVENT_NOTIFICATION_LIBRARIES"
+#define CFG_EVENT_QUEUE_SIZE                "EVENT_QUEUE_SIZE"
 #define CFG_RETRY_AUTHORIZATION_INTERVAL_S  "RETRY_AUTHORIZATION_INTERVAL_S"
 #define CFG_USE_UDI_AS_DEVICE_IDENTITY      "USE_UDI_AS_DEVICE_IDENTITY"
 #define CFG_EXT_DDKG_UDI_PROPERTY           "EXT_DDKG_UDI_PROPERTY"
 #define CFG_DDKG_ROOT_FS                    "DDKG_ROOT_FS"
 #define CFG_OSSL_PROVIDER                   "OSSL_PROVIDER"
+#define CFG_SCRIPT_TIMEOUT_S                "SCRIPT_TIMEOUT_S"
+#define CFG_SCRIPT_MAX_OUTPUT_BYTES         "SCRIPT_MAX_OUTPUT_BYTES"
+#define CFG_SCRIPT_MAX_CONCURRENT           "SCRIPT_MAX_CONCURRENT"
+#define CFG_DOWNLOAD_MAX_RETRIES            "DOWNLOAD_MAX_RETRIES"
+#define CFG_BULK_CRYPTO_MIN_BYTES           "BULK_CRYPTO_MIN_BYTES"
+#define CFG_KEY_POOL_SIZE                   "KEY_POOL_SIZE"
+#define CFG_KEY_POOL_TYPES                  "KEY_POOL_TYPES"
+#define CFG_APP_KEY_CACHE_TTL_S             "APP_KEY_CACHE_TTL_S"
+#define CFG_AUTH_SESSION_MAX_S              "AUTH_SESSION_MAX_S"
 
 // Keyscaler Edge/Central Specific Config
 #define CFG_NODE                            "NODE"
@@ -8,7 +8,16 @@
 
 #include <string>
 #include <vector>
+#include "evp_crypto.hpp"
 
+/**
+ * @brief AES-256-CFB encryption to and decryption from base64 text.
+ *
+ * @details Payloads of at least BULK_CRYPTO_MIN_BYTES with a 32 byte key and 16 byte IV are ciphered with
+ * OpenSSL EVP. The cipher context and buffers are kept between operations, so an instance that is reused
+ * does not allocate once its buffers have grown to the size of the payload. The payload passes through
+ * the cipher and base64 coding in one pass, in blocks. Other payloads are ciphered by the DDKG.
+ */
 class dacryptor
 {
 public:
@@ -31,12 +40,21 @@ public:
     // Get the encrypted/decrypted result
     void getCryptedData(const unsigned char*& outputData, unsigned int& dataLength);
 
+    // Wipe the key, IV and data, keeping the buffers for the next operation
+    void clear();
+
 private:
 
     std::string m_output;
     std::string m_input;
     std::vector<char> m_key;
     std::vector<char> m_iv;
+    evp_crypto::AesCfbCipher m_cipher;
+    // Holds a block of the payload between the cipher and base64
+    std::vector<unsigned char> m_block;
+
+    dacryptor(const dacryptor&);
+    dacryptor& operator=(const dacryptor&);
 };
 
 #endif // #ifndef DACRYPTOR_HPP
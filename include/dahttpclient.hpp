@@ -24,12 +24,15 @@ public:
 
     DAErrorCode sendRequest(int reqType, const std::string &url, std::string &response, const std::string &post) override;
     DAErrorCode sendRequest(int reqType, const std::string &url, std::ostream *outStream, std::istream *inStream=0) override;
+    DAErrorCode download(const std::string &url, std::ostream *outStream, uint64_t resumeFrom, const DAHttp::ProgressCallback &progress) override;
 
 private:
     CURL *m_handle;
     char m_error_buffer[CURL_ERROR_SIZE + 1];
     curl_slist *m_headers;
 	std::string m_userAgent;
+    /// @brief The offset of the download in progress, 0 for other requests
+    uint64_t m_resume_from;
 };
 
 #endif // #ifndef DA_HTTP_CLIENT_HPP
@@ -1,10 +1,18 @@
 #ifndef DA_HTTP_CLIENT_BASE_HPP
 #define DA_HTTP_CLIENT_BASE_HPP
 
+#include <stdint.h>
+#include <functional>
 #include <string>
 #include <iostream>
 #include "dahttpenums.hpp"
 
+namespace DAHttp
+{
+    /// @brief Receives the download progress, as the bytes received so far and the total size (0 if not known)
+    typedef std::function<void(uint64_t, uint64_t)> ProgressCallback;
+}
+
 class DAHttpClientBase
 {
 public:
@@ -12,6 +20,21 @@ public:
 
     virtual DAErrorCode sendRequest(int req_type, const std::string &url, std::string &response, const std::string &post) = 0;
     virtual DAErrorCode sendRequest(int req_type, const std::string &url, std::ostream *p_out_stream, std::istream *p_in_stream = 0) = 0;
+
+    /**
+     * @brief Download a resource with a GET request
+     *
+     * @param url The resource to download
+     * @param p_out_stream Receives the content, from resume_from onwards
+     * @param resume_from The offset to request the content from, to resume an interrupted download
+     * @param progress Optional callback receiving the download progress, which clients may not report
+     * @return ERR_OK on success, ERR_RANGE if the download can not be resumed from resume_from
+     */
+    virtual DAErrorCode download(const std::string &url, std::ostream *p_out_stream, uint64_t resume_from, const DAHttp::ProgressCallback & /* progress */)
+    {
+        // Clients without range support can only download from the start
+        return resume_from == 0 ? sendRequest(DAHttp::ReqType::eGET, url, p_out_stream) : ERR_RANGE;
+    }
 };
 
 #endif // #ifndef DA_HTTP_CLIENT_BASE_HPP
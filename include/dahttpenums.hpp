@@ -8,7 +8,8 @@ typedef enum DAReturnCode_
     ERR_BAD_PARAM       = 2,
     ERR_BAD_DATA        = 3,
     ERR_INTERNAL        = 4,
-    ERR_CURL            = 5
+    ERR_CURL            = 5,
+    ERR_RANGE           = 6
 } DAErrorCode;
 
 namespace DAHttp
@@ -9,6 +9,10 @@
 #if defined(WIN32)
 #include <Windows.h>
 #endif // #if defined(WIN32)
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
 #include <string>
 #include "DeviceKeyDef.h"
 #include <vector>
@@ -75,24 +79,25 @@ public:
     int doCipherAES(const char * key, const int key_sz, const char* iv, const int iv_sz, const char* input, const int input_sz, CipherMode mode, char ** output);
     std::string doDigestSHA256(const std::string &input);
     std::string getDeviceKey(const std::string& challengeID, std::string& message, char* keyid = 0, char* key = 0, char* iv = 0);
+    // The TID and UDI are read from the DDKG once and kept until the identity is invalidated, and are
+    // returned as copies taken under the lock as another thread may invalidate and read them again
     std::string getDeviceTid();
     bool getIDCToken(std::string &token);
+    void invalidateSession();
     bool destroyInstance();
     void setAPIURL(const std::string& APIURL);
     void setUserId(const std::string& user);
     // Write UDI to the DDKG
     bool setUDI(const std::string &udi) const override;
     // Read UDI from the DDKG
-    const std::string getUDI() const override;
+    std::string getUDI() const override;
+    void invalidateIdentity() override;
     // Write Ext DDKG UDI property name to DDKG
     bool setExtDdkgUDIPropertyName(const std::string &udi_property) const;
     // Write DDKG root filesystem path to DDKG
     bool setDdkgRootFilepath(const std::string &ddkg_root_fs) const;
 
-    const std::string &getUserId() const override
-    {
-        return m_user;
-    }
+    std::string getUserId() const override;
 
     // Keyscaler Edge Support
     const std::string& userAgentString() const;
@@ -113,17 +118,29 @@ private:
     // Do registration. This only needs to be done once (ever) unless the device has been removed from DA.
     bool registration(const std::string& challengeID, std::string& message);
     bool registration(const std::string& challengeID, std::string& message, std::string& metadata);
+    // Register the device unless another caller has since the given number of registrations was read. Returns
+    // true in that case too, with no message or metadata, so that the caller authorises again.
+    bool registerOnce(unsigned int registrations, const std::string& challengeID, std::string& message, std::string& metadata);
     // Request an registration challenge from DA
     std::string registrationChallenge(std::string &message, void *clientPtr);
-    // Request an authorisation challenge from DA (via reliant party)
-    std::string authorisationChallenge(std::string& message, bool& registered, void *clientPtr, int &status_code, std::string policyID = "");
+    // Request an authorisation challenge from DA (via reliant party), with how long the server lets its response be reused
+    std::string authorisationChallenge(std::string& message, bool& registered, void *clientPtr, int &status_code, std::string policyID = "", int *p_session_lifetime_s = nullptr);
     // Generate the json body needed for the policy gateway call
     std::string getBodyJSONForAPICall(const std::string &challenge_id, std::string &key_id, std::string &key, std::string &iv, const std::string &apphash, const std::string& asset_id_str, std::string &message);
     std::string getBodyJSONForAPICall(const std::string &challenge_id, std::string &key_id, std::string &key, std::string &iv, const std::string &apphash, bool sign_apphash, const std::string& asset_id_str, std::string &message);
-    std::string challenge(const std::string& type, const std::string& bodytext, bool& registered, std::string& message, void *clientPtr, int &status_code);
+    std::string challenge(const std::string& type, const std::string& bodytext, bool& registered, std::string& message, void *clientPtr, int &status_code, int *p_session_lifetime_s = nullptr);
+    // Get the authorisation kept for a session key, if it has not expired
+    bool findSession(const std::string& session_key, std::string& key_id, std::string& key, std::string& iv, std::string& body);
+    // Keep an authorisation for the lifetime given by the server, capped by the configuration
+    void keepSession(const std::string& session_key, int lifetime_s, const std::string& key_id, const std::string& key, const std::string& iv, const std::string& body);
     //std::string getDeviceKey(const std::string& challengeID, std::string& message, char *keyid = 0, char *key = 0, char *iv = 0);
     // Load up the dynamic ddk library
     bool loadLibrary();
+    // Read the TID and UDI from the DDKG
+    std::string readDeviceTid();
+    std::string readUDI() const;
+    // The KeyScaler API URL, copied so that a request keeps using one even if it is set meanwhile
+    std::string getAPIURL() const;
 
     // Keyscaler Edge Support
     std::string getDeviceKeyForEdge(const std::string& edgeDeviceMeta, const std::string& challengeID, std::string& message, char *keyid = 0, char *key = 0, char *iv = 0);
@@ -133,12 +150,17 @@ private:
     static DeviceAuthorityBase *mp_da_instance;    // Singleton
     
 #if defined(USETHREADING)
+    /// @brief Serialises the singleton's lifetime and device registration
     static pthread_mutex_t mutexDA_;
+    /// @brief Serialises every call into the DDKG, which is not reentrant
+    static pthread_mutex_t mutexDDKG_;
 #endif // #if defined(USETHREADING)
     /// @brief Pointer to the event manager instance
     EventManagerBase *mp_event_manager;
 
     bool m_registered;
+    /// @brief Guards the user and API URL, which getInstance() may set while other callers are authorising
+    mutable std::mutex m_endpoint_mutex;
     std::string m_user;
     std::string m_APIURL;
     std::string m_user_agent;
@@ -172,10 +194,38 @@ private:
     NAUDADDK_SETROOTFS_PROC pfnaudaddk_setrootfs;
     std::string m_deviceTID;
     HMODULE m_hdll;
-    bool m_is_edge_node;
+    std::atomic<bool> m_is_edge_node;
+    /// @brief The number of registrations done, so that callers finding the device unregistered at once register it once
+    std::atomic<unsigned int> m_registrations;
+
+    /// @brief An authorisation that KeyScaler accepts again until it expires
+    struct AuthSession
+    {
+        std::string key_id;
+        std::string key;
+        std::string iv;
+        std::string body;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    std::mutex m_session_mutex;
+    /// @brief Authorisations kept for reuse, keyed by what was authorised
+    std::map<std::string, AuthSession> m_sessions;
+    /// @brief Guards the TID and UDI read from the DDKG, and whether they are still valid
+    mutable std::mutex m_identity_mutex;
+    std::string m_tid;
+    bool m_tid_valid;
+    mutable std::string m_udi;
+    mutable bool m_udi_valid;
+
+    /// @brief The IDC token obtained with a kept authorisation, and when that authorisation expires
+    std::string m_idc_token;
+    std::chrono::steady_clock::time_point m_idc_token_expires;
 
     static void mutex_lock();
     static void mutex_unlock();
+    static void ddkg_lock();
+    static void ddkg_unlock();
 };
 
 #endif // #ifndef DEVICE_AUTHORITY_HPP
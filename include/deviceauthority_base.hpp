@@ -31,14 +31,18 @@ public:
     virtual std::string getDeviceKey(const std::string& challengeID, std::string& message, char* keyid = 0, char* key = 0, char* iv = 0) = 0;
     virtual std::string getDeviceTid() = 0;
     virtual bool getIDCToken(std::string &token) = 0;
+    // Forget any authorisation kept for reuse, e.g. after the server has rejected it
+    virtual void invalidateSession() = 0;
     virtual bool destroyInstance() = 0;
     virtual void setAPIURL(const std::string& APIURL) = 0;
     virtual void setUserId(const std::string& user) = 0;
     virtual bool setUDI(const std::string &udi) const = 0;
-    virtual const std::string getUDI() const = 0;
+    virtual std::string getUDI() const = 0;
+    // Forget the TID and UDI read from the DDKG, as they change when the device registers or its UDI is set
+    virtual void invalidateIdentity() = 0;
     virtual bool setExtDdkgUDIPropertyName(const std::string &udi_property) const = 0;
     virtual bool setDdkgRootFilepath(const std::string &ddkg_root_fs) const = 0;
-    virtual const std::string &getUserId() const = 0;
+    virtual std::string getUserId() const = 0;
 
     // Keyscaler Edge Support
     virtual const std::string &userAgentString() const = 0;
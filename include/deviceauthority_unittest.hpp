@@ -0,0 +1,286 @@
+/**
+ * \file
+ *
+ * \brief Stress test of concurrent authorisation and of reused authorisations against a stub KeyScaler
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef DEVICEAUTHORITY_UNITTEST_HPP
+#define DEVICEAUTHORITY_UNITTEST_HPP
+
+#if !defined(WIN32)
+#include <arpa/inet.h>
+#include <dlfcn.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "dahttpclient.hpp"
+#include "deviceauthority.hpp"
+
+namespace
+{
+    /// @brief HTTP server on the loopback interface that answers every request with an authorisation challenge
+    /// after a fixed delay, standing in for KeyScaler's network and processing time
+    class StubKeyScaler
+    {
+    public:
+        /// @param session_lifetime_s How long the response to a challenge may be reused, 0 for not at all
+        explicit StubKeyScaler(int latency_ms, int session_lifetime_s = 0)
+            : m_latency_ms(latency_ms), m_session_lifetime_s(session_lifetime_s), m_socket(-1), m_port(0), m_stopping(false), m_requests(0)
+        {
+        }
+
+        ~StubKeyScaler()
+        {
+            stop();
+        }
+
+        bool start()
+        {
+            m_socket = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t size = sizeof(address);
+            if (m_socket < 0 || bind(m_socket, (sockaddr *)&address, size) != 0 || listen(m_socket, 64) != 0 ||
+                getsockname(m_socket, (sockaddr *)&address, &size) != 0)
+            {
+                return false;
+            }
+            m_port = ntohs(address.sin_port);
+            m_thread = std::thread(&StubKeyScaler::run, this);
+            return true;
+        }
+
+        void stop()
+        {
+            if (m_thread.joinable())
+            {
+                m_stopping = true;
+                shutdown(m_socket, SHUT_RDWR);
+                m_thread.join();
+            }
+            if (m_socket >= 0)
+            {
+                close(m_socket);
+                m_socket = -1;
+            }
+        }
+
+        const std::string url() const
+        {
+            return "http://127.0.0.1:" + std::to_string(m_port);
+        }
+
+        unsigned int requests() const
+        {
+            return m_requests;
+        }
+
+    private:
+        const int m_latency_ms;
+        const int m_session_lifetime_s;
+        int m_socket;
+        unsigned short m_port;
+        std::atomic<bool> m_stopping;
+        std::atomic<unsigned int> m_requests;
+        std::thread m_thread;
+
+        void run()
+        {
+            std::vector<std::thread> connections;
+            while (!m_stopping)
+            {
+                const int connection = accept(m_socket, nullptr, nullptr);
+                if (connection < 0)
+                {
+                    break;
+                }
+                connections.push_back(std::thread(&StubKeyScaler::respond, this, connection));
+            }
+            for (auto connection_iter = connections.begin(); connection_iter != connections.end(); ++connection_iter)
+            {
+                connection_iter->join();
+            }
+        }
+
+        void respond(int connection)
+        {
+            // Read the headers, answering an expectation of a body, then the body whether chunked or not
+            std::string request;
+            char buffer[4096];
+            size_t body_start = std::string::npos;
+            bool continued = false;
+            for (;;)
+            {
+                if (body_start == std::string::npos && (body_start = request.find("\r\n\r\n")) != std::string::npos)
+                {
+                    body_start += 4;
+                }
+                if (body_start != std::string::npos)
+                {
+                    if (!continued && request.find("Expect: 100-continue") < body_start)
+                    {
+                        static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                        send(connection, CONTINUE, sizeof(CONTINUE) - 1, 0);
+                        continued = true;
+                    }
+                    const size_t length_pos = request.find("Content-Length: ");
+                    if (length_pos < body_start)
+                    {
+                        if (request.size() - body_start >= std::stoul(request.substr(length_pos + 16)))
+                        {
+                            break;
+                        }
+                    }
+                    else if (request.find("0\r\n\r\n", body_start) != std::string::npos || request.find("chunked") > body_start)
+                    {
+                        break;
+                    }
+                }
+                const ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+                if (received <= 0)
+                {
+                    close(connection);
+                    return;
+                }
+                request.append(buffer, (size_t)received);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(m_latency_ms));
+            m_requests++;
+            const std::string body = "{\"httpCode\":200,\"statusCode\":0,\"message\":{\"challenge\":\"stub-challenge\"" +
+                                     (m_session_lifetime_s > 0 ? ",\"sessionLifetime\":" + std::to_string(m_session_lifetime_s) : std::string()) + "}}";
+            const std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: " +
+                                         std::to_string(body.size()) + "\r\n\r\n" + body;
+            send(connection, response.c_str(), response.size(), 0);
+            close(connection);
+        }
+    };
+
+    /// @brief Authorise from a number of threads at once
+    /// @return The number of successful authorisations per second
+    double authoriseConcurrently(DeviceAuthorityBase *p_da, size_t threads, int iterations_per_thread, unsigned int &failures)
+    {
+        std::atomic<unsigned int> failed(0);
+        std::vector<std::thread> workers;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.push_back(std::thread([p_da, iterations_per_thread, &failed]()
+            {
+                DAHttpClient http_client(p_da->userAgentString());
+                for (int j = 0; j < iterations_per_thread; ++j)
+                {
+                    std::string key_id;
+                    std::string key;
+                    std::string iv;
+                    std::string message;
+                    if (p_da->identifyAndAuthorise(key_id, key, iv, message, &http_client).empty())
+                    {
+                        failed++;
+                    }
+                }
+            }));
+        }
+        for (auto worker_iter = workers.begin(); worker_iter != workers.end(); ++worker_iter)
+        {
+            worker_iter->join();
+        }
+        const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        failures = failed;
+        return (threads * iterations_per_thread - failed) / elapsed_s;
+    }
+
+    /// @brief Get whether the DDKG library, which generates the device keys, can be loaded
+    bool isDDKGAvailable()
+    {
+        void *p_ddkg = dlopen("libnaudaddk_shared.so", RTLD_LAZY);
+        if (p_ddkg == nullptr)
+        {
+            printf("libnaudaddk_shared.so is not available, skipping\n");
+            return false;
+        }
+        dlclose(p_ddkg);
+        return true;
+    }
+} // namespace
+
+// Aggregate authorisation throughput as callers are added, run with --gtest_also_run_disabled_tests.
+// Needs the DDKG library, which generates the device keys.
+TEST(DeviceAuthority, DISABLED_StressAuthorise)
+{
+    if (!isDDKGAvailable())
+    {
+        return;
+    }
+
+    StubKeyScaler keyscaler(20);
+    ASSERT_TRUE(keyscaler.start());
+    DAHttpClient::init();
+    DeviceAuthorityBase *p_da = DeviceAuthority::getInstanceForApp("stress@example.com", keyscaler.url(), "stress", "");
+    ASSERT_TRUE(p_da != nullptr);
+
+    const int iterations_per_thread = 20;
+    for (size_t threads : {1, 2, 4, 8})
+    {
+        unsigned int failures = 0;
+        const double rate = authoriseConcurrently(p_da, threads, iterations_per_thread, failures);
+        ASSERT_EQ(0u, failures);
+        printf("%lu callers: %8.1f authorisations per second\n", (unsigned long)threads, rate);
+    }
+    printf("%u requests served\n", keyscaler.requests());
+
+    keyscaler.stop();
+    DAHttpClient::terminate();
+}
+
+// Authorisations within the lifetime given by the server reuse the first one, run with --gtest_also_run_disabled_tests.
+// Needs the DDKG library, which generates the device keys.
+TEST(DeviceAuthority, DISABLED_ReuseSession)
+{
+    if (!isDDKGAvailable())
+    {
+        return;
+    }
+
+    StubKeyScaler keyscaler(20, 60);
+    ASSERT_TRUE(keyscaler.start());
+    DAHttpClient::init();
+    DeviceAuthorityBase *p_da = DeviceAuthority::getInstanceForApp("session@example.com", keyscaler.url(), "session", "");
+    ASSERT_TRUE(p_da != nullptr);
+
+    const int iterations_per_thread = 20;
+    for (size_t threads : {1, 8})
+    {
+        p_da->invalidateSession();
+        const unsigned int requests = keyscaler.requests();
+        unsigned int failures = 0;
+        const double rate = authoriseConcurrently(p_da, threads, iterations_per_thread, failures);
+        ASSERT_EQ(0u, failures);
+        // Callers that start before the first authorisation completes each ask for a challenge
+        ASSERT_LE(keyscaler.requests() - requests, threads);
+        printf("%lu callers: %8.1f authorisations per second, %u challenges\n", (unsigned long)threads, rate, keyscaler.requests() - requests);
+    }
+
+    keyscaler.stop();
+    DAHttpClient::terminate();
+}
+#endif // #if !defined(WIN32)
+
+#endif // #ifndef DEVICEAUTHORITY_UNITTEST_HPP
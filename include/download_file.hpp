@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Destination file for downloads, hashing the content as it is received
+ */
+#ifndef DOWNLOAD_FILE_HPP
+#define DOWNLOAD_FILE_HPP
+
+#include <stdint.h>
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <openssl/evp.h>
+
+/**
+ * @brief Writes a download to a file through a large buffer and computes its SHA-256 digest as the bytes
+ * arrive, so that the content never has to be read back from disk to be verified.
+ *
+ * @details The file is written through stream(), which is passed to the HTTP client. After a failed transfer
+ * commit() leaves exactly size() bytes in the file, from which the download can be resumed; restart()
+ * discards them when the server can not resume.
+ */
+class DownloadFile : public std::streambuf
+{
+public:
+    /**
+     * @brief Constructor - creates or truncates the file
+     *
+     * @param path The path of the file to write
+     * @throws std::runtime_error if the file can not be opened
+     */
+    explicit DownloadFile(const std::string &path);
+
+    /// @brief Destructor - closes the file, anything not committed is lost
+    ~DownloadFile();
+
+    /// @brief Get the stream writing to the file
+    std::ostream &stream();
+
+    /// @brief Get the number of bytes received so far
+    uint64_t size() const;
+
+    /**
+     * @brief Write the buffered bytes to the file and reset the stream state for another transfer
+     *
+     * @return True if all the bytes received have been written, false on a write error
+     */
+    bool commit();
+
+    /**
+     * @brief Discard the content received so far, to download again from the start
+     *
+     * @throws std::runtime_error if the file can not be reopened
+     */
+    void restart();
+
+    /**
+     * @brief Complete the download and close the file
+     *
+     * @return The SHA-256 digest of the content, as a lower case hex string
+     * @throws std::runtime_error if the file can not be written
+     */
+    const std::string finish();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *p_data, std::streamsize size) override;
+    int sync() override;
+
+private:
+    /// @brief The size of the buffer between the transfer and the file
+    static const size_t BUFFER_SIZE = 1024 * 1024;
+
+    const std::string m_path;
+    FILE *mp_file;
+    EVP_MD_CTX *mp_digest_ctx;
+    std::vector<char> m_buffer;
+    /// @brief The end of the bytes in the buffer that have been added to the digest
+    char *mp_digested;
+    /// @brief The number of bytes written to the file
+    uint64_t m_written;
+    bool m_write_failed;
+    std::ostream m_stream;
+
+    void openFile();
+    void resetDigest();
+    void resetBuffer();
+    void digestBuffered();
+    bool writeBuffer();
+
+    DownloadFile(const DownloadFile &);
+    DownloadFile &operator=(const DownloadFile &);
+};
+
+#endif // #ifndef DOWNLOAD_FILE_HPP
@@ -0,0 +1,153 @@
+/**
+ * \file
+ *
+ * \brief Unit test download file and resumed downloads
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef DOWNLOAD_FILE_UNITTEST_HPP
+#define DOWNLOAD_FILE_UNITTEST_HPP
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "gtest/gtest.h"
+#include "dahttpclient_base.hpp"
+#include "download_file.hpp"
+#include "http_asset_messenger.hpp"
+
+namespace
+{
+    const char *const DOWNLOAD_TEST_FILE = "download_file_test.bin";
+
+    // SHA-256 of "abc"
+    const char *const ABC_SHA256 = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+
+    const std::string readDownloadTestFile()
+    {
+        std::ifstream ifs(DOWNLOAD_TEST_FILE, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    /// @brief HTTP client whose first transfer is interrupted half way through the content
+    class InterruptedHttpClient : public DAHttpClientBase
+    {
+    public:
+        InterruptedHttpClient(const std::string &content, bool supports_range)
+            : m_content(content), m_supports_range(supports_range), m_requests(0)
+        {
+        }
+
+        DAErrorCode sendRequest(int req_type, const std::string &url, std::string &response, const std::string &post) override
+        {
+            return ERR_UNKNOWN;
+        }
+
+        DAErrorCode sendRequest(int req_type, const std::string &url, std::ostream *p_out_stream, std::istream *p_in_stream = nullptr) override
+        {
+            return ERR_UNKNOWN;
+        }
+
+        DAErrorCode download(const std::string &url, std::ostream *p_out_stream, uint64_t resume_from, const DAHttp::ProgressCallback &progress) override
+        {
+            if (++m_requests == 1)
+            {
+                p_out_stream->write(m_content.data(), m_content.size() / 2);
+                return ERR_CURL;
+            }
+            if (resume_from > 0 && !m_supports_range)
+            {
+                return ERR_RANGE;
+            }
+            p_out_stream->write(m_content.data() + resume_from, m_content.size() - resume_from);
+            progress(m_content.size(), m_content.size());
+            return ERR_OK;
+        }
+
+        const std::string m_content;
+        const bool m_supports_range;
+        int m_requests;
+    };
+} // namespace
+
+TEST(DownloadFile, WriteInBlocks_ExpectContentAndDigest)
+{
+    {
+        DownloadFile file(DOWNLOAD_TEST_FILE);
+        file.stream().write("a", 1);
+        file.stream().put('b');
+        file.stream().write("c", 1);
+        ASSERT_EQ(3u, file.size());
+        ASSERT_EQ(ABC_SHA256, file.finish());
+    }
+    ASSERT_EQ("abc", readDownloadTestFile());
+    std::remove(DOWNLOAD_TEST_FILE);
+}
+
+TEST(DownloadFile, WriteBlockLargerThanBuffer_ExpectContentInOrder)
+{
+    const std::string small_block(1000, 'x');
+    const std::string large_block(3 * 1024 * 1024, 'y');
+    {
+        DownloadFile file(DOWNLOAD_TEST_FILE);
+        file.stream().write(small_block.data(), small_block.size());
+        file.stream().write(large_block.data(), large_block.size());
+        file.stream().write(small_block.data(), small_block.size());
+        ASSERT_TRUE(file.stream().good());
+        file.finish();
+    }
+    ASSERT_EQ(small_block + large_block + small_block, readDownloadTestFile());
+    std::remove(DOWNLOAD_TEST_FILE);
+}
+
+TEST(DownloadFile, Restart_ExpectPreviousContentDiscarded)
+{
+    {
+        DownloadFile file(DOWNLOAD_TEST_FILE);
+        file.stream().write("discarded", 9);
+        ASSERT_TRUE(file.commit());
+        file.restart();
+        ASSERT_EQ(0u, file.size());
+        file.stream().write("abc", 3);
+        ASSERT_EQ(ABC_SHA256, file.finish());
+    }
+    ASSERT_EQ("abc", readDownloadTestFile());
+    std::remove(DOWNLOAD_TEST_FILE);
+}
+
+TEST(DownloadFile, FetchFileInterrupted_ExpectResumed)
+{
+    const std::string content = "0123456789abcdefghijklmnopqrstuvwxyz";
+    InterruptedHttpClient http_client(content, true);
+    HttpAssetMessenger messenger("test url", &http_client);
+
+    std::string sha256;
+    ASSERT_TRUE(messenger.fetchFile("test url/file", DOWNLOAD_TEST_FILE, sha256));
+    ASSERT_EQ(2, http_client.m_requests);
+    ASSERT_EQ(content, readDownloadTestFile());
+    ASSERT_EQ(64u, sha256.size());
+    std::remove(DOWNLOAD_TEST_FILE);
+}
+
+TEST(DownloadFile, FetchFileInterruptedWithoutRangeSupport_ExpectRestarted)
+{
+    const std::string content = "0123456789abcdefghijklmnopqrstuvwxyz";
+    InterruptedHttpClient http_client(content, false);
+    HttpAssetMessenger messenger("test url", &http_client);
+
+    std::string sha256;
+    ASSERT_TRUE(messenger.fetchFile("test url/file", DOWNLOAD_TEST_FILE, sha256));
+    ASSERT_EQ(3, http_client.m_requests);
+    ASSERT_EQ(content, readDownloadTestFile());
+    std::remove(DOWNLOAD_TEST_FILE);
+}
+
+#endif // #ifndef DOWNLOAD_FILE_UNITTEST_HPP
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Bounded queue and thread delivering event notifications to one event library
+ */
+#ifndef EVENT_DISPATCHER_HPP
+#define EVENT_DISPATCHER_HPP
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Delivers event notifications to one event library on its own thread, so that a slow library
+ * stalls neither the thread raising the event nor the other libraries.
+ *
+ * @details post() only queues the event. The queue holds at most the capacity given to the constructor:
+ * a heartbeat is coalesced with one already waiting, and when the queue is full the oldest waiting
+ * heartbeat makes room, otherwise the new event is dropped. stop() delivers whatever is still queued
+ * before the thread ends, so that a shutdown notification raised just before it is not lost.
+ */
+class EventDispatcher
+{
+public:
+    /// @brief Delivers one notification to the library, returning true if the library accepted it
+    typedef std::function<bool(const char *event_type, const char *notification_type, const std::string &context)> Deliver;
+
+    /// @brief Counters of the events passed through the dispatcher
+    struct Statistics
+    {
+        uint64_t queued;
+        uint64_t delivered;
+        /// @brief Events delivered that the library did not accept
+        uint64_t failed;
+        uint64_t dropped;
+        /// @brief Events merged into one already queued
+        uint64_t coalesced;
+        /// @brief Time from post() until the library returned, summed over the delivered events
+        uint64_t total_latency_us;
+        uint64_t max_latency_us;
+    };
+
+    /**
+     * @brief Constructor - starts the dispatch thread
+     *
+     * @param name The name of the library, used in log messages
+     * @param deliver Called on the dispatch thread for each event
+     * @param capacity The most events that may wait in the queue, at least 1
+     */
+    EventDispatcher(const std::string &name, const Deliver &deliver, size_t capacity);
+
+    /// @brief Destructor - stops the dispatch thread, delivering the queued events first
+    ~EventDispatcher();
+
+    /**
+     * @brief Queue an event for delivery
+     *
+     * @param event_type The event type, which must be a literal as only the pointer is queued
+     * @param notification_type The notification type, which must be a literal
+     * @param p_context The context delivered with the event, copied into the queue
+     * @param context_size The length of the context
+     * @return True if the event was queued or coalesced, false if it was dropped
+     */
+    bool post(const char *event_type, const char *notification_type, const char *p_context, size_t context_size);
+
+    /// @brief Deliver the queued events, then stop the dispatch thread. Later events are dropped.
+    void stop();
+
+    /// @brief Get the counters so far
+    Statistics statistics() const;
+
+    const std::string &name() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Event
+    {
+        const char *event_type;
+        const char *notification_type;
+        std::string context;
+        Clock::time_point posted;
+    };
+
+    const std::string m_name;
+    const Deliver m_deliver;
+    const size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Event> m_queue;
+    Statistics m_statistics;
+    bool m_stopping;
+    /// @brief Set while the queue is overflowing, so that a burst of dropped events is logged once
+    bool m_dropping;
+    std::thread m_thread;
+
+    /// @brief Whether an event is frequent and carries no information beyond the latest one
+    static bool isCoalescable(const char *event_type);
+
+    /// @brief Make room in a full queue by dropping the oldest coalescable event, with the lock held
+    bool evictCoalescable();
+
+    void run();
+
+    EventDispatcher(const EventDispatcher &);
+    EventDispatcher &operator=(const EventDispatcher &);
+};
+
+#endif // #ifndef EVENT_DISPATCHER_HPP
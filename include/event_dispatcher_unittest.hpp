@@ -0,0 +1,183 @@
+/**
+ * \file
+ *
+ * \brief Unit test of the asynchronous event notification dispatch
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef EVENT_DISPATCHER_UNITTEST_HPP
+#define EVENT_DISPATCHER_UNITTEST_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "event_dispatcher.hpp"
+#include "steady_timer.hpp"
+
+namespace
+{
+    /// @brief Event library that records the events delivered, and can be held up to fill the queue
+    class BlockingEventLibrary
+    {
+    public:
+        BlockingEventLibrary() : m_blocked(false), m_delivering(0)
+        {
+        }
+
+        EventDispatcher::Deliver deliver()
+        {
+            return [this](const char *event_type, const char *notification_type, const std::string &context)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_delivering++;
+                m_changed.notify_all();
+                m_changed.wait(lock, [this]() { return !m_blocked; });
+                m_events.push_back(std::string(event_type) + "/" + notification_type + "/" + context);
+                return true;
+            };
+        }
+
+        void block()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_blocked = true;
+        }
+
+        void release()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_blocked = false;
+            m_changed.notify_all();
+        }
+
+        /// @brief Wait until the library has been called the given number of times
+        void waitForDelivery(size_t count)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this, count]() { return m_delivering >= count; });
+        }
+
+        const std::vector<std::string> events()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_events;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        bool m_blocked;
+        size_t m_delivering;
+        std::vector<std::string> m_events;
+    };
+} // namespace
+
+TEST(EventDispatcher, Post_ExpectDeliveredInOrder)
+{
+    BlockingEventLibrary library;
+    EventDispatcher dispatcher("test", library.deliver(), 8);
+    ASSERT_TRUE(dispatcher.post("Registration", "InProgress", "{}", 2));
+    ASSERT_TRUE(dispatcher.post("Registration", "Success", "{}", 2));
+    dispatcher.stop();
+
+    const std::vector<std::string> events = library.events();
+    ASSERT_EQ(2u, events.size());
+    ASSERT_EQ("Registration/InProgress/{}", events[0]);
+    ASSERT_EQ("Registration/Success/{}", events[1]);
+
+    const EventDispatcher::Statistics stats = dispatcher.statistics();
+    ASSERT_EQ(2u, stats.queued);
+    ASSERT_EQ(2u, stats.delivered);
+    ASSERT_EQ(0u, stats.dropped);
+    ASSERT_FALSE(dispatcher.post("Shutdown", "Info", "{}", 2));
+}
+
+TEST(EventDispatcher, SlowLibrary_ExpectPostDoesNotWait)
+{
+    BlockingEventLibrary library;
+    library.block();
+    EventDispatcher dispatcher("test", library.deliver(), 8);
+    ASSERT_TRUE(dispatcher.post("Startup", "Info", "{}", 2));
+    library.waitForDelivery(1);
+
+    steady_timer timer;
+    ASSERT_TRUE(dispatcher.post("Certificate", "Received", "{}", 2));
+    ASSERT_LT(timer.get_elapsed_time_in_millseconds(), 100);
+
+    library.release();
+    dispatcher.stop();
+    ASSERT_EQ(2u, library.events().size());
+}
+
+TEST(EventDispatcher, Heartbeats_ExpectCoalesced)
+{
+    BlockingEventLibrary library;
+    library.block();
+    EventDispatcher dispatcher("test", library.deliver(), 8);
+    ASSERT_TRUE(dispatcher.post("Startup", "Info", "{}", 2));
+    library.waitForDelivery(1);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        ASSERT_TRUE(dispatcher.post("Heartbeat", "Info", "{}", 2));
+    }
+    library.release();
+    dispatcher.stop();
+
+    ASSERT_EQ(2u, library.events().size());
+    ASSERT_EQ(4u, dispatcher.statistics().coalesced);
+}
+
+TEST(EventDispatcher, QueueFull_ExpectHeartbeatDroppedBeforeOtherEvents)
+{
+    BlockingEventLibrary library;
+    library.block();
+    EventDispatcher dispatcher("test", library.deliver(), 2);
+    ASSERT_TRUE(dispatcher.post("Startup", "Info", "{}", 2));
+    library.waitForDelivery(1);
+
+    ASSERT_TRUE(dispatcher.post("Heartbeat", "Info", "{}", 2));
+    ASSERT_TRUE(dispatcher.post("CertificateSigningRequest", "Created", "{}", 2));
+    // The waiting heartbeat makes room
+    ASSERT_TRUE(dispatcher.post("CertificateSigningRequest", "Delivered", "{}", 2));
+    // Nothing left to make room with
+    ASSERT_FALSE(dispatcher.post("Certificate", "Received", "{}", 2));
+    ASSERT_FALSE(dispatcher.post("Heartbeat", "Info", "{}", 2));
+    library.release();
+    dispatcher.stop();
+
+    const std::vector<std::string> events = library.events();
+    ASSERT_EQ(3u, events.size());
+    ASSERT_EQ("CertificateSigningRequest/Created/{}", events[1]);
+    ASSERT_EQ("CertificateSigningRequest/Delivered/{}", events[2]);
+    ASSERT_EQ(3u, dispatcher.statistics().dropped);
+}
+
+TEST(EventDispatcher, Stop_ExpectQueuedEventsDelivered)
+{
+    BlockingEventLibrary library;
+    EventDispatcher dispatcher("test", library.deliver(), 64);
+    for (int i = 0; i < 50; ++i)
+    {
+        ASSERT_TRUE(dispatcher.post("SecureAssetTransfer", "Received", "{}", 2));
+    }
+    ASSERT_TRUE(dispatcher.post("Shutdown", "Info", "{}", 2));
+    dispatcher.stop();
+
+    const std::vector<std::string> events = library.events();
+    ASSERT_EQ(51u, events.size());
+    ASSERT_EQ("Shutdown/Info/{}", events.back());
+    ASSERT_GE(dispatcher.statistics().max_latency_us, dispatcher.statistics().total_latency_us / 51);
+}
+
+#endif // #ifndef EVENT_DISPATCHER_UNITTEST_HPP
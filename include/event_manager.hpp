@@ -26,10 +26,14 @@
 #include <dlfcn.h>
 #endif // # ifdef _WIN32
 
+#include <atomic>
+#include <cstring>
+#include <initializer_list>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
+#include "event_dispatcher.hpp"
 #include "event_manager_base.hpp"
 #include "eventlib_api.h"
 #include "log.hpp"
@@ -120,15 +124,15 @@ class EventLib
     /// @param context The associated context data to be delivered with the event
     /// @return True if successfully sent notification or no event library 
     /// loaded, false if failure to notify
-    bool notify(const std::string &event_type, const std::string &notification_type, const std::string &context)
+    bool notify(const char *event_type, const char *notification_type, const std::string &context)
     {
         if (mp_eventlib_notify)
         {
             return mp_eventlib_notify(
-                event_type.c_str(), 
-                event_type.length(), 
-                notification_type.c_str(), 
-                notification_type.length(), 
+                event_type, 
+                std::strlen(event_type), 
+                notification_type, 
+                std::strlen(notification_type), 
                 context.c_str(), 
                 context.length()) == 1;
         }
@@ -302,43 +306,52 @@ class EventManager
     
     bool notifyGroupMetadataFailure(const std::string &error) override;
 
+    protected:
+    /// @brief Constructor
+    EventManager();
+
+    /// @brief Destructor
+    virtual ~EventManager();
+
+    /// @brief Starts delivering the notifications to an event library
+    /// @param event_library_name The name of the library
+    /// @param deliver Called on the dispatch thread of the library for each notification
+    /// @param queue_size The most notifications that may wait for the library
+    void addDispatcher(const std::string &event_library_name, const EventDispatcher::Deliver &deliver, size_t queue_size);
+
     private:
+    /// @brief An attribute of the context of a notification, referencing the caller's strings
+    struct Attribute
+    {
+        const char *key;
+        const std::string &value;
+    };
+
     /// @brief Singleton instance of EventManager
     static EventManagerBase* mp_instance;
 
     /// @brief Vector containing the pointers to the loaded event libraries
     std::map<const std::string, std::unique_ptr<EventLib>> m_event_libs;
 
+    /// @brief The queue and thread delivering the notifications to each of the loaded event libraries
+    std::map<const std::string, std::unique_ptr<EventDispatcher>> m_dispatchers;
+
+    /// @brief Whether there is any library to notify, read without the lock by every notification
+    std::atomic<bool> m_has_dispatchers;
+
 #if defined(USETHREADING)
     /// @brief Manages access to the event library container
     pthread_mutex_t m_event_libs_mutex;
 #endif // #if defined(USETHREADING)
 
-    /// @brief Constructor
-    EventManager();
-
-    /// @brief Destructor
-    virtual ~EventManager();
-
-    /// @brief Raises an event notification with the external event library
-    /// @param event_type The event type string
-    /// @param notification_type The notification type string
-    /// @param context The associated context data to be delivered with the event
-    /// @return True if successfully sent notification or no event library 
-    /// loaded, false if failure to notify
-    bool notify(const std::string &event_type, const std::string &notification_type, const std::string &context = "{}");
-
-    /// @brief Creates a JSON string containing up to two attributes
-    /// @param key1 The first attribute key
-    /// @param value1 The first value
-    /// @param key2 The second attribute key
-    /// @param value2 The second value
-    /// @param key3 The third attribute key
-    /// @param value3 The third value
-    /// @param key4 The forth attribute key
-    /// @param value4 The forth value
-    /// @return The JSON object as a string
-    static const std::string createJsonString(const std::string &key1, const std::string &value1, const std::string &key2 = "", const std::string &value2 = "", const std::string &key3 = "", const std::string &value3 = "", const std::string& key4 = "", const std::string& value4 = "");
+    /// @brief Queues an event notification for each of the external event libraries
+    /// @param event_type The event type string, which must be a literal
+    /// @param notification_type The notification type string, which must be a literal
+    /// @param attributes The attributes of the context delivered with the event, those with
+    /// an empty value are left out. The context is only built when a library is loaded.
+    /// @return True if queued for every library or no event library
+    /// loaded, false if dropped by a full queue
+    bool notify(const char *event_type, const char *notification_type, std::initializer_list<Attribute> attributes = {});
 };
 
 #endif // #ifndef EVENT_MANAGER_H
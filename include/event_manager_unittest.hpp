@@ -0,0 +1,121 @@
+/**
+ * \file
+ *
+ * \brief Unit test and benchmark of the event notification path
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef EVENT_MANAGER_UNITTEST_HPP
+#define EVENT_MANAGER_UNITTEST_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "event_manager.hpp"
+
+namespace
+{
+    /// @brief Event manager notifying libraries that record the last context delivered instead of loaded ones
+    class RecordingEventManager : public EventManager
+    {
+    public:
+        ~RecordingEventManager()
+        {
+            teardown();
+        }
+
+        void addLibraries(size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                addDispatcher("library" + std::to_string(i), [this](const char *, const char *, const std::string &context)
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_context = context;
+                    return true;
+                }, 1024 * 1024);
+            }
+        }
+
+        const std::string context()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_context;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::string m_context;
+    };
+} // namespace
+
+TEST(EventManager, NoLibraries_ExpectNotifySucceeds)
+{
+    RecordingEventManager manager;
+    ASSERT_TRUE(manager.notifyHeartbeat());
+    ASSERT_TRUE(manager.notifyCertificateStored("CN=device", "/tmp", "provider", true));
+}
+
+TEST(EventManager, Context_ExpectEscapedJsonWithoutEmptyValues)
+{
+    RecordingEventManager manager;
+    manager.addLibraries(1);
+    ASSERT_TRUE(manager.notifyCertificateStored("CN=\"device\"\n", "", "a\\b\x01", false));
+    manager.teardown();
+    ASSERT_EQ("{\"subject_name\":\"CN=\\\"device\\\"\\n\",\"provider\":\"a\\\\b\\u0001\",\"encrypted\":\"false\"}", manager.context());
+}
+
+TEST(EventManager, NoAttributes_ExpectEmptyObject)
+{
+    RecordingEventManager manager;
+    manager.addLibraries(1);
+    ASSERT_TRUE(manager.notifyRegistrationFailure(""));
+    manager.teardown();
+    ASSERT_EQ("{}", manager.context());
+}
+
+TEST(EventManager, LongContext_ExpectComplete)
+{
+    RecordingEventManager manager;
+    manager.addLibraries(1);
+    const std::string error(2000, 'e');
+    ASSERT_TRUE(manager.notifyAPMFailure(error));
+    manager.teardown();
+    ASSERT_EQ("{\"error\":\"" + error + "\"}", manager.context());
+}
+
+// Cost of a notification to the caller, run with --gtest_also_run_disabled_tests
+TEST(EventManager, DISABLED_BenchmarkNotify)
+{
+    const int iterations = 200000;
+    const std::string subject_name = "CN=device.example.com";
+    const std::string location = "/etc/ssl/certs/device.pem";
+    const std::string provider = "default";
+
+    for (size_t libraries : {0, 1, 4})
+    {
+        RecordingEventManager manager;
+        manager.addLibraries(libraries);
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            manager.notifyCertificateStored(subject_name, location, provider, true);
+        }
+        const int64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%lu libraries: %8.1f ns per notification\n", (unsigned long)libraries, (double)elapsed_ns / iterations);
+    }
+}
+
+#endif // #ifndef EVENT_MANAGER_UNITTEST_HPP
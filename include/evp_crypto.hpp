@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Streaming AES and SHA-256 through the OpenSSL EVP interface, for bulk payloads
+ */
+#ifndef EVP_CRYPTO_HPP
+#define EVP_CRYPTO_HPP
+
+#include <stddef.h>
+#include <string>
+#include <openssl/evp.h>
+#include "deviceauthority_base.hpp"
+
+namespace evp_crypto
+{
+
+/// @brief The AES block size, also the largest amount of padding added to an encrypted payload
+const size_t AES_BLOCK_BYTES = 16;
+
+/// @brief The AES-256 key size, the only one AesCfbCipher takes
+const size_t AES_KEY_BYTES = 32;
+
+/// @brief Get whether a payload is large enough to be processed here instead of by the DDKG, from BULK_CRYPTO_MIN_BYTES
+bool isBulkPayload(size_t size);
+
+/// @brief Get whether a payload is ciphered here instead of by the DDKG. Smaller payloads, and keys or IVs of other
+/// sizes than AesCfbCipher takes, are left to the DDKG.
+bool isBulkCipher(size_t size, size_t key_size, size_t iv_size);
+
+/**
+ * @brief AES-256-CFB128 cipher with PKCS#7 padding, producing the same output as the DDKG
+ * naudaddk_docipher_aes_cfb128 but using the AES instructions of the CPU when available.
+ *
+ * @details The payload is passed through update() in as many blocks as the caller likes, then final().
+ * When decrypting, the last block of plaintext is held back until final() so that the padding can be
+ * removed.
+ */
+class AesCfbCipher
+{
+public:
+    AesCfbCipher();
+    ~AesCfbCipher();
+
+    /**
+     * @brief Start a new payload
+     *
+     * @param key The 32 byte key
+     * @param key_size The size of the key
+     * @param iv The 16 byte IV
+     * @param iv_size The size of the IV
+     * @param mode Whether to encrypt or decrypt
+     * @return True on success, false if the key or IV has the wrong size
+     */
+    bool init(const char *key, size_t key_size, const char *iv, size_t iv_size, CipherMode mode);
+
+    /**
+     * @brief Process the next block of the payload
+     *
+     * @param p_in The input
+     * @param size The number of bytes of input
+     * @param p_out Receives the output, must have room for size + AES_BLOCK_BYTES bytes
+     * @return The number of bytes written to p_out, or -1 on failure
+     */
+    long update(const unsigned char *p_in, size_t size, unsigned char *p_out);
+
+    /**
+     * @brief Complete the payload
+     *
+     * @param p_out Receives the remaining output, must have room for AES_BLOCK_BYTES bytes
+     * @return The number of bytes written to p_out, or -1 on failure or bad padding
+     */
+    long final(unsigned char *p_out);
+
+private:
+    EVP_CIPHER_CTX *mp_ctx;
+    CipherMode m_mode;
+    /// @brief Number of bytes processed since init, used to work out the padding
+    size_t m_processed;
+    /// @brief Plaintext held back while decrypting, as it may be padding
+    unsigned char m_tail[AES_BLOCK_BYTES];
+    size_t m_tail_size;
+
+    AesCfbCipher(const AesCfbCipher &);
+    AesCfbCipher &operator=(const AesCfbCipher &);
+};
+
+/// @brief Incremental SHA-256 digest
+class Sha256Digest
+{
+public:
+    Sha256Digest();
+    ~Sha256Digest();
+
+    /// @brief Start a new digest
+    bool init();
+
+    /// @brief Add the next block of data to the digest
+    bool update(const void *p_data, size_t size);
+
+    /**
+     * @brief Complete the digest
+     *
+     * @param digest Receives the raw 32 byte digest
+     * @return True on success
+     */
+    bool final(std::string &digest);
+
+private:
+    EVP_MD_CTX *mp_ctx;
+
+    Sha256Digest(const Sha256Digest &);
+    Sha256Digest &operator=(const Sha256Digest &);
+};
+
+/**
+ * @brief Encrypt or decrypt a whole payload with AesCfbCipher
+ *
+ * @param output Receives the output
+ * @return True on success
+ */
+bool cipherAES(const char *key, size_t key_size, const char *iv, size_t iv_size, const char *p_input, size_t input_size, CipherMode mode, std::string &output);
+
+/// @brief Get the raw SHA-256 digest of a buffer, empty on failure
+const std::string digestSHA256(const char *p_data, size_t size);
+
+/**
+ * @brief Get the raw SHA-256 digest of a file, reading it in blocks
+ *
+ * @param path The file to digest
+ * @param digest Receives the digest
+ * @param p_size If set, receives the number of bytes read from the file
+ * @return True on success, false if the file can not be read
+ */
+bool digestFileSHA256(const std::string &path, std::string &digest, size_t *p_size = nullptr);
+
+} // namespace evp_crypto
+
+#endif // #ifndef EVP_CRYPTO_HPP
@@ -0,0 +1,159 @@
+/**
+ * \file
+ *
+ * \brief Unit test and benchmark of the EVP bulk crypto path
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef EVP_CRYPTO_UNITTEST_HPP
+#define EVP_CRYPTO_UNITTEST_HPP
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "deviceauthority.hpp"
+#include "evp_crypto.hpp"
+#include "log.hpp"
+#include "steady_timer.hpp"
+#include "test_deviceauthority.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    const std::string EVP_TEST_KEY = "01234567890123456789012345678901";
+    const std::string EVP_TEST_IV = "0123456789ABCDEF";
+
+    const std::string makeEvpTestPayload(size_t size)
+    {
+        std::string payload(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            payload[i] = (char)(i * 31 + 7);
+        }
+        return payload;
+    }
+
+    /// @brief Run a crypto operation over the payload until at least min_bytes are processed, returning MB/s
+    template <typename Op>
+    double evpBenchmarkThroughput(const std::string &payload, size_t min_bytes, Op op)
+    {
+        const size_t iterations = payload.size() >= min_bytes ? 1 : min_bytes / payload.size();
+        steady_timer timer;
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            op(payload);
+        }
+        const int64_t elapsed_ms = timer.get_elapsed_time_in_millseconds();
+        return (double)(payload.size() * iterations) / (1024.0 * 1024.0) * 1000.0 / (double)(elapsed_ms > 0 ? elapsed_ms : 1);
+    }
+} // namespace
+
+TEST(EvpCrypto, EncryptKnownVector_ExpectSameAsDdkg)
+{
+    // Output of naudaddk_docipher_aes_cfb128 for this key, IV and plaintext
+    std::string output;
+    ASSERT_TRUE(evp_crypto::cipherAES(EVP_TEST_KEY.c_str(), EVP_TEST_KEY.size(), EVP_TEST_IV.c_str(), EVP_TEST_IV.size(),
+                                      "THIS IS INPUT DATA", 18, CipherModeEncrypt, output));
+    ASSERT_EQ("s63m9IopRzje81P3w9TepMgmIEP8E1oRSofEwEo2Zng=", utils::toBase64(output));
+}
+
+TEST(EvpCrypto, DecryptInBlocks_ExpectPlaintextWithoutPadding)
+{
+    for (size_t size : {0, 1, 15, 16, 17, 1000})
+    {
+        const std::string plaintext = makeEvpTestPayload(size);
+        std::string ciphertext;
+        ASSERT_TRUE(evp_crypto::cipherAES(EVP_TEST_KEY.c_str(), EVP_TEST_KEY.size(), EVP_TEST_IV.c_str(), EVP_TEST_IV.size(),
+                                          plaintext.c_str(), plaintext.size(), CipherModeEncrypt, ciphertext));
+        ASSERT_EQ((size / evp_crypto::AES_BLOCK_BYTES + 1) * evp_crypto::AES_BLOCK_BYTES, ciphertext.size());
+
+        // Decrypt 7 bytes at a time so that the held back padding straddles the blocks
+        evp_crypto::AesCfbCipher cipher;
+        ASSERT_TRUE(cipher.init(EVP_TEST_KEY.c_str(), EVP_TEST_KEY.size(), EVP_TEST_IV.c_str(), EVP_TEST_IV.size(), CipherModeDecrypt));
+        std::string decrypted;
+        std::vector<unsigned char> out(7 + evp_crypto::AES_BLOCK_BYTES);
+        for (size_t offset = 0; offset < ciphertext.size(); offset += 7)
+        {
+            const size_t block = std::min((size_t)7, ciphertext.size() - offset);
+            const long n = cipher.update((const unsigned char *)ciphertext.c_str() + offset, block, &out[0]);
+            ASSERT_GE(n, 0);
+            decrypted.append((const char *)&out[0], n);
+        }
+        const long n = cipher.final(&out[0]);
+        ASSERT_GE(n, 0);
+        decrypted.append((const char *)&out[0], n);
+        ASSERT_EQ(plaintext, decrypted);
+    }
+}
+
+TEST(EvpCrypto, DecryptBadPadding_ExpectFailure)
+{
+    std::string ciphertext;
+    ASSERT_TRUE(evp_crypto::cipherAES(EVP_TEST_KEY.c_str(), EVP_TEST_KEY.size(), EVP_TEST_IV.c_str(), EVP_TEST_IV.size(),
+                                      "THIS IS INPUT DATA", 18, CipherModeEncrypt, ciphertext));
+    ciphertext[ciphertext.size() - 1] ^= 0x5a;
+    std::string output;
+    ASSERT_FALSE(evp_crypto::cipherAES(EVP_TEST_KEY.c_str(), EVP_TEST_KEY.size(), EVP_TEST_IV.c_str(), EVP_TEST_IV.size(),
+                                       ciphertext.c_str(), ciphertext.size(), CipherModeDecrypt, output));
+}
+
+TEST(EvpCrypto, DigestFile_ExpectSameAsBuffer)
+{
+    const std::string payload = makeEvpTestPayload(200 * 1024);
+    const char *const path = "evp_crypto_test.bin";
+    {
+        std::ofstream ofs(path, std::ofstream::binary);
+        ofs.write(payload.c_str(), payload.size());
+    }
+
+    std::string file_digest;
+    ASSERT_TRUE(evp_crypto::digestFileSHA256(path, file_digest));
+    ASSERT_EQ(evp_crypto::digestSHA256(payload.c_str(), payload.size()), file_digest);
+    ASSERT_EQ(32u, file_digest.size());
+    std::remove(path);
+}
+
+// Throughput of the DDKG and EVP paths, run with --gtest_also_run_disabled_tests
+TEST(EvpCrypto, DISABLED_BenchmarkAgainstDdkg)
+{
+    TestDeviceAuthority ddkg;
+    const size_t min_bytes = 200 * 1024 * 1024;
+
+    for (size_t size : {(size_t)1024, (size_t)1024 * 1024, (size_t)100 * 1024 * 1024})
+    {
+        const std::string payload = makeEvpTestPayload(size);
+
+        const double ddkg_aes = evpBenchmarkThroughput(payload, min_bytes, [&ddkg](const std::string &p)
+        {
+            ddkg.doCipherAES(EVP_TEST_KEY, EVP_TEST_IV, p, CipherModeEncrypt);
+        });
+        const double evp_aes = evpBenchmarkThroughput(payload, min_bytes, [](const std::string &p)
+        {
+            std::string out;
+            evp_crypto::cipherAES(EVP_TEST_KEY.c_str(), EVP_TEST_KEY.size(), EVP_TEST_IV.c_str(), EVP_TEST_IV.size(),
+                                  p.c_str(), p.size(), CipherModeEncrypt, out);
+        });
+        const double ddkg_sha = evpBenchmarkThroughput(payload, min_bytes, [&ddkg](const std::string &p)
+        {
+            ddkg.doDigestSHA256(p);
+        });
+        const double evp_sha = evpBenchmarkThroughput(payload, min_bytes, [](const std::string &p)
+        {
+            evp_crypto::digestSHA256(p.c_str(), p.size());
+        });
+
+        printf("%9lu bytes: AES DDKG %8.1f MB/s EVP %8.1f MB/s, SHA-256 DDKG %8.1f MB/s EVP %8.1f MB/s\n",
+               (unsigned long)size, ddkg_aes, evp_aes, ddkg_sha, evp_sha);
+    }
+}
+
+#endif // #ifndef EVP_CRYPTO_UNITTEST_HPP
@@ -28,6 +28,14 @@ public:
 
     }
 
+    /// @brief Change the heartbeat interval, after a configuration reload
+    /// @param heartbeat_interval_s The heartbeat interval in seconds
+    void setInterval(int heartbeat_interval_s)
+    {
+        m_heartbeat_interval_ms = heartbeat_interval_s * steady_timer::MILLISECONDS_IN_ONE_SECOND;
+        m_total_elapsed_time = 0;
+    }
+
     /// @brief Periodically called by a worker loop to update the heartbeat interval and
     /// if required, send a heartbeat event notification
     void update()
@@ -49,7 +57,7 @@ public:
 
 private:
     /// @brief The heartbeat interval in milliseconds
-    const int m_heartbeat_interval_ms;
+    int m_heartbeat_interval_ms;
 
     /// @brief Timer that tracks the duration since the last heartbeat
     steady_timer m_update_timer;
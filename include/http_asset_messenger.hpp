@@ -30,7 +30,7 @@ public:
         const std::string &generated_csr,
         std::string &message);
 
-    bool fetchFile(const std::string &apiurl, const std::string &response_file_path);
+    bool fetchFile(const std::string &apiurl, const std::string &response_file_path, std::string &sha256);
 
     bool sendScriptOutput(const std::string &script_id, const std::string &device_specific_topic, const std::string &script_output);
 
@@ -21,8 +21,8 @@ public:
     const std::string m_metadata_file;
     /// @brief Flag indicating if the application is running as a daemon
     const bool m_daemon_mode;
-    /// @brief The requested data poll time in seconds
-    const long m_requested_data_poll_time_s;
+    /// @brief The requested data poll time in seconds, updated by the worker on a reload
+    long m_requested_data_poll_time_s;
 
     /// @brief Default constructor
     /// @param api_url The KeyScaler SAC API URL
@@ -41,6 +41,10 @@ public:
 
     void terminate() override;
 
+protected:
+    void applyConfiguration() override;
+
+public:
     static bool processAssets(AssetManager &asset_manager, const rapidjson::Document &asset_val, const std::string &key, const std::string &iv, const std::string &key_id, AssetMessenger *p_asset_messenger, unsigned int &sleep_period_from_ks);
 };
 
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Reusable memory for parsing the JSON responses from KeyScaler
+ */
+#ifndef JSON_ARENA_HPP
+#define JSON_ARENA_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/**
+ * @brief Parses JSON in place into a document whose values are allocated from a block of memory that is
+ * kept from one parse to the next.
+ *
+ * @details Strings are not copied: the document's strings point into the buffer that was parsed, which is
+ * modified by the parse. The values are allocated from the block, which is cleared rather than freed before
+ * each parse, so a loop that parses a response on every iteration stops allocating for them once the block
+ * is large enough. When a response needs more than the block, the block is grown for the next parse, up to
+ * MAX_CAPACITY. Only rapidjson's parse stack is still allocated per parse.
+ */
+class JsonArena
+{
+public:
+    /// @brief The initial size of the block, enough for a typical polling response
+    static const size_t DEFAULT_CAPACITY = 16 * 1024;
+
+    /// @brief The size the block is not grown beyond, larger responses use extra memory only while parsed
+    static const size_t MAX_CAPACITY = 1024 * 1024;
+
+    /**
+     * @brief Constructor
+     *
+     * @param capacity The initial size of the block in bytes
+     */
+    explicit JsonArena(size_t capacity = DEFAULT_CAPACITY);
+
+    ~JsonArena();
+
+    /**
+     * @brief Parse JSON in place, releasing the document of the previous parse
+     *
+     * @param json [in/out] The JSON, overwritten by the parse. It must not be changed or freed while the document is used.
+     * @return The document, valid until the next parse. It is null if the JSON could not be parsed.
+     */
+    rapidjson::Document &parse(std::string &json);
+
+    /// @brief Get the size of the block in bytes
+    size_t capacity() const;
+
+private:
+    /// @brief The block, as 64-bit words to align the values allocated from it
+    std::vector<uint64_t> m_block;
+    std::unique_ptr<rapidjson::MemoryPoolAllocator<> > mp_allocator;
+    std::unique_ptr<rapidjson::Document> mp_document;
+
+    /// @brief Create the allocator over the block, and the document using it
+    void create();
+
+    JsonArena(const JsonArena &);
+    JsonArena &operator=(const JsonArena &);
+};
+
+#endif // #ifndef JSON_ARENA_HPP
@@ -0,0 +1,89 @@
+/**
+ * \file
+ *
+ * \brief Unit test of parsing JSON in place into reusable memory
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef JSON_ARENA_UNITTEST_HPP
+#define JSON_ARENA_UNITTEST_HPP
+
+#include <string>
+#include "gtest/gtest.h"
+#include "json_arena.hpp"
+
+TEST(JsonArena, Parse_ExpectStringsInBuffer)
+{
+    JsonArena json_arena;
+    std::string json = "{\"statusCode\":0,\"message\":{\"authenticated\":true,\"name\":\"a \\\"quoted\\\" name\"}}";
+
+    const rapidjson::Document &document = json_arena.parse(json);
+    ASSERT_FALSE(document.HasParseError());
+    ASSERT_EQ(0, document["statusCode"].GetInt());
+    ASSERT_TRUE(document["message"]["authenticated"].GetBool());
+
+    const rapidjson::Value &name_val = document["message"]["name"];
+    ASSERT_STREQ("a \"quoted\" name", name_val.GetString());
+    ASSERT_TRUE(name_val.GetString() >= json.c_str() && name_val.GetString() < json.c_str() + json.size());
+}
+
+TEST(JsonArena, Parse_ExpectPreviousDocumentReplaced)
+{
+    JsonArena json_arena;
+    std::string first = "{\"first\":1}";
+    std::string second = "{\"second\":2}";
+
+    json_arena.parse(first);
+    const rapidjson::Document &document = json_arena.parse(second);
+    ASSERT_FALSE(document.HasMember("first"));
+    ASSERT_EQ(2, document["second"].GetInt());
+}
+
+TEST(JsonArena, Parse_ExpectNullDocumentOnError)
+{
+    JsonArena json_arena;
+    std::string good = "{\"statusCode\":0}";
+    std::string bad = "{\"statusCode\":";
+    std::string empty;
+
+    json_arena.parse(good);
+    ASSERT_TRUE(json_arena.parse(bad).HasParseError());
+    ASSERT_TRUE(json_arena.parse(bad).IsNull());
+    ASSERT_TRUE(json_arena.parse(empty).HasParseError());
+    ASSERT_TRUE(json_arena.parse(empty).IsNull());
+}
+
+TEST(JsonArena, Parse_ExpectBlockGrownForLargeResponse)
+{
+    JsonArena json_arena(1024);
+    ASSERT_EQ(1024u, json_arena.capacity());
+
+    std::string json = "[";
+    for (int i = 0; i < 1000; ++i)
+    {
+        json.append(i == 0 ? "" : ",").append("{\"assetId\":\"").append(std::to_string(i)).append("\"}");
+    }
+    json.append("]");
+    std::string copy = json;
+
+    ASSERT_EQ(1000u, json_arena.parse(json).Size());
+    std::string small = "{}";
+    json_arena.parse(small);
+    const size_t grown_capacity = json_arena.capacity();
+    ASSERT_GT(grown_capacity, 1024u);
+    ASSERT_LE(grown_capacity, JsonArena::MAX_CAPACITY);
+
+    // The next response of the same size fits
+    ASSERT_EQ(1000u, json_arena.parse(copy).Size());
+    json_arena.parse(small);
+    ASSERT_EQ(grown_capacity, json_arena.capacity());
+}
+
+#endif // #ifndef JSON_ARENA_UNITTEST_HPP
@@ -11,6 +11,7 @@
 #include <rapidjson/document.h>
 #include <iomanip>
 #include <sstream>
+#include <string>
 
 class JsonUtils
 {
@@ -82,6 +83,22 @@ public:
         }
         return o.str();
     }
+
+    /// @brief Write an object member with a string value through a rapidjson writer, which escapes it
+    template <typename Writer>
+    static void writeMember(Writer &writer, const char *name, const std::string &value)
+    {
+        writer.Key(name);
+        writer.String(value.c_str(), (rapidjson::SizeType)value.size());
+    }
+
+    /// @brief Write an object member with a string value through a rapidjson writer, a null value being written as ""
+    template <typename Writer>
+    static void writeMember(Writer &writer, const char *name, const char *value)
+    {
+        writer.Key(name);
+        writer.String(value == nullptr ? "" : value);
+    }
 };
 
 #endif // #ifndef JSON_UTILS_HPP
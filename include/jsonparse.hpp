@@ -7,6 +7,7 @@
  * This class provides JSON parsing functionality
  */
 
+#include <cstddef>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -14,24 +15,58 @@
 namespace cryptosoft
 {
 
+/*
+ * A parsed JSON value. The nodes and strings of a document are allocated from
+ * an arena owned by the root, which parses a copy of the input in place; they
+ * are freed together when the root is destroyed or parses again. Replacing a
+ * value does not free the old one until then.
+ */
 class Json
 {
     public:
 
-        typedef std::vector< std::pair< std::string, Json* > > objType;
-        typedef std::vector< Json* > arrType;
-
-        Json() : obj(0), arr(0), val(0), boolean(0), num(0)
+        /*
+         * An XPath split into its steps once, for repeated lookups:
+         *   <path>: '/' <name> <path> | "/[" <index> ']' <path> | '/' | ""
+         * A name of "*" matches every member of an object and an index of "*"
+         * every element of an array.
+         */
+        class XPath
         {
-        }
+            public:
+                explicit XPath( const std::string& path );
+
+//            private:
+
+                // A step names the characters of the path it matches
+                struct Step
+                {
+                    size_t offset;
+                    size_t length;
+                    bool anyName;
+                    bool isIndex;
+                    bool anyIndex;
+                    size_t index;
+                };
 
+                // Fill in up to capacity steps, returning how many the path has
+                static size_t split( const std::string& path, Step* steps, size_t capacity );
+
+                std::string path;
+                std::vector< Step > steps;
+        };
+
+        Json();
         ~Json();
 
         bool parse( std::istream& is, bool allowValues = false );
         bool parse( const std::string& ss, bool allowValues = false );
+        bool parseBuffer( const char* data, size_t length, bool allowValues = false );
 
         Json* atXPath( const std::string& path );
+        Json* atXPath( const XPath& path );
         void allAtXPath( const std::string& path, std::vector< Json* >& result );
+        void allAtXPath( const XPath& path, std::vector< Json* >& result );
         bool replaceWith( const std::string& replacement );
         bool replaceAllAtXPath( const std::string& path, const std::string& replacement );
         void replaceStringAtXPath( const std::string& path, const std::string& replacement );
@@ -47,20 +82,65 @@ class Json
 
 //    private:
 
-        bool parseObject( std::istream& is );
-        bool parseArray( std::istream& is );
-        bool parseNull( std::istream& is );
-        bool parseBool( std::istream& is );
-        bool parseNumber( std::istream& is );
-        bool parseString( std::istream& is, std::string* useThis = 0 );
-        void clearAndDestroy( void );
-        void clear( void );
-
-        objType* obj;
-        arrType* arr;
-        std::string* val;
+        class Arena;
+
+        enum Type
+        {
+            NULL_TYPE,
+            OBJECT,
+            ARRAY,
+            STRING,
+            BOOL,
+            NUMBER
+        };
+
+        struct Cursor
+        {
+            char* pos;
+            char* end;
+            // The children of the objects and arrays being parsed
+            std::vector< Json* >* stack;
+        };
+
+        explicit Json( Arena* arena );
+
+        bool parseValue( Cursor& c );
+        bool parseObject( Cursor& c );
+        bool parseArray( Cursor& c );
+        bool parseLiteral( Cursor& c, const char* literal, size_t length );
+        bool parseNumber( Cursor& c );
+        static bool parseString( Cursor& c, const char*& value, size_t& length );
+        Json* match( const char* path, const XPath::Step* steps, size_t stepCount, size_t step, std::vector< Json* >* result );
+        Json* newNode( void );
+        Arena& getArena( void );
+        void endChildren( Cursor& c, size_t base );
+        void assign( const Json& other );
+
+        Type type;
+        bool ownsArena;
+        bool boolValue;
+        Arena* arena;
+
+        // The member name when this is in an object
+        const char* key;
+        size_t keyLength;
+
+        // Members or elements
+        Json** children;
+        size_t count;
+
+        const char* str;
+        size_t strLength;
+
+        // Point at boolValue or numValue when this is a boolean or a number
         bool* boolean;
         double* num;
+        double numValue;
+
+    private:
+
+        Json( const Json& );
+        Json& operator=( const Json& );
 };
 
 }
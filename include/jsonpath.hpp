@@ -12,6 +12,44 @@
 
 namespace rapidjson
 {
+    /**
+     * A JSON "XPath" compiled once into one instruction per level, so that it
+     * can be applied to many documents without parsing the path again
+     *
+     * <path>: '/' <fieldname> <path> | "/[" <index> ']' <path> | '/'
+     * <fieldname>: [0-9a-zA-Z_]+ | '*'
+     * <index>: [0-9]+ | '*'
+     */
+    class XPath
+    {
+        public:
+            explicit XPath( const std::string& path );
+
+            /**
+             * Obtain all JSON values matching the path, without allocating
+             * other than to grow the result
+             *
+             * @param[in]  value  Pointer to rapidjson::Value from which to start search
+             * @param[out] result JSON values matching the path
+             */
+            void allAt( Value* value, std::vector< Value* >& result ) const;
+
+        private:
+            struct Instruction
+            {
+                std::string name;   // Matched against member names
+                bool anyName;       // '*' matches every member
+                bool isIndex;       // "[...]" also selects array elements
+                bool anyIndex;      // "[*]" selects every element
+                bool validIndex;    // False for a negative index, which selects nothing
+                SizeType index;
+            };
+
+            void match( Value* value, size_t step, std::vector< Value* >& result ) const;
+
+            std::vector< Instruction > instructions_;
+    };
+
     /**
      * Obtain all JSON values matching the given JSON "XPath"
      *
@@ -24,4 +62,13 @@ namespace rapidjson
      * @param[out] result JSON values matching given path string
      */
 	void allAtXPath( Value* value, const std::string& path, std::vector< Value* >& result );
+
+    /**
+     * Obtain all JSON values matching a precompiled JSON "XPath"
+     *
+     * @param[in]  value  Pointer to rapidjson::Value from which to start search
+     * @param[in]  path   Compiled JSON XPath
+     * @param[out] result JSON values matching the path
+     */
+	void allAtXPath( Value* value, const XPath& path, std::vector< Value* >& result );
 } //end rapidjson
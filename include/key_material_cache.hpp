@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Cache of the keys fetched from KeyScaler to decrypt DA encrypted files
+ */
+#ifndef KEY_MATERIAL_CACHE_HPP
+#define KEY_MATERIAL_CACHE_HPP
+
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Keeps the key and IV that decrypt a DA encrypted file for a limited time, so that an application
+ * loading the same certificate or private key into many SSL contexts only asks KeyScaler for them once.
+ *
+ * @details Entries are keyed by the file path, its modification time and the key ID in the file, so a
+ * rewritten file is never decrypted with a stale key. The secrets are held in a fixed block of memory that
+ * is locked against swapping where the platform allows it, and are zeroised when they expire, are evicted
+ * or the cache is cleared. When the cache is full the entry closest to expiry is evicted.
+ */
+class KeyMaterialCache
+{
+public:
+    /// @brief The number of files whose keys can be held at once
+    static const size_t CAPACITY = 16;
+
+    /// @brief The largest key or IV that can be held
+    static const size_t MAX_SECRET_BYTES = 64;
+
+    /// @brief Get the cache shared by the process
+    static KeyMaterialCache *getInstance();
+
+    KeyMaterialCache();
+
+    /// @brief Destructor - zeroises and releases the secrets
+    ~KeyMaterialCache();
+
+    /**
+     * @brief Look up the key and IV of a file
+     *
+     * @param path The path of the encrypted file
+     * @param mtime The modification time of the file
+     * @param key_id The key ID in the file
+     * @param key [out] The key, if found
+     * @param iv [out] The IV, if found
+     * @return True if an entry that has not expired was found, false otherwise
+     */
+    bool lookup(const std::string &path, time_t mtime, const std::string &key_id, std::string &key, std::string &iv);
+
+    /**
+     * @brief Keep the key and IV of a file
+     *
+     * @param ttl_seconds How long to keep them, 0 to not keep them at all
+     * @return True if kept, false if the cache is disabled or the key or IV is too large
+     */
+    bool insert(const std::string &path, time_t mtime, const std::string &key_id, const std::string &key, const std::string &iv, unsigned int ttl_seconds);
+
+    /// @brief Zeroise and forget all entries
+    void clear();
+
+    /// @brief Get the number of entries held, including any that have expired but are not yet evicted
+    size_t size() const;
+
+private:
+    /// @brief The secrets of an entry, kept in the locked block
+    struct Secret
+    {
+        unsigned char key[MAX_SECRET_BYTES];
+        unsigned char iv[MAX_SECRET_BYTES];
+        size_t key_size;
+        size_t iv_size;
+    };
+
+    struct Entry
+    {
+        bool in_use;
+        std::string path;
+        time_t mtime;
+        std::string key_id;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    mutable std::mutex m_mutex;
+    Entry m_entries[CAPACITY];
+    /// @brief CAPACITY secrets, the secret of an entry having the same index
+    Secret *mp_secrets;
+    size_t m_secrets_size;
+
+    /// @brief Zeroise an entry's secret and free it, with the lock held
+    void evict(size_t index);
+
+    KeyMaterialCache(const KeyMaterialCache &);
+    KeyMaterialCache &operator=(const KeyMaterialCache &);
+};
+
+#endif // #ifndef KEY_MATERIAL_CACHE_HPP
@@ -0,0 +1,96 @@
+/**
+ * \file
+ *
+ * \brief Unit test of the cache of keys for DA encrypted files
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef KEY_MATERIAL_CACHE_UNITTEST_HPP
+#define KEY_MATERIAL_CACHE_UNITTEST_HPP
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+#include "key_material_cache.hpp"
+
+TEST(KeyMaterialCache, Lookup_ExpectKeyOfSameFileVersionAndKeyId)
+{
+    KeyMaterialCache cache;
+    ASSERT_TRUE(cache.insert("/etc/ssl/device.pem", 100, "key1", "secretkey", "secretiv", 60));
+
+    std::string key;
+    std::string iv;
+    ASSERT_TRUE(cache.lookup("/etc/ssl/device.pem", 100, "key1", key, iv));
+    ASSERT_EQ("secretkey", key);
+    ASSERT_EQ("secretiv", iv);
+
+    ASSERT_FALSE(cache.lookup("/etc/ssl/device.pem", 101, "key1", key, iv));
+    ASSERT_FALSE(cache.lookup("/etc/ssl/device.pem", 100, "key2", key, iv));
+    ASSERT_FALSE(cache.lookup("/etc/ssl/other.pem", 100, "key1", key, iv));
+}
+
+TEST(KeyMaterialCache, Insert_ExpectRewrittenFileReplaced)
+{
+    KeyMaterialCache cache;
+    ASSERT_TRUE(cache.insert("/etc/ssl/device.pem", 100, "key1", "oldkey", "oldiv", 60));
+    ASSERT_TRUE(cache.insert("/etc/ssl/device.pem", 200, "key2", "newkey", "newiv", 60));
+    ASSERT_EQ(1u, cache.size());
+
+    std::string key;
+    std::string iv;
+    ASSERT_FALSE(cache.lookup("/etc/ssl/device.pem", 100, "key1", key, iv));
+    ASSERT_TRUE(cache.lookup("/etc/ssl/device.pem", 200, "key2", key, iv));
+    ASSERT_EQ("newkey", key);
+}
+
+TEST(KeyMaterialCache, Insert_ExpectDisabledOrOversizedNotKept)
+{
+    KeyMaterialCache cache;
+    ASSERT_FALSE(cache.insert("/etc/ssl/device.pem", 100, "key1", "key", "iv", 0));
+    ASSERT_FALSE(cache.insert("/etc/ssl/device.pem", 100, "key1", std::string(KeyMaterialCache::MAX_SECRET_BYTES + 1, 'k'), "iv", 60));
+    ASSERT_EQ(0u, cache.size());
+}
+
+TEST(KeyMaterialCache, Expiry_ExpectEvicted)
+{
+    KeyMaterialCache cache;
+    ASSERT_TRUE(cache.insert("/etc/ssl/device.pem", 100, "key1", "key", "iv", 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    std::string key;
+    std::string iv;
+    ASSERT_FALSE(cache.lookup("/etc/ssl/device.pem", 100, "key1", key, iv));
+    ASSERT_EQ(0u, cache.size());
+}
+
+TEST(KeyMaterialCache, Full_ExpectEntryClosestToExpiryEvicted)
+{
+    KeyMaterialCache cache;
+    ASSERT_TRUE(cache.insert("/etc/ssl/first.pem", 100, "key", "key", "iv", 10));
+    for (size_t i = 1; i < KeyMaterialCache::CAPACITY; ++i)
+    {
+        ASSERT_TRUE(cache.insert("/etc/ssl/" + std::to_string(i) + ".pem", 100, "key", "key", "iv", 60));
+    }
+    ASSERT_EQ(KeyMaterialCache::CAPACITY, cache.size());
+    ASSERT_TRUE(cache.insert("/etc/ssl/last.pem", 100, "key", "key", "iv", 60));
+    ASSERT_EQ(KeyMaterialCache::CAPACITY, cache.size());
+
+    std::string key;
+    std::string iv;
+    ASSERT_FALSE(cache.lookup("/etc/ssl/first.pem", 100, "key", key, iv));
+    ASSERT_TRUE(cache.lookup("/etc/ssl/1.pem", 100, "key", key, iv));
+    ASSERT_TRUE(cache.lookup("/etc/ssl/last.pem", 100, "key", key, iv));
+
+    cache.clear();
+    ASSERT_EQ(0u, cache.size());
+}
+
+#endif // #ifndef KEY_MATERIAL_CACHE_UNITTEST_HPP
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Pool of key pairs generated in the background, ready for CSRs
+ */
+#ifndef KEY_POOL_HPP
+#define KEY_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <openssl/evp.h>
+#include "ssl_wrapper.hpp"
+
+/**
+ * @brief Generates key pairs on a low priority thread ahead of time, so that a CSR can be produced without
+ * waiting for a key when a certificate rotation arrives.
+ *
+ * @details The pool keeps up to the configured number of keys of each type. It is refilled whenever a key is
+ * taken. The keys only ever exist in memory, and are held encrypted under a random key of the process that
+ * is never written anywhere. take() returns false when no key of the type is ready, and the caller then
+ * generates one itself. The pool does nothing until start() is called.
+ */
+class KeyPool
+{
+public:
+    /// @brief Get the pool used by the agent
+    static KeyPool *getInstance();
+
+    KeyPool();
+
+    /// @brief Destructor - stops the generation thread
+    ~KeyPool();
+
+    /**
+     * @brief Start generating keys
+     *
+     * @param specs The types of key to keep ready
+     * @param size The number of keys to keep ready of each type
+     * @return True if started, false if there is nothing to generate or the pool is already running
+     */
+    bool start(const std::vector<KeySpec> &specs, size_t size);
+
+    /// @brief Stop generating keys and discard those ready
+    void stop();
+
+    /**
+     * @brief Take a key out of the pool
+     *
+     * @param spec The type of key wanted
+     * @param private_key [out] The private key as PEM, as written by SSLWrapper::writePrivateKey
+     * @param pp_key [out] The key, to be freed by the caller
+     * @return True if a key was ready, false otherwise
+     */
+    bool take(const KeySpec &spec, std::string &private_key, EVP_PKEY **pp_key);
+
+    /// @brief Get the number of keys of a type that are ready
+    size_t available(const KeySpec &spec) const;
+
+private:
+    /// @brief A private key encrypted under the pool key
+    struct SealedKey
+    {
+        std::string iv;
+        std::string ciphertext;
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::map<KeySpec, std::deque<SealedKey>> m_keys;
+    size_t m_size;
+    bool m_stopping;
+    std::thread m_thread;
+    /// @brief The AES key the pooled keys are encrypted with, generated when the pool starts
+    std::string m_seal_key;
+
+    /// @brief Get a type of key that is short of keys, with the lock held
+    bool findShortfall(KeySpec &spec) const;
+
+    bool seal(const std::string &private_key, SealedKey &sealed) const;
+    bool unseal(const SealedKey &sealed, std::string &private_key) const;
+
+    void run();
+
+    KeyPool(const KeyPool &);
+    KeyPool &operator=(const KeyPool &);
+};
+
+#endif // #ifndef KEY_POOL_HPP
@@ -0,0 +1,146 @@
+/**
+ * \file
+ *
+ * \brief Unit test and benchmark of the key pair pool
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef KEY_POOL_UNITTEST_HPP
+#define KEY_POOL_UNITTEST_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "key_pool.hpp"
+#include "ssl_wrapper.hpp"
+#include "steady_timer.hpp"
+
+namespace
+{
+    const KeySpec POOL_TEST_SPEC = {KeySpec::EC, 256};
+
+    /// @brief Wait up to 30 seconds for the pool to hold a number of keys
+    bool waitForKeys(const KeyPool &pool, const KeySpec &spec, size_t count)
+    {
+        steady_timer timer;
+        while (pool.available(spec) < count)
+        {
+            if (timer.get_elapsed_time_in_millseconds() > 30000)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+} // namespace
+
+TEST(KeySpec, Parse_ExpectSupportedTypesOnly)
+{
+    KeySpec spec;
+    ASSERT_TRUE(KeySpec::parse("rsa-3072", spec));
+    ASSERT_EQ(KeySpec::RSA, spec.algorithm);
+    ASSERT_EQ(3072, spec.bits);
+    ASSERT_TRUE(KeySpec::parse("EC-P384", spec));
+    ASSERT_EQ(KeySpec::EC, spec.algorithm);
+    ASSERT_EQ(384, spec.bits);
+    ASSERT_EQ("EC-P384", spec.name());
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    ASSERT_TRUE(KeySpec::parse("Ed25519", spec));
+    ASSERT_EQ(KeySpec::ED25519, spec.algorithm);
+    ASSERT_EQ("ED25519", spec.name());
+#endif // #if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    ASSERT_FALSE(KeySpec::parse("RSA-1024", spec));
+    ASSERT_FALSE(KeySpec::parse("EC-P521", spec));
+}
+
+TEST(KeyPool, Take_ExpectKeyMatchingPemAndPoolRefilled)
+{
+    KeyPool pool;
+    ASSERT_TRUE(pool.start(std::vector<KeySpec>(1, POOL_TEST_SPEC), 2));
+    ASSERT_TRUE(waitForKeys(pool, POOL_TEST_SPEC, 2));
+
+    std::string private_key;
+    EVP_PKEY *p_key = nullptr;
+    ASSERT_TRUE(pool.take(POOL_TEST_SPEC, private_key, &p_key));
+    ASSERT_EQ(EVP_PKEY_EC, EVP_PKEY_id(p_key));
+    ASSERT_NE(std::string::npos, private_key.find("BEGIN EC PRIVATE KEY"));
+
+    std::string written;
+    ASSERT_TRUE(SSLWrapper::writePrivateKey(p_key, written));
+    ASSERT_EQ(written, private_key);
+    EVP_PKEY_free(p_key);
+
+    ASSERT_TRUE(waitForKeys(pool, POOL_TEST_SPEC, 2));
+}
+
+TEST(KeyPool, TakeOtherType_ExpectNoKey)
+{
+    KeyPool pool;
+    ASSERT_TRUE(pool.start(std::vector<KeySpec>(1, POOL_TEST_SPEC), 1));
+    ASSERT_TRUE(waitForKeys(pool, POOL_TEST_SPEC, 1));
+
+    std::string private_key;
+    EVP_PKEY *p_key = nullptr;
+    ASSERT_FALSE(pool.take(DEFAULT_CSR_KEY_SPEC, private_key, &p_key));
+    ASSERT_TRUE(p_key == nullptr);
+}
+
+TEST(KeyPool, Stop_ExpectKeysDiscarded)
+{
+    KeyPool pool;
+    ASSERT_FALSE(pool.start(std::vector<KeySpec>(), 1));
+    ASSERT_TRUE(pool.start(std::vector<KeySpec>(1, POOL_TEST_SPEC), 1));
+    ASSERT_FALSE(pool.start(std::vector<KeySpec>(1, POOL_TEST_SPEC), 1));
+    ASSERT_TRUE(waitForKeys(pool, POOL_TEST_SPEC, 1));
+    pool.stop();
+
+    std::string private_key;
+    EVP_PKEY *p_key = nullptr;
+    ASSERT_EQ(0u, pool.available(POOL_TEST_SPEC));
+    ASSERT_FALSE(pool.take(POOL_TEST_SPEC, private_key, &p_key));
+}
+
+// Time to produce a CSR with and without a pooled key, run with --gtest_also_run_disabled_tests
+TEST(KeyPool, DISABLED_BenchmarkGenerateCSR)
+{
+    const int iterations = 10;
+    CsrInstructions csr_info;
+    csr_info.setCSRInfo("certificate", "asset", "device.example.com", "device.pem", false, false);
+    SSLWrapper ssl_wrapper;
+    std::string csr;
+    std::string private_key;
+
+    steady_timer inline_timer;
+    for (int i = 0; i < iterations; ++i)
+    {
+        ASSERT_TRUE(ssl_wrapper.generateCSR(csr_info, "key", "iv", "key_id", csr, private_key));
+    }
+    const int64_t inline_ms = inline_timer.get_elapsed_time_in_millseconds();
+
+    KeyPool *p_pool = KeyPool::getInstance();
+    ASSERT_TRUE(p_pool->start(std::vector<KeySpec>(1, DEFAULT_CSR_KEY_SPEC), iterations));
+    ASSERT_TRUE(waitForKeys(*p_pool, DEFAULT_CSR_KEY_SPEC, iterations));
+    steady_timer pooled_timer;
+    for (int i = 0; i < iterations; ++i)
+    {
+        ASSERT_TRUE(ssl_wrapper.generateCSR(csr_info, "key", "iv", "key_id", csr, private_key));
+    }
+    const int64_t pooled_ms = pooled_timer.get_elapsed_time_in_millseconds();
+    p_pool->stop();
+
+    printf("%s CSR: %8.1f ms generating the key, %8.1f ms with a pooled key\n", DEFAULT_CSR_KEY_SPEC.name().c_str(),
+           (double)inline_ms / iterations, (double)pooled_ms / iterations);
+}
+
+#endif // #ifndef KEY_POOL_UNITTEST_HPP
@@ -55,9 +55,12 @@ public:
     bool initialise(const std::string& processName, const std::string& fullPathOfFile, unsigned long maxFileSize = 1024000, std::string syslogHost = "", unsigned int syslogPort = 0);
     void useColour(bool value);
     void printf(Severity level, const char *text, ...);
+    /// @brief Get whether messages of a level are written, to skip building text that would be discarded
+    bool isEnabled(Severity level) const;
 
 private:
     Log(bool verbose = false);
+    bool open(const std::string& processName, const std::string& fullPathOfFile, unsigned long maxFileSize, const std::string& syslogHost, unsigned int syslogPort);
     // Helper functions for log file use
     const char *timestamp(char *buffer) const;
     const char *severityString(Severity level) const;
@@ -60,6 +60,9 @@ class MessageFactory
     /**
      * @brief Create a script result message from a script output
      *
+     * @details The output is streamed through ScriptResultWriter and is truncated at SCRIPT_MAX_OUTPUT_BYTES.
+     * Use ScriptResultWriter directly to build the message while the script is running.
+     *
      * @param logs_type The log type indicator
      * @param compress Whether to compress the JSON response
      * @param script_output The script output logs
@@ -114,6 +117,15 @@ class MessageFactory
      */
     static const std::string buildApmPasswordsMessage(const std::vector<account*> &accounts);
 
+    /**
+     * @brief Generate a request sent to KeyScaler over MQTT
+     *
+     * @details The payload is written once through a rapidjson writer, so all the values are escaped.
+     * For asset-status, data is the receipt JSON object whose members are added to the request.
+     *
+     * @param op The operation: ch, register, auth, asset-status or device-csr
+     * @return The request JSON
+     */
     static const std::string generateMqttPayload(
         const std::string &op,
         const std::string &udi,
@@ -127,11 +139,21 @@ class MessageFactory
         const char *keyId = "");
 
     private:
+    /// @brief The initial capacity of the buffer an MQTT payload is written to, enough for most payloads
+    static const size_t MQTT_PAYLOAD_CAPACITY = 1024;
+
     /**
      * Constructor
      */
     MessageFactory() {};
 
+    /// @brief Write the dFactorAuthentication member of an MQTT request
+    static void writeDFactorAuthentication(
+        rapidjson::Writer<rapidjson::StringBuffer> &writer,
+        const std::string &user_agent,
+        const std::string &user_id,
+        const char *deviceKey);
+
     /**
      * @brief Merge two JSON objects into a single JSON object
      *
@@ -18,8 +18,57 @@
 #ifndef MESSAGE_FACTORY_UNITTEST_HPP
 #define MESSAGE_FACTORY_UNITTEST_HPP
 
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <sstream>
 #include "gtest/gtest.h"
 #include "message_factory.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    /// @brief Get an MQTT payload from its "device" member on, leaving out the request ID and timestamp that vary
+    std::string mqttPayloadFromDevice(const std::string &payload)
+    {
+        const size_t device_pos = payload.find("\"device\":");
+        return device_pos == std::string::npos ? payload : payload.substr(device_pos);
+    }
+
+    /// @brief The challenge request as it was built by concatenating strings, to benchmark against
+    std::string concatenatedChallengePayload(const std::string &udi, const std::string &user_agent, const std::string &user_id, const char *tid)
+    {
+        std::stringstream ss;
+        std::string payload = "{";
+        std::string reqIdKey = "\"reqId\":\"" + utils::generateUUID() + "\",";
+        time_t t = time(0);
+
+        ss << t;
+
+        std::string tsKey = "\"ts\":" + ss.str() + ",";
+        std::string udiKey = "\"device\":\"" + udi + "\",";
+        std::string opKey = "\"op\":\"ch\",";
+        std::string userAgentKey = "\"userAgent\":\"" + user_agent + "\",";
+        std::string userIdKey = "\"userId\":\"" + user_id + "\",";
+        std::string reqKey = "\"req\":{";
+
+        payload += reqIdKey + tsKey + udiKey + opKey + reqKey;
+        payload += "\"type\":\"challenge\",";
+        payload += userAgentKey;
+        payload += "\"challengeType\":\"auth\",";
+        payload += userIdKey;
+        payload += "\"deviceKey\":\"\",";
+        payload += "\"tid\":\"";
+        payload += tid;
+        payload += "\",";
+        payload += "\"encryptPolicyId\":\"\"";
+        payload += "},";
+        payload += "\"tenant\":\"tenant\"";
+        payload += "}";
+
+        return payload;
+    }
+} // namespace
 
 TEST(MessageFactory, GenerateAckMessageSuccess)
 {
@@ -163,4 +212,60 @@ TEST(MessageFactory, GenerateApmPasswordsMessageNonEmpty)
     ASSERT_STREQ(expected_json, result.c_str());
 }
 
+TEST(MessageFactory, GenerateMqttChallengePayload)
+{
+    const auto expected_json = "\"device\":\"udi\",\"op\":\"ch\",\"req\":{\"type\":\"challenge\",\"userAgent\":\"agent\",\"challengeType\":\"auth\","
+                               "\"userId\":\"user\",\"deviceKey\":\"\",\"tid\":\"tid\",\"encryptPolicyId\":\"\"},\"tenant\":\"tenant\"}";
+    const std::string result = MessageFactory::generateMqttPayload("ch", "udi", "agent", "user", "auth", "", "tid");
+    ASSERT_EQ(0u, result.find("{\"reqId\":\""));
+    ASSERT_STREQ(expected_json, mqttPayloadFromDevice(result).c_str());
+}
+
+TEST(MessageFactory, GenerateMqttPayloadEscaped)
+{
+    const auto expected_json = "\"device\":\"my \\\"udi\\\"\",\"op\":\"register\",\"req\":{\"type\":\"register\",\"userAgent\":\"agent\\\\1\","
+                               "\"userId\":\"user\",\"deviceKey\":\"key\",\"displayName\":\"my \\\"udi\\\"\"},\"tenant\":\"tenant\"}";
+    const std::string result = MessageFactory::generateMqttPayload("register", "my \"udi\"", "agent\\1", "user", "", "key");
+    ASSERT_STREQ(expected_json, mqttPayloadFromDevice(result).c_str());
+}
+
+TEST(MessageFactory, GenerateMqttDeviceCsrPayload)
+{
+    const auto expected_json = "\"device\":\"udi\",\"op\":\"device-csr\",\"req\":{\"type\":\"csr\",\"dFactorAuthentication\":{\"userId\":\"user\","
+                               "\"deviceKey\":\"key\",\"domainPublicIP\":\"\",\"userAgent\":\"agent\"},\"certificateId\":\"certificate\","
+                               "\"csr\":\"-----BEGIN CERTIFICATE REQUEST-----\\nMIIB\\n\"},\"tenant\":\"tenant\"}";
+    const std::string result = MessageFactory::generateMqttPayload("device-csr", "udi", "agent", "user", "", "key", "", "certificate",
+                                                                   "-----BEGIN CERTIFICATE REQUEST-----\nMIIB\n");
+    ASSERT_STREQ(expected_json, mqttPayloadFromDevice(result).c_str());
+}
+
+// Time to build the challenge request with the writer and by concatenating strings, run with --gtest_also_run_disabled_tests
+TEST(MessageFactory, DISABLED_BenchmarkGenerateMqttPayload)
+{
+    const int iterations = 100000;
+    const std::string udi = "device-0123456789abcdef";
+    const std::string user_agent = "Linux x86_64 Credential Manager";
+    const std::string user_id = "user@example.com";
+    const std::string tid = "c2f1b4f7e8a94d5b8f0a6e3d2c1b0a99";
+
+    size_t size = 0;
+    const std::chrono::steady_clock::time_point concatenated_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        size += concatenatedChallengePayload(udi, user_agent, user_id, tid.c_str()).size();
+    }
+    const int64_t concatenated_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - concatenated_start).count();
+
+    const std::chrono::steady_clock::time_point writer_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        size += MessageFactory::generateMqttPayload("ch", udi, user_agent, user_id, "auth", "", tid.c_str()).size();
+    }
+    const int64_t writer_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - writer_start).count();
+
+    ASSERT_GT(size, 0u);
+    printf("concatenated: %8.3f us per payload\n", (double)concatenated_us / iterations);
+    printf("writer:       %8.3f us per payload\n", (double)writer_us / iterations);
+}
+
 #endif // #ifndef MESSAGE_FACTORY_UNITTEST_HPP
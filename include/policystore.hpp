@@ -7,6 +7,7 @@
 #ifndef POLICYSTORE_HPP
 #define POLICYSTORE_HPP
 
+#include "json_arena.hpp"
 #include "policy.hpp"
 #include "log.hpp"
 #include "optype.h"
@@ -89,6 +90,8 @@ public:
 
     bool getPropertiesFromPolicy(std::string domain, STRINGMAP *mapProps, OpType& operation, std::string& name, std::string& policyID, std::string& error, bool &policyUpdateFailed);
 
+    // Apply the policies returned from the SAC, either the complete set or a delta from the version last received.
+    // Called with mutex_ held, as the policies are parsed with jsonArena_.
     bool processCryptoPolicies(std::string cryptoPolicies, std::string&  error);
     bool processJSONPolicies(const rapidjson::Value& jsonPolicies, std::string&  error);
     bool processPolicy(const rapidjson::Value& jsonPolicy, std::string&  error);
@@ -106,14 +109,28 @@ private:
     std::string stripQuotes(const std::string& data) const;
     // Make a call to the SAC API to get all the policies for this device/protocol then cache them up
     bool getPoliciesFromSAC(std::string& error);
+    // Parse an array of policies from the SAC into the supplied map
+    bool parseCryptoPolicies(const rapidjson::Value& policiesVal, POLICYMAP& policies, std::string& error) const;
+    // Add, replace and remove the policies listed in a delta from the SAC
+    bool applyPolicyDelta(const rapidjson::Value& msgVal, const std::string& version, std::string& error);
+    // Clear the policies along with the version and digest they were received with
+    void forgetPolicies(void);
+    // Digest of an array of policies from the SAC, to tell whether it differs from the policies in use
+    const std::string digestPolicies(const rapidjson::Value& policiesVal) const;
 
 private:
     std::string protocol_;
     unsigned int refreshTime_;
     unsigned int refreshRetryTime_;
+    // Parses the policies from the SAC, its block grows to the largest response received so far
+    JsonArena jsonArena_;
     static time_t timestamp_;
     static bool forceStale_;
     static POLICYMAP policies_;
+    // Version of the policies sent by the SAC, returned to it so that it can reply with a delta
+    static std::string policyVersion_;
+    // Digest of the complete set of policies last received
+    static std::string policiesDigest_;
     static PolicyStore *gPolicyStoreInstance;   // Singleton
     static pthread_mutex_t mutex_;
 };
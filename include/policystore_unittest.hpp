@@ -0,0 +1,128 @@
+/**
+ * \file
+ *
+ * \brief Unit test of the policy sync with the SAC
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef POLICYSTORE_UNITTEST_HPP
+#define POLICYSTORE_UNITTEST_HPP
+
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "constants.hpp"
+#include "policystore.hpp"
+
+namespace
+{
+    const std::string makeSacPolicy(const std::string &id, const std::string &operation, const std::string &pattern)
+    {
+        return "{\"gatewayCryptoOperation\":\"" + operation + "\",\"id\":\"" + id + "\",\"name\":\"" + id +
+               "\",\"domain\":\"deviceauthority.com\",\"urlPattern\":\"" + pattern +
+               "\",\"gatewayDataDirection\":\"C2S\",\"gatewayMethodType\":\"NONE\",\"payLoadType\":\"PLAIN\",\"cryptionPath\":\"/\"}";
+    }
+
+    const std::string dumpPolicies(PolicyStore *p_store)
+    {
+        std::ostringstream oss;
+        p_store->dumpToStream(oss);
+        return oss.str();
+    }
+
+    PolicyStore *resetPolicyStore()
+    {
+        PolicyStore *p_store = PolicyStore::getPolicyStoreInstance(PROTO_MQTT, false);
+        // Never stale, so that the tests do not go to the SAC
+        p_store->updatePolicyRefreshTime(0);
+        p_store->clear();
+        return p_store;
+    }
+
+    const std::string POLICY_A = makeSacPolicy("A", "ENCRYPT", "/device/a");
+    const std::string POLICY_B = makeSacPolicy("B", "DECRYPT", "/device/b");
+    const std::string POLICY_C = makeSacPolicy("C", "ENCRYPT", "/device/c");
+} // namespace
+
+TEST(PolicyStore, CompleteSetReplacesPolicies)
+{
+    PolicyStore *p_store = resetPolicyStore();
+    std::string error;
+
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"policies\":[" + POLICY_A + "," + POLICY_B + "]}}", error));
+    const std::string first = dumpPolicies(p_store);
+    ASSERT_NE(std::string::npos, first.find("Policy: A "));
+    ASSERT_NE(std::string::npos, first.find("Policy: B "));
+
+    // The same set again is kept as it is
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"policies\":[" + POLICY_A + "," + POLICY_B + "]}}", error));
+    ASSERT_EQ(first, dumpPolicies(p_store));
+
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"policies\":[" + POLICY_C + "]}}", error));
+    ASSERT_EQ(std::string::npos, dumpPolicies(p_store).find("Policy: A "));
+    ASSERT_NE(std::string::npos, dumpPolicies(p_store).find("Policy: C "));
+}
+
+TEST(PolicyStore, DeltaAddsChangesAndRemoves)
+{
+    PolicyStore *p_store = resetPolicyStore();
+    std::string error;
+
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"1\",\"policies\":[" + POLICY_A + "," + POLICY_B + "]}}", error));
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"2\",\"added\":[" + POLICY_C + "],\"changed\":[" +
+                                               makeSacPolicy("A", "DECRYPT", "/device/a") + "],\"removed\":[\"B\"]}}",
+                                               error));
+
+    const std::string policies = dumpPolicies(p_store);
+    ASSERT_NE(std::string::npos, policies.find("Policy: A to fully DECRYPT"));
+    ASSERT_EQ(std::string::npos, policies.find("Policy: B "));
+    ASSERT_NE(std::string::npos, policies.find("Policy: C to fully ENCRYPT"));
+}
+
+TEST(PolicyStore, UnchangedVersionKeepsPolicies)
+{
+    PolicyStore *p_store = resetPolicyStore();
+    std::string error;
+
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"1\",\"policies\":[" + POLICY_A + "]}}", error));
+    const std::string first = dumpPolicies(p_store);
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"1\"}}", error));
+    ASSERT_EQ(first, dumpPolicies(p_store));
+}
+
+TEST(PolicyStore, DeltaWithoutBaseVersion_ExpectFailure)
+{
+    PolicyStore *p_store = resetPolicyStore();
+    std::string error;
+
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"policies\":[" + POLICY_A + "]}}", error));
+    ASSERT_FALSE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"2\",\"added\":[" + POLICY_B + "]}}", error));
+    ASSERT_FALSE(error.empty());
+    ASSERT_EQ(std::string::npos, dumpPolicies(p_store).find("Policy: B "));
+}
+
+TEST(PolicyStore, DeltaWithInvalidPolicy_ExpectRejectedAndCompleteSetRequested)
+{
+    PolicyStore *p_store = resetPolicyStore();
+    std::string error;
+
+    ASSERT_TRUE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"1\",\"policies\":[" + POLICY_A + "]}}", error));
+    const std::string first = dumpPolicies(p_store);
+    ASSERT_FALSE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"2\",\"added\":[" + POLICY_C + ",{\"id\":\"D\"}],\"removed\":[\"A\"]}}",
+                                                error));
+    ASSERT_FALSE(error.empty());
+    ASSERT_EQ(first, dumpPolicies(p_store));
+    ASSERT_TRUE(p_store->isStale());
+
+    // Without a version to apply it to, the next delta is refused as well
+    ASSERT_FALSE(p_store->processCryptoPolicies("{\"message\":{\"version\":\"3\",\"added\":[" + POLICY_B + "]}}", error));
+}
+
+#endif // #ifndef POLICYSTORE_UNITTEST_HPP
@@ -14,6 +14,7 @@
 #include "asset_processor.hpp"
 #include "async_exec_script.hpp"
 #include "rsa_utils.hpp"
+#include "script_result_writer.hpp"
 
 class ScriptAssetProcessor : public AssetProcessor
 {
@@ -37,6 +38,8 @@ private:
     std::shared_ptr<std::string> m_data_file_path;
     /// @brief Thread that manages the execution of the script
     std::unique_ptr<AsyncExecScript> m_script_future;
+    /// @brief Builds the result message from the script output as the script runs
+    std::shared_ptr<ScriptResultWriter> m_result_writer;
     /// @brief The asset type
     std::string m_asset_type;
     /// @brief The public key used to verify the signature of the script
@@ -50,6 +53,9 @@ private:
      */
     bool sendReceipt(bool is_success, const std::string &json_payload, std::string &failure_reason);
 
+    /// @brief Get the log type indicator reported in the script result message for this asset type
+    const char *logsType() const;
+
     /**
      * @brief Generate a temporary filepath for storage of the response of a fetched file content
      * @details Uses file_name as the name if not empty, else generates a random UUID value as filename
@@ -64,7 +70,13 @@ private:
 
     const std::string digest(const std::string &data) const;
 
-    void fetchFile(const std::string &api_url, const std::string &response_file_path) const;
+    /**
+     * @brief Download the data file of the asset
+     * @param api_url The URL of the data file
+     * @param response_file_path The path to write the data file to
+     * @return The SHA-256 digest of the data file as a hex string, empty if it was not downloaded
+     */
+    const std::string fetchFile(const std::string &api_url, const std::string &response_file_path) const;
 
     void removeFile(const std::string *p_filepath) const;
 };
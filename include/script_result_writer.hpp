@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Streaming builder of the script result message returned to the KeyScaler
+ */
+#ifndef SCRIPT_RESULT_WRITER_HPP
+#define SCRIPT_RESULT_WRITER_HPP
+
+#include <string>
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/stringbuffer.h"
+#if defined(ALLOW_COMPRESSION)
+#include "zlib.h"
+#endif // #if defined(ALLOW_COMPRESSION)
+
+/**
+ * @brief Builds the script result message from script output appended in blocks.
+ *
+ * @details The script output is split into lines and written as the device_logs JSON array. This JSON is
+ * deflated in chunks (when compression is requested), and the deflated bytes are base64 encoded straight
+ * into the message buffer. The whole output, its JSON form and its compressed form are never held in
+ * memory at once.
+ */
+class ScriptResultWriter
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param logs_type The log type indicator
+     * @param compress Whether to compress the script output
+     * @param max_output_bytes Maximum number of script output bytes included in the message, 0 for no limit
+     */
+    ScriptResultWriter(const std::string &logs_type, bool compress, size_t max_output_bytes = 0);
+
+    /// @brief Destructor
+    ~ScriptResultWriter();
+
+    /**
+     * @brief Append a block of script output
+     *
+     * @param p_data The script output
+     * @param size The number of bytes in the block
+     * @return True if the output was accepted, false once the output limit has been reached
+     */
+    bool append(const char *p_data, size_t size);
+
+    /**
+     * @brief Record that script output was dropped before it reached the writer, so that the message
+     * notes the truncation. No more output can be appended afterwards.
+     */
+    void markTruncated();
+
+    /**
+     * @brief Complete the message. No more output can be appended afterwards.
+     *
+     * @return The script result message
+     */
+    const std::string finish();
+
+    /// @brief Get whether script output was dropped because of the output limit
+    bool isTruncated() const;
+
+private:
+    /// @brief The size of the chunks passed through the compressor
+    static const size_t CHUNK_SIZE = 16 * 1024;
+
+    const bool m_compress;
+    const size_t m_max_output_bytes;
+    size_t m_output_bytes;
+    bool m_truncated;
+    bool m_finished;
+
+    /// @brief Number of lines written to the device_logs array
+    unsigned int m_line_count;
+    /// @brief The current line of script output, until its newline is appended
+    std::string m_line;
+    /// @brief Reused buffer holding the JSON of a single line
+    rapidjson::StringBuffer m_line_json;
+
+    /// @brief Bytes left over from the last base64 encoded chunk, at most 2 short of a whole group
+    unsigned char m_b64_remainder[3];
+    size_t m_b64_remainder_size;
+
+    /// @brief The message being built
+    std::string m_message;
+
+#if defined(ALLOW_COMPRESSION)
+    z_stream m_zstream;
+#endif // #if defined(ALLOW_COMPRESSION)
+
+    void writeLine(const char *p_line, size_t size);
+    void writeData(const char *p_data, size_t size);
+#if defined(ALLOW_COMPRESSION)
+    void compressData(const char *p_data, size_t size, int flush);
+#endif // #if defined(ALLOW_COMPRESSION)
+    void encodeBase64(const unsigned char *p_data, size_t size);
+    void encodeBase64Final();
+
+    ScriptResultWriter(const ScriptResultWriter &);
+    ScriptResultWriter &operator=(const ScriptResultWriter &);
+};
+
+#endif // #ifndef SCRIPT_RESULT_WRITER_HPP
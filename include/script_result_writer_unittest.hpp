@@ -0,0 +1,78 @@
+/**
+ * \file
+ *
+ * \brief Unit test script result writer
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef SCRIPT_RESULT_WRITER_UNITTEST_HPP
+#define SCRIPT_RESULT_WRITER_UNITTEST_HPP
+
+#include "gtest/gtest.h"
+#include "script_result_writer.hpp"
+
+TEST(ScriptResultWriter, WriteOutputInOneBlock)
+{
+    const auto expected_json = "{\"device_logs\":{\"type\":\"asset-device-data-codesigning\",\"compression\":\"none\",\"data\":\"eyJkZXZpY2VfaW5mbyI6IiIsImRldmljZV9sb2dzIjpbeyJsaW5lIjoxLCJkZXNjcmlwdGlvbiI6InNjcmlwdCJ9LHsibGluZSI6MiwiZGVzY3JpcHRpb24iOiJvdXRwdXQifSx7ImxpbmUiOjMsImRlc2NyaXB0aW9uIjoiZXhpdCJ9XX0=\"}}";
+    ScriptResultWriter writer("asset-device-data-codesigning", false);
+    const std::string output = "script\noutput\nexit\n";
+    ASSERT_TRUE(writer.append(output.data(), output.size()));
+    ASSERT_STREQ(expected_json, writer.finish().c_str());
+}
+
+TEST(ScriptResultWriter, WriteOutputOneByteAtATime_ExpectSameMessage)
+{
+    const std::string output = "script\noutput with \"quotes\" and \\ backslash\n\nexit";
+
+    ScriptResultWriter whole("asset-device-data-logs", false);
+    whole.append(output.data(), output.size());
+
+    ScriptResultWriter split("asset-device-data-logs", false);
+    for (size_t i = 0; i < output.size(); ++i)
+    {
+        split.append(&output[i], 1);
+    }
+
+    ASSERT_EQ(whole.finish(), split.finish());
+}
+
+TEST(ScriptResultWriter, WriteEmptyOutput)
+{
+    // {"device_info":"","device_logs":[]}
+    const auto expected_json = "{\"device_logs\":{\"type\":\"asset-device-data-logs\",\"compression\":\"none\",\"data\":\"eyJkZXZpY2VfaW5mbyI6IiIsImRldmljZV9sb2dzIjpbXX0=\"}}";
+    ScriptResultWriter writer("asset-device-data-logs", false);
+    ASSERT_STREQ(expected_json, writer.finish().c_str());
+}
+
+TEST(ScriptResultWriter, WriteOutputOverLimit_ExpectTruncated)
+{
+    // {"device_info":"","device_logs":[{"line":1,"description":"abcd"},{"line":2,"description":"[output truncated after 4 bytes]"}]}
+    const auto expected_json = "{\"device_logs\":{\"type\":\"asset-device-data-logs\",\"compression\":\"none\",\"data\":\"eyJkZXZpY2VfaW5mbyI6IiIsImRldmljZV9sb2dzIjpbeyJsaW5lIjoxLCJkZXNjcmlwdGlvbiI6ImFiY2QifSx7ImxpbmUiOjIsImRlc2NyaXB0aW9uIjoiW291dHB1dCB0cnVuY2F0ZWQgYWZ0ZXIgNCBieXRlc10ifV19\"}}";
+    ScriptResultWriter writer("asset-device-data-logs", false, 4);
+    ASSERT_FALSE(writer.append("abcdefgh\n", 9));
+    ASSERT_TRUE(writer.isTruncated());
+    ASSERT_FALSE(writer.append("more", 4));
+    ASSERT_STREQ(expected_json, writer.finish().c_str());
+}
+
+TEST(ScriptResultWriter, MarkTruncated_ExpectNotice)
+{
+    // {"device_info":"","device_logs":[{"line":1,"description":"abcd"},{"line":2,"description":"[output truncated after 4 bytes]"}]}
+    const auto expected_json = "{\"device_logs\":{\"type\":\"asset-device-data-logs\",\"compression\":\"none\",\"data\":\"eyJkZXZpY2VfaW5mbyI6IiIsImRldmljZV9sb2dzIjpbeyJsaW5lIjoxLCJkZXNjcmlwdGlvbiI6ImFiY2QifSx7ImxpbmUiOjIsImRlc2NyaXB0aW9uIjoiW291dHB1dCB0cnVuY2F0ZWQgYWZ0ZXIgNCBieXRlc10ifV19\"}}";
+    ScriptResultWriter writer("asset-device-data-logs", false, 4);
+    ASSERT_TRUE(writer.append("abcd", 4));
+    ASSERT_FALSE(writer.isTruncated());
+    writer.markTruncated();
+    ASSERT_TRUE(writer.isTruncated());
+    ASSERT_FALSE(writer.append("more", 4));
+    ASSERT_STREQ(expected_json, writer.finish().c_str());
+}
+
+#endif // #ifndef SCRIPT_RESULT_WRITER_UNITTEST_HPP
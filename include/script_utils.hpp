@@ -7,12 +7,102 @@
 #ifndef SCRIPT_UTILS_HPP
 #define SCRIPT_UTILS_HPP
 
+#include <functional>
 #include <string>
 #include <sstream>
 #include <stdexcept>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/types.h>
 
 namespace script_utils
 {
+    /// @brief Size of the blocks read from the script output pipe
+    const size_t OUTPUT_BLOCK_SIZE = 64 * 1024;
+
+    /// @brief Amount of output kept for the failure message when the output is streamed to a sink
+    const size_t OUTPUT_TAIL_SIZE = 4 * 1024;
+
+    /// @brief Limits applied to a running script
+    struct ExecLimits
+    {
+        ExecLimits() : max_output_bytes(0), timeout_s(0) {}
+
+        /// @brief Maximum number of output bytes passed to the sink, 0 for no limit. Output beyond the
+        /// limit is drained and discarded so the script is not blocked writing to a full pipe.
+        size_t max_output_bytes;
+        /// @brief Maximum run time in seconds before the script process group is killed, 0 for no limit
+        unsigned int timeout_s;
+    };
+
+    /**
+     * @brief Receives blocks of script output as they are read from the pipe
+     * @return True to keep reading, false to stop and kill the script
+     */
+    typedef std::function<bool(const char *p_data, size_t size)> OutputSink;
+
+    /**
+     * @brief Get the script limits configured in the configuration file
+     * @return The configured limits
+     */
+    ExecLimits configuredLimits();
+
+    /// @brief A single script execution, spawned as its own process group so the script and
+    /// anything it starts can be killed together
+    class ScriptProcess
+    {
+    public:
+        /// @brief Constructor
+        /// @param script The script to execute
+        /// @param limits The limits to apply while the script runs
+        ScriptProcess(const std::string &script, const ExecLimits &limits);
+
+        /// @brief Destructor
+        ~ScriptProcess();
+
+        /**
+         * @brief Run the script, blocking until it exits, times out or is killed
+         *
+         * @param sink Receives the script output in blocks of up to OUTPUT_BLOCK_SIZE bytes
+         * @return True if the script ran and exited with a zero status, else false
+         */
+        bool run(const OutputSink &sink);
+
+        /// @brief Kill the script process group. Safe to call from any thread, before or during run().
+        void kill();
+
+        /// @brief Get the raw wait status of the script, -1 if it could not be run
+        int getExitStatus() const;
+
+        /// @brief Get whether the script was killed for exceeding the timeout
+        bool isTimedOut() const;
+
+        /// @brief Get whether output was discarded for exceeding the output limit
+        bool isTruncated() const;
+
+    private:
+        const std::string m_script;
+        const ExecLimits m_limits;
+        int m_exit_status;
+        bool m_timed_out;
+        bool m_truncated;
+
+        /// @brief Guards the process handle and m_killed, which are shared with kill()
+        mutable pthread_mutex_t m_pid_lock;
+#if defined(WIN32)
+        /// @brief Pipe to the running script, nullptr when not running
+        FILE *mp_pipe;
+#else
+        /// @brief Process ID (and process group ID) of the running script, 0 when not running
+        pid_t m_pid;
+#endif // #if defined(WIN32)
+        /// @brief Flag set by kill(), prevents a script being started after it was cancelled
+        bool m_killed;
+
+        ScriptProcess(const ScriptProcess &);
+        ScriptProcess &operator=(const ScriptProcess &);
+    };
+
     /**
      * @brief Executes a script
      *
@@ -22,6 +112,35 @@ namespace script_utils
      */
     bool execScript(const std::string &script, std::string& logOutput);
 
+    /**
+     * @brief Executes a script with the given limits
+     *
+     * @param script The script to execute
+     * @param limits The limits applied to the script
+     * @param[in] logOutput The script output if success
+     * @return True on success, false if failure to run the script
+     */
+    bool execScript(const std::string &script, const ExecLimits &limits, std::string& logOutput);
+
+    /**
+     * @brief Runs a script process, collecting its output
+     *
+     * @param process The script process to run
+     * @param[in] logOutput The script output if success, else the failure details and output
+     * @return True on success, false if failure to run the script
+     */
+    bool execScript(ScriptProcess &process, std::string& logOutput);
+
+    /**
+     * @brief Runs a script process, streaming its output to a sink
+     *
+     * @param process The script process to run
+     * @param sink Receives the script output in blocks as it is produced
+     * @param[in] logOutput Empty if success, else the failure details and the last OUTPUT_TAIL_SIZE bytes of output
+     * @return True on success, false if failure to run the script
+     */
+    bool execScript(ScriptProcess &process, const OutputSink &sink, std::string& logOutput);
+
 } // namespace script_utils
 
 #endif // #ifndef SCRIPT_UTILS_HPP
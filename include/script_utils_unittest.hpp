@@ -18,8 +18,11 @@
 #ifndef SCRIPT_UTILS_UNITTEST_HPP
 #define SCRIPT_UTILS_UNITTEST_HPP
 
+#include <string>
+#include <thread>
 #include "gtest/gtest.h"
 #include "script_utils.hpp"
+#include "steady_timer.hpp"
 
 TEST(ScriptUtils, ExecuteScriptAndVerifyOutput_ExpectSuccess)
 {
@@ -43,4 +46,65 @@ TEST(ScriptUtils, ExecuteInvalidScript_ExpectFailure)
     ASSERT_STREQ(logOutput.substr(0, expectedErrorString.length()).c_str(), expectedErrorString.c_str());
 }
 
+#ifndef _WIN32
+TEST(ScriptUtils, ExecuteScriptExceedingTimeout_ExpectFailure)
+{
+    script_utils::ExecLimits limits;
+    limits.timeout_s = 1;
+
+    std::string logOutput;
+    ASSERT_FALSE(script_utils::execScript("echo started; sleep 30", limits, logOutput));
+    ASSERT_NE(std::string::npos, logOutput.find("(timed out)"));
+    ASSERT_NE(std::string::npos, logOutput.find("started"));
+}
+
+TEST(ScriptUtils, ExecuteScriptExceedingOutputLimit_ExpectTruncatedOutput)
+{
+    script_utils::ExecLimits limits;
+    limits.max_output_bytes = 100;
+
+    script_utils::ScriptProcess process("head -c 1000000 /dev/zero | tr '\\0' 'a'", limits);
+    std::string logOutput;
+    ASSERT_TRUE(script_utils::execScript(process, logOutput));
+    ASSERT_TRUE(process.isTruncated());
+    ASSERT_EQ(100u, logOutput.length());
+}
+
+TEST(ScriptUtils, ExecuteScriptsConcurrently_ExpectShortScriptNotHeldByLongOne)
+{
+    // Start both at once, so that the long script would inherit the short one's pipe if it leaked
+    std::string long_output;
+    std::thread long_script([&long_output]() { script_utils::execScript("sleep 3", long_output); });
+
+    steady_timer timer;
+    std::string logOutput;
+    ASSERT_TRUE(script_utils::execScript("echo done", logOutput));
+    const int64_t elapsed_ms = timer.get_elapsed_time_in_millseconds();
+    long_script.join();
+
+    ASSERT_STREQ("done\n", logOutput.c_str());
+    ASSERT_LT(elapsed_ms, 2000);
+}
+
+TEST(ScriptUtils, ExecuteScriptClosingStdoutThenHanging_ExpectTimeout)
+{
+    script_utils::ExecLimits limits;
+    limits.timeout_s = 1;
+
+    std::string logOutput;
+    ASSERT_FALSE(script_utils::execScript("echo started; exec >&-; sleep 30", limits, logOutput));
+    ASSERT_NE(std::string::npos, logOutput.find("(timed out)"));
+}
+
+TEST(ScriptUtils, KillScriptBeforeRun_ExpectFailure)
+{
+    script_utils::ScriptProcess process("echo 'should not run'", script_utils::ExecLimits());
+    process.kill();
+
+    std::string logOutput;
+    ASSERT_FALSE(script_utils::execScript(process, logOutput));
+    ASSERT_EQ(std::string::npos, logOutput.find("should not run"));
+}
+#endif // #ifndef _WIN32
+
 #endif // #ifndef SCRIPT_UTILS_UNITTEST_HPP
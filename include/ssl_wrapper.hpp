@@ -7,9 +7,48 @@
 #define SSLWRAPPER_HPP
 
 #include <string>
+#include <openssl/evp.h>
 #include "log.hpp"
 #include "tpm_wrapper.hpp"
 
+/*
+ * The algorithm and size of a key pair
+ */
+struct KeySpec
+{
+    enum Algorithm
+    {
+        RSA,
+        EC,
+        ED25519
+    };
+
+    Algorithm algorithm;
+    /// @brief The modulus size for RSA, the size of the curve for EC and Ed25519
+    int bits;
+
+    /// @brief Parse a name such as RSA-2048, RSA-3072, EC-P256, EC-P384 or ED25519, ignoring case.
+    /// Ed25519 needs OpenSSL 1.1.1 or later.
+    /// @return True if the name is a supported key type
+    static bool parse(const std::string &name, KeySpec &spec);
+
+    /// @brief Get the name of the key type, as accepted by parse
+    const std::string name() const;
+
+    bool operator==(const KeySpec &other) const
+    {
+        return algorithm == other.algorithm && bits == other.bits;
+    }
+
+    bool operator<(const KeySpec &other) const
+    {
+        return algorithm != other.algorithm ? algorithm < other.algorithm : bits < other.bits;
+    }
+};
+
+/// @brief The key type of CSRs whose instructions do not give one
+const KeySpec DEFAULT_CSR_KEY_SPEC = {KeySpec::RSA, 2048};
+
 /*
  * Stores the CSR generation instructions obtained from KeyScaler
  */
@@ -19,6 +58,7 @@ public:
     CsrInstructions() 
         : caSubject{ false }
         , storeEncrypted{ false } 
+        , keySpec(DEFAULT_CSR_KEY_SPEC)
     { 
     }
 
@@ -54,11 +94,21 @@ public:
         return certificateId;
     }
 
+    inline const KeySpec &getKeySpec() const
+    {
+        return keySpec;
+    }
+
+    inline void setKeySpec(const KeySpec &spec)
+    {
+        keySpec = spec;
+    }
+
     inline void printCSR() const
     {
         Log *logger = Log::getInstance();
 
-        logger->printf(Log::Debug, " %s certificateId: %s, assetId: %s, commonName: %s, fileName: %s, storeEncrypted: %d, caSubject %d", __func__, certificateId.c_str(), assetId.c_str(), commonName.c_str(), fileName.c_str(), storeEncrypted,caSubject);
+        logger->printf(Log::Debug, " %s certificateId: %s, assetId: %s, commonName: %s, fileName: %s, storeEncrypted: %d, caSubject %d, keyType: %s", __func__, certificateId.c_str(), assetId.c_str(), commonName.c_str(), fileName.c_str(), storeEncrypted,caSubject, keySpec.name().c_str());
     }
 
     void setCSRInfo(const std::string certId, const std::string assetId,const std::string commonName,const std::string fileName,const bool storeEncrypted,bool caSubject)
@@ -78,6 +128,7 @@ private:
     std::string fileName;
     bool storeEncrypted;
     bool caSubject;
+    KeySpec keySpec;
 };
 
 // Uses openssl APIs tp generate key pair and CSR
@@ -129,10 +180,21 @@ public:
     /// @return True on success, else false.
     bool writeCertificateToStorageProvider(const std::string &certificate, const std::string &cert_id, bool store_encrypted);
 
+    /// @brief Generate a new private key
+    /// @param spec The type and size of the key
+    /// @return The key, to be freed by the caller, or null on failure
+    static EVP_PKEY *generatePrivateKey(const KeySpec &spec);
+
+    /// @brief Write a private key as PEM, RSA and EC keys in their traditional formats and Ed25519 keys as PKCS#8
+    /// @param p_key The key
+    /// @param private_key [out] The PEM
+    /// @return True on success
+    static bool writePrivateKey(EVP_PKEY *p_key, std::string &private_key);
+
 private:
     static bool m_use_custom_storage_provider;
 
-    bool generateKeyPair(const std::string& key, const std::string& iv, std::string &priv_str, EVP_PKEY** public_key);
+    bool generateKeyPair(const KeySpec& spec, const std::string& key, const std::string& iv, std::string &priv_str, EVP_PKEY** public_key);
     bool createX509Request(const CsrInstructions& csr_info, EVP_PKEY* p_key, std::string &csr_out_str);
     void freeAll(void *x509_req, void *pKey, void *bne, void *r, void *bio_key, void *bio_csr);
 };
@@ -0,0 +1,130 @@
+/**
+ * \file
+ *
+ * \brief Unit test and benchmark of CSR key types
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef SSL_WRAPPER_UNITTEST_HPP
+#define SSL_WRAPPER_UNITTEST_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include "gtest/gtest.h"
+#include "ssl_wrapper.hpp"
+
+namespace
+{
+    /// @brief The key types a CSR instruction can ask for
+    const std::vector<std::string> CSR_KEY_TYPES = {"RSA-2048", "EC-P256", "EC-P384",
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+                                                    "ED25519"
+#endif // #if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    };
+
+    /// @brief Get the type of the key in a CSR, or NID_undef if the CSR's signature does not verify
+    int verifyCSR(const std::string &csr)
+    {
+        BIO *p_bio = BIO_new_mem_buf((void *)csr.c_str(), (int)csr.size());
+        X509_REQ *p_req = PEM_read_bio_X509_REQ(p_bio, nullptr, nullptr, nullptr);
+        BIO_free(p_bio);
+        if (p_req == nullptr)
+        {
+            return NID_undef;
+        }
+
+        EVP_PKEY *p_key = X509_REQ_get_pubkey(p_req);
+        const int key_type = X509_REQ_verify(p_req, p_key) == 1 ? EVP_PKEY_id(p_key) : NID_undef;
+        EVP_PKEY_free(p_key);
+        X509_REQ_free(p_req);
+        return key_type;
+    }
+} // namespace
+
+TEST(SSLWrapper, GenerateCSR_ExpectKeyTypeOfInstruction)
+{
+    const int expected_key_types[] = {EVP_PKEY_RSA, EVP_PKEY_EC, EVP_PKEY_EC,
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+                                      EVP_PKEY_ED25519
+#endif // #if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    };
+    SSLWrapper ssl_wrapper;
+
+    for (size_t i = 0; i < CSR_KEY_TYPES.size(); ++i)
+    {
+        CsrInstructions csr_info;
+        csr_info.setCSRInfo("certificate", "asset", "device.example.com", "device.pem", false, false);
+        KeySpec spec;
+        ASSERT_TRUE(KeySpec::parse(CSR_KEY_TYPES[i], spec));
+        ASSERT_EQ(CSR_KEY_TYPES[i], spec.name());
+        csr_info.setKeySpec(spec);
+
+        std::string csr;
+        std::string private_key;
+        ASSERT_TRUE(ssl_wrapper.generateCSR(csr_info, "key", "iv", "key_id", csr, private_key)) << CSR_KEY_TYPES[i];
+        ASSERT_EQ(expected_key_types[i], verifyCSR(csr)) << CSR_KEY_TYPES[i];
+        ASSERT_NE(std::string::npos, private_key.find("PRIVATE KEY")) << CSR_KEY_TYPES[i];
+    }
+}
+
+TEST(SSLWrapper, DefaultKeySpec_ExpectRSA2048)
+{
+    CsrInstructions csr_info;
+    ASSERT_TRUE(DEFAULT_CSR_KEY_SPEC == csr_info.getKeySpec());
+    ASSERT_EQ("RSA-2048", csr_info.getKeySpec().name());
+}
+
+// Time to generate a key and to sign with it for each key type, run with --gtest_also_run_disabled_tests
+TEST(SSLWrapper, DISABLED_BenchmarkKeyTypes)
+{
+    const int keygen_iterations = 10;
+    const int sign_iterations = 200;
+    const std::string message(256, 'm');
+
+    for (size_t i = 0; i < CSR_KEY_TYPES.size(); ++i)
+    {
+        KeySpec spec;
+        ASSERT_TRUE(KeySpec::parse(CSR_KEY_TYPES[i], spec));
+
+        EVP_PKEY *p_key = nullptr;
+        const std::chrono::steady_clock::time_point keygen_start = std::chrono::steady_clock::now();
+        for (int j = 0; j < keygen_iterations; ++j)
+        {
+            EVP_PKEY_free(p_key);
+            p_key = SSLWrapper::generatePrivateKey(spec);
+            ASSERT_TRUE(p_key != nullptr);
+        }
+        const int64_t keygen_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - keygen_start).count();
+
+        // Ed25519 signs the message in one go, the others sign its SHA-256 digest
+        const EVP_MD *p_md = spec.algorithm == KeySpec::ED25519 ? nullptr : EVP_sha256();
+        std::vector<unsigned char> signature(EVP_PKEY_size(p_key));
+        const std::chrono::steady_clock::time_point sign_start = std::chrono::steady_clock::now();
+        for (int j = 0; j < sign_iterations; ++j)
+        {
+            EVP_MD_CTX *p_ctx = EVP_MD_CTX_create();
+            size_t signature_size = signature.size();
+            ASSERT_EQ(1, EVP_DigestSignInit(p_ctx, nullptr, p_md, nullptr, p_key));
+            ASSERT_EQ(1, EVP_DigestSign(p_ctx, signature.data(), &signature_size, (const unsigned char *)message.c_str(), message.size()));
+            EVP_MD_CTX_destroy(p_ctx);
+        }
+        const int64_t sign_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sign_start).count();
+        EVP_PKEY_free(p_key);
+
+        printf("%-8s %8.2f ms per key, %8.1f us per signature\n", CSR_KEY_TYPES[i].c_str(),
+               (double)keygen_us / keygen_iterations / 1000, (double)sign_us / sign_iterations);
+    }
+}
+
+#endif // #ifndef SSL_WRAPPER_UNITTEST_HPP
@@ -258,7 +258,7 @@ public:
 
     std::string getDeviceTid()
     {
-        return "";
+        return m_tid;
     }
 
     bool getIDCToken(std::string &token)
@@ -266,6 +266,10 @@ public:
         return true;
     }
 
+    void invalidateSession()
+    {
+    }
+
     bool destroyInstance()
     {
         return true;
@@ -281,7 +285,7 @@ public:
         m_userId = user;
     }
 
-    const std::string &getUserId() const override
+    std::string getUserId() const override
     {
         return m_userId;
     }
@@ -291,9 +295,13 @@ public:
         return true;
     }
 
-    const std::string getUDI() const override
+    std::string getUDI() const override
+    {
+        return m_udi;
+    }
+
+    void invalidateIdentity() override
     {
-        return "my-device-udi";
     }
 
     const std::string &userAgentString() const
@@ -335,6 +343,8 @@ private:
     std::string m_apiURL;
     std::string m_userAgent;
     std::string m_platform;
+    std::string m_tid;
+    std::string m_udi = "my-device-udi";
 };
 
 #endif // #ifndef TEST_DEVICEAUTHORITY_HPP
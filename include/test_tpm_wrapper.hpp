@@ -8,9 +8,11 @@
 #define TEST_TPM_WRAPPER_HPP
 
 #include <algorithm>
+#include <chrono>
 #include <fcntl.h>
 #include <map>
 #include <string>
+#include <thread>
 #include "log.hpp"
 #include "tpm_wrapper_base.hpp"
 
@@ -36,6 +38,18 @@ public:
         m_random_bytes_queue[random_bytes.size()] = random_bytes;
     }
 
+    /// @brief Make each seal, unseal and delete take as long as a real TPM would
+    void setLatency(std::chrono::microseconds latency)
+    {
+        m_latency = latency;
+    }
+
+    /// @brief Get the number of unseals made
+    size_t unsealCount() const
+    {
+        return m_unseal_count;
+    }
+
     bool getRandom(size_t num_bytes, std::vector<char> &random_bytes) const override
     {
         // Use fixed value if given, else generate random using /dev/urandom
@@ -59,6 +73,7 @@ public:
     bool createSeal(const std::string &path, const std::vector<char> &data, bool overwrite = false) override
     {
         Log::getInstance()->printf(Log::Debug, "Adding data to path %s", path.c_str());
+        std::this_thread::sleep_for(m_latency);
 
         if (!overwrite)
         {
@@ -72,6 +87,8 @@ public:
 
     bool unseal(const std::string &path, std::vector<char> &data) override
     {
+        std::this_thread::sleep_for(m_latency);
+        ++m_unseal_count;
         auto iter = m_sealed_data.find(path);
         if (iter != m_sealed_data.end())
         {
@@ -89,6 +106,7 @@ public:
 
     bool deleteKey(const std::string &path) override
     {
+        std::this_thread::sleep_for(m_latency);
         auto iter = m_sealed_data.find(path);
         if (iter != m_sealed_data.end())
         {
@@ -105,6 +123,9 @@ private:
 
     std::map<int, std::vector<char>> m_random_bytes_queue;
 
+    std::chrono::microseconds m_latency{0};
+
+    size_t m_unseal_count{0};
 };
 
 #else
@@ -126,6 +147,15 @@ public:
 
     }
 
+    void setLatency(std::chrono::microseconds latency)
+    {
+    }
+
+    size_t unsealCount() const
+    {
+        return 0;
+    }
+
     bool getRandom(size_t num_bytes, std::vector<char> &random_bytes) const override
     {
         return false;
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Runs the operations of a TPM wrapper one at a time on a worker thread
+ */
+#ifndef TPM_JOB_QUEUE_HPP
+#define TPM_JOB_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tpm_wrapper_base.hpp"
+
+/**
+ * @brief A TPM wrapper that queues every operation for one worker thread, which alone uses the wrapped TPM.
+ *
+ * @details A FAPI context must not be used by two threads at once, and the TPM executes one command at a time
+ * anyway, so the operations of all the agent's threads are run in the order they were submitted on the thread
+ * that owns the context. The caller waits for its operation to finish. An unseal of a path that is already
+ * queued and not yet finished is not queued again: the caller waits for the queued one and gets its result. A
+ * seal or delete of the path stops later unseals from joining an earlier one, so they see the new data.
+ */
+class TpmJobQueue : public TpmWrapperBase
+{
+public:
+    /**
+     * @brief Constructor - starts the worker thread
+     *
+     * @param p_tpm The TPM wrapper to run the operations on, which is deleted with the queue
+     */
+    explicit TpmJobQueue(TpmWrapperBase *p_tpm);
+
+    /// @brief Destructor - finishes the queued operations, stops the worker and deletes the wrapped TPM
+    virtual ~TpmJobQueue();
+
+    bool getRandom(size_t num_bytes, std::vector<char> &random_str) const override;
+
+    bool createSeal(const std::string &path, const std::vector<char> &data, bool overwrite = false) override;
+
+    bool unseal(const std::string &path, std::vector<char> &data) override;
+
+    bool deleteKey(const std::string &path) override;
+
+    /// @brief Get the number of operations queued or running
+    size_t pending() const;
+
+    /// @brief Get the number of unseals answered by joining one already queued
+    size_t coalescedUnseals() const;
+
+private:
+    /// @brief An operation and its result, value-initialised so that it starts not done
+    struct Job
+    {
+        enum Kind
+        {
+            GetRandom,
+            CreateSeal,
+            Unseal,
+            DeleteKey
+        };
+
+        Kind kind;
+        std::string path;
+        std::vector<char> data;
+        size_t num_bytes;
+        bool overwrite;
+        bool done;
+        bool success;
+    };
+
+    TpmWrapperBase *mp_tpm;
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_wake;
+    mutable std::condition_variable m_done;
+    mutable std::deque<std::shared_ptr<Job>> m_jobs;
+    /// @brief The unseals queued and not yet finished, by path
+    mutable std::map<std::string, std::shared_ptr<Job>> m_unseals;
+    size_t m_running;
+    size_t m_coalesced;
+    bool m_stopping;
+    std::thread m_thread;
+
+    /// @brief Queue a job and wait for it to finish, returning whether it succeeded
+    bool run(const std::shared_ptr<Job> &p_job) const;
+
+    /// @brief Wait for a queued job to finish, with the lock held, returning whether it succeeded
+    bool wait(std::unique_lock<std::mutex> &lock, const std::shared_ptr<Job> &p_job) const;
+
+    void work();
+
+    TpmJobQueue(const TpmJobQueue &);
+    TpmJobQueue &operator=(const TpmJobQueue &);
+};
+
+#endif // #ifndef TPM_JOB_QUEUE_HPP
@@ -0,0 +1,199 @@
+/**
+ * \file
+ *
+ * \brief Unit test and benchmark of the TPM job queue, on the test TPM wrapper
+ *
+ * \author Copyright (c) 2024 by Device Authority Ltd. ALL RIGHTS RESERVED.
+ *
+ * This document contains CONFIDENTIAL, PROPRIETARY, PATENTABLE
+ * and/or TRADE SECRET information belonging to Device Authority Ltd. and may
+ * not be reproduced or adapted, in whole or in part, without prior
+ * written permission from Device Authority Ltd.
+ *
+ */
+
+#ifndef TPM_JOB_QUEUE_UNITTEST_HPP
+#define TPM_JOB_QUEUE_UNITTEST_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "steady_timer.hpp"
+#include "test_tpm_wrapper.hpp"
+#include "tpm_job_queue.hpp"
+
+namespace
+{
+    /// @brief Wait until the queue holds at least a number of operations
+    bool waitForPending(const TpmJobQueue &queue, size_t count)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            if (queue.pending() >= count)
+            {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    std::vector<char> toData(const std::string &text)
+    {
+        return std::vector<char>(text.begin(), text.end());
+    }
+} // namespace
+
+TEST(TpmJobQueue, SealAndUnseal_ExpectOperationsInOrder)
+{
+    TpmJobQueue queue(new TestTpmWrapper());
+    ASSERT_TRUE(queue.initialised());
+    ASSERT_TRUE(queue.isTpmAvailable());
+
+    std::vector<char> data;
+    ASSERT_FALSE(queue.unseal("mySeal", data));
+    ASSERT_TRUE(queue.createSeal("mySeal", toData("first")));
+    ASSERT_FALSE(queue.createSeal("mySeal", toData("second")));
+    ASSERT_TRUE(queue.createSeal("mySeal", toData("second"), true));
+    ASSERT_TRUE(queue.unseal("mySeal", data));
+    ASSERT_EQ(toData("second"), data);
+    ASSERT_TRUE(queue.deleteKey("mySeal"));
+    ASSERT_FALSE(queue.unseal("mySeal", data));
+
+    std::vector<char> random_bytes;
+    ASSERT_TRUE(queue.getRandom(16, random_bytes));
+    ASSERT_EQ(16u, random_bytes.size());
+    ASSERT_EQ(0u, queue.pending());
+}
+
+TEST(TpmJobQueue, ConcurrentUnseals_ExpectCoalesced)
+{
+    TestTpmWrapper *p_tpm = new TestTpmWrapper();
+    ASSERT_TRUE(p_tpm->createSeal("mySeal", toData("secret")));
+    p_tpm->setLatency(std::chrono::milliseconds(50));
+    TpmJobQueue queue(p_tpm);
+
+    // Keep the worker busy so that every unseal is queued while the first is waiting
+    std::thread busy([&queue]() { queue.createSeal("other", toData("other")); });
+    ASSERT_TRUE(waitForPending(queue, 1));
+
+    const int threads = 8;
+    std::vector<std::vector<char>> results(threads);
+    std::vector<int> successes(threads, 0);
+    std::vector<std::thread> unsealers;
+    for (int i = 0; i < threads; ++i)
+    {
+        unsealers.push_back(std::thread([&queue, &results, &successes, i]() { successes[i] = queue.unseal("mySeal", results[i]); }));
+    }
+    for (auto thread_iter = unsealers.begin(); thread_iter != unsealers.end(); ++thread_iter)
+    {
+        thread_iter->join();
+    }
+    busy.join();
+
+    for (int i = 0; i < threads; ++i)
+    {
+        ASSERT_TRUE(successes[i]);
+        ASSERT_EQ(toData("secret"), results[i]);
+    }
+    ASSERT_EQ(1u, p_tpm->unsealCount());
+    ASSERT_EQ((size_t)threads - 1, queue.coalescedUnseals());
+}
+
+TEST(TpmJobQueue, SealAfterQueuedUnseal_ExpectLaterUnsealSeesNewData)
+{
+    TestTpmWrapper *p_tpm = new TestTpmWrapper();
+    ASSERT_TRUE(p_tpm->createSeal("mySeal", toData("old")));
+    p_tpm->setLatency(std::chrono::milliseconds(20));
+    TpmJobQueue queue(p_tpm);
+
+    std::thread busy([&queue]() { queue.createSeal("other", toData("other")); });
+    ASSERT_TRUE(waitForPending(queue, 1));
+
+    std::vector<char> before;
+    std::thread early([&queue, &before]() { queue.unseal("mySeal", before); });
+    ASSERT_TRUE(waitForPending(queue, 2));
+    std::thread seal([&queue]() { queue.createSeal("mySeal", toData("new"), true); });
+    ASSERT_TRUE(waitForPending(queue, 3));
+
+    std::vector<char> after;
+    ASSERT_TRUE(queue.unseal("mySeal", after));
+    early.join();
+    seal.join();
+    busy.join();
+
+    ASSERT_EQ(toData("old"), before);
+    ASSERT_EQ(toData("new"), after);
+    ASSERT_EQ(0u, queue.coalescedUnseals());
+}
+
+TEST(TpmJobQueue, DISABLED_BenchmarkUnseal)
+{
+    const int threads = 8;
+    const int unseals = 50;
+    const int paths = 4;
+    const std::chrono::microseconds latency(1000);
+
+    // Direct use of the TPM, serialised as a FAPI context requires
+    TestTpmWrapper direct_tpm;
+    for (int p = 0; p < paths; ++p)
+    {
+        ASSERT_TRUE(direct_tpm.createSeal("key" + std::to_string(p), toData("secret")));
+    }
+    direct_tpm.setLatency(latency);
+    std::mutex direct_mutex;
+    std::vector<std::thread> workers;
+    steady_timer direct_timer;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&direct_tpm, &direct_mutex, t]() {
+            std::vector<char> data;
+            for (int i = 0; i < unseals; ++i)
+            {
+                std::lock_guard<std::mutex> lock(direct_mutex);
+                direct_tpm.unseal("key" + std::to_string((t + i) % paths), data);
+            }
+        }));
+    }
+    for (auto thread_iter = workers.begin(); thread_iter != workers.end(); ++thread_iter)
+    {
+        thread_iter->join();
+    }
+    const int64_t direct_ms = direct_timer.get_elapsed_time_in_millseconds();
+
+    TestTpmWrapper *p_tpm = new TestTpmWrapper();
+    for (int p = 0; p < paths; ++p)
+    {
+        ASSERT_TRUE(p_tpm->createSeal("key" + std::to_string(p), toData("secret")));
+    }
+    p_tpm->setLatency(latency);
+    TpmJobQueue queue(p_tpm);
+    workers.clear();
+    steady_timer queued_timer;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&queue, t]() {
+            std::vector<char> data;
+            for (int i = 0; i < unseals; ++i)
+            {
+                queue.unseal("key" + std::to_string((t + i) % paths), data);
+            }
+        }));
+    }
+    for (auto thread_iter = workers.begin(); thread_iter != workers.end(); ++thread_iter)
+    {
+        thread_iter->join();
+    }
+    const int64_t queued_ms = queued_timer.get_elapsed_time_in_millseconds();
+
+    const double operations = threads * unseals;
+    printf("unseal: %8.0f ops/s direct, %8.0f ops/s queued (%lu TPM unseals for %.0f requests)\n",
+           operations * 1000 / (direct_ms ? direct_ms : 1), operations * 1000 / (queued_ms ? queued_ms : 1),
+           (unsigned long)p_tpm->unsealCount(), operations);
+}
+
+#endif // #ifndef TPM_JOB_QUEUE_UNITTEST_HPP
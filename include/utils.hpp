@@ -18,7 +18,7 @@
 #endif // #if defined(WIN32)
 #include <sys/stat.h>
 #include <errno.h>
-#include "base64.h"
+#include "base64.hpp"
 #include "dacryptor.hpp"
 #include "byte.h"
 #include "rapidjson/rapidjson.h"
@@ -4,6 +4,8 @@
  * Unit tests for the common utils functions
  */
 
+#include <cstdio>
+#include <fstream>
 #include "gtest/gtest.h"
 #include "utils.hpp"
 
@@ -121,6 +123,33 @@ TEST(Utils, TestEncryptDecryptFile_TestSuccess)
     ASSERT_STREQ(pk.c_str(), "abcdefg");
 }
 
+TEST(Utils, Sha256AndEncodeEmptyFile_TestFailure)
+{
+    const std::string file_path{"/tmp/test_empty.bin"};
+    {
+        std::ofstream ofs(file_path.c_str(), std::ofstream::binary);
+    }
+
+    std::string hash;
+    ASSERT_FALSE(utils::sha256AndEncode(file_path, true, true, hash));
+    ASSERT_TRUE(hash.empty());
+    std::remove(file_path.c_str());
+}
+
+TEST(Utils, Sha256AndEncodeFile_TestSuccess)
+{
+    const std::string file_path{"/tmp/test_abc.bin"};
+    {
+        std::ofstream ofs(file_path.c_str(), std::ofstream::binary);
+        ofs << "abc";
+    }
+
+    std::string hash;
+    ASSERT_TRUE(utils::sha256AndEncode(file_path, true, true, hash));
+    ASSERT_EQ("ungWv48Bz+pBQUDeXa4iI7ADYaOWF3qctBD/YfIAFa0=", hash);
+    std::remove(file_path.c_str());
+}
+
 TEST(Utils, TestGetFileNameFromWindowsFilePath_TestSuccess)
 {
     const std::string m_file_path{ "C:\\ABC\\DEF\\GHIJK.txt" };
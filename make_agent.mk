@@ -18,22 +18,30 @@ OBJECT_FILES_CC=
 
 # Object Files (source .cpp extension)
 OBJECT_FILES_CXX= \
+	${OBJECT_DIR}/asset_decoder.o \
 	${OBJECT_DIR}/asset_manager.o \
 	${OBJECT_DIR}/apm_asset_processor.o \
 	${OBJECT_DIR}/app_utils.o \
 	${OBJECT_DIR}/async_exec_script.o \
 	${OBJECT_DIR}/account.o \
+	${OBJECT_DIR}/event_dispatcher.o \
 	${OBJECT_DIR}/event_manager.o \
 	${OBJECT_DIR}/ssl_wrapper.o \
+	${OBJECT_DIR}/key_pool.o \
+	${OBJECT_DIR}/key_material_cache.o \
 	${OBJECT_DIR}/timehelper.o \
 	${OBJECT_DIR}/opensslhelper.o \
+	${OBJECT_DIR}/config_watcher.o \
 	${OBJECT_DIR}/configuration.o \
 	${OBJECT_DIR}/log.o \
 	${OBJECT_DIR}/dacryptor.o \
 	${OBJECT_DIR}/deviceauthority.o \
 	${OBJECT_DIR}/dahttpclient.o \
+	${OBJECT_DIR}/download_file.o \
+	${OBJECT_DIR}/evp_crypto.o \
 	${OBJECT_DIR}/bytestring.o \
 	${OBJECT_DIR}/utils.o \
+	${OBJECT_DIR}/json_arena.o \
 	${OBJECT_DIR}/jsonparse.o \
 	${OBJECT_DIR}/jsonpath.o \
 	${OBJECT_DIR}/policy.o \
@@ -44,10 +52,12 @@ OBJECT_FILES_CXX= \
 	${OBJECT_DIR}/http_worker_loop.o \
 	${OBJECT_DIR}/http_asset_messenger.o \
 	${OBJECT_DIR}/script_asset_processor.o \
+	${OBJECT_DIR}/script_result_writer.o \
 	${OBJECT_DIR}/script_utils.o \
 	${OBJECT_DIR}/certificate_data_asset_processor.o \
 	${OBJECT_DIR}/certificate_asset_processor.o \
 	${OBJECT_DIR}/group_asset_processor.o \
+	${OBJECT_DIR}/tpm_job_queue.o \
 	${OBJECT_DIR}/tpm_wrapper.o \
 	${OBJECT_DIR}/main.o
 
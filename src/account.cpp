@@ -5,7 +5,7 @@
  */
 #include <sstream>
 #include "account.hpp"
-#include "base64.h"
+#include "base64.hpp"
 #include "log.hpp"
 #include "utils.hpp"
 
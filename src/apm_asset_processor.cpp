@@ -11,6 +11,7 @@
 #include <sstream>
 #include "account.hpp"
 #include "apm_asset_processor.hpp"
+#include "asset_decoder.hpp"
 #include "event_manager.hpp"
 #include "message_factory.hpp"
 #include "script_utils.hpp"
@@ -44,133 +45,91 @@ bool ApmAssetProcessor::processPasswordManagementRequest(const rapidjson::Value
 {
     Log *p_logger = Log::getInstance();
 
-    // autoRotate
-    if (json.HasMember("autoRotate"))
-    {
-        const rapidjson::Value &auto_rotate_val = json["autoRotate"];
-        bool autoRotate = auto_rotate_val.GetBool();
+    bool auto_rotate = false;
+    int polling_rate = 0;
+    const rapidjson::Value *p_accounts_val = nullptr;
+    AssetDecoder decoder;
+    decoder.field("autoRotate", auto_rotate)
+        .field("pollingRate", polling_rate)
+        .field("apmPasswords", p_accounts_val, "No apmPasswords information received. Nothing to process (apmPasswords is not present in json).");
+    const bool decoded = decoder.decode(json);
 
-        if (autoRotate && json.HasMember("pollingRate"))
-        {
-            const rapidjson::Value &polling_rate_val = json["pollingRate"];
-            sleep_value_from_ks = polling_rate_val.GetInt();
-            p_logger->printf(Log::Debug, " %s pollingRate: %d", __func__, sleep_value_from_ks);
-        }
+    if (auto_rotate && decoder.present("pollingRate"))
+    {
+        sleep_value_from_ks = polling_rate;
+        p_logger->printf(Log::Debug, " %s pollingRate: %d", __func__, sleep_value_from_ks);
     }
 
     std::vector<account *> account_info;
-
-    // apmPasswords
-    if (json.HasMember("apmPasswords"))
+    if (!decoded)
     {
-        // Get the number of accounts
-        const rapidjson::Value &accounts_val = json["apmPasswords"];
-        unsigned int accounts = accounts_val.Size();
+        message = MessageFactory::buildApmPasswordsMessage(account_info);
+        p_logger->printf(Log::Error, " %s %s", __func__, decoder.errorMessage().c_str());
 
-        p_logger->printf(Log::Information, " %s Processing APM policy for %d account(s)", __func__, accounts);
-        for (unsigned int c = 0; c < accounts; c++)
+        return false;
+    }
+
+    // Get the number of accounts
+    const rapidjson::Value &accounts_val = *p_accounts_val;
+    unsigned int accounts = accounts_val.Size();
+
+    // The decoder of the account records, reused for each one
+    std::string name;
+    std::string salt;
+    std::string hash;
+    AssetDecoder account_decoder;
+    account_decoder.field("account", name, "Name is missing")
+        .field("salt", salt, "Salt info is missing")
+        .field("hash", hash, "Hash info is missing");
+
+    p_logger->printf(Log::Information, " %s Processing APM policy for %d account(s)", __func__, accounts);
+    for (unsigned int c = 0; c < accounts; c++)
+    {
+        std::string reason;
+        std::string result = account::success;
+        name.clear();
+        salt.clear();
+        hash.clear();
+
+        const rapidjson::Value &account_val = accounts_val[c];
+        if (account_val.IsObject())
         {
-            std::string name;
-            std::string salt;
-            std::string hash;
-            std::string reason;
-            std::string result = account::success;
-
-            const rapidjson::Value &account_val = accounts_val[c];
-            if (!account_val.IsNull())
+            const bool account_decoded = account_decoder.decode(account_val);
+            if (!name.empty())
             {
-                // Account Name
-                if (account_val.HasMember("account"))
-                {
-                    const rapidjson::Value &account_name_val = account_val["account"];
-                    if (!account_name_val.IsNull())
-                    {
-                        const std::string account_name_str = account_name_val.GetString();
-                        p_logger->printf(Log::Information, " %s Account name: %s, len: %d", __func__, account_name_str.c_str(), account_name_str.length());
-                        name.append(account_name_str);
-                    }
-                }
-                if (name.empty())
-                {
-                    result = account::failure;
-
-                    std::ostringstream oss;
-                    oss << "Name is missing in account record #" << c;
-                    reason = oss.str();
-                    p_logger->printf(Log::Error, " %s FATAL! Name info missing..skipping account record #%d", __func__, c);
-                }
-                else
-                {
-                    // Salt
-                    if (account_val.HasMember("salt"))
-                    {
-                        const rapidjson::Value &salt_val = account_val["salt"];
-                        if (!salt_val.IsNull())
-                        {
-                            const std::string salt_str = salt_val.GetString();
-                            salt.append(salt_str);
-                        }
-                    }
-                    if (salt.empty())
-                    {
-                        result = account::failure;
-
-                        std::ostringstream oss;
-                        oss << "Salt info is missing in account record #" << c;
-                        reason = oss.str();
-                        p_logger->printf(Log::Error, " %s FATAL! Salt info missing..skipping account record #%d", __func__, c);
-                    }
-                    else
-                    {
-                        // Hash
-                        if (account_val.HasMember("hash"))
-                        {
-                            const rapidjson::Value &hash_val = account_val["hash"];
-                            if (!hash_val.IsNull())
-                            {
-                                const std::string hash_str = hash_val.GetString();
-                                hash.append(hash_str);
-                            }
-                        }
-                        if (hash.empty())
-                        {
-                            result = account::failure;
-
-                            std::ostringstream oss;
-                            oss << "Hash info is missing in account record #" << c;
-                            reason = oss.str();
-                            p_logger->printf(Log::Error, " %s FATAL! Hash info missing..skipping account record #%d", __func__, c);
-                        }
-                    }
-                }
+                p_logger->printf(Log::Information, " %s Account name: %s, len: %d", __func__, name.c_str(), name.length());
             }
-            else
+            if (!account_decoded)
             {
                 result = account::failure;
 
                 std::ostringstream oss;
-                oss << "Account is missing in record #" << c;
+                oss << account_decoder.errorMessage(", ") << " in account record #" << c;
                 reason = oss.str();
-                p_logger->printf(Log::Error, " %s FATAL! Account missing..skipping record #%d", __func__, c);
+                p_logger->printf(Log::Error, " %s FATAL! %s..skipping account record #%d", __func__, account_decoder.errorMessage(", ").c_str(), c);
             }
-
-            account_info.push_back(new account(name, salt, hash, result, reason));
         }
-
-        if (account_info.size())
+        else
         {
-            return updatePasswords(account_info, key, message);
+            result = account::failure;
+
+            std::ostringstream oss;
+            oss << "Account is missing in record #" << c;
+            reason = oss.str();
+            p_logger->printf(Log::Error, " %s FATAL! Account missing..skipping record #%d", __func__, c);
         }
 
-        // Empty apmPasswords array
-        message = MessageFactory::buildApmPasswordsMessage(account_info);
-        p_logger->printf(Log::Error, " %s No apmPasswords information received. Nothing to process (apmPasswords array is empty).", __func__);
+        account_info.push_back(new account(name, salt, hash, result, reason));
+    }
 
-        return false;
+    if (account_info.size())
+    {
+        return updatePasswords(account_info, key, message);
     }
-    // Missing apmPasswords array
+
+    // Empty apmPasswords array
     message = MessageFactory::buildApmPasswordsMessage(account_info);
-    p_logger->printf(Log::Error, " %s No apmPasswords information received. Nothing to process (apmPasswords is not present in json).", __func__);
+    p_logger->printf(Log::Error, " %s No apmPasswords information received. Nothing to process (apmPasswords array is empty).", __func__);
 
     return false;
 }
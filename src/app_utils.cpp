@@ -4,7 +4,11 @@
  * Application utility functions.
  */
 
+#include <sstream>
+#include <vector>
 #include "app_utils.hpp"
+#include "constants.hpp"
+#include "key_pool.hpp"
 #include "version.h"
 #include "win_cert_store_factory.hpp"
 
@@ -67,4 +71,77 @@ namespace app_utils
             printf("\n");
         }
     }
+
+    bool initialise_logger(Log* p_logger, const Configuration& config)
+    {
+        // Empty string means logging is off
+        std::string log_file_name;
+        // Empty string means syslog logging is off
+        std::string syslog_host;
+        // 514 is default syslog port
+        unsigned int syslog_port = 514;
+
+        if (config.exists(CFG_SYSLOGHOST))
+        {
+            syslog_host.append(config.lookup(CFG_SYSLOGHOST));
+        }
+        if (config.exists(CFG_SYSLOGPORT))
+        {
+            syslog_port = config.lookupAsLong(CFG_SYSLOGPORT);
+        }
+        if (config.exists(CFG_LOGFILENAME))
+        {
+            log_file_name.append(config.lookup(CFG_LOGFILENAME));
+        }
+
+        unsigned long max_log_size = config.lookupAsLong(CFG_ROTATELOGAFTER);
+        return p_logger->initialise(std::string("credentialmanager"), log_file_name, max_log_size, syslog_host, syslog_port);
+    }
+
+    bool reload_configuration(Log* p_logger)
+    {
+        if (!config.reload())
+        {
+            return false;
+        }
+        if (!initialise_logger(p_logger, config))
+        {
+            p_logger->printf(Log::Warning, " %s No log file configured after reload", __func__);
+        }
+        return true;
+    }
+
+    bool start_key_pool(Log* p_logger, const Configuration& config)
+    {
+        const long size = config.lookupAsLong(CFG_KEY_POOL_SIZE);
+        if (size <= 0)
+        {
+            return false;
+        }
+
+        std::vector<KeySpec> specs;
+        std::string name;
+        std::istringstream iss(config.lookup(CFG_KEY_POOL_TYPES));
+        while (std::getline(iss, name, ','))
+        {
+            // Allow spaces around the commas, e.g. "RSA-2048, EC-P256"
+            const size_t first = name.find_first_not_of(" \t");
+            if (first == std::string::npos)
+            {
+                continue;
+            }
+            name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+
+            KeySpec spec;
+            if (KeySpec::parse(name, spec))
+            {
+                specs.push_back(spec);
+            }
+            else
+            {
+                p_logger->printf(Log::Warning, " %s Unknown key type '%s' in %s", __func__, name.c_str(), CFG_KEY_POOL_TYPES);
+            }
+        }
+        return KeyPool::getInstance()->start(specs, (size_t)size);
+    }
 }
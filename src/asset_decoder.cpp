@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Decodes the fields of a received asset in a single pass over its members
+ */
+
+#include <cstring>
+#include "asset_decoder.hpp"
+
+namespace
+{
+    /// @brief Enough for the fields of any asset type, so declaring them does not reallocate
+    const size_t EXPECTED_FIELDS = 16;
+} // namespace
+
+AssetDecoder::AssetDecoder()
+{
+    m_fields.reserve(EXPECTED_FIELDS);
+}
+
+AssetDecoder &AssetDecoder::field(const char *name, std::string &value, const char *missing_message)
+{
+    return add(name, String, &value, missing_message);
+}
+
+AssetDecoder &AssetDecoder::field(const char *name, bool &value, const char *missing_message)
+{
+    return add(name, Bool, &value, missing_message);
+}
+
+AssetDecoder &AssetDecoder::field(const char *name, int &value, const char *missing_message)
+{
+    return add(name, Int, &value, missing_message);
+}
+
+AssetDecoder &AssetDecoder::field(const char *name, const rapidjson::Value *&p_value, const char *missing_message)
+{
+    p_value = nullptr;
+    return add(name, Array, &p_value, missing_message);
+}
+
+AssetDecoder &AssetDecoder::lenient()
+{
+    if (!m_fields.empty())
+    {
+        m_fields.back().lenient = true;
+    }
+    return *this;
+}
+
+bool AssetDecoder::decode(const rapidjson::Value &json)
+{
+    m_errors.clear();
+    for (auto field_iter = m_fields.begin(); field_iter != m_fields.end(); ++field_iter)
+    {
+        field_iter->present = false;
+        field_iter->type_error = false;
+    }
+
+    if (json.IsObject())
+    {
+        for (rapidjson::Value::ConstMemberIterator member_iter = json.MemberBegin(); member_iter != json.MemberEnd(); ++member_iter)
+        {
+            const rapidjson::Value &name = member_iter->name;
+            for (auto field_iter = m_fields.begin(); field_iter != m_fields.end(); ++field_iter)
+            {
+                if (field_iter->name_length == name.GetStringLength() && memcmp(field_iter->name, name.GetString(), field_iter->name_length) == 0)
+                {
+                    if (!member_iter->value.IsNull())
+                    {
+                        field_iter->present = store(*field_iter, member_iter->value);
+                        field_iter->type_error = !field_iter->present && !field_iter->lenient;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    static const char *const TYPE_NAMES[] = {"a string", "a boolean", "an integer", "an array"};
+    for (auto field_iter = m_fields.begin(); field_iter != m_fields.end(); ++field_iter)
+    {
+        if (field_iter->type_error)
+        {
+            m_errors.push_back(std::string(field_iter->name) + " is not " + TYPE_NAMES[field_iter->type] + ".");
+        }
+        else if (field_iter->missing_message != nullptr &&
+                 (!field_iter->present || (field_iter->type == String && ((std::string *)field_iter->p_value)->empty())))
+        {
+            m_errors.push_back(field_iter->missing_message);
+        }
+    }
+
+    return m_errors.empty();
+}
+
+bool AssetDecoder::present(const char *name) const
+{
+    for (auto field_iter = m_fields.begin(); field_iter != m_fields.end(); ++field_iter)
+    {
+        if (strcmp(field_iter->name, name) == 0)
+        {
+            return field_iter->present;
+        }
+    }
+    return false;
+}
+
+std::string AssetDecoder::errorMessage(const char *separator) const
+{
+    std::string message;
+    for (auto error_iter = m_errors.begin(); error_iter != m_errors.end(); ++error_iter)
+    {
+        if (!message.empty())
+        {
+            message.append(separator);
+        }
+        message.append(*error_iter);
+    }
+    return message;
+}
+
+AssetDecoder &AssetDecoder::add(const char *name, Type type, void *p_value, const char *missing_message)
+{
+    Field field = {name, (rapidjson::SizeType)strlen(name), type, p_value, missing_message, false, false, false};
+    m_fields.push_back(field);
+    return *this;
+}
+
+bool AssetDecoder::store(const Field &field, const rapidjson::Value &value)
+{
+    switch (field.type)
+    {
+    case String:
+        if (!value.IsString())
+        {
+            return false;
+        }
+        ((std::string *)field.p_value)->assign(value.GetString(), value.GetStringLength());
+        return true;
+    case Bool:
+        if (!value.IsBool())
+        {
+            return false;
+        }
+        *(bool *)field.p_value = value.GetBool();
+        return true;
+    case Int:
+        if (!value.IsInt())
+        {
+            return false;
+        }
+        *(int *)field.p_value = value.GetInt();
+        return true;
+    case Array:
+        if (!value.IsArray())
+        {
+            return false;
+        }
+        *(const rapidjson::Value **)field.p_value = &value;
+        return true;
+    }
+    return false;
+}
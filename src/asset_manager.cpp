@@ -30,7 +30,7 @@
 
 #include "account.hpp"
 #include "asset_manager.hpp"
-#include "base64.h"
+#include "base64.hpp"
 #include "configuration.hpp"
 #include "constants.hpp"
 #include "deviceauthority.hpp"
@@ -4,46 +4,178 @@
 
 #include <cstring>
 #include "async_exec_script.hpp"
+#include "configuration.hpp"
+#include "constants.hpp"
 #include "log.hpp"
 #include "script_utils.hpp"
 
-void *runScript(void *p_data)
+ScriptJob::ScriptJob(const std::string &script, const script_utils::ExecLimits &limits, const script_utils::OutputSink &sink)
+    : m_process(script, limits), m_sink(sink), m_finished(false), m_success(false)
 {
-    ThreadResult* p_thread_data = (ThreadResult*)p_data;
-    if (p_thread_data)
+    pthread_mutex_init(&m_lock, NULL);
+}
+
+ScriptJob::~ScriptJob()
+{
+    pthread_mutex_destroy(&m_lock);
+}
+
+void ScriptJob::run()
+{
+    std::string log_output;
+    const bool success = m_sink ?
+        script_utils::execScript(m_process, m_sink, log_output) :
+        script_utils::execScript(m_process, log_output);
+
+    pthread_mutex_lock(&m_lock);
+    m_log_output.swap(log_output);
+    m_success = success;
+    m_finished = true;
+    pthread_mutex_unlock(&m_lock);
+}
+
+void ScriptJob::fail(const std::string &message)
+{
+    pthread_mutex_lock(&m_lock);
+    m_log_output = message;
+    m_success = false;
+    m_finished = true;
+    pthread_mutex_unlock(&m_lock);
+}
+
+void ScriptJob::cancel()
+{
+    m_process.kill();
+}
+
+bool ScriptJob::isFinished() const
+{
+    pthread_mutex_lock(&m_lock);
+    const bool finished = m_finished;
+    pthread_mutex_unlock(&m_lock);
+    return finished;
+}
+
+bool ScriptJob::isSuccess() const
+{
+    return m_success;
+}
+
+const std::string &ScriptJob::getLogOutput() const
+{
+    return m_log_output;
+}
+
+bool ScriptJob::isTruncated() const
+{
+    return m_process.isTruncated();
+}
+
+ScriptExecPool *ScriptExecPool::getInstance()
+{
+    // Constructed once and never destroyed, idle workers are left waiting on the queue at exit
+    static ScriptExecPool *p_instance = new ScriptExecPool((unsigned int)config.lookupAsLong(CFG_SCRIPT_MAX_CONCURRENT));
+    return p_instance;
+}
+
+ScriptExecPool::ScriptExecPool(unsigned int max_concurrent)
+    : m_max_concurrent(max_concurrent > 0 ? max_concurrent : 1), m_workers(0), m_idle_workers(0)
+{
+    pthread_mutex_init(&m_lock, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+void ScriptExecPool::submit(const std::shared_ptr<ScriptJob> &job)
+{
+    pthread_mutex_lock(&m_lock);
+    m_queue.push_back(job);
+    // Each idle worker takes one queued job, so start another while the queue outnumbers them
+    if (m_queue.size() > m_idle_workers && m_workers < m_max_concurrent)
+    {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_t handle;
+        if (pthread_create(&handle, &attr, &workerThread, this) == 0)
+        {
+            ++m_workers;
+        }
+        else
+        {
+            Log::getInstance()->printf(Log::Error, "Failed to create script executing thread");
+            if (m_workers == 0)
+            {
+                // No worker would ever take the job, so fail it rather than leave it queued
+                m_queue.pop_back();
+                job->fail("Failed to create script executing thread");
+            }
+        }
+        pthread_attr_destroy(&attr);
+    }
+    else if (m_queue.size() > m_idle_workers)
     {
-        p_thread_data->m_success = script_utils::execScript(p_thread_data->m_script.c_str(), p_thread_data->m_log_output);
-        p_thread_data->m_finished = true;
+        Log::getInstance()->printf(Log::Information, "%u scripts already running, script queued", m_workers);
     }
-    return (void*)p_thread_data;
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_lock);
 }
 
-AsyncExecScript::AsyncExecScript(const std::string &script)
-	: m_thread_data(script), m_thread_running(false)
+void *ScriptExecPool::workerThread(void *p_data)
 {
-    if (pthread_create(&m_handle, NULL, &runScript, (void *)&m_thread_data) != 0)
+    ScriptExecPool *p_pool = (ScriptExecPool *)p_data;
+
+    pthread_mutex_lock(&p_pool->m_lock);
+    while (true)
     {
-        Log::getInstance()->printf(Log::Error, "Failed to create script executing thread");
+        while (p_pool->m_queue.empty())
+        {
+            ++p_pool->m_idle_workers;
+            pthread_cond_wait(&p_pool->m_cond, &p_pool->m_lock);
+            --p_pool->m_idle_workers;
+        }
+
+        std::shared_ptr<ScriptJob> job = p_pool->m_queue.front();
+        p_pool->m_queue.pop_front();
+        pthread_mutex_unlock(&p_pool->m_lock);
+
+        job->run();
+        job.reset();
+
+        pthread_mutex_lock(&p_pool->m_lock);
     }
+
+    return nullptr;
+}
+
+AsyncExecScript::AsyncExecScript(const std::string &script)
+	: m_job(new ScriptJob(script, script_utils::configuredLimits(), script_utils::OutputSink())), m_thread_running(true)
+{
+    ScriptExecPool::getInstance()->submit(m_job);
+}
+
+AsyncExecScript::AsyncExecScript(const std::string &script, const script_utils::OutputSink &sink)
+	: m_job(new ScriptJob(script, script_utils::configuredLimits(), sink)), m_thread_running(true)
+{
+    ScriptExecPool::getInstance()->submit(m_job);
 }
 
 AsyncExecScript::~AsyncExecScript()
 {
     if (m_thread_running)
     {
-        pthread_cancel(m_handle);
+        // The pool keeps its own reference to the job, so it is safe to let go once the script is killed
+        m_job->cancel();
         m_thread_running = false;
     }
 }
 
 bool AsyncExecScript::tryJoin()
 {
-    if (!m_thread_data.m_finished)
+    if (!m_job->isFinished())
     {
-        // Thread still running
+        // Script still queued or running
         return false;
     }
-    pthread_join(m_handle, nullptr);
     m_thread_running = false;
 
     return true;
@@ -55,7 +187,7 @@ bool AsyncExecScript::isSuccess() const
     {
         return false;
     }
-    return m_thread_data.m_success;
+    return m_job->isSuccess();
 }
 
 const std::string AsyncExecScript::getScriptOutput() const
@@ -64,5 +196,14 @@ const std::string AsyncExecScript::getScriptOutput() const
     {
         return "";
     }
-    return m_thread_data.m_log_output;
+    return m_job->getLogOutput();
+}
+
+bool AsyncExecScript::isTruncated() const
+{
+    if (m_thread_running)
+    {
+        return false;
+    }
+    return m_job->isTruncated();
 }
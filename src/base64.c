@@ -2,68 +2,404 @@
  * Copyright (c) 2015 deviceauthority. - All rights reserved. - www.deviceauthority.com
  *
  * Functions to perform base64 encoding and decoding.
+ *
+ * The bulk of the input goes through SSSE3 or AVX2 kernels on x86, chosen at run time, or NEON kernels on
+ * AArch64. The kernels stop at anything they can not handle, such as padding or invalid characters, and the
+ * table driven scalar code finishes off, so the results are the same on every CPU.
  */
 
 #include "base64.h"
+#include "base64_testing.h"
 #include <string.h>
 #include <stdio.h>
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
-/* Because binary representation is back to front need to put the
- * octets in backwards
- */
-struct Octet
-{
-    unsigned int fourth : 6;
-    unsigned int third : 6;
-    unsigned int second : 6;
-    unsigned int first : 6;
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BASE64_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BASE64_TARGET(isa)
+#else
+#define BASE64_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define BASE64_NEON
+#include <arm_neon.h>
+#endif
+
+static const char encodeMap[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* The value of each base64 character, 0xff for the rest */
+static const unsigned char decodeMap[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
 };
 
-/* Because binary representation is back to front need to put the
- * characters in backwards
- */
-struct Byte
+enum Base64Kernel
 {
-    unsigned int third : 8;
-    unsigned int second : 8;
-    unsigned int first : 8;
+    KERNEL_UNKNOWN,
+    KERNEL_SCALAR,
+    KERNEL_SSSE3,
+    KERNEL_AVX2,
+    KERNEL_NEON
 };
 
-static union
-{
-    struct Byte bytes;
-    struct Octet octs; 
-} con;
+static int scalarOnly = 0;
 
 unsigned char decodeTable(char input)
 {
-    if (input == '+')
-        return 62;
-    if (input == '/')
-        return 63;
-    if ((input >= '0') && (input <= '9'))
-        return input + 4;
-    if ((input >= 'A') && (input <= 'Z'))
-        return input - 65;
-    if ((input >= 'a') && (input <= 'z'))
-        return input - 71;
-    return -1;
+    return decodeMap[(unsigned char)input];
 }
 
 char encodeTable(unsigned char input)
 {
-    const char encodeMap[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    return encodeMap[input & 0x3f];
+}
+
+#if defined(BASE64_X86)
+
+static int detectKernel(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        __cpuid(info, 1);
+        /* AVX2 also needs the OS to save the YMM registers */
+        if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6))
+        {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5))
+                return KERNEL_AVX2;
+        }
+    }
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) ? KERNEL_SSSE3 : KERNEL_SCALAR;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return KERNEL_AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return KERNEL_SSSE3;
+    return KERNEL_SCALAR;
+#endif
+}
+
+/* Map 6 bit values to their base64 characters */
+BASE64_TARGET("ssse3") static __m128i encodeLookupSsse3(__m128i indices)
+{
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+}
+
+/* Split 12 bytes, spread over the 16 bytes of the input, into 16 6 bit values */
+BASE64_TARGET("ssse3") static __m128i encodeSplitSsse3(__m128i input)
+{
+    const __m128i in = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+/* Map 16 base64 characters to 6 bit values, returning 0 if any is not a base64 character */
+BASE64_TARGET("ssse3") static int decodeLookupSsse3(__m128i in, __m128i *values)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+    const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), nibbleMask);
+    const __m128i lo = _mm_shuffle_epi8(lutLo, _mm_and_si128(in, nibbleMask));
+    const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xffff)
+        return 0;
+    const __m128i eq2f = _mm_cmpeq_epi8(in, _mm_set1_epi8(0x2f));
+    *values = _mm_add_epi8(in, _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2f, hiNibbles)));
+    return 1;
+}
+
+/* Pack 16 6 bit values into 12 bytes at the start of the result */
+BASE64_TARGET("ssse3") static __m128i decodePackSsse3(__m128i values)
+{
+    const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+BASE64_TARGET("ssse3") static unsigned int encodeSsse3(const unsigned char *in, unsigned int length, char *out)
+{
+    unsigned int c = 0;
+    /* Each block reads 16 bytes to encode 12 */
+    for (; c + 16 <= length; c += 12)
+    {
+        const __m128i indices = encodeSplitSsse3(_mm_loadu_si128((const __m128i *)(in + c)));
+        _mm_storeu_si128((__m128i *)out, encodeLookupSsse3(indices));
+        out += 16;
+    }
+    return c;
+}
+
+BASE64_TARGET("ssse3") static unsigned int decodeSsse3(const char *in, unsigned int length, unsigned char *out, unsigned int size)
+{
+    unsigned int c = 0;
+    unsigned int o = 0;
+    /* Each block writes 16 bytes to decode 12 */
+    for (; c + 16 <= length && o + 16 <= size; c += 16, o += 12)
+    {
+        __m128i values;
+        if (!decodeLookupSsse3(_mm_loadu_si128((const __m128i *)(in + c)), &values))
+            break;
+        _mm_storeu_si128((__m128i *)(out + o), decodePackSsse3(values));
+    }
+    return c;
+}
+
+BASE64_TARGET("avx2") static unsigned int encodeAvx2(const unsigned char *in, unsigned int length, char *out)
+{
+    const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                           'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    unsigned int c = 0;
+    /* Each block reads 28 bytes to encode 24, 12 in each lane */
+    for (; c + 28 <= length; c += 24)
+    {
+        const __m256i input = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + c))),
+                                                      _mm_loadu_si128((const __m128i *)(in + c + 12)), 1);
+        const __m256i spread = _mm256_shuffle_epi8(input, shuffle);
+        const __m256i t0 = _mm256_and_si256(spread, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(spread, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i *)out, _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices));
+        out += 32;
+    }
+    return c;
+}
+
+BASE64_TARGET("avx2") static unsigned int decodeAvx2(const char *in, unsigned int length, unsigned char *out, unsigned int size)
+{
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+    unsigned int c = 0;
+    unsigned int o = 0;
+    /* Each block writes 32 bytes to decode 24 */
+    for (; c + 32 <= length && o + 32 <= size; c += 32, o += 24)
+    {
+        const __m256i input = _mm256_loadu_si256((const __m256i *)(in + c));
+        const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), nibbleMask);
+        const __m256i lo = _mm256_shuffle_epi8(lutLo, _mm256_and_si256(input, nibbleMask));
+        const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+        const __m256i eq2f = _mm256_cmpeq_epi8(input, _mm256_set1_epi8(0x2f));
+        const __m256i values = _mm256_add_epi8(input, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2f, hiNibbles)));
+        const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i packed = _mm256_shuffle_epi8(_mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000)), pack);
+        /* Bring the 12 bytes from each lane together */
+        _mm256_storeu_si256((__m256i *)(out + o), _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7)));
+    }
+    return c;
+}
+
+#elif defined(BASE64_NEON)
+
+static int detectKernel(void)
+{
+    /* NEON is part of the AArch64 base architecture */
+    return KERNEL_NEON;
+}
 
-    return encodeMap[input];
+static unsigned int encodeNeon(const unsigned char *in, unsigned int length, char *out)
+{
+    const uint8x16x4_t lookup = { { vld1q_u8((const uint8_t *)encodeMap), vld1q_u8((const uint8_t *)encodeMap + 16),
+                                    vld1q_u8((const uint8_t *)encodeMap + 32), vld1q_u8((const uint8_t *)encodeMap + 48) } };
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+    unsigned int c = 0;
+    for (; c + 48 <= length; c += 48)
+    {
+        const uint8x16x3_t bytes = vld3q_u8(in + c);
+        uint8x16x4_t chars;
+        chars.val[0] = vshrq_n_u8(bytes.val[0], 2);
+        chars.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), mask);
+        chars.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), mask);
+        chars.val[3] = vandq_u8(bytes.val[2], mask);
+        chars.val[0] = vqtbl4q_u8(lookup, chars.val[0]);
+        chars.val[1] = vqtbl4q_u8(lookup, chars.val[1]);
+        chars.val[2] = vqtbl4q_u8(lookup, chars.val[2]);
+        chars.val[3] = vqtbl4q_u8(lookup, chars.val[3]);
+        vst4q_u8((uint8_t *)out, chars);
+        out += 64;
+    }
+    return c;
+}
+
+static unsigned int decodeNeon(const char *in, unsigned int length, unsigned char *out, unsigned int size)
+{
+    /* Two tables for the characters below 128, anything out of range of a table looks up as 0 */
+    const uint8x16x4_t lookupLo = { { vld1q_u8(decodeMap), vld1q_u8(decodeMap + 16), vld1q_u8(decodeMap + 32), vld1q_u8(decodeMap + 48) } };
+    const uint8x16x4_t lookupHi = { { vld1q_u8(decodeMap + 64), vld1q_u8(decodeMap + 80), vld1q_u8(decodeMap + 96), vld1q_u8(decodeMap + 112) } };
+    const uint8x16_t offset = vdupq_n_u8(64);
+    unsigned int c = 0;
+    unsigned int o = 0;
+    for (; c + 64 <= length && o + 48 <= size; c += 64, o += 48)
+    {
+        const uint8x16x4_t chars = vld4q_u8((const uint8_t *)in + c);
+        uint8x16_t values[4];
+        uint8x16_t invalid = vdupq_n_u8(0);
+        uint8x16x3_t bytes;
+        int i;
+        for (i = 0; i < 4; ++i)
+        {
+            values[i] = vorrq_u8(vqtbl4q_u8(lookupLo, chars.val[i]), vqtbl4q_u8(lookupHi, vsubq_u8(chars.val[i], offset)));
+            /* 0xff marks an invalid character, and characters of 128 or more miss both tables */
+            invalid = vorrq_u8(invalid, vorrq_u8(vcgtq_u8(values[i], vdupq_n_u8(63)), vcgeq_u8(chars.val[i], vdupq_n_u8(128))));
+        }
+        if (vmaxvq_u8(invalid) != 0)
+            break;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(values[0], 2), vshrq_n_u8(values[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(values[1], 4), vshrq_n_u8(values[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(values[2], 6), values[3]);
+        vst3q_u8(out + o, bytes);
+    }
+    return c;
+}
+
+#else
+
+static int detectKernel(void)
+{
+    return KERNEL_SCALAR;
+}
+
+#endif
+
+static int detected = KERNEL_UNKNOWN;
+
+#if defined(WIN32)
+static BOOL CALLBACK detectOnce(PINIT_ONCE once, PVOID parameter, PVOID *context)
+{
+    detected = detectKernel();
+    return TRUE;
+}
+#else
+static void detectOnce(void)
+{
+    detected = detectKernel();
+}
+#endif
+
+static int kernel(void)
+{
+    /* Detected on first use, once, so that threads starting together all see the result */
+#if defined(WIN32)
+    static INIT_ONCE once = INIT_ONCE_STATIC_INIT;
+    InitOnceExecuteOnce(&once, detectOnce, NULL, NULL);
+#else
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, detectOnce);
+#endif
+    return scalarOnly ? KERNEL_SCALAR : detected;
+}
+
+/* Encode as many whole blocks as the kernel can, returning the number of bytes encoded */
+static unsigned int encodeBlocks(const unsigned char *in, unsigned int length, char *out)
+{
+    switch (kernel())
+    {
+#if defined(BASE64_X86)
+    case KERNEL_AVX2:
+    {
+        const unsigned int c = encodeAvx2(in, length, out);
+        return c + encodeSsse3(in + c, length - c, out + c / 3 * 4);
+    }
+    case KERNEL_SSSE3:
+        return encodeSsse3(in, length, out);
+#elif defined(BASE64_NEON)
+    case KERNEL_NEON:
+        return encodeNeon(in, length, out);
+#endif
+    default:
+        return 0;
+    }
+}
+
+/* Decode as many whole blocks as the kernel can, returning the number of characters decoded */
+static unsigned int decodeBlocks(const char *in, unsigned int length, unsigned char *out, unsigned int size)
+{
+    switch (kernel())
+    {
+#if defined(BASE64_X86)
+    case KERNEL_AVX2:
+    {
+        const unsigned int c = decodeAvx2(in, length, out, size);
+        const unsigned int o = c / 4 * 3;
+        return c + decodeSsse3(in + c, length - c, out + o, size - o);
+    }
+    case KERNEL_SSSE3:
+        return decodeSsse3(in, length, out, size);
+#elif defined(BASE64_NEON)
+    case KERNEL_NEON:
+        return decodeNeon(in, length, out, size);
+#endif
+    default:
+        return 0;
+    }
 }
 
 unsigned int base64Decode(const char *textToDecode, unsigned char *decodedByteBuffer, unsigned int decodedByteBufferSize)
 {
-    unsigned short bytesToDrop;
-    unsigned int decodedPos = 0;
+    if (!textToDecode)
+    {
+        return 0;
+    }
+    return base64DecodeLength(textToDecode, strlen(textToDecode), decodedByteBuffer, decodedByteBufferSize);
+}
+
+unsigned int base64DecodeLength(const char *textToDecode, unsigned int textToDecodeLength, unsigned char *decodedByteBuffer, unsigned int decodedByteBufferSize)
+{
+    unsigned int decodedPos;
     unsigned int c;
-    unsigned char value = 64;
-    const unsigned int textToDecodeLength = strlen( textToDecode );
+    unsigned int i;
     if (!textToDecode)
     {
         return 0;
@@ -72,159 +408,108 @@ unsigned int base64Decode(const char *textToDecode, unsigned char *decodedByteBu
     {
         return 0;
     }
-    for (c = 0; c < textToDecodeLength; c = c + 4)
+    c = decodeBlocks(textToDecode, textToDecodeLength, decodedByteBuffer, decodedByteBufferSize);
+    decodedPos = c / 4 * 3;
+    for (; c < textToDecodeLength; c = c + 4)
     {
-        bytesToDrop = 0;
-        value = decodeTable(textToDecode[c]);
-        if (value > 64) return 0;
-        con.octs.first = value;
-        if (c+1 < textToDecodeLength)
+        unsigned char values[4] = { 0, 0, 0, 0 };
+        unsigned short bytesToDrop = 0;
+        for (i = 0; i < 4; ++i)
         {
-            value = decodeTable(textToDecode[c+1]);
-            if (value > 64) return 0;
-            con.octs.second = value;
+            if (c + i >= textToDecodeLength || (i >= 2 && textToDecode[c + i] == '='))
+            {
+                /* Missing or padding characters after the first two drop a byte */
+                if (i >= 2)
+                    ++bytesToDrop;
+                continue;
+            }
+            values[i] = decodeMap[(unsigned char)textToDecode[c + i]];
+            if (values[i] > 64) return 0;
         }
-        if (c+2 < textToDecodeLength && textToDecode[c+2] != '=')
+        /* Fail rather than truncate when the buffer is too small */
+        if (decodedPos + 3 - bytesToDrop > decodedByteBufferSize)
         {
-            value = decodeTable(textToDecode[c+2]);
-            if (value > 64) return 0;
-            con.octs.third = value;
-        }
-        else
-            ++bytesToDrop;
-        if (c+3 < textToDecodeLength && textToDecode[c+3] != '=')
-        {
-            value = decodeTable(textToDecode[c+3]);
-            if (value > 64) return 0;
-            con.octs.fourth = value;
-        }
-        else
-            ++bytesToDrop;
-        if (decodedPos >= decodedByteBufferSize)
-        {
-            decodedPos = 0;
-            break;
-        }
-        decodedByteBuffer[decodedPos] = con.bytes.first;
-        ++decodedPos;
-        if (decodedPos >= decodedByteBufferSize)
-        {
-            decodedPos = 0;
-            break;
+            return 0;
         }
+        decodedByteBuffer[decodedPos++] = (unsigned char)((values[0] << 2) | (values[1] >> 4));
         if (bytesToDrop < 2)
-        {
-            decodedByteBuffer[decodedPos] = con.bytes.second;
-            ++decodedPos;
-        }
-        if (decodedPos >= decodedByteBufferSize)
-        {
-            decodedPos = 0;
-            break;
-        }
+            decodedByteBuffer[decodedPos++] = (unsigned char)((values[1] << 4) | (values[2] >> 2));
         if (bytesToDrop < 1)
-        {
-            decodedByteBuffer[decodedPos] = con.bytes.third;
-            ++decodedPos;
-        }
+            decodedByteBuffer[decodedPos++] = (unsigned char)((values[2] << 6) | values[3]);
     }
     return decodedPos;
 }
 
 unsigned int base64Encode(const unsigned char *bytesToEncode, unsigned int bytesToEncodeLength, char *encodedTextBuffer, unsigned int encodedTextBufferSize)
 {
-    unsigned short octsToDrop;
-    unsigned int encodedPos = 0;
+    unsigned int encodedLength;
+    unsigned int encodedPos;
     unsigned int c;
     if (!bytesToEncode)
     {
-        return encodedPos;
+        return 0;
     }
     if (!encodedTextBuffer)
     {
-        return encodedPos;
+        return 0;
     }
     if (!bytesToEncodeLength)
     {
-        return encodedPos;
+        return 0;
     }
-    for (c = 0; c < bytesToEncodeLength; c = c + 3)
+    /* Fail rather than truncate when the buffer is too small */
+    encodedLength = (bytesToEncodeLength + 2) / 3 * 4;
+    if (encodedLength > encodedTextBufferSize)
     {
-        octsToDrop = 0;
-        con.bytes.first = bytesToEncode[c];
-        if (c+1 < bytesToEncodeLength)
-            con.bytes.second = bytesToEncode[c+1];
-        else
-        {
-            con.bytes.second = 0;
-            ++octsToDrop;
-        }
-        if (c+2 < bytesToEncodeLength)
-            con.bytes.third = bytesToEncode[c+2];
-        else
-        {
-            con.bytes.third = 0;
-            ++octsToDrop;
-        }
-        if (encodedPos >= encodedTextBufferSize)
-        {
-            encodedPos = 0;
-            break;
-        }
-        encodedTextBuffer[encodedPos] = encodeTable(con.octs.first);
-        ++encodedPos;
-        if (encodedPos >= encodedTextBufferSize)
-        {
-            encodedPos = 0;
-            break;
-        }
-        encodedTextBuffer[encodedPos] = encodeTable(con.octs.second);
-        ++encodedPos;
-        if (encodedPos >= encodedTextBufferSize)
-        {
-            encodedPos = 0;
-            break;
-        }
-        if (octsToDrop < 2)
-        {
-            encodedTextBuffer[encodedPos] = encodeTable(con.octs.third);
-            ++encodedPos;
-        }
-        else
+        if (encodedTextBufferSize > 0)
         {
-            encodedTextBuffer[encodedPos] = '=';
-            ++encodedPos;
-        }
-        if (encodedPos >= encodedTextBufferSize)
-        {
-            encodedPos = 0;
-            break;
-        }
-        if (octsToDrop < 1)
-        {
-            encodedTextBuffer[encodedPos] = encodeTable(con.octs.fourth);
-            ++encodedPos;
-        }
-        else
-        {
-            encodedTextBuffer[encodedPos] = '=';
-            ++encodedPos;
+            encodedTextBuffer[0] = '\0';
         }
+        return 0;
+    }
+    c = encodeBlocks(bytesToEncode, bytesToEncodeLength, encodedTextBuffer);
+    encodedPos = c / 3 * 4;
+    for (; c + 3 <= bytesToEncodeLength; c = c + 3)
+    {
+        const unsigned int group = (bytesToEncode[c] << 16) | (bytesToEncode[c + 1] << 8) | bytesToEncode[c + 2];
+        encodedTextBuffer[encodedPos++] = encodeMap[group >> 18];
+        encodedTextBuffer[encodedPos++] = encodeMap[(group >> 12) & 0x3f];
+        encodedTextBuffer[encodedPos++] = encodeMap[(group >> 6) & 0x3f];
+        encodedTextBuffer[encodedPos++] = encodeMap[group & 0x3f];
+    }
+    if (c < bytesToEncodeLength)
+    {
+        const unsigned int second = c + 1 < bytesToEncodeLength ? bytesToEncode[c + 1] : 0;
+        const unsigned int group = (bytesToEncode[c] << 16) | (second << 8);
+        encodedTextBuffer[encodedPos++] = encodeMap[group >> 18];
+        encodedTextBuffer[encodedPos++] = encodeMap[(group >> 12) & 0x3f];
+        encodedTextBuffer[encodedPos++] = c + 1 < bytesToEncodeLength ? encodeMap[(group >> 6) & 0x3f] : '=';
+        encodedTextBuffer[encodedPos++] = '=';
+    }
+    /* Terminate the text when there is room */
+    if (encodedPos < encodedTextBufferSize)
+    {
+        encodedTextBuffer[encodedPos] = '\0';
     }
-    encodedTextBuffer[encodedPos] = '\0';
     return encodedPos;
 }
 
-/*
-int main(int argc, char* argv[])
+void base64SetScalarOnly(int scalarOnlyFlag)
 {
-//    char bytesToEncode[] = "pleasure.";
-//    char textToDecode[] = "cGxlYXN1cmUu";
+    scalarOnly = scalarOnlyFlag;
+}
 
-    if (argv[1][0] == 'E')
-        encode(argv[2]);
-    else
-        decode(argv[2]);
-    return 0;
+const char* base64KernelName(void)
+{
+    switch (kernel())
+    {
+    case KERNEL_AVX2:
+        return "AVX2";
+    case KERNEL_SSSE3:
+        return "SSSE3";
+    case KERNEL_NEON:
+        return "NEON";
+    default:
+        return "scalar";
+    }
 }
-*/
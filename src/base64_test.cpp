@@ -4,10 +4,14 @@
  * This class is a unit test for the Device Authority base 64 functions.
  *
  */
-#include "base64.h"
+#include "base64.hpp"
+#include "base64_testing.h"
 #include "gtest/gtest.h"
+#include "steady_timer.hpp"
 #include <stdio.h>
 #include <string.h>
+#include <string>
+#include <vector>
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -185,3 +189,163 @@ TEST(CryptosoftBase64, ThreadsAreSafeDecode)
     ASSERT_EQ( 7500ul * threads, total );
 }
 #endif
+
+static std::vector<unsigned char> makeBytes(size_t size)
+{
+    std::vector<unsigned char> bytes(size);
+    unsigned int x = 12345;
+    for (size_t i = 0; i < size; ++i)
+    {
+        x = x * 1103515245 + 12345;
+        bytes[i] = (unsigned char)(x >> 16);
+    }
+    return bytes;
+}
+
+static std::string encodeWith(bool scalarOnly, const std::vector<unsigned char>& bytes)
+{
+    base64SetScalarOnly(scalarOnly);
+    std::string text((bytes.size() + 2) / 3 * 4 + 1, '\0');
+    unsigned int sz = base64Encode(bytes.empty() ? NULL : &bytes[0], bytes.size(), &text[0], text.size());
+    base64SetScalarOnly(0);
+    text.resize(sz);
+    return text;
+}
+
+static std::vector<unsigned char> decodeWith(bool scalarOnly, const std::string& text)
+{
+    base64SetScalarOnly(scalarOnly);
+    std::vector<unsigned char> bytes(text.size() / 4 * 3 + 3);
+    unsigned int sz = base64DecodeLength(text.c_str(), text.size(), &bytes[0], bytes.size());
+    base64SetScalarOnly(0);
+    bytes.resize(sz);
+    return bytes;
+}
+
+TEST(CryptosoftBase64, KernelsMatchScalar)
+{
+    // Every length up to several blocks of the widest kernel, with each amount of padding
+    for (size_t size = 0; size < 600; ++size)
+    {
+        const std::vector<unsigned char> bytes = makeBytes(size);
+        const std::string text = encodeWith(false, bytes);
+        ASSERT_EQ( encodeWith(true, bytes), text ) << "size " << size << " kernels " << base64KernelName();
+        ASSERT_EQ( bytes, decodeWith(false, text) ) << "size " << size;
+        ASSERT_EQ( bytes, decodeWith(true, text) ) << "size " << size;
+    }
+}
+
+TEST(CryptosoftBase64, KernelsRejectInvalidCharacters)
+{
+    const std::string text = encodeWith(false, makeBytes(300));
+    const char invalid[] = { '*', '-', '_', ' ', '\n', (char)0x80, (char)0xff };
+    for (size_t pos = 0; pos < text.size(); pos += 7)
+    {
+        for (size_t i = 0; i < sizeof(invalid); ++i)
+        {
+            std::string bad = text;
+            bad[pos] = invalid[i];
+            ASSERT_TRUE( decodeWith(false, bad).empty() ) << "position " << pos;
+            ASSERT_TRUE( decodeWith(true, bad).empty() ) << "position " << pos;
+        }
+    }
+}
+
+TEST(CryptosoftBase64, KernelsStopAtPadding)
+{
+    // Padding part way through is decoded by the scalar code, in the same way with or without the kernels
+    std::string text = encodeWith(false, makeBytes(96));
+    text[62] = '=';
+    text[63] = '=';
+    ASSERT_EQ( decodeWith(true, text), decodeWith(false, text) );
+    ASSERT_EQ( 94u, decodeWith(false, text).size() );
+}
+
+TEST(CryptosoftBase64, EncodeBufferTooSmall)
+{
+    const std::vector<unsigned char> bytes = makeBytes(100);
+    char text[136];
+    ASSERT_EQ( 0u, base64Encode(&bytes[0], bytes.size(), text, 135) );
+    // Exactly the encoded size, without room for the terminator
+    ASSERT_EQ( 136u, base64Encode(&bytes[0], bytes.size(), text, 136) );
+}
+
+TEST(CryptosoftBase64, ExactSizes)
+{
+    for (size_t size = 0; size < 10; ++size)
+    {
+        const std::vector<unsigned char> bytes = makeBytes(size);
+        std::string text;
+        ASSERT_EQ( base64::OK, base64::encodeAppend(bytes.data(), bytes.size(), text) );
+        ASSERT_EQ( base64::encodedSize(size), text.size() );
+        ASSERT_EQ( size, base64::decodedSize(text.data(), text.size()) );
+
+        std::string data = "prefix";
+        ASSERT_EQ( base64::OK, base64::decodeAppend(text, data) );
+        ASSERT_EQ( "prefix" + std::string(bytes.begin(), bytes.end()), data );
+    }
+}
+
+TEST(CryptosoftBase64, TruncationIsReported)
+{
+    const std::vector<unsigned char> bytes = makeBytes(100);
+    char text[136];
+    size_t written = 0;
+    ASSERT_EQ( base64::BUFFER_TOO_SMALL, base64::encode(&bytes[0], bytes.size(), text, 135, written) );
+    ASSERT_EQ( 136u, written );
+    ASSERT_EQ( base64::OK, base64::encode(&bytes[0], bytes.size(), text, 136, written) );
+    ASSERT_EQ( 136u, written );
+
+    unsigned char decoded[100];
+    ASSERT_EQ( base64::BUFFER_TOO_SMALL, base64::decode(text, 136, decoded, 99, written) );
+    ASSERT_EQ( 100u, written );
+    ASSERT_EQ( base64::OK, base64::decode(text, 136, decoded, 100, written) );
+    ASSERT_EQ( 100u, written );
+    ASSERT_EQ( 0, memcmp(&bytes[0], decoded, 100) );
+}
+
+TEST(CryptosoftBase64, InvalidInputLeavesStringUnchanged)
+{
+    std::string data = "unchanged";
+    ASSERT_EQ( base64::INVALID_INPUT, base64::decodeAppend(std::string("MQ*="), data) );
+    ASSERT_EQ( "unchanged", data );
+}
+
+// Throughput of the kernels and the scalar code, run with --gtest_also_run_disabled_tests
+TEST(CryptosoftBase64, DISABLED_Benchmark)
+{
+    const size_t minBytes = 512 * 1024 * 1024;
+    printf("Kernels: %s\n", base64KernelName());
+    for (size_t size = 64; size <= 64 * 1024 * 1024; size *= 16)
+    {
+        const std::vector<unsigned char> bytes = makeBytes(size);
+        std::string text((size + 2) / 3 * 4 + 1, '\0');
+        std::vector<unsigned char> decoded(size + 3);
+        const size_t iterations = size >= minBytes ? 1 : minBytes / size;
+        double gbs[2][2];
+
+        for (int scalarOnly = 0; scalarOnly < 2; ++scalarOnly)
+        {
+            base64SetScalarOnly(scalarOnly);
+            steady_timer timer;
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                base64Encode(&bytes[0], size, &text[0], text.size());
+            }
+            int64_t elapsed = timer.get_elapsed_time_in_millseconds();
+            gbs[scalarOnly][0] = (double)(size * iterations) / (double)(elapsed > 0 ? elapsed : 1) / 1.0e6;
+
+            timer.reset();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                base64DecodeLength(text.c_str(), text.size() - 1, &decoded[0], decoded.size());
+            }
+            elapsed = timer.get_elapsed_time_in_millseconds();
+            gbs[scalarOnly][1] = (double)(size * iterations) / (double)(elapsed > 0 ? elapsed : 1) / 1.0e6;
+        }
+        base64SetScalarOnly(0);
+
+        printf("%9lu bytes: encode %6.2f GB/s (scalar %5.2f), decode %6.2f GB/s (scalar %5.2f)\n",
+               (unsigned long)size, gbs[0][0], gbs[1][0], gbs[0][1], gbs[1][1]);
+    }
+}
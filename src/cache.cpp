@@ -9,7 +9,7 @@
 #include "dacryptor.hpp"
 #include "configuration.hpp"
 #include "log.hpp"
-#include "base64.h"
+#include "base64.hpp"
 #include "byte.h"
 #include <sstream>
 #include <cstring>
@@ -162,9 +162,9 @@ Cache::FetchResponse Cache::fetch( const Lookup& cacheKey, CachedData& cacheValu
     std::string newiv;
     FetchResponse rc = NotAllowed;
     Log *logger = Log::getInstance();
-    static const std::string DAUser = config.lookup(CFG_DAUSERID);
-    static const std::string DAAPIURL = config.lookup(CFG_DAAPIURL);
-    static const std::string deviceName = config.lookup(CFG_DEVICENAME);
+    // Looked up on each call, so that a reloaded configuration is used
+    static const Configuration::Key daApiUrlKey = config.key(CFG_DAAPIURL);
+    const std::string DAAPIURL = config.lookup(daApiUrlKey);
     DeviceAuthorityBase *daInstance = DeviceAuthority::getInstance();
 
     if (!daInstance)
@@ -186,22 +186,21 @@ Cache::FetchResponse Cache::fetch( const Lookup& cacheKey, CachedData& cacheValu
             //logger->printf( Log::Debug, "KeyID is: %s", newkeyid.c_str() );
             //logger->printf( Log::Debug, "Key is: %s", newkey.c_str() );
             //logger->printf( Log::Debug, "IV is: %s", newiv.c_str() );
-            unsigned char decodedData[1024] = {};
-            unsigned int decodedLength = base64Decode( newkey.c_str(), decodedData, 1024 );
+            std::string decoded;
 
-            if (decodedLength)
+            if (base64::decodeAppend(newkey, decoded) == base64::OK && !decoded.empty())
             {
-                newkey = std::string((const char *)decodedData, decodedLength);
+                newkey.swap(decoded);
             }
             else
             {
                 logger->printf(Log::Critical, "Unable to decode key (E).");
                 rc = Error;
             }
-            decodedLength = base64Decode(newiv.c_str(), decodedData, 1024);
-            if (decodedLength)
+            decoded.clear();
+            if (base64::decodeAppend(newiv, decoded) == base64::OK && !decoded.empty())
             {
-                newiv = std::string((const char *)decodedData, decodedLength);
+                newiv.swap(decoded);
             }
             else
             {
@@ -312,22 +311,21 @@ Cache::FetchResponse Cache::fetch( const Lookup& cacheKey, CachedData& cacheValu
                 //logger->printf(Log::Debug, "KeyID is: %s", newkeyid.c_str());
                 //logger->printf(Log::Debug, "Key is: %s", newkey.c_str());
                 //logger->printf(Log::Debug, "IV is: %s", newiv.c_str());
-                unsigned char decodedData[1024] = "";
-                unsigned int decodedLength = base64Decode(newkey.c_str(), decodedData, 1024);
+                std::string decoded;
 
-                if (decodedLength)
+                if (base64::decodeAppend(newkey, decoded) == base64::OK && !decoded.empty())
                 {
-                    newkey = std::string((const char *)decodedData, decodedLength);
+                    newkey.swap(decoded);
                 }
                 else
                 {
                     logger->printf(Log::Critical, "Unable to decode key (E).");
                     rc = Error;
                 }
-                decodedLength = base64Decode(newiv.c_str(), decodedData, 1024);
-                if (decodedLength)
+                decoded.clear();
+                if (base64::decodeAppend(newiv, decoded) == base64::OK && !decoded.empty())
                 {
-                    newiv = std::string((const char *)decodedData, decodedLength);
+                    newiv.swap(decoded);
                 }
                 else
                 {
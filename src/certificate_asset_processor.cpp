@@ -8,7 +8,9 @@
 #include <Windows.h>
 #endif //WIN32
 
+#include <algorithm>
 #include "certificate_asset_processor.hpp"
+#include "asset_decoder.hpp"
 #include "dacryptor.hpp"
 #include "event_manager.hpp"
 #include "message_factory.hpp"
@@ -17,6 +19,12 @@
 #include "win_cert_store_factory.hpp"
 #include "ssl_wrapper.hpp"
 
+namespace
+{
+    /// @brief The error for a certificate asset without a certificate
+    const char *const NO_CERTIFICATE_MESSAGE = "No certificate specified (was expected).";
+} // namespace
+
 CertificateAssetProcessor::CertificateAssetProcessor(const std::string &asset_id, AssetMessenger *p_asset_messenger)
     : AssetProcessor(asset_id, p_asset_messenger)
 {
@@ -47,99 +55,23 @@ bool CertificateAssetProcessor::handleCertificate(const rapidjson::Value &json,
 {
     Log *p_logger = Log::getInstance();
 
-    std::string file_path;
-    if (!json.IsNull() && json.HasMember("filePath"))
+    CertificateAsset asset;
+    if (!decodeCertificate(json, asset, sleep_value_from_ks))
     {
-        const rapidjson::Value &filePathVal = json["filePath"];
-
-        if (!filePathVal.IsNull())
-        {
-            file_path = filePathVal.GetString();
-        }
-    }
-    if (file_path.empty())
-    {
-        m_error_message = "No file path specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
         return false;
     }
-
-    if (json.HasMember("autoRotate"))
-    {
-        const rapidjson::Value &auto_rotate_val = json["autoRotate"];
-        bool auto_rotate = auto_rotate_val.GetBool();
-
-        if (auto_rotate && json.HasMember("pollingRate"))
-        {
-            const rapidjson::Value &polling_rate_val = json["pollingRate"];
-
-            sleep_value_from_ks = polling_rate_val.GetInt();
-            p_logger->printf(Log::Debug, " %s pollingRate: %d", __func__, sleep_value_from_ks);
-        }
-    }
+    const std::string &file_path = asset.file_path;
+    const bool store_encrypted = asset.store_encrypted;
+    std::string &certificate = asset.certificate;
+    std::string &private_key = asset.private_key;
 
     std::string pk_path;
     std::string cert_path;
     utils::getPKAndCertName(pk_path, cert_path, file_path);
     p_logger->printf(Log::Debug, " %s:%d pk_name: %s, cert_name: %s", __func__, __LINE__, pk_path.c_str(), cert_path.c_str());
 
-    bool store_encrypted = false;
-    if (json.HasMember("storeEncrypted"))
-    {
-        const rapidjson::Value &store_encrypted_val = json["storeEncrypted"];
-        store_encrypted = store_encrypted_val.GetBool();
-    }
-    else
-    {
-        m_error_message = "No store encrypted flag specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
-
-    std::string certificate;
-    if (json.HasMember("certificate"))
-    {
-        const rapidjson::Value &certificate_val = json["certificate"];
-        if (!certificate_val.IsNull())
-        {
-            certificate = certificate_val.GetString();
-        }
-    }
-
-    if (certificate.empty())
-    {
-        m_error_message = "No certificate specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-        EventManager::getInstance()->notifyCertificateFailure(m_error_message);
-        return false;
-    }
     EventManager::getInstance()->notifyCertificateReceived();
 
-    std::string key_id_str;
-    if (json.HasMember("keyId"))
-    {
-        const rapidjson::Value &key_id_val = json["keyId"];
-
-        if (!key_id_val.IsNull())
-        {
-            key_id_str = key_id_val.GetString();
-        }
-    }
-
-    // There should be a privateKey element in the JSON if CSR is DAE generated.
-    std::string private_key;
-    if (json.HasMember("privateKey"))
-    {
-        const rapidjson::Value &private_key_val = json["privateKey"];
-
-        if (!private_key_val.IsNull())
-        {
-            private_key = private_key_val.GetString();
-        }
-    }
-
     if (!private_key.empty())
     {
         p_logger->printf(Log::Debug, " %s DAE generated CSR and private key", __func__);
@@ -218,7 +150,7 @@ bool CertificateAssetProcessor::handleCertificate(const rapidjson::Value &json,
         }
 
         // Try to store the private key in {"key-id":"XX", "ciphertext":"YYY"} format
-        if (key_id_str.empty())
+        if (asset.key_id.empty())
         {
             m_error_message = "No KeyId was specified in the KeyScaler response (was expected).";
             p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
@@ -265,18 +197,12 @@ bool CertificateAssetProcessor::handleCertificate(const rapidjson::Value &json,
             return true;
         }
 
-        bool sign_apphash = false;
-        if (json.HasMember("signAppHash"))
-        {
-            sign_apphash = json["signAppHash"].GetBool();
-        }
-
         std::string private_key_json;
-        utils::createJsonEncryptionBlock(key_id, m_asset_id, private_key, private_key_json, false, sign_apphash);
+        utils::createJsonEncryptionBlock(key_id, m_asset_id, private_key, private_key_json, false, asset.sign_apphash);
         private_key = private_key_json;
 
         std::string certificate_json;
-        utils::createJsonEncryptionBlock(key_id, m_asset_id, certificate, certificate_json, false, sign_apphash);
+        utils::createJsonEncryptionBlock(key_id, m_asset_id, certificate, certificate_json, false, asset.sign_apphash);
         certificate = certificate_json;
 
         return writeKeyAndCertificate(pk_path, private_key, cert_path, certificate, store_encrypted);
@@ -337,17 +263,8 @@ bool CertificateAssetProcessor::handleCertificate(const rapidjson::Value &json,
             return true;
         }
 
-        std::string json_key;
         // Get key and iv returned from DAE with generated CERT to decrypt the private key
-        if (json.HasMember("key"))
-        {
-            const rapidjson::Value &key_val = json["key"];
-
-            if (!key_val.IsNull())
-            {
-                json_key = key_val.GetString();
-            }
-        }
+        const std::string &json_key = asset.key;
         if (json_key.empty())
         {
             m_error_message = "No key specified to decrypt private key";
@@ -356,15 +273,7 @@ bool CertificateAssetProcessor::handleCertificate(const rapidjson::Value &json,
             return false;
         }
 
-        std::string json_iv;
-        if (json.HasMember("iv"))
-        {
-            const rapidjson::Value &iv_val = json["iv"];
-            if (!iv_val.IsNull())
-            {
-                json_iv = iv_val.GetString();
-            }
-        }
+        const std::string &json_iv = asset.iv;
         if (json_iv.empty())
         {
             m_error_message = "No iv specified to decrypt PK";
@@ -469,116 +378,23 @@ bool CertificateAssetProcessor::handleCertificate(const rapidjson::Value &json,
 {
     Log *p_logger = Log::getInstance();
 
-    std::string file_path;
-    if (!json.IsNull() && json.HasMember("filePath"))
-    {
-        const rapidjson::Value &filePathVal = json["filePath"];
-
-        if (!filePathVal.IsNull())
-        {
-            file_path = filePathVal.GetString();
-        }
-    }
-    if (file_path.empty())
+    CertificateAsset asset;
+    if (!decodeCertificate(json, asset, sleep_value_from_ks))
     {
-        m_error_message = "No file path specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
         return false;
     }
-
-    if (json.HasMember("autoRotate"))
-    {
-        const rapidjson::Value &auto_rotate_val = json["autoRotate"];
-        bool auto_rotate = auto_rotate_val.GetBool();
-
-        if (auto_rotate && json.HasMember("pollingRate"))
-        {
-            const rapidjson::Value &polling_rate_val = json["pollingRate"];
-
-            sleep_value_from_ks = polling_rate_val.GetInt();
-            p_logger->printf(Log::Debug, " %s pollingRate: %d", __func__, sleep_value_from_ks);
-        }
-    }
+    const std::string &file_path = asset.file_path;
+    const bool store_encrypted = asset.store_encrypted;
+    std::string &certificate = asset.certificate;
+    std::string &private_key = asset.private_key;
 
     std::string pk_name;
     std::string cert_name;
     utils::getPKAndCertName(pk_name, cert_name, file_path);
     p_logger->printf(Log::Debug, " %s:%d pk_name: %s, cert_name: %s", __func__, __LINE__, pk_name.c_str(), cert_name.c_str());
 
-    bool store_encrypted = false;
-    if (json.HasMember("storeEncrypted"))
-    {
-        const rapidjson::Value &store_encrypted_val = json["storeEncrypted"];
-        store_encrypted = store_encrypted_val.GetBool();
-    }
-    else
-    {
-        m_error_message = "No store encrypted flag specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
-
-    std::string certificate;
-    if (json.HasMember("certificate"))
-    {
-        const rapidjson::Value &certificate_val = json["certificate"];
-        if (!certificate_val.IsNull())
-        {
-            certificate = certificate_val.GetString();
-        }
-    }
-    if (certificate.empty())
-    {
-        m_error_message = "No certificate specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
-
     EventManager::getInstance()->notifyCertificateReceived();
 
-    std::string asset_id;
-    if (json.HasMember("assetId"))
-    {
-        const rapidjson::Value &asset_id_val = json["assetId"];
-        if (!asset_id_val.IsNull())
-        {
-            asset_id = asset_id_val.GetString();
-        }
-    }
-    if (asset_id.empty())
-    {
-        m_error_message = "No assetId specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
-
-    std::string key_id_str;
-    if (json.HasMember("keyId"))
-    {
-        const rapidjson::Value &key_id_val = json["keyId"];
-
-        if (!key_id_val.IsNull())
-        {
-            key_id_str = key_id_val.GetString();
-        }
-    }
-
-    // There should be a private_key element in the JSON if CSR is DAE generated.
-    std::string private_key;
-    if (json.HasMember("privateKey"))
-    {
-        const rapidjson::Value &private_key_val = json["privateKey"];
-
-        if (!private_key_val.IsNull())
-        {
-            private_key = private_key_val.GetString();
-        }
-    }
-
     // Must use storage provider. We don't do anything with encrypting as the provider must manage this
     if (SSLWrapper::isUsingCustomStorageProvider())
     {
@@ -720,6 +536,53 @@ bool CertificateAssetProcessor::handleCertificate(const rapidjson::Value &json,
 }
 #endif
 
+bool CertificateAssetProcessor::decodeCertificate(const rapidjson::Value &json, CertificateAsset &asset, unsigned int &sleep_value_from_ks)
+{
+    Log *p_logger = Log::getInstance();
+
+    bool auto_rotate = false;
+    int polling_rate = 0;
+    AssetDecoder decoder;
+    decoder.field("filePath", asset.file_path, "No file path specified (was expected).")
+        .field("autoRotate", auto_rotate)
+        .field("pollingRate", polling_rate)
+        .field("storeEncrypted", asset.store_encrypted, "No store encrypted flag specified (was expected).")
+        .field("certificate", asset.certificate, NO_CERTIFICATE_MESSAGE)
+#if defined(WIN32)
+        .field("assetId", asset.asset_id, "No assetId specified (was expected).")
+#else
+        .field("assetId", asset.asset_id)
+#endif // #if defined(WIN32)
+        .field("keyId", asset.key_id)
+        .field("privateKey", asset.private_key)
+        .field("signAppHash", asset.sign_apphash)
+        .field("key", asset.key)
+        .field("iv", asset.iv);
+    if (!decoder.decode(json))
+    {
+        m_error_message = decoder.errorMessage();
+        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
+#if !defined(WIN32)
+        // Only a missing certificate is a certificate failure, other fields are reported in the receipt
+        const std::vector<std::string> &errors = decoder.errors();
+        if (std::find(errors.begin(), errors.end(), NO_CERTIFICATE_MESSAGE) != errors.end())
+        {
+            EventManager::getInstance()->notifyCertificateFailure(NO_CERTIFICATE_MESSAGE);
+        }
+#endif // #if !defined(WIN32)
+
+        return false;
+    }
+
+    if (auto_rotate && decoder.present("pollingRate"))
+    {
+        sleep_value_from_ks = polling_rate;
+        p_logger->printf(Log::Debug, " %s pollingRate: %d", __func__, sleep_value_from_ks);
+    }
+
+    return true;
+}
+
 bool CertificateAssetProcessor::writeKeyAndCertificate(const std::string &pk_path, const std::string &private_key, const std::string &cert_path, const std::string &certificate, bool store_encrypted)
 {
     Log *p_logger = Log::getInstance();
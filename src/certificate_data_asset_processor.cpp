@@ -6,6 +6,7 @@
  */
 
 #include "certificate_data_asset_processor.hpp"
+#include "asset_decoder.hpp"
 #include "dacryptor.hpp"
 #include "deviceauthority_base.hpp"
 #include "deviceauthority.hpp"
@@ -34,7 +35,8 @@ void CertificateDataAssetProcessor::handleAsset(
     Log *p_logger = Log::getInstance();
 
     CsrInstructions csr_info;
-    m_success = handleCSRData(json, csr_info, sleep_value_from_ks);
+    bool sign_apphash = false;
+    m_success = handleCSRData(json, csr_info, sign_apphash, sleep_value_from_ks);
     const std::string json_receipt = MessageFactory::buildAcknowledgeMessage(m_asset_id, m_success, m_error_message);
     mp_asset_messenger->acknowledgeReceipt(json_receipt, m_error_message);
 
@@ -121,12 +123,6 @@ void CertificateDataAssetProcessor::handleAsset(
             }
             else
             {
-                bool sign_apphash = false;
-                if (json.HasMember("signAppHash"))
-                {
-                    sign_apphash = json["signAppHash"].GetBool();
-                }
-
                 // There is no TPM on the device so we will store the private key using secure soft storage
                 if (!utils::encryptAndStorePK(private_key, newkey, newiv, newkeyid, m_asset_id, csr_info.getFileName(), true, sign_apphash))
                 {
@@ -166,81 +162,64 @@ void CertificateDataAssetProcessor::onUpdate()
 }
 
 /* Handles CSR generation instruction coming from DAE*/
-bool CertificateDataAssetProcessor::handleCSRData(const rapidjson::Value &json, CsrInstructions &csr_info, unsigned int &sleep_value_from_ks)
+bool CertificateDataAssetProcessor::handleCSRData(const rapidjson::Value &json, CsrInstructions &csr_info, bool &sign_apphash, unsigned int &sleep_value_from_ks)
 {
     bool store_encrypted = false;
     bool is_ca = false;
-    Log *p_logger = Log::getInstance();
-
-    p_logger->printf(Log::Debug, " %s:%d ", __func__, __LINE__);
-
-    std::string json_str;
-    // JSON writer
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-
-    json.Accept(writer);
-    json_str = buffer.GetString();
-    p_logger->printf(Log::Debug, "\n %s:%d input: %s", __func__, __LINE__, json_str.c_str());
-    // store_encrypted (mandatory)
-    if (!json.IsNull() && json.HasMember("storeEncrypted"))
-    {
-        const rapidjson::Value &store_encrypted_val = json["storeEncrypted"];
-
-        store_encrypted = store_encrypted_val.GetBool();
-    }
-    else
-    {
-        m_error_message = "No store encrypted flag specified (was expected).";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
-
+    bool auto_rotate = false;
+    int polling_rate = 0;
     std::string file_path;
     std::string common_name;
     std::string certificate_id;
     std::string asset_id;
+    std::string key_type;
     std::string pk_file_name;
+    Log *p_logger = Log::getInstance();
 
-    // CA
-    if (json.HasMember("ca"))
+    if (p_logger->isEnabled(Log::Debug))
     {
-        const rapidjson::Value &ca_val = json["ca"];
-        is_ca = ca_val.GetBool();
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        json.Accept(writer);
+        p_logger->printf(Log::Debug, "\n %s:%d input: %s", __func__, __LINE__, buffer.GetString());
     }
-    // auto_rotate
-    if (json.HasMember("autoRotate"))
-    {
-        const rapidjson::Value &auto_rotate_val = json["autoRotate"];
-        bool auto_rotate = auto_rotate_val.GetBool();
 
-        if (auto_rotate && json.HasMember("pollingRate"))
-        {
-            const rapidjson::Value &polling_rate_val = json["pollingRate"];
+    AssetDecoder decoder;
+    decoder.field("storeEncrypted", store_encrypted, "No store encrypted flag specified (was expected).")
+        .field("ca", is_ca)
+        .field("autoRotate", auto_rotate)
+        .field("pollingRate", polling_rate).lenient()
+        .field("filePath", file_path, "No file_path found in the CSR generation instruction.")
+        .field("commonName", common_name, "No commonName found in the CSR generation instruction.")
+        .field("certificateId", certificate_id, "No certificateId found in the CSR generation instruction.")
+        .field("assetId", asset_id, "No assetId found in the CSR generation instruction.")
+        .field("signAppHash", sign_apphash)
+        .field("keyType", key_type).lenient();
+    if (!decoder.decode(json))
+    {
+        m_error_message = decoder.errorMessage();
+        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
 
-            sleep_value_from_ks = polling_rate_val.GetInt();
-            p_logger->printf(Log::Debug, " %s pollingRate: %d", __func__, sleep_value_from_ks);
-        }
+        return false;
     }
-    // file_path (mandatory)
-    if (json.HasMember("filePath"))
-    {
-        const rapidjson::Value &file_path_val = json["filePath"];
 
-        if (!file_path_val.IsNull())
-        {
-            file_path = file_path_val.GetString();
-            p_logger->printf(Log::Debug, " %s filePath: %s", __func__, file_path.c_str());
-        }
+    if (auto_rotate && decoder.present("pollingRate"))
+    {
+        sleep_value_from_ks = polling_rate;
+        p_logger->printf(Log::Debug, " %s pollingRate: %d", __func__, sleep_value_from_ks);
     }
-    if (file_path.empty())
+    p_logger->printf(Log::Debug, " %s filePath: %s", __func__, file_path.c_str());
+
+    // keyType (optional) is ignored rather than failing the instruction when it is not a string
+    KeySpec key_spec = DEFAULT_CSR_KEY_SPEC;
+    if (!key_type.empty() && !KeySpec::parse(key_type, key_spec))
     {
-        m_error_message = "No file_path found in the CSR generation instruction.";
+        m_error_message = "Unsupported keyType " + key_type + " in the CSR generation instruction.";
         p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
 
         return false;
     }
+
 #ifdef WIN32 // if storing encrypted on windows we don't use file storage so path is irrelevant
     if (!store_encrypted)
     {
@@ -260,58 +239,6 @@ bool CertificateDataAssetProcessor::handleCSRData(const rapidjson::Value &json,
     }
 #endif
 
-
-    // commonName (mandatory)
-    if (json.HasMember("commonName"))
-    {
-        const rapidjson::Value &common_name_val = json["commonName"];
-
-        if (!common_name_val.IsNull())
-        {
-            common_name = common_name_val.GetString();
-        }
-    }
-    if (common_name.empty())
-    {
-        m_error_message = "No commonName found in the CSR generation instruction.";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
-    // certificateId (mandatory)
-    if (json.HasMember("certificateId"))
-    {
-        const rapidjson::Value &certificate_id_val = json["certificateId"];
-
-        if (!certificate_id_val.IsNull())
-        {
-            certificate_id = certificate_id_val.GetString();
-        }
-    }
-    if (certificate_id.empty())
-    {
-        m_error_message = "No certificateId found in the CSR generation instruction.";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
-    // assetId (mandatory)
-    if (json.HasMember("assetId"))
-    {
-        const rapidjson::Value &asset_id_val = json["assetId"];
-
-        if (!asset_id_val.IsNull())
-        {
-            asset_id = asset_id_val.GetString();
-        }
-    }
-    if (asset_id.empty())
-    {
-        m_error_message = "No assetId found in the CSR generation instruction.";
-        p_logger->printf(Log::Error, " %s %s", __func__, m_error_message.c_str());
-
-        return false;
-    }
     if (store_encrypted && !SSLWrapper::isUsingCustomStorageProvider())
     {
         utils::generateKeyPath(file_path, "private_inter.pem", pk_file_name);
@@ -322,6 +249,7 @@ bool CertificateDataAssetProcessor::handleCSRData(const rapidjson::Value &json,
         utils::getPKAndCertName(pk_file_name, cert_name, file_path);
     }
     csr_info.setCSRInfo(certificate_id, asset_id, common_name, pk_file_name, store_encrypted, is_ca);
+    csr_info.setKeySpec(key_spec);
 
     return true;
 }
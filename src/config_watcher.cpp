@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Watches the configuration file for changes
+ */
+
+#include "config_watcher.hpp"
+#include "log.hpp"
+#if defined(__linux__)
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif // #if defined(__linux__)
+
+#if defined(__linux__)
+
+ConfigWatcher::ConfigWatcher(const std::string &path) : m_fd(-1)
+{
+    const size_t slash = path.find_last_of('/');
+    const std::string dir = (slash == std::string::npos) ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    m_name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0 || inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        Log::getInstance()->printf(Log::Warning, " %s Unable to watch %s for changes: %s", __func__, path.c_str(), strerror(errno));
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+bool ConfigWatcher::changed()
+{
+    if (m_fd < 0)
+    {
+        return false;
+    }
+
+    bool changed = false;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t size;
+    while ((size = read(m_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (ssize_t offset = 0; offset < size; )
+        {
+            const struct inotify_event *p_event = (const struct inotify_event *)(buffer + offset);
+            if (p_event->len > 0 && m_name == p_event->name)
+            {
+                changed = true;
+            }
+            offset += sizeof(struct inotify_event) + p_event->len;
+        }
+    }
+    return changed;
+}
+
+#else // #if defined(__linux__)
+
+ConfigWatcher::ConfigWatcher(const std::string &path) : m_name(path), m_fd(-1)
+{
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+}
+
+bool ConfigWatcher::changed()
+{
+    return false;
+}
+
+#endif // #if defined(__linux__)
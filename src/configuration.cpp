@@ -14,12 +14,13 @@
 #include "utils.hpp"
 
 const std::string Configuration::noDefault_ = "NODEF";
+const Configuration::Key Configuration::INVALID_KEY;
 
 #if defined(USETHREADING)
 pthread_mutex_t Configuration::m_config_lock = PTHREAD_MUTEX_INITIALIZER;
 #endif // #if defined(USETHREADING)
 
-Configuration::Configuration()
+Configuration::Configuration() : generation_(0)
 {
     validationMap_.insert(std::pair<std::string, Type>(CFG_KEYCACHETIMEOUT, NUMERIC));
     defaults_.insert(std::pair<std::string, std::string>(CFG_KEYCACHETIMEOUT, noDefault_));
@@ -163,6 +164,9 @@ Configuration::Configuration()
     validationMap_.insert(std::pair<std::string, Type>(CFG_EVENT_NOTIFICATION_LIBRARIES, TEXT));
     defaults_.insert(std::pair<std::string, std::string>(CFG_EVENT_NOTIFICATION_LIBRARIES, ""));
 
+    validationMap_.insert(std::pair<std::string, Type>(CFG_EVENT_QUEUE_SIZE, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_EVENT_QUEUE_SIZE, "64"));
+
     validationMap_.insert(std::pair<std::string, Type>(CFG_RETRY_AUTHORIZATION_INTERVAL_S, NUMERIC));
     defaults_.insert(std::pair<std::string, std::string>(CFG_RETRY_AUTHORIZATION_INTERVAL_S, "15"));
 
@@ -178,6 +182,33 @@ Configuration::Configuration()
     validationMap_.insert(std::pair<std::string, Type>(CFG_OSSL_PROVIDER, TEXT));
     defaults_.insert(std::pair<std::string, std::string>(CFG_OSSL_PROVIDER, ""));
 
+    validationMap_.insert(std::pair<std::string, Type>(CFG_SCRIPT_TIMEOUT_S, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_SCRIPT_TIMEOUT_S, "0"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_SCRIPT_MAX_OUTPUT_BYTES, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_SCRIPT_MAX_OUTPUT_BYTES, "67108864"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_SCRIPT_MAX_CONCURRENT, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_SCRIPT_MAX_CONCURRENT, "2"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_DOWNLOAD_MAX_RETRIES, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_DOWNLOAD_MAX_RETRIES, "3"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_BULK_CRYPTO_MIN_BYTES, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_BULK_CRYPTO_MIN_BYTES, "65536"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_KEY_POOL_SIZE, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_KEY_POOL_SIZE, "0"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_KEY_POOL_TYPES, TEXT));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_KEY_POOL_TYPES, "RSA-2048"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_APP_KEY_CACHE_TTL_S, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_APP_KEY_CACHE_TTL_S, "300"));
+
+    validationMap_.insert(std::pair<std::string, Type>(CFG_AUTH_SESSION_MAX_S, NUMERIC));
+    defaults_.insert(std::pair<std::string, std::string>(CFG_AUTH_SESSION_MAX_S, "300"));
+
 #if defined(WIN32)
     validationMap_.insert(std::pair<std::string, Type>(CFG_DDKGLIB, TEXT));
     defaults_.insert(std::pair<std::string, std::string>(CFG_DDKGLIB, "npUDADDK.dll"));
@@ -188,6 +219,9 @@ Configuration::Configuration()
     validationMap_.insert(std::pair<std::string, Type>(CFG_STORE_FULL_CERTIFICATE_CHAIN, BOOLTYPE));
     defaults_.insert(std::pair<std::string, std::string>(CFG_STORE_FULL_CERTIFICATE_CHAIN, "FALSE"));
 #endif // #if defined(WIN32)
+
+    registerKeys();
+    publish();
 }
 
 Configuration::~Configuration()
@@ -280,7 +314,7 @@ std::string Configuration::escapeSpecialChars(const std::string &from) const
     return to;
 }
 
-void Configuration::add(const std::string &item, const std::string &value)
+void Configuration::add(ConfigurationContainer &data, const std::string &item, const std::string &value) const
 {
     std::string ucItem = upperCase(item);
 
@@ -292,22 +326,22 @@ void Configuration::add(const std::string &item, const std::string &value)
         {
         case NUMERIC:
         case TEXT:
-            data_[ucItem] = value;
+            data[ucItem] = value;
             break;
 
         case ESCTEXTDB:
-            data_[ucItem] = escapeSpecialChars(value);
+            data[ucItem] = escapeSpecialChars(value);
             break;
 
         case LOCATIONTYPE:
         case MODETYPE:
-            data_[ucItem] = upperCase(value);
+            data[ucItem] = upperCase(value);
             break;
         case TEXTLOWER:
-            data_[ucItem] = utils::toLower(value);
+            data[ucItem] = utils::toLower(value);
             break;
         case BOOLTYPE:
-            data_[ucItem] = upperCase(value);
+            data[ucItem] = upperCase(value);
             break;
         default:
             assert("Unknown type used.");
@@ -324,77 +358,161 @@ std::string Configuration::upperCase(const std::string &item) const
     return ucItem;
 }
 
-bool Configuration::exists(const std::string &item) const
+Configuration::Key Configuration::key(const std::string &item) const
 {
 #if defined(USETHREADING)
     pthread_mutex_lock(&m_config_lock);
 #endif // #if defined(USETHREADING)
 
-    ConfigurationContainer::const_iterator f = data_.find(upperCase(item));
+    KeyContainer::const_iterator f = keys_.find(upperCase(item));
+    const Key result = (f != keys_.end()) ? f->second : INVALID_KEY;
 
 #if defined(USETHREADING)
     pthread_mutex_unlock(&m_config_lock);
 #endif // #if defined(USETHREADING)
 
-    return (f != data_.end());
+    return result;
 }
 
-std::string Configuration::lookup(const std::string &item) const
+// The snapshot a call reads, which stays allocated until the call releases it
+std::shared_ptr<const Configuration::Snapshot> Configuration::current() const
 {
-#if defined(USETHREADING)
-    pthread_mutex_lock(&m_config_lock);
-#endif // #if defined(USETHREADING)
+    return std::atomic_load(&snapshot_);
+}
 
-    std::string result = "";
-    ConfigurationContainer::const_iterator f = data_.find(upperCase(item));
+const Configuration::Value *Configuration::find(const Snapshot &snapshot, Key key) const
+{
+    return (key < snapshot.values.size()) ? &snapshot.values[key] : nullptr;
+}
 
-    if (f == data_.end())
-    {
-        DefaultsContainer::const_iterator d = defaults_.find(upperCase(item));
+bool Configuration::exists(Key key) const
+{
+    const std::shared_ptr<const Snapshot> p_snapshot = current();
+    const Value *p_value = find(*p_snapshot, key);
 
-        if (d != defaults_.end())
-        {
-            if (d->second != noDefault_)
-            {
-                result = d->second;
-            }
-            else
-            {
-                Log::getInstance()->printf(Log::Error, " %s Unknown configuration item '%s', exiting....", __func__, item.c_str());
-            }
-        }
-        else
-        {
-            Log::getInstance()->printf(Log::Error, " %s Unknown configuration item '%s', exiting....", __func__, item.c_str());
-        }
+    return (p_value && p_value->set);
+}
+
+bool Configuration::exists(const std::string &item) const
+{
+    return exists(key(item));
+}
+
+std::string Configuration::lookup(Key key) const
+{
+    const std::shared_ptr<const Snapshot> p_snapshot = current();
+    const Value *p_value = find(*p_snapshot, key);
+
+    if (!p_value)
+    {
+        Log::getInstance()->printf(Log::Error, " %s Unknown configuration item %lu, exiting....", __func__, (unsigned long)key);
+        return std::string();
     }
-    else
+    if (p_value->missing)
     {
-        result = f->second;
+        Log::getInstance()->printf(Log::Error, " %s Unknown configuration item '%s', exiting....", __func__, p_value->name.c_str());
     }
 
-#if defined(USETHREADING)
-    pthread_mutex_unlock(&m_config_lock);
-#endif // #if defined(USETHREADING)
+    return p_value->text;
+}
 
-    return result;
+std::string Configuration::lookup(const std::string &item) const
+{
+    const Key k = key(item);
+
+    if (k == INVALID_KEY)
+    {
+        Log::getInstance()->printf(Log::Error, " %s Unknown configuration item '%s', exiting....", __func__, item.c_str());
+        return std::string();
+    }
+
+    return lookup(k);
 }
 
-long Configuration::lookupAsLong(const std::string &item) const
+long Configuration::lookupAsLong(Key key) const
 {
-    std::string value = lookup(item);
+    const std::shared_ptr<const Snapshot> p_snapshot = current();
+    const Value *p_value = find(*p_snapshot, key);
 
-    if (!isNumeric(value))
+    if (!p_value || p_value->missing)
+    {
+        // Logs the error, the value is empty
+        lookup(key);
+        return 0;
+    }
+    if (!p_value->numeric)
     {
-        Log::getInstance()->printf(Log::Error, " %s '%s' is non numeric, exiting....", __func__, item.c_str());
+        Log::getInstance()->printf(Log::Error, " %s '%s' is non numeric, exiting....", __func__, p_value->name.c_str());
         exit(1);
     }
 
-    return strtol(value.c_str(), NULL, 0);
+    return p_value->number;
 }
 
-// bool Configuration::parse(const char *fullPathOfFile)
-bool Configuration::parse(const std::string fullPathOfFile)
+long Configuration::lookupAsLong(const std::string &item) const
+{
+    const Key k = key(item);
+
+    if (k == INVALID_KEY)
+    {
+        // Logs the error, the value is empty
+        lookup(item);
+        return 0;
+    }
+
+    return lookupAsLong(k);
+}
+
+void Configuration::registerKeys()
+{
+    for (ValidationContainer::const_iterator it = validationMap_.begin(); it != validationMap_.end(); ++it)
+    {
+        if (keys_.insert(std::pair<std::string, Key>(it->first, keyNames_.size())).second)
+        {
+            keyNames_.push_back(it->first);
+        }
+    }
+}
+
+// Build a snapshot of the current values and make it the one read, only called with the lock held
+void Configuration::publish()
+{
+    std::shared_ptr<Snapshot> p_snapshot = std::make_shared<Snapshot>();
+
+    p_snapshot->values.resize(keyNames_.size());
+    for (Key k = 0; k < keyNames_.size(); ++k)
+    {
+        Value &value = p_snapshot->values[k];
+        ConfigurationContainer::const_iterator f = data_.find(keyNames_[k]);
+
+        value.name = keyNames_[k];
+        value.set = (f != data_.end());
+        value.missing = false;
+        if (value.set)
+        {
+            value.text = f->second;
+        }
+        else
+        {
+            DefaultsContainer::const_iterator d = defaults_.find(keyNames_[k]);
+
+            value.missing = (d == defaults_.end()) || (d->second == noDefault_);
+            if (!value.missing)
+            {
+                value.text = d->second;
+            }
+        }
+        value.numeric = isNumeric(value.text);
+        value.number = value.numeric ? strtol(value.text.c_str(), NULL, 0) : 0;
+    }
+
+    // The replaced snapshot is freed by the last call still reading it
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(p_snapshot));
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+// Read the items in a file into data, which is left partly updated on failure
+bool Configuration::read(const std::string &fullPathOfFile, ConfigurationContainer &data) const
 {
     bool parsed = true;
     std::ifstream ifs(fullPathOfFile.c_str());
@@ -430,7 +548,7 @@ bool Configuration::parse(const std::string fullPathOfFile)
                 parsed = false;
                 break;
             }
-            add(item, value);
+            add(data, item, value);
         }
     }
     else
@@ -440,20 +558,93 @@ bool Configuration::parse(const std::string fullPathOfFile)
     }
     ifs.close();
 
+    return parsed;
+}
+
+// Make data the current values, only called with the lock held
+void Configuration::commit(ConfigurationContainer &data, const std::string &fullPathOfFile)
+{
+    data_.swap(data);
+    fullPathOfFile_ = fullPathOfFile;
+    publish();
+}
+
+// bool Configuration::parse(const char *fullPathOfFile)
+bool Configuration::parse(const std::string fullPathOfFile)
+{
+    // The file is parsed into a copy, so that the values read change all at once and only on success
+#if defined(USETHREADING)
+    pthread_mutex_lock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+    ConfigurationContainer data(data_);
+#if defined(USETHREADING)
+    pthread_mutex_unlock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+
+    bool parsed = read(fullPathOfFile, data);
+
     if (parsed)
     {
-        fullPathOfFile_ = fullPathOfFile;
+#if defined(USETHREADING)
+        pthread_mutex_lock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+        commit(data, fullPathOfFile);
+#if defined(USETHREADING)
+        pthread_mutex_unlock(&m_config_lock);
+#endif // #if defined(USETHREADING)
     }
 
     return parsed;
 }
 
+bool Configuration::reload()
+{
+    // Start again from the defaults, so that items removed from the file go back to them
+    ConfigurationContainer data;
+    const std::string fullPathOfFile = path();
+
+    if (fullPathOfFile.empty() || !read(fullPathOfFile, data))
+    {
+        Log::getInstance()->printf(Log::Error, " %s Keeping the current configuration", __func__);
+        return false;
+    }
+
+#if defined(USETHREADING)
+    pthread_mutex_lock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+    for (ConfigurationContainer::const_iterator it = overrides_.begin(); it != overrides_.end(); ++it)
+    {
+        data[it->first] = it->second;
+    }
+    commit(data, fullPathOfFile);
+#if defined(USETHREADING)
+    pthread_mutex_unlock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+
+    Log::getInstance()->printf(Log::Notice, " %s Reloaded configuration file: %s", __func__, fullPathOfFile.c_str());
+
+    return true;
+}
+
+unsigned long Configuration::generation() const
+{
+    return generation_.load(std::memory_order_acquire);
+}
+
 std::string Configuration::path() const
 {
-    return fullPathOfFile_;
+#if defined(USETHREADING)
+    pthread_mutex_lock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+    const std::string fullPathOfFile = fullPathOfFile_;
+#if defined(USETHREADING)
+    pthread_mutex_unlock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+
+    return fullPathOfFile;
 }
 
-void Configuration::trimValue(std::string &value)
+void Configuration::trimValue(std::string &value) const
 {
     std::string whitespaces(" \t\f\v\n\r");
     size_t last = value.find_last_not_of(whitespaces);
@@ -479,7 +670,15 @@ bool Configuration::override(const std::string &item, const std::string &value)
 {
     if (validate(item, value))
     {
-        add(item, value);
+#if defined(USETHREADING)
+        pthread_mutex_lock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+        add(data_, item, value);
+        add(overrides_, item, value);
+        publish();
+#if defined(USETHREADING)
+        pthread_mutex_unlock(&m_config_lock);
+#endif // #if defined(USETHREADING)
 
         return true;
     }
@@ -489,6 +688,10 @@ bool Configuration::override(const std::string &item, const std::string &value)
 
 void Configuration::addValidationMap(std::map<std::string, int> &validationMap, const std::map<std::string, std::string> &defaults)
 {
+#if defined(USETHREADING)
+    pthread_mutex_lock(&m_config_lock);
+#endif // #if defined(USETHREADING)
+
     for (std::map<std::string, int>::const_iterator it = validationMap.begin(); it != validationMap.end(); ++it)
     {
         if (it->second == NUMERIC_TYPE)
@@ -524,6 +727,12 @@ void Configuration::addValidationMap(std::map<std::string, int> &validationMap,
     {
         defaults_.insert(std::pair<std::string, std::string>(it->first, it->second));
     }
+    registerKeys();
+    publish();
+
+#if defined(USETHREADING)
+    pthread_mutex_unlock(&m_config_lock);
+#endif // #if defined(USETHREADING)
 }
 
 // Global instance of the config
@@ -5,10 +5,13 @@
  *
  */
 #include "configuration.hpp"
+#include "config_watcher.hpp"
 #include "gtest/gtest.h"
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <thread>
 #include "constants.hpp"
 //using namespace cryptosoft;
 
@@ -407,3 +410,155 @@ TEST(Configuration, ItemExists)
     ASSERT_TRUE( component.exists( CFG_ROTATELOGAFTER ) );
     ASSERT_FALSE( component.exists( "PortNumber" ) );
 }
+
+TEST(Configuration, LookupByKey)
+{
+    // Resolve items to keys in any case, and look them up through the keys
+    std::ofstream ofs( "test.conf" );
+    ofs << "KeyCacheTimeOut = 100" << std::endl;
+    ofs << "DeviceName = Test 1.0" << std::endl;
+    ofs.close();
+    // Now do the test
+    Configuration component;
+    ASSERT_TRUE( component.parse( "test.conf" ) );
+    const Configuration::Key timeout = component.key( "KeyCacheTimeOut" );
+    ASSERT_NE( Configuration::INVALID_KEY, timeout );
+    ASSERT_EQ( timeout, component.key( CFG_KEYCACHETIMEOUT ) );
+    ASSERT_TRUE( component.exists( timeout ) );
+    ASSERT_EQ( 100, component.lookupAsLong( timeout ) );
+    ASSERT_STREQ( "Test 1.0", component.lookup( component.key( CFG_DEVICENAME ) ).c_str() );
+    ASSERT_FALSE( component.exists( component.key( CFG_SLEEPPERIOD ) ) );
+    ASSERT_EQ( 10, component.lookupAsLong( component.key( CFG_SLEEPPERIOD ) ) );
+    ASSERT_EQ( Configuration::INVALID_KEY, component.key( "PortNumber" ) );
+    ASSERT_STREQ( "", component.lookup( Configuration::INVALID_KEY ).c_str() );
+}
+
+TEST(Configuration, OverrideKeepsPreviousValues)
+{
+    // A value looked up before an override is a copy that keeps its value, later lookups see the new value
+    Configuration component;
+    ASSERT_TRUE( component.override( CFG_KEYCACHETIMEOUT, "100" ) );
+    const Configuration::Key timeout = component.key( CFG_KEYCACHETIMEOUT );
+    const std::string before = component.lookup( timeout );
+    ASSERT_TRUE( component.override( CFG_KEYCACHETIMEOUT, "200" ) );
+    ASSERT_STREQ( "100", before.c_str() );
+    ASSERT_STREQ( "200", component.lookup( timeout ).c_str() );
+    ASSERT_EQ( 200, component.lookupAsLong( timeout ) );
+}
+
+TEST(Configuration, FailedParseKeepsValues)
+{
+    // Nothing from a file that fails to parse is applied
+    std::ofstream ofs( "test.conf" );
+    ofs << "KeyCacheTimeOut = 100" << std::endl;
+    ofs << "UnknownItem = FAIL" << std::endl;
+    ofs.close();
+    // Now do the test
+    Configuration component;
+    ASSERT_TRUE( component.override( CFG_KEYCACHETIMEOUT, "50" ) );
+    ASSERT_FALSE( component.parse( "test.conf" ) );
+    ASSERT_EQ( 50, component.lookupAsLong( CFG_KEYCACHETIMEOUT ) );
+}
+
+TEST(Configuration, ReadWhileOverriding)
+{
+    // Readers always see one of the values written, never a partial one
+    Configuration component;
+    ASSERT_TRUE( component.override( CFG_DEVICENAME, "first" ) );
+    const Configuration::Key name = component.key( CFG_DEVICENAME );
+    bool consistent = true;
+    std::thread reader([&component, name, &consistent]()
+    {
+        for (int i = 0; i < 100000; ++i)
+        {
+            const std::string value = component.lookup( name );
+            consistent = consistent && (value == "first" || value == "second");
+        }
+    });
+    for (int i = 0; i < 100; ++i)
+    {
+        component.override( CFG_DEVICENAME, (i % 2) ? "first" : "second" );
+    }
+    reader.join();
+    ASSERT_TRUE( consistent );
+}
+
+TEST(Configuration, ReloadAppliesFile)
+{
+    // Items changed in the file take their new values, items removed go back to their defaults
+    std::ofstream ofs( "test.conf" );
+    ofs << "SleepPeriod = 30" << std::endl;
+    ofs << "KeyCacheTimeOut = 100" << std::endl;
+    ofs.close();
+    Configuration component;
+    ASSERT_TRUE( component.parse( "test.conf" ) );
+    const unsigned long generation = component.generation();
+
+    ofs.open( "test.conf" );
+    ofs << "KeyCacheTimeOut = 200" << std::endl;
+    ofs.close();
+    ASSERT_TRUE( component.reload() );
+    ASSERT_NE( generation, component.generation() );
+    ASSERT_EQ( 200, component.lookupAsLong( CFG_KEYCACHETIMEOUT ) );
+    ASSERT_FALSE( component.exists( CFG_SLEEPPERIOD ) );
+    ASSERT_EQ( 10, component.lookupAsLong( CFG_SLEEPPERIOD ) );
+}
+
+TEST(Configuration, ReloadKeepsOverrides)
+{
+    std::ofstream ofs( "test.conf" );
+    ofs << "SleepPeriod = 30" << std::endl;
+    ofs.close();
+    Configuration component;
+    ASSERT_TRUE( component.parse( "test.conf" ) );
+    ASSERT_TRUE( component.override( CFG_SLEEPPERIOD, "5" ) );
+    ASSERT_TRUE( component.reload() );
+    ASSERT_EQ( 5, component.lookupAsLong( CFG_SLEEPPERIOD ) );
+}
+
+TEST(Configuration, ReloadInvalidFileKeepsValues)
+{
+    std::ofstream ofs( "test.conf" );
+    ofs << "SleepPeriod = 30" << std::endl;
+    ofs.close();
+    Configuration component;
+    ASSERT_TRUE( component.parse( "test.conf" ) );
+    const unsigned long generation = component.generation();
+
+    ofs.open( "test.conf" );
+    ofs << "SleepPeriod = FAIL" << std::endl;
+    ofs.close();
+    ASSERT_FALSE( component.reload() );
+    ASSERT_EQ( generation, component.generation() );
+    ASSERT_EQ( 30, component.lookupAsLong( CFG_SLEEPPERIOD ) );
+}
+
+#if defined(__linux__)
+TEST(Configuration, WatcherSeesWriteAndReplace)
+{
+    std::ofstream ofs( "watched.conf" );
+    ofs.close();
+    ConfigWatcher watcher( "watched.conf" );
+    ASSERT_FALSE( watcher.changed() );
+
+    // Other files in the directory are ignored
+    ofs.open( "test.conf" );
+    ofs.close();
+    ASSERT_FALSE( watcher.changed() );
+
+    ofs.open( "watched.conf" );
+    ofs << "SleepPeriod = 30" << std::endl;
+    ofs.close();
+    ASSERT_TRUE( watcher.changed() );
+    ASSERT_FALSE( watcher.changed() );
+
+    // Written to a new file and renamed over the old one, as editors do
+    ofs.open( "watched.conf.new" );
+    ofs << "SleepPeriod = 40" << std::endl;
+    ofs.close();
+    watcher.changed();
+    ASSERT_EQ( 0, std::rename( "watched.conf.new", "watched.conf" ) );
+    ASSERT_TRUE( watcher.changed() );
+    std::remove( "watched.conf" );
+}
+#endif // #if defined(__linux__)
@@ -8,6 +8,7 @@
 #include <sstream>
 #include <fstream>
 #include <cstring>
+#include <mutex>
 #include <sys/types.h>
 #if defined(WIN32)
 #else
@@ -16,12 +17,13 @@
 #endif // #if defined(WIN32)
 #include <sys/stat.h>
 #include <errno.h>
-#include "base64.h"
+#include "base64.hpp"
 #include "dahttpclient.hpp"
 #include "deviceauthority.hpp"
 #include "configuration.hpp"
 #include "dacryptor.hpp"
 #include "da.hpp"
+#include "key_material_cache.hpp"
 #include "utils.hpp"
 #include "constants.hpp"
 #include "tpm_wrapper.hpp"
@@ -85,10 +87,28 @@ bool getProcessInfoFromPid(const int pid, std::string &exePath)
 }
 
 
+namespace
+{
+    /// @brief The hash of the executable, kept until the file on disk changes
+    struct AppHashCache
+    {
+        std::mutex mutex;
+        std::string path;
+        struct stat info;
+        std::string hash;
+    };
+
+    AppHashCache app_hash_cache;
+
+    bool sameFile(const struct stat &a, const struct stat &b)
+    {
+        return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size && a.st_mtime == b.st_mtime;
+    }
+} // namespace
+
 bool getAppHash(std::string &hash)
 {
     std::string execPath;
-    bool result = false;
 #if defined(WIN32)
 #else
     //printf("\n %s Process identifier is %d", __func__, getpid());
@@ -100,24 +120,32 @@ bool getAppHash(std::string &hash)
         return false;
     }
 #endif // #if defined(WIN32)
-    if ( utils::sha256AndEncode(execPath, true, true, hash) )
+
+    // The executable is only hashed again if it has been replaced or modified since it was last hashed
+    struct stat info;
+    const bool have_info = stat(execPath.c_str(), &info) == 0;
+    std::lock_guard<std::mutex> lock(app_hash_cache.mutex);
+    if (have_info && !app_hash_cache.hash.empty() && app_hash_cache.path == execPath && sameFile(app_hash_cache.info, info))
     {
-        result = true;
-        Log::getInstance()->printf(Log::Debug, " %s hash value is (between :: markers) ::%s::", __func__, hash.c_str());
+        hash = app_hash_cache.hash;
+        return true;
     }
-    else
+
+    if (!utils::sha256AndEncode(execPath, true, true, hash))
     {
         Log::getInstance()->printf(Log::Error, " %s sha256AndEncode failed", __func__);
+        return false;
     }
-    /*
-    std::string  hash2;
-    std::string str= "TestHashStr";
+    Log::getInstance()->printf(Log::Debug, " %s hash value is (between :: markers) ::%s::", __func__, hash.c_str());
 
-    hashed = sha256AndEncode(str,false,true,hash2);
-    logger.printf(Log::Error, "%s Test hash is %s", __func__, hash2.c_str());
-    */
+    if (have_info)
+    {
+        app_hash_cache.path = execPath;
+        app_hash_cache.info = info;
+        app_hash_cache.hash = hash;
+    }
 
-    return result;
+    return true;
 }
 
 /*
@@ -263,6 +291,7 @@ bool getInfoFromDAE(std::string& key_id, const std::string& asset_id, bool sign_
 
         oss << "Connect to API '" << DAAPIURL << "' has failed with HTTP client error code: " << rc;
         Log::getInstance()->printf(Log::Error," %s  %s ", __func__, oss.str().c_str());
+        p_da_instance->invalidateSession();
 
         return false;
     }
@@ -455,7 +484,26 @@ bool getRawData(std::string file_name, std::string &raw_data)
              * It is required that the functions be called when no other thread in the program is running.
              */
             //DAHttpClient::init();
-            bool result = getInfoFromDAE(extracted_key_id, extracted_asset_id, sign_apphash, key, iv);
+            // The key of a file already loaded is reused until the file changes or the key expires
+            struct stat file_info;
+            const time_t mtime = stat(file_name.c_str(), &file_info) == 0 ? file_info.st_mtime : 0;
+            const std::string file_key_id = extracted_key_id;
+            KeyMaterialCache *p_key_cache = KeyMaterialCache::getInstance();
+            bool result = p_key_cache->lookup(file_name, mtime, file_key_id, key, iv);
+
+            if (result)
+            {
+                Log::getInstance()->printf(Log::Debug, " %s Using the cached key for %s", __func__, file_name.c_str());
+            }
+            else
+            {
+                result = getInfoFromDAE(extracted_key_id, extracted_asset_id, sign_apphash, key, iv);
+                if (result && mtime != 0)
+                {
+                    const long ttl = config.lookupAsLong(CFG_APP_KEY_CACHE_TTL_S);
+                    p_key_cache->insert(file_name, mtime, file_key_id, key, iv, ttl > 0 ? (unsigned int)ttl : 0);
+                }
+            }
 
             //printf("\n key:%s,iv:%s\n", key.c_str(), iv.c_str());
             if (result && key.size() && iv.size())
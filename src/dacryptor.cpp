@@ -4,21 +4,47 @@
  * This class provides encryption and decryption functionality using AES
  */
 #include "dacryptor.hpp"
-#include "base64.h"
+#include "base64.hpp"
 #include "log.hpp"
+#include <algorithm>
 #include <cstring>
 #include <vector>
+#include <openssl/crypto.h>
 #include "deviceauthority.hpp"
 
 namespace
 {
-    std::string crypt(const std::vector<char> &key, const std::vector<char> &iv, std::string &input, CipherMode mode)
+    // Bytes of payload per block, a multiple of 3 so that each block encodes to whole base64 groups
+    const size_t BLOCK_BYTES = 3 * 4096;
+    // Base64 characters per block when decoding
+    const size_t BLOCK_CHARS = BLOCK_BYTES / 3 * 4;
+
+    void wipe(std::string &data)
+    {
+        if (!data.empty())
+        {
+            OPENSSL_cleanse(&data[0], data.size());
+        }
+        data.clear();
+    }
+
+    void wipe(std::vector<char> &data)
+    {
+        if (!data.empty())
+        {
+            OPENSSL_cleanse(&data[0], data.size());
+        }
+        data.clear();
+    }
+
+    // Encrypt or decrypt a whole payload with the DDKG
+    std::string crypt(const std::vector<char> &key, const std::vector<char> &iv, const std::string &input, CipherMode mode)
     {
         std::string output;
         if (DeviceAuthorityBase* da = DeviceAuthority::getInstance())
         {
             char *out_buf = nullptr;
-            int out_len = da->doCipherAES(&key[0], key.size(), &iv[0], iv.size(), input.c_str(), input.size(), mode, &out_buf);
+            int out_len = da->doCipherAES(key.data(), key.size(), iv.data(), iv.size(), input.c_str(), input.size(), mode, &out_buf);
             if (out_len >= 0)
             {
                 output = std::string(out_buf, out_buf + static_cast<size_t>(out_len));
@@ -44,6 +70,7 @@ dacryptor::dacryptor()
 
 dacryptor::~dacryptor()
 {
+    clear();
 }
 
 void dacryptor::setInputData(const std::string& input_data)
@@ -53,39 +80,88 @@ void dacryptor::setInputData(const std::string& input_data)
 
 bool dacryptor::setInitVector(const std::string& iv)
 {
-    m_iv = std::vector<char>(iv.begin(), iv.end());
+    m_iv.assign(iv.begin(), iv.end());
     return true;
 }
 
 bool dacryptor::setInitVector(const std::vector<char>& iv)
 {
-    m_iv = std::vector<char>(iv.begin(), iv.end());
+    m_iv.assign(iv.begin(), iv.end());
     return true;
 }
 
 bool dacryptor::setCryptionKey(const std::string& key)
 {
-	m_key = std::vector<char>(key.begin(), key.end());
+    m_key.assign(key.begin(), key.end());
     return true;
 }
 
 bool dacryptor::setCryptionKey(const std::vector<char>& key)
 {
-    m_key = std::vector<char>(key.begin(), key.end());
+    m_key.assign(key.begin(), key.end());
     return true;
 }
 
 bool dacryptor::encrypt()
 {
-    // Encrypt input to raw string
-    std::string raw = crypt(m_key, m_iv, m_input, CipherModeEncrypt);
-
-    // Base64 encode raw to output buffer
-    std::vector< char > out_buf( raw.size() * 2/* Factor to ensure buf big enough to hold base64 data*/ );
-    unsigned sz = base64Encode( (const unsigned char*)raw.c_str(), raw.size(), &out_buf[0], out_buf.size() );
+    m_output.clear();
+    if (m_input.empty())
+    {
+        return false;
+    }
+    if (!evp_crypto::isBulkCipher(m_input.size(), m_key.size(), m_iv.size()))
+    {
+        const std::string raw = crypt(m_key, m_iv, m_input, CipherModeEncrypt);
+        base64::encodeAppend(raw, m_output);
+        return !m_output.empty();
+    }
+    if (!m_cipher.init(m_key.data(), m_key.size(), m_iv.data(), m_iv.size(), CipherModeEncrypt))
+    {
+        return false;
+    }
 
-    // Copy out buffer to output string
-    m_output.assign( &out_buf[0], sz );
+    // The output size is known up front
+    const size_t encrypted_size = (m_input.size() / evp_crypto::AES_BLOCK_BYTES + 1) * evp_crypto::AES_BLOCK_BYTES;
+    m_output.resize(base64::encodedSize(encrypted_size));
+    m_block.resize(BLOCK_BYTES + evp_crypto::AES_BLOCK_BYTES);
+
+    const unsigned char *p_in = (const unsigned char *)m_input.data();
+    size_t remaining = m_input.size();
+    size_t pending = 0; // Encrypted bytes at the start of m_block not yet encoded
+    size_t encoded = 0;
+    bool finished = false;
+    while (!finished)
+    {
+        long crypted;
+        if (remaining > 0)
+        {
+            const size_t block = std::min(remaining, BLOCK_BYTES - pending);
+            crypted = m_cipher.update(p_in, block, &m_block[pending]);
+            p_in += block;
+            remaining -= block;
+        }
+        else
+        {
+            crypted = m_cipher.final(&m_block[pending]);
+            finished = true;
+        }
+        if (crypted < 0)
+        {
+            Log::getInstance()->printf(Log::Error, "%s Failed to encrypt", __func__);
+            m_output.clear();
+            return false;
+        }
+        pending += (size_t)crypted;
+
+        // Encode whole groups of 3 bytes, carrying the rest to the next block until the payload is complete
+        const size_t whole = finished ? pending : pending / 3 * 3;
+        size_t written = 0;
+        base64::encode(&m_block[0], whole, &m_output[encoded], m_output.size() - encoded, written);
+        encoded += written;
+        memmove(&m_block[0], &m_block[whole], pending - whole);
+        pending -= whole;
+    }
+    m_output.resize(encoded);
 
     // Success if we have some data
     return !m_output.empty();
@@ -93,15 +169,61 @@ bool dacryptor::encrypt()
 
 bool dacryptor::decrypt()
 {
-    // Base64 decode input string before decryption
-    std::vector< unsigned char > rawBuf( m_input.size() );
-    unsigned sz = base64Decode( m_input.c_str(), (unsigned char *)&rawBuf[0], rawBuf.size() );
+    m_output.clear();
+    if (m_input.empty())
+    {
+        return false;
+    }
+    if (!evp_crypto::isBulkCipher(base64::decodedSize(m_input.data(), m_input.size()), m_key.size(), m_iv.size()))
+    {
+        std::string raw;
+        if (base64::decodeAppend(m_input, raw) != base64::OK || raw.empty())
+        {
+            Log::getInstance()->printf(Log::Error, "%s Invalid base64 input", __func__);
+            return false;
+        }
+        m_output = crypt(m_key, m_iv, raw, CipherModeDecrypt);
+        wipe(raw);
+        return !m_output.empty();
+    }
+    if (!m_cipher.init(m_key.data(), m_key.size(), m_iv.data(), m_iv.size(), CipherModeDecrypt))
+    {
+        return false;
+    }
+
+    // Decrypt straight into the output, which is sized for the largest possible plaintext then trimmed
+    m_output.resize(base64::decodedSize(m_input.data(), m_input.size()) + evp_crypto::AES_BLOCK_BYTES);
+    m_block.resize(BLOCK_BYTES + evp_crypto::AES_BLOCK_BYTES);
 
-    // Copy rawBuf to string
-    std::string raw_str((const char*)&rawBuf[0], sz);
+    size_t decrypted = 0;
+    for (size_t offset = 0; offset < m_input.size(); offset += BLOCK_CHARS)
+    {
+        const size_t chars = std::min(BLOCK_CHARS, m_input.size() - offset);
+        size_t decoded = 0;
+        if (base64::decode(m_input.data() + offset, chars, &m_block[0], m_block.size(), decoded) != base64::OK || decoded == 0)
+        {
+            Log::getInstance()->printf(Log::Error, "%s Invalid base64 input", __func__);
+            m_output.clear();
+            return false;
+        }
+        const long crypted = m_cipher.update(&m_block[0], decoded, (unsigned char *)&m_output[decrypted]);
+        if (crypted < 0)
+        {
+            Log::getInstance()->printf(Log::Error, "%s Failed to decrypt", __func__);
+            m_output.clear();
+            return false;
+        }
+        decrypted += (size_t)crypted;
+    }
 
-    // Decrypt the raw string
-    m_output = crypt(m_key, m_iv, raw_str, CipherModeDecrypt);
+    const long crypted = m_cipher.final((unsigned char *)&m_output[decrypted]);
+    if (crypted < 0)
+    {
+        Log::getInstance()->printf(Log::Error, "%s Failed to decrypt, bad padding", __func__);
+        m_output.clear();
+        return false;
+    }
+    m_output.resize(decrypted + (size_t)crypted);
 
     // Success if we have some data
     return !m_output.empty();
@@ -112,3 +234,15 @@ void dacryptor::getCryptedData(const unsigned char *& outputData, unsigned int&
     outputData = (unsigned char*)m_output.c_str();
     dataLength = m_output.size();
 }
+
+void dacryptor::clear()
+{
+    wipe(m_key);
+    wipe(m_iv);
+    wipe(m_input);
+    wipe(m_output);
+    if (!m_block.empty())
+    {
+        OPENSSL_cleanse(&m_block[0], m_block.size());
+    }
+}
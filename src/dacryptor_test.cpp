@@ -5,9 +5,13 @@
  *
  */
 #include "dacryptor.hpp"
+#include "configuration.hpp"
+#include "constants.hpp"
 #include "gtest/gtest.h"
 #include "log.hpp"
-#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 #include <string>
 
 #define CLEAR_TXT "THIS IS INPUT DATA"
@@ -26,6 +30,75 @@
 
 #define CIPHER_TXT_SZ strlen( CIPHER_TXT )
 
+// Count the allocations made through operator new, to check that a dacryptor reuses its buffers
+static std::atomic<size_t> allocation_count(0);
+
+void* operator new(size_t size)
+{
+    ++allocation_count;
+    if (void* p = malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+static std::string makePayload(size_t size)
+{
+    std::string payload(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+    {
+        payload[i] = (char)(i * 31 + 7);
+    }
+    return payload;
+}
+
+// Sends payloads of any size through OpenSSL EVP while in scope, as only that path reuses the buffers
+class BulkCryptoForAll
+{
+public:
+    BulkCryptoForAll() : m_min_bytes(config.lookup(CFG_BULK_CRYPTO_MIN_BYTES))
+    {
+        config.override(CFG_BULK_CRYPTO_MIN_BYTES, "1");
+    }
+
+    ~BulkCryptoForAll()
+    {
+        config.override(CFG_BULK_CRYPTO_MIN_BYTES, m_min_bytes);
+    }
+
+private:
+    const std::string m_min_bytes;
+};
+
+// Allocations made by a fresh dacryptor to encrypt and then decrypt the payload
+static size_t countRoundTripAllocations(const std::string& payload)
+{
+    const std::string iv = "0123456789ABCDEF";
+    const std::string key = "01234567890123456789012345678901";
+    const size_t before = allocation_count;
+    {
+        dacryptor component;
+        component.setInitVector(iv);
+        component.setCryptionKey(key);
+        component.setInputData(payload);
+        EXPECT_TRUE( component.encrypt() );
+        const unsigned char* output;
+        unsigned int length;
+        component.getCryptedData( output, length );
+        component.setInputData(std::string((const char*)output, length));
+        EXPECT_TRUE( component.decrypt() );
+        component.getCryptedData( output, length );
+        EXPECT_EQ( payload, std::string((const char*)output, length) );
+    }
+    return allocation_count - before;
+}
+
 TEST(dacryptor, EncryptNoInputData)
 {
     // Try to call encrypt without first supplying any input data
@@ -305,3 +378,66 @@ TEST(dacryptor, CheckCacheMadeStale)
     ASSERT_EQ( inputData.size(), length2 );
     ASSERT_STREQ( inputData.c_str(), (const char*) output2 );
 }
+
+TEST(dacryptor, EncryptDecryptLargePayload)
+{
+    // Payloads over several blocks, with each amount of base64 and cipher padding
+    BulkCryptoForAll bulk;
+    for (size_t size : {12287u, 12288u, 12289u, 100000u})
+    {
+        countRoundTripAllocations(makePayload(size));
+    }
+}
+
+TEST(dacryptor, DecryptBadBase64)
+{
+    dacryptor component;
+    component.setInitVector(std::string("0123456789ABCDEF"));
+    component.setCryptionKey(std::string("01234567890123456789012345678901"));
+    component.setInputData("s63m9IopRzje81P3w9Te*MgmIEP8E1oRSofEwEo2Zng=");
+    ASSERT_FALSE( component.decrypt() );
+}
+
+TEST(dacryptor, AllocationsIndependentOfPayloadSize)
+{
+    // The temporary string made from the ciphertext is the only allocation that is not a buffer of the dacryptor
+    BulkCryptoForAll bulk;
+    const size_t small = countRoundTripAllocations(makePayload(1024));
+    const size_t large = countRoundTripAllocations(makePayload(1024 * 1024));
+    ASSERT_EQ( small, large );
+}
+
+TEST(dacryptor, ReuseWithoutAllocating)
+{
+    const std::string inputData = makePayload(1000);
+    const std::string iv = "0123456789ABCDEF";
+    const std::string key = "01234567890123456789012345678901";
+    BulkCryptoForAll bulk;
+    dacryptor component;
+    std::string encryptedStr;
+    const unsigned char* output;
+    unsigned int length;
+
+    // The first round trip grows the buffers to the size of the payload
+    size_t before = allocation_count;
+    for (int i = 0; i < 100; ++i)
+    {
+        component.setInitVector(iv);
+        component.setCryptionKey(key);
+        component.setInputData(inputData);
+        ASSERT_TRUE( component.encrypt() );
+        component.getCryptedData( output, length );
+        encryptedStr.assign((const char*)output, length);
+        component.setInputData(encryptedStr);
+        ASSERT_TRUE( component.decrypt() );
+        component.getCryptedData( output, length );
+        ASSERT_EQ( inputData.size(), length );
+        ASSERT_EQ( 0, memcmp( inputData.c_str(), output, length ) );
+        if (i == 0)
+        {
+            ASSERT_LT( 0u, allocation_count - before );
+            before = allocation_count;
+        }
+    }
+    ASSERT_EQ( 0u, allocation_count - before );
+}
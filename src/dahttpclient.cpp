@@ -100,9 +100,33 @@ namespace
 
         return CURL_SEEKFUNC_OK;
     }
+
+    /// @brief The state passed to the libcurl progress callback of a download
+    struct DownloadProgress
+    {
+        const DAHttp::ProgressCallback *p_callback;
+        curl_off_t resumed_from;
+    };
+
+    /**
+     * This is a callback registered with libcurl to report the progress of a download. libcurl
+     * reports the bytes of the current transfer, which starts at the offset the download resumed from.
+     *
+     * @param data The DownloadProgress of the download
+     * @param dltotal The number of bytes expected in this transfer, 0 if not known
+     * @param dlnow The number of bytes received in this transfer
+     * @return 0 to continue the transfer
+    */
+    int httpProgressCallback(void *data, curl_off_t dltotal, curl_off_t dlnow, curl_off_t, curl_off_t)
+    {
+        const DownloadProgress *p_progress = (const DownloadProgress *)data;
+        (*p_progress->p_callback)((uint64_t)(p_progress->resumed_from + dlnow),
+                                  dltotal > 0 ? (uint64_t)(p_progress->resumed_from + dltotal) : 0);
+        return 0;
+    }
 }
 
-DAHttpClient::DAHttpClient(const std::string &userAgent) : m_handle(NULL), m_userAgent(userAgent)
+DAHttpClient::DAHttpClient(const std::string &userAgent) : m_handle(NULL), m_userAgent(userAgent), m_resume_from(0)
 {
     m_headers = NULL;
     m_handle = curl_easy_init();
@@ -146,8 +170,10 @@ DAErrorCode DAHttpClient::sendRequest(const int reqType, const std::string &url,
 {
     CURLcode curlCode = CURLE_FAILED_INIT;
     DAErrorCode rc = ERR_OK;
-    std::string Proxy_Loc = config.lookup(CFG_PROXY);
-    std::string Proxy_Cred = config.lookup(CFG_PROXY_CREDENTIALS);
+    static const Configuration::Key proxyLocKey = config.key(CFG_PROXY);
+    static const Configuration::Key proxyCredKey = config.key(CFG_PROXY_CREDENTIALS);
+    const std::string Proxy_Loc = config.lookup(proxyLocKey);
+    const std::string Proxy_Cred = config.lookup(proxyCredKey);
 
     if (m_handle != NULL)
     {
@@ -192,8 +218,10 @@ DAErrorCode DAHttpClient::sendRequest(const int reqType, const std::string &url,
         curl_easy_setopt(m_handle, CURLOPT_VERBOSE, 1L);
 #endif // ENABLE_VERBOSE_LOG
 
-        std::string CApath = config.lookup(CFG_CAPATH);
-        std::string CAfile = config.lookup(CFG_CAFILE);
+        static const Configuration::Key caPathKey = config.key(CFG_CAPATH);
+        static const Configuration::Key caFileKey = config.key(CFG_CAFILE);
+        const std::string CApath = config.lookup(caPathKey);
+        const std::string CAfile = config.lookup(caFileKey);
 
         if (CApath.length())
         {
@@ -247,7 +275,8 @@ DAErrorCode DAHttpClient::sendRequest(const int reqType, const std::string &url,
             long httpRespCode = 0;
 
             curl_easy_getinfo(m_handle, CURLINFO_RESPONSE_CODE, &httpRespCode);
-            if (httpRespCode != 200)
+            // 206 is only expected by a download resuming from an offset
+            if (httpRespCode != 200 && !(httpRespCode == 206 && m_resume_from > 0))
             {
                 Log::getInstance()->printf(Log::Debug, " %s:%d httpRespCode: %ld", __func__, __LINE__, httpRespCode);
                 rc = ERR_CURL;
@@ -256,6 +285,8 @@ DAErrorCode DAHttpClient::sendRequest(const int reqType, const std::string &url,
         else
         {
             Log::getInstance()->printf(Log::Error, " %s:%d error buffer: %s, curlCode: %d", __func__, __LINE__, m_error_buffer, curlCode);
+            long httpRespCode = 0;
+            curl_easy_getinfo(m_handle, CURLINFO_RESPONSE_CODE, &httpRespCode);
             if (CApath.length())
             {
                 Log::getInstance()->printf(Log::Information, "%s CURLOPT_CAPATH(CApath): %s", __func__, CApath.c_str());
@@ -264,9 +295,41 @@ DAErrorCode DAHttpClient::sendRequest(const int reqType, const std::string &url,
             {
                 Log::getInstance()->printf(Log::Information, "%s CURLOPT_CAINFO(CAfile) :%s ", __func__, CAfile.c_str());
             }
-            rc = ERR_CURL;
+            // The server ignored the requested range, or the range is past the end of the resource
+            rc = (curlCode == CURLE_RANGE_ERROR || httpRespCode == 416) ? ERR_RANGE : ERR_CURL;
         }
     }
 
     return rc;
 }
+
+DAErrorCode DAHttpClient::download(const std::string &url, std::ostream *outStream, uint64_t resumeFrom, const DAHttp::ProgressCallback &progress)
+{
+    if (m_handle == NULL)
+    {
+        return ERR_CURL;
+    }
+
+    DownloadProgress downloadProgress = { &progress, (curl_off_t)resumeFrom };
+    curl_easy_setopt(m_handle, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)resumeFrom);
+    m_resume_from = resumeFrom;
+    // Fail on an error status before its body is written into the download
+    curl_easy_setopt(m_handle, CURLOPT_FAILONERROR, 1L);
+    if (progress)
+    {
+        curl_easy_setopt(m_handle, CURLOPT_XFERINFOFUNCTION, httpProgressCallback);
+        curl_easy_setopt(m_handle, CURLOPT_XFERINFODATA, (void *)&downloadProgress);
+        curl_easy_setopt(m_handle, CURLOPT_NOPROGRESS, 0L);
+    }
+
+    const DAErrorCode rc = sendRequest(DAHttp::ReqType::eGET, url, outStream);
+
+    // The handle is reused for other requests
+    curl_easy_setopt(m_handle, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)0);
+    m_resume_from = 0;
+    curl_easy_setopt(m_handle, CURLOPT_FAILONERROR, 0L);
+    curl_easy_setopt(m_handle, CURLOPT_NOPROGRESS, 1L);
+    curl_easy_setopt(m_handle, CURLOPT_XFERINFODATA, NULL);
+
+    return rc;
+}
@@ -18,10 +18,21 @@
 #include "dahttpclient.hpp"
 #include "deviceauthority.hpp"
 #include "DeviceKeyDef.h"
+#include "evp_crypto.hpp"
+#include "json_utils.hpp"
 #include "log.hpp"
 
 using namespace rapidjson;
 
+namespace
+{
+    /// @brief Get the key under which an authorisation for a policy and key ID is kept
+    std::string authSessionKey(const std::string &policy_id, const std::string &key_id)
+    {
+        return "auth\n" + policy_id + "\n" + key_id;
+    }
+}
+
 
 #if defined(WIN32)
 #if !defined(strdup)
@@ -36,6 +47,7 @@ bool mutexDA_initialised = false;
 #else
 pthread_mutex_t DeviceAuthority::mutexDA_ = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 #endif // #if !defined(PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP)
+pthread_mutex_t DeviceAuthority::mutexDDKG_ = PTHREAD_MUTEX_INITIALIZER;
 #endif // #if defined(USETHREADING)
 DeviceAuthorityBase *DeviceAuthority::mp_da_instance = nullptr;
 
@@ -68,6 +80,22 @@ void DeviceAuthority::mutex_unlock()
 #endif // #if defined(USETHREADING)
 }
 
+/// @brief Lock the DDKG if threading is enabled. Only held around DDKG calls, never around network I/O.
+void DeviceAuthority::ddkg_lock()
+{
+#if defined(USETHREADING)
+    pthread_mutex_lock(&mutexDDKG_);
+#endif // #if defined(USETHREADING)
+}
+
+/// @brief Unlock the DDKG if threading is enabled
+void DeviceAuthority::ddkg_unlock()
+{
+#if defined(USETHREADING)
+    pthread_mutex_unlock(&mutexDDKG_);
+#endif // #if defined(USETHREADING)
+}
+
 typedef union
 {
     NAUDADDK_GETDEVICEKEYWITHCHALLENGE_WITHDEVICEROLE_PROC pfnaudaddk_getdevicekeywithchallenge_withdevicerole;
@@ -259,7 +287,9 @@ bool DeviceAuthority::destroyInstance()
         if (pfnaudaddk_globalcleanup)
         {
             Log::getInstance()->printf(Log::Debug, " %s Calling pfnaudaddk_globalcleanup", __func__);
+            ddkg_lock();
             pfnaudaddk_globalcleanup();
+            ddkg_unlock();
             Log::getInstance()->printf(Log::Debug, " %s Calling pfnaudaddk_globalcleanup Done", __func__);
         }
         // Calls DeviceAuthority destructor
@@ -274,12 +304,42 @@ bool DeviceAuthority::destroyInstance()
 
 void DeviceAuthority::setAPIURL(const std::string& APIURL)
 {
-    m_APIURL = APIURL;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_endpoint_mutex);
+        changed = (m_APIURL != APIURL);
+        m_APIURL = APIURL;
+    }
+    if (changed)
+    {
+        invalidateSession();
+    }
 }
 
 void DeviceAuthority::setUserId(const std::string& user)
 {
-    m_user = user;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_endpoint_mutex);
+        changed = (m_user != user);
+        m_user = user;
+    }
+    if (changed)
+    {
+        invalidateSession();
+    }
+}
+
+std::string DeviceAuthority::getUserId() const
+{
+    std::lock_guard<std::mutex> lock(m_endpoint_mutex);
+    return m_user;
+}
+
+std::string DeviceAuthority::getAPIURL() const
+{
+    std::lock_guard<std::mutex> lock(m_endpoint_mutex);
+    return m_APIURL;
 }
 
 const std::string& DeviceAuthority::userAgentString() const
@@ -296,9 +356,13 @@ bool DeviceAuthority::setUDI(const std::string &udi) const
 {
     if (!udi.empty() && pfnaudaddk_setudi != nullptr)
     {
+        ddkg_lock();
         const auto result = pfnaudaddk_setudi(udi.c_str(), udi.length());
+        ddkg_unlock();
         if (result == 0)
         {
+            std::lock_guard<std::mutex> lock(m_identity_mutex);
+            m_udi_valid = false;
             return true;
         }
 
@@ -308,7 +372,25 @@ bool DeviceAuthority::setUDI(const std::string &udi) const
     return false;
 }
 
-const std::string DeviceAuthority::getUDI() const
+std::string DeviceAuthority::getUDI() const
+{
+    std::lock_guard<std::mutex> lock(m_identity_mutex);
+    if (!m_udi_valid)
+    {
+        m_udi = readUDI();
+        m_udi_valid = !m_udi.empty();
+    }
+    return m_udi;
+}
+
+void DeviceAuthority::invalidateIdentity()
+{
+    std::lock_guard<std::mutex> lock(m_identity_mutex);
+    m_tid_valid = false;
+    m_udi_valid = false;
+}
+
+std::string DeviceAuthority::readUDI() const
 {
     if (pfnaudaddk_getudi == nullptr)
     {
@@ -316,9 +398,11 @@ const std::string DeviceAuthority::getUDI() const
     }
 
     char *raw_udi = NULL;
+    ddkg_lock();
     int result = pfnaudaddk_getudi(&raw_udi);
     if (result != kDDKStatusSuccess)
     {
+        ddkg_unlock();
         Log::getInstance()->printf(Log::Error, " %s Failed to get UDI: rc %d", __func__, result);
         return "";
     }
@@ -329,6 +413,7 @@ const std::string DeviceAuthority::getUDI() const
         udi.append(raw_udi);
         pfnaudaddk_freebuffer(&raw_udi);
     }
+    ddkg_unlock();
     return udi;
 }
 
@@ -336,7 +421,9 @@ bool DeviceAuthority::setExtDdkgUDIPropertyName(const std::string &udi_property)
 {
     if (!udi_property.empty() && pfnaudaddk_extddkg_setudipropertyname != nullptr)
     {
+        ddkg_lock();
         const auto result = pfnaudaddk_extddkg_setudipropertyname(udi_property.c_str(), udi_property.length());
+        ddkg_unlock();
         if (result == 0)
         {
             return true;
@@ -352,7 +439,9 @@ bool DeviceAuthority::setDdkgRootFilepath(const std::string &ddkg_root_fs) const
 {
     if (!ddkg_root_fs.empty() && pfnaudaddk_setrootfs != nullptr)
     {
+        ddkg_lock();
         const auto result = pfnaudaddk_setrootfs(ddkg_root_fs.c_str(), ddkg_root_fs.length());
+        ddkg_unlock();
         if (result == 0)
         {
             return true;
@@ -398,6 +487,9 @@ DeviceAuthority::DeviceAuthority(const std::string& user, const std::string& API
     , m_deviceTID("")
     , m_hdll(NULL)
     , m_is_edge_node(false)
+    , m_registrations(0)
+    , m_tid_valid(false)
+    , m_udi_valid(false)
 {
     // m_device_name may be blank and if so use the hostname of the device to provide a name
     if (m_device_name.empty())
@@ -451,7 +543,9 @@ DeviceAuthority::DeviceAuthority(const std::string& user, const std::string& API
         //Log::getInstance()->printf(Log::Debug, " %s Calling pfnaudaddk_globalinit", __func__);
         if (pfnaudaddk_globalinit)
         {
+            ddkg_lock();
             pfnaudaddk_globalinit();
+            ddkg_unlock();
         }
     }
 }
@@ -488,7 +582,10 @@ DeviceAuthority::DeviceAuthority(const std::string& user, const std::string& API
     pfnaudaddk_setrootfs(NULL),
     m_deviceTID(""),
     m_hdll(NULL),
-    m_is_edge_node(false)
+    m_is_edge_node(false),
+    m_registrations(0),
+    m_tid_valid(false),
+    m_udi_valid(false)
 {
     // m_device_name may be blank and if so use the hostname of the device to provide a name
     if (m_device_name.empty())
@@ -542,7 +639,9 @@ DeviceAuthority::DeviceAuthority(const std::string& user, const std::string& API
         //Log::getInstance()->printf(Log::Debug, " %s Calling pfnaudaddk_globalinit", __func__);
         if (pfnaudaddk_globalinit)
         {
+            ddkg_lock();
             pfnaudaddk_globalinit();
+            ddkg_unlock();
         }
     }
 }
@@ -951,7 +1050,9 @@ bool DeviceAuthority::loadLibrary()
         logger->printf(Log::Notice, " %s getting platform from ddkg...", __func__ );
 
         char *ddkstring = NULL;
+        ddkg_lock();
         int result = pfnaudaddk_getplatformstring(&ddkstring);
+        ddkg_unlock();
 
         logger->printf(Log::Notice, " %s done get platform", __func__);
         if ((result == kDDKStatusSuccess) && ddkstring)
@@ -963,7 +1064,9 @@ bool DeviceAuthority::loadLibrary()
         {
             logger->printf(Log::Critical, " %s Unable to get platform string, status: %d", __func__, result);
         }
+        ddkg_lock();
         pfnaudaddk_freebuffer(&ddkstring);
+        ddkg_unlock();
     }
     std::cout << "Platform: " << m_platform << std::endl;
 
@@ -975,7 +1078,9 @@ bool DeviceAuthority::loadLibrary()
         logger->printf(Log::Notice, " %s getting user agent from ddkg...", __func__ );
 
         char *ddkstring = NULL;
+        ddkg_lock();
         int result = pfnaudaddk_getuseragentstring(&ddkstring);
+        ddkg_unlock();
 
         logger->printf(Log::Notice, " %s done get user agent", __func__);
         if ((result == kDDKStatusSuccess) && ddkstring)
@@ -987,7 +1092,9 @@ bool DeviceAuthority::loadLibrary()
         {
             logger->printf(Log::Critical, " %s Unable to get userAgent string, status: %d", __func__, result);
         }
+        ddkg_lock();
         pfnaudaddk_freebuffer(&ddkstring);
+        ddkg_unlock();
     }
     std::cout << "User-Agent: " << m_user_agent << std::endl;
 
@@ -995,7 +1102,9 @@ bool DeviceAuthority::loadLibrary()
     if (m_version.empty())
     {
         char *ddkstring = NULL;
+        ddkg_lock();
         int result = pfnaudaddk_getdevicekeyversion(&ddkstring);
+        ddkg_unlock();
 
         logger->printf(Log::Notice, " %s done get devicekey version", __func__);
         if ((result == kDDKStatusSuccess) && ddkstring)
@@ -1007,7 +1116,9 @@ bool DeviceAuthority::loadLibrary()
         {
             logger->printf(Log::Critical, " %s Unable to get devicekey version string, status: %d", __func__, result);
         }
+        ddkg_lock();
         pfnaudaddk_freebuffer(&ddkstring);
+        ddkg_unlock();
     }
     std::cout << "DDKG Version: " << m_version << std::endl;
 
@@ -1026,8 +1137,7 @@ std::string DeviceAuthority::authoriseTheApp(std::string& key_id, std::string& k
 
 std::string DeviceAuthority::authoriseTheApp(std::string& key_id, std::string& key, std::string& iv, std::string& message, const std::string& apphash, bool sign_apphash, const std::string& asset_id_str, void *p_client_obj)
 {
-    mutex_lock();
-
+    // Challenges from different callers run concurrently, only the DDKG calls are serialised
 #if defined(ENABLE_VERBOSE_LOG)
     Log::getInstance()->printf(Log::Debug, " %s:%d: appHash=%s, assetId=%s", __func__, __LINE__, appHash.c_str(), assetIdStr.c_str());
 #endif // #if defined(ENABLE_VERBOSE_LOG)
@@ -1036,6 +1146,12 @@ std::string DeviceAuthority::authoriseTheApp(std::string& key_id, std::string& k
     m_is_edge_node = node.compare(EDGE_NODE) == 0;
 
     std::string result;
+    const std::string session_key = "app\n" + key_id + "\n" + asset_id_str + "\n" + apphash + (sign_apphash ? "\n1" : "\n0");
+    if (findSession(session_key, key_id, key, iv, result))
+    {
+        return result;
+    }
+
     bool registered = true;
     DAHttpClient *p_client_ptr = NULL;
 
@@ -1049,7 +1165,8 @@ std::string DeviceAuthority::authoriseTheApp(std::string& key_id, std::string& k
     }
 
     int status_code = 0;
-    const std::string challenge = authorisationChallenge(message, registered, (void *)p_client_ptr, status_code);
+    int session_lifetime_s = 0;
+    const std::string challenge = authorisationChallenge(message, registered, (void *)p_client_ptr, status_code, "", &session_lifetime_s);
     if (!registered)
     {
         Log::getInstance()->printf(Log::Error," Device is not registered ");
@@ -1060,9 +1177,11 @@ std::string DeviceAuthority::authoriseTheApp(std::string& key_id, std::string& k
         //printf("%s: registered:%d  ", __func__, registered);
         // The SAC will inform if registration is needed first
         result = getBodyJSONForAPICall(challenge, key_id, key, iv, apphash, sign_apphash, asset_id_str, message);
+        if (!result.empty())
+        {
+            keepSession(session_key, session_lifetime_s, key_id, key, iv, result);
+        }
     }
-    
-    mutex_unlock();
 
     return result;
 }
@@ -1079,24 +1198,24 @@ std::string DeviceAuthority::identifyAndAuthorise(std::string& key_id, std::stri
 {
     Log *p_logger = Log::getInstance();
 
-#if defined(ENABLE_VERBOSE_LOG)
-    logger->printf(Log::Debug, " %s:%d: lock wait called", __func__, __LINE__);
-#endif // #if defined(ENABLE_VERBOSE_LOG)
-
-    mutex_lock();
-
-#if defined(ENABLE_VERBOSE_LOG)
-    logger->printf(Log::Debug, " %s:%d: lock acquired called", __func__, __LINE__);
-#endif // #if defined(ENABLE_VERBOSE_LOG)
-
+    // Challenges from different callers run concurrently, only the DDKG calls and registration are serialised
     const std::string node = config.lookup(CFG_NODE);
 
     m_is_edge_node = node.compare(EDGE_NODE) == 0;
 
+    // Reuse the last authorisation for the same policy and key while KeyScaler still accepts it
     std::string result;
+    const std::string session_key = authSessionKey(policy_id, key_id);
+    if (findSession(session_key, key_id, key, iv, result))
+    {
+        return result;
+    }
+
+    const unsigned int registrations = m_registrations;
     bool registered = true; // Assume true for now
     int status_code = 0;
-    std::string challenge = authorisationChallenge(message, registered, (void *)p_client_ptr, status_code, policy_id);
+    int session_lifetime_s = 0;
+    std::string challenge = authorisationChallenge(message, registered, (void *)p_client_ptr, status_code, policy_id, &session_lifetime_s);
 #if defined(ENABLE_VERBOSE_LOG)
     logger->printf(Log::Debug, " %s:%d: authorisationChallenge returned %d", __func__, __LINE__, challenge.size());
 #endif // #if defined(ENABLE_VERBOSE_LOG)
@@ -1115,17 +1234,15 @@ std::string DeviceAuthority::identifyAndAuthorise(std::string& key_id, std::stri
         if (registered)
         {
             result = getBodyJSONForAPICall(challenge, key_id, key, iv, "", "", message);
+            if (!result.empty())
+            {
+                keepSession(session_key, session_lifetime_s, key_id, key, iv, result);
+            }
         }
         else
         {
             // Need to register first
-            p_logger->printf(Log::Information, "Device registration required");
-            if (mp_event_manager) 
-            {
-                mp_event_manager->notifyRegistrationRequired();
-            }
-            
-            registered = registration(challenge, message, metadata);
+            registered = registerOnce(registrations, challenge, message, metadata);
 
             if (registered)
             {
@@ -1137,8 +1254,6 @@ std::string DeviceAuthority::identifyAndAuthorise(std::string& key_id, std::stri
             }
         }
     }
-    
-    mutex_unlock();
 
 #if defined(ENABLE_VERBOSE_LOG)
     //logger->printf(Log::Debug, " %s:%d: lock released called, size=%d, error=%s", __func__, __LINE__, result.size(), message.c_str());
@@ -1147,6 +1262,39 @@ std::string DeviceAuthority::identifyAndAuthorise(std::string& key_id, std::stri
     return result;
 }
 
+bool DeviceAuthority::registerOnce(unsigned int registrations, const std::string& challengeID, std::string& message, std::string& metadata)
+{
+    mutex_lock();
+
+    bool registered = true;
+    // A caller that found the device unregistered at the same time may have registered it already
+    if (m_registrations == registrations)
+    {
+        Log::getInstance()->printf(Log::Information, "Device registration required");
+        if (mp_event_manager)
+        {
+            mp_event_manager->notifyRegistrationRequired();
+        }
+
+        registered = registration(challengeID, message, metadata);
+        if (registered)
+        {
+            m_registrations++;
+            invalidateIdentity();
+        }
+    }
+    else
+    {
+        // The message is from the challenge that found the device unregistered, not from a registration
+        Log::getInstance()->printf(Log::Debug, " %s Device already registered by another caller", __func__);
+        message.clear();
+    }
+
+    mutex_unlock();
+
+    return registered;
+}
+
 bool DeviceAuthority::registration(const std::string& challengeID, std::string& message)
 {
     std::string metadata;
@@ -1157,7 +1305,8 @@ bool DeviceAuthority::registration(const std::string& challengeID, std::string&
 bool DeviceAuthority::registration(const std::string& challengeID, std::string& message, std::string& metadata)
 {
     bool registered = false;  // Assume it is not registered
-    std::string apiurl = m_APIURL + REGISTER_PATH;
+    std::string apiurl = getAPIURL() + REGISTER_PATH;
+    const std::string user = getUserId();
     rapidjson::Document json;
     DAErrorCode rc = ERR_OK;
 
@@ -1179,10 +1328,10 @@ bool DeviceAuthority::registration(const std::string& challengeID, std::string&
             bodytext.append(",\"userAgent\":\"");
             bodytext.append(m_user_agent + "\"");
             bodytext.append(",\"displayName\":\"" + m_device_name + "\"");
-            if (!m_user.empty())
+            if (!user.empty())
             {
                 // Add userId into the json string
-                bodytext.append(",\"userId\":\"" + m_user + "\"");
+                bodytext.append(",\"userId\":\"" + user + "\"");
             }
             bodytext.append("}");
             //if (!APIKey_.empty() || !APISecret_.empty())
@@ -1316,15 +1465,19 @@ std::string getChallengeStringFromJson(const rapidjson::Document &json, std::str
     return "";
 }
 
-std::string DeviceAuthority::challenge(const std::string& type, const std::string& bodytext, bool& registered, std::string& message, void *p_http_client, int &status_code)
+std::string DeviceAuthority::challenge(const std::string& type, const std::string& bodytext, bool& registered, std::string& message, void *p_http_client, int &status_code, int *p_session_lifetime_s)
 {
     message = "";
     status_code = 0;
+    if (p_session_lifetime_s)
+    {
+        *p_session_lifetime_s = 0;
+    }
 
     std::string result = "";
     std::string body = bodytext;
     std::string json_response = "";
-    std::string apiurl = m_APIURL+ CHALLENGE_PATH;
+    std::string apiurl = getAPIURL() + CHALLENGE_PATH;
 
     if (!p_http_client)
     {
@@ -1394,6 +1547,12 @@ std::string DeviceAuthority::challenge(const std::string& type, const std::strin
                     }
                 }
             }
+
+            // A server that accepts the response to this challenge more than once says for how long
+            if (p_session_lifetime_s && msg_val.HasMember("sessionLifetime") && msg_val["sessionLifetime"].IsInt())
+            {
+                *p_session_lifetime_s = msg_val["sessionLifetime"].GetInt();
+            }
         }
 
         result = getChallengeStringFromJson(json, message);
@@ -1414,7 +1573,7 @@ std::string DeviceAuthority::registrationChallenge(std::string &message, void *p
     DAHttpClient *p_http_client_obj = (DAHttpClient *)p_client_ptr;
 
     std::string json_response = "";
-    std::string apiurl = m_APIURL + CHALLENGE_PATH;
+    std::string apiurl = getAPIURL() + CHALLENGE_PATH;
     DAErrorCode rc = p_http_client_obj->sendRequest(DAHttp::ReqType::ePOST, apiurl, json_response, bodytext);
 
     rapidjson::Document json;
@@ -1441,7 +1600,7 @@ std::string DeviceAuthority::registrationChallenge(std::string &message, void *p
     return challenge;
 }
 
-std::string DeviceAuthority::authorisationChallenge(std::string &message, bool &registered, void *p_client_ptr, int &status_code, std::string policyID)
+std::string DeviceAuthority::authorisationChallenge(std::string &message, bool &registered, void *p_client_ptr, int &status_code, std::string policyID, int *p_session_lifetime_s)
 {
     Log::getInstance()->printf(Log::Debug, " %s:%d", __func__, __LINE__);
 
@@ -1472,11 +1631,12 @@ std::string DeviceAuthority::authorisationChallenge(std::string &message, bool &
         bodytext.append(m_version);
         bodytext.append("\"");
 #endif
-        if (!m_user.empty())
+        const std::string user = getUserId();
+        if (!user.empty())
         {
             // Add userId to json string
             bodytext.append(",\"userId\":\"");
-            bodytext.append(m_user);
+            bodytext.append(user);
             bodytext.append("\"");
         }
         if (!policyID.empty())
@@ -1496,7 +1656,7 @@ std::string DeviceAuthority::authorisationChallenge(std::string &message, bool &
         bodytext.append("\"");
         bodytext.append("}");
         Log::getInstance()->printf(Log::Debug, " %s:%d send challenge", __func__, __LINE__);
-        result = challenge(CHTYPEAUTH_TEXT, bodytext, registered, message, p_client_ptr, status_code);
+        result = challenge(CHTYPEAUTH_TEXT, bodytext, registered, message, p_client_ptr, status_code, p_session_lifetime_s);
     }
     //Log::getInstance()->printf(Log::Debug, "Exit %s %d registered :%d ", __func__, __LINE__, registered);
 
@@ -1546,13 +1706,13 @@ string DeviceAuthority::getDeviceKey(const std::string& challengeID, std::string
 	    }
     }
     */
-    std::string metadataJSON = "{";
+    rapidjson::StringBuffer metadata_buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> metadata_writer(metadata_buffer);
+    metadata_writer.StartObject();
 
     if (m_is_edge_node)
     {
-        std::string node = config.lookup(CFG_NODE);
-
-        metadataJSON = metadataJSON + "\"" + JSON_NODE + "\":\"" + node + "\"";
+        JsonUtils::writeMember(metadata_writer, JSON_NODE, config.lookup(CFG_NODE));
     }
     if (!challengeID.empty())
     {
@@ -1566,16 +1726,18 @@ string DeviceAuthority::getDeviceKey(const std::string& challengeID, std::string
         }
 
         const std::string udi = config.lookup(CFG_UDI);
-		if (m_is_edge_node)
-		{
-			metadataJSON = metadataJSON + ",";
-		}
-        metadataJSON = metadataJSON + "\"" + JSON_DEVICE_ROLE + "\":\"" + deviceRole + "\"";
+        JsonUtils::writeMember(metadata_writer, JSON_DEVICE_ROLE, deviceRole);
         if (udi.length() > 0)
         {
-            metadataJSON = metadataJSON + ",\"" + JSON_DEVICE_META + "\":[{\"" + JSON_DEVICE_META_NAME + "\":\"deviceId\",\"" + JSON_DEVICE_META_VALUE + "\":\"" + udi + "\"}]";
+            metadata_writer.Key(JSON_DEVICE_META);
+            metadata_writer.StartArray();
+            metadata_writer.StartObject();
+            JsonUtils::writeMember(metadata_writer, JSON_DEVICE_META_NAME, "deviceId");
+            JsonUtils::writeMember(metadata_writer, JSON_DEVICE_META_VALUE, udi);
+            metadata_writer.EndObject();
+            metadata_writer.EndArray();
         }
-        metadataJSON = metadataJSON + ",\"" + JSON_CH + "\":\"" + challengeID + "\"";
+        JsonUtils::writeMember(metadata_writer, JSON_CH, challengeID);
         /*
         if ((udi.length() > 0) && pfnaudaddk_getdevicekeywithchallenge_withdevicemeta)
         {
@@ -1591,13 +1753,7 @@ string DeviceAuthority::getDeviceKey(const std::string& challengeID, std::string
     }
     else
     {
-        const std::string cryptoProvider = config.lookup(CFG_KEYSTORE_PROVIDER);
-
-		if (m_is_edge_node)
-		{
-			metadataJSON = metadataJSON + ",";
-		}
-        metadataJSON = metadataJSON + "\"" + JSON_CRYPTO_PROVIDER + "\":\"" + cryptoProvider + "\"";
+        JsonUtils::writeMember(metadata_writer, JSON_CRYPTO_PROVIDER, config.lookup(CFG_KEYSTORE_PROVIDER));
         //Log::getInstance()->printf(Log::Debug, " %s:%d", __func__, __LINE__);
         /*
         if (pfnaudaddk_getdevicekeyoaep)
@@ -1635,78 +1791,57 @@ string DeviceAuthority::getDeviceKey(const std::string& challengeID, std::string
 
                 if (a.HasMember("keyAndExpiry"))
                 {
-                    // Get keyAndExpiry
+                    // Get keyAndExpiry, the writer escapes the newlines of the key
                     const Value& b = a["keyAndExpiry"];
 
-                    metadataJSON = metadataJSON + ",\"" + JSON_KEY_AND_EXPIRY + "\":{";
+                    metadata_writer.Key(JSON_KEY_AND_EXPIRY);
+                    metadata_writer.StartObject();
                     if (b.HasMember("key"))
                     {
                         const rapidjson::Value& keyVal = b["key"];
-                        std::string temp_string = keyVal.GetString();
-                        std::string eol = "\n";
-                        size_t pos = temp_string.find(eol);
-                        std::string neweol = "\\n";
 
-                        while (pos != std::string::npos)
-                        {
-                            temp_string.replace(pos, eol.size(), neweol);
-                            pos = temp_string.find(eol, pos + neweol.size());
-                        }
-                        metadataJSON = metadataJSON + "\"" + JSON_KEY + "\":\"" + temp_string + "\"";
+                        metadata_writer.Key(JSON_KEY);
+                        metadata_writer.String(keyVal.GetString(), keyVal.GetStringLength());
                     }
                     if (b.HasMember("expiry"))
                     {
                         const rapidjson::Value& expiryVal = b["expiry"];
-                        uint64_t expiry_int = expiryVal.GetUint64();
 
-                        metadataJSON = metadataJSON + ",\"" + JSON_EXPIRY + "\":" + std::to_string(expiry_int);
+                        metadata_writer.Key(JSON_EXPIRY);
+                        metadata_writer.Uint64(expiryVal.GetUint64());
                     }
-                    metadataJSON = metadataJSON + "}";
+                    metadata_writer.EndObject();
                 }
                 if (a.HasMember("signature"))
                 {
                     // Get signature
                     const Value& c = a["signature"];
+                    static const char *SIGNATURE_MEMBERS[] = {JSON_SIGNATURE_ALGO, JSON_SIGNATURE_DATA, JSON_SIGNATURE_ENCODING, JSON_SIGNATURE_SIGN_ALGO};
 
-                    metadataJSON = metadataJSON + ",\"" + JSON_SIGNATURE + "\":{";
-                    if (c.HasMember("algo"))
-                    {
-                        const rapidjson::Value& algo = c["algo"];
-                        std::string temp_algo = algo.GetString();
-
-                        metadataJSON = metadataJSON + "\"" + JSON_SIGNATURE_ALGO + "\":\"" + temp_algo + "\"";
-                    }
-                    if (c.HasMember("data"))
-                    {
-                        const rapidjson::Value& data = c["data"];
-                        std::string temp_data = data.GetString();
-
-                        metadataJSON = metadataJSON + ",\"" + JSON_SIGNATURE_DATA + "\":\"" + temp_data + "\"";
-                    }
-                    if (c.HasMember("encoding"))
+                    metadata_writer.Key(JSON_SIGNATURE);
+                    metadata_writer.StartObject();
+                    for (size_t i = 0; i < sizeof(SIGNATURE_MEMBERS) / sizeof(SIGNATURE_MEMBERS[0]); ++i)
                     {
-                        const rapidjson::Value& encoding = c["encoding"];
-                        std::string temp_encoding = encoding.GetString();
-
-                        metadataJSON = metadataJSON + ",\"" + JSON_SIGNATURE_ENCODING + "\":\"" + temp_encoding + "\"";
-                    }
-                    if (c.HasMember("sig_algo"))
-                    {
-                        const rapidjson::Value& sig_algo = c["sig_algo"];
-                        std::string temp_sig_algo = sig_algo.GetString();
+                        if (c.HasMember(SIGNATURE_MEMBERS[i]))
+                        {
+                            const rapidjson::Value& member = c[SIGNATURE_MEMBERS[i]];
 
-                        metadataJSON = metadataJSON + ",\"" + JSON_SIGNATURE_SIGN_ALGO + "\":\"" + temp_sig_algo + "\"";
+                            metadata_writer.Key(SIGNATURE_MEMBERS[i]);
+                            metadata_writer.String(member.GetString(), member.GetStringLength());
+                        }
                     }
-                    metadataJSON = metadataJSON + "}";
+                    metadata_writer.EndObject();
                 }
             }
         }
     }
-    metadataJSON = metadataJSON + "}";
-	// Log::getInstance()->printf(Log::Debug, " %s:%d metadataJSON: %s", __func__, __LINE__, metadataJSON.c_str());
+    metadata_writer.EndObject();
+	// Log::getInstance()->printf(Log::Debug, " %s:%d metadataJSON: %s", __func__, __LINE__, metadata_buffer.GetString());
+    // The DDKG is locked from generating the key until it is freed
+    ddkg_lock();
     if (pfnaudaddk_getdevicekey_foredge)
     {
-        result = pfnaudaddk_getdevicekey_foredge(metadataJSON.c_str(), &deviceKeyJSON);
+        result = pfnaudaddk_getdevicekey_foredge(metadata_buffer.GetString(), &deviceKeyJSON);
     }
     if (result == kDDKStatusSuccess)
     {
@@ -1836,9 +1971,12 @@ string DeviceAuthority::getDeviceKey(const std::string& challengeID, std::string
         {
             result = pfnaudaddk_freedevicekey(&deviceKeyJSON);
         }
+        ddkg_unlock();
     } //if (result == kDDKStatusSuccess)
     else
     {
+        ddkg_unlock();
+
         ostringstream oss;
 
         Log::getInstance()->printf(Log::Information, " %s:%d Failed to generate device key: %d", __func__, __LINE__, result);
@@ -1854,13 +1992,26 @@ string DeviceAuthority::getDeviceKey(const std::string& challengeID, std::string
     return deviceKey;
 }
 
-string DeviceAuthority::getDeviceTid()
+std::string DeviceAuthority::getDeviceTid()
+{
+    std::lock_guard<std::mutex> lock(m_identity_mutex);
+    if (!m_tid_valid)
+    {
+        m_tid = readDeviceTid();
+        m_tid_valid = !m_tid.empty();
+    }
+    return m_tid;
+}
+
+std::string DeviceAuthority::readDeviceTid()
 {
     int result = kDDKStatusError;
     char* devicetid = NULL;
     std::string result_tid = "";
 
+    ddkg_lock();
     pfnaudaddk_getdevicetid(&devicetid);
+    ddkg_unlock();
     rapidjson::Document json;
 
     json.Parse(devicetid);
@@ -1876,7 +2027,9 @@ string DeviceAuthority::getDeviceTid()
             result_tid = tidVal.GetString();
         }
     }
+    ddkg_lock();
     pfnaudaddk_freebuffer(&devicetid);
+    ddkg_unlock();
 
     return result_tid;
 }
@@ -1922,10 +2075,11 @@ std::string DeviceAuthority::getBodyJSONForAPICall(
 
             bodytext += "\"userAgent\":\"" + m_user_agent + "\",";
         }
-        if (!m_user.empty())
+        const std::string user = getUserId();
+        if (!user.empty())
         {
             // Add userId to json string
-            bodytext += "\"userId\":\"" + m_user + "\",";
+            bodytext += "\"userId\":\"" + user + "\",";
         }
         if (!key_id.empty())
         {
@@ -1961,7 +2115,14 @@ std::string DeviceAuthority::getBodyJSONForAPICall(
 
 bool DeviceAuthority::getIDCToken(std::string &token)
 {
-    mutex_lock();
+    {
+        std::lock_guard<std::mutex> lock(m_session_mutex);
+        if (!m_idc_token.empty() && std::chrono::steady_clock::now() < m_idc_token_expires)
+        {
+            token = m_idc_token;
+            return true;
+        }
+    }
 
     std::string keyId;
     std::string authkey;
@@ -1990,8 +2151,6 @@ bool DeviceAuthority::getIDCToken(std::string &token)
             errMessage = " deviceKey not found in authenticate response";
             Log::getInstance()->printf(Log::Error, "%s : %s", __func__, errMessage.c_str());
 
-            mutex_unlock();
-
             return retVal;
         }
 
@@ -2000,10 +2159,11 @@ bool DeviceAuthority::getIDCToken(std::string &token)
         std::string appId;
         const std::string udi = config.lookup(CFG_UDI);
         const std::string udiType = config.lookup(CFG_UDITYPE);
-        std::string apiurl = m_APIURL+ IDC_PATH;
-        std::string request = "\"req\":{ \"op\":\"idc\",\"auth_id\":\"" + m_user + "\",\"app-id\":\"" + appId + "\",\"meta\":{},\"udi\":\"" + udi + "\",\"udi-type\":\"" + udiType + "\",\"type\":\"self\"}";
+        const std::string user = getUserId();
+        std::string apiurl = getAPIURL() + IDC_PATH;
+        std::string request = "\"req\":{ \"op\":\"idc\",\"auth_id\":\"" + user + "\",\"app-id\":\"" + appId + "\",\"meta\":{},\"udi\":\"" + udi + "\",\"udi-type\":\"" + udiType + "\",\"type\":\"self\"}";
 
-        idcPacket += "{\"ddkg\":\"" + jsonKeyStr + "\",\"deviceAccountId\":\"" + m_user + "\",\"userAgent\":\"" + m_user_agent+ "\",\"domainPublicIP\":\"\"," + request + "}";
+        idcPacket += "{\"ddkg\":\"" + jsonKeyStr + "\",\"deviceAccountId\":\"" + user + "\",\"userAgent\":\"" + m_user_agent+ "\",\"domainPublicIP\":\"\"," + request + "}";
 
         std::string idcPacketReq = "{\"idcPacket\":" + idcPacket + "}";
 
@@ -2042,6 +2202,15 @@ bool DeviceAuthority::getIDCToken(std::string &token)
                     token = jsonStr;
                     Log::getInstance()->printf(Log::Debug, "%s : FINAL token:%s", __func__, jsonStr.c_str());
                     retVal = true;
+
+                    // The token is reused for as long as the authorisation it was obtained with
+                    std::lock_guard<std::mutex> lock(m_session_mutex);
+                    const std::map<std::string, AuthSession>::const_iterator session_iter = m_sessions.find(authSessionKey("", ""));
+                    if (session_iter != m_sessions.end())
+                    {
+                        m_idc_token = token;
+                        m_idc_token_expires = session_iter->second.expires;
+                    }
                 }
             } // if (json.HasParseError())
         } // if (errorCode != SDK_NO_ERROR)
@@ -2050,18 +2219,83 @@ bool DeviceAuthority::getIDCToken(std::string &token)
     {
         Log::getInstance()->printf(Log::Error, " %s Device failed to authenticate in getIDC()", __func__);
     }
-    
-    mutex_unlock();
 
     return retVal;
 }
 
+void DeviceAuthority::invalidateSession()
+{
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    m_sessions.clear();
+    m_idc_token.clear();
+}
+
+bool DeviceAuthority::findSession(const std::string& session_key, std::string& key_id, std::string& key, std::string& iv, std::string& body)
+{
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    const std::map<std::string, AuthSession>::iterator session_iter = m_sessions.find(session_key);
+    if (session_iter == m_sessions.end())
+    {
+        return false;
+    }
+    if (session_iter->second.expires <= std::chrono::steady_clock::now())
+    {
+        m_sessions.erase(session_iter);
+        return false;
+    }
+
+    key_id = session_iter->second.key_id;
+    key = session_iter->second.key;
+    iv = session_iter->second.iv;
+    body = session_iter->second.body;
+    return true;
+}
+
+void DeviceAuthority::keepSession(const std::string& session_key, int lifetime_s, const std::string& key_id, const std::string& key, const std::string& iv, const std::string& body)
+{
+    static const Configuration::Key maxLifetimeKey = config.key(CFG_AUTH_SESSION_MAX_S);
+    const long max_lifetime_s = config.lookupAsLong(maxLifetimeKey);
+    if (lifetime_s <= 0 || max_lifetime_s <= 0)
+    {
+        return;
+    }
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    for (std::map<std::string, AuthSession>::iterator session_iter = m_sessions.begin(); session_iter != m_sessions.end();)
+    {
+        if (session_iter->second.expires <= now)
+        {
+            session_iter = m_sessions.erase(session_iter);
+        }
+        else
+        {
+            ++session_iter;
+        }
+    }
+
+    AuthSession &session = m_sessions[session_key];
+    session.key_id = key_id;
+    session.key = key;
+    session.iv = iv;
+    session.body = body;
+    session.expires = now + std::chrono::seconds(std::min((long)lifetime_s, max_lifetime_s));
+}
+
 std::string DeviceAuthority::doCipherAES(const std::string &key, const std::string &iv, const std::string &input, CipherMode mode)
 {
     std::string output;
-    if (pfnaudaddk_docipher_aes_cfb128)
+    if (evp_crypto::isBulkCipher(input.size(), key.size(), iv.size()))
+    {
+        if (!evp_crypto::cipherAES(key.c_str(), key.size(), iv.c_str(), iv.size(), input.c_str(), input.size(), mode, output))
+        {
+            Log::getInstance()->printf(Log::Error, " %s Failed to doCipherAES on %lu bytes", __func__, (unsigned long)input.size());
+        }
+    }
+    else if (pfnaudaddk_docipher_aes_cfb128)
     {
         unsigned char* result = 0;
+        ddkg_lock();
         int res = pfnaudaddk_docipher_aes_cfb128(key.c_str(), key.size(), iv.c_str(), iv.size(), (const unsigned char*)input.c_str(), input.size(), &result, mode);
         if (res >= 0)
         {
@@ -2072,15 +2306,38 @@ std::string DeviceAuthority::doCipherAES(const std::string &key, const std::stri
         {
             Log::getInstance()->printf(Log::Error, " %s Failed to doCipherAES error:%d", __func__, res);
         }
+        ddkg_unlock();
     }
     return output;
 }
 
 int DeviceAuthority::doCipherAES(const char* key, const int key_sz, const char* iv, const int iv_sz, const char* input, const int input_sz, CipherMode mode, char** output) {
 
+    if (input_sz >= 0 && key_sz >= 0 && iv_sz >= 0 && evp_crypto::isBulkCipher((size_t)input_sz, (size_t)key_sz, (size_t)iv_sz))
+    {
+        evp_crypto::AesCfbCipher cipher;
+        if (!cipher.init(key, key_sz, iv, iv_sz, mode))
+        {
+            return -1;
+        }
+        unsigned char *result = new unsigned char[input_sz + 2 * evp_crypto::AES_BLOCK_BYTES + 1];
+        const long updated = cipher.update((const unsigned char *)input, input_sz, result);
+        const long finished = updated < 0 ? -1 : cipher.final(result + updated);
+        if (finished < 0)
+        {
+            Log::getInstance()->printf(Log::Error, " %s Failed to doCipherAES on %d bytes", __func__, input_sz);
+            delete[] result;
+            return -1;
+        }
+        result[updated + finished] = '\0';
+        *output = (char *)result;
+        return (int)(updated + finished);
+    }
+
     if (pfnaudaddk_docipher_aes_cfb128)
     {
         unsigned char* result = 0;
+        ddkg_lock();
         int res = pfnaudaddk_docipher_aes_cfb128(key, key_sz, iv, iv_sz, (const unsigned char*)input, input_sz, &result, mode);
         if (res >= 0)
         {
@@ -2094,6 +2351,7 @@ int DeviceAuthority::doCipherAES(const char* key, const int key_sz, const char*
         {
             Log::getInstance()->printf(Log::Error, " %s Failed to doCipherAES error:%d", __func__, res);
         }
+        ddkg_unlock();
         return res;
     }
     return -1;
@@ -2102,9 +2360,18 @@ int DeviceAuthority::doCipherAES(const char* key, const int key_sz, const char*
 std::string DeviceAuthority::doDigestSHA256(const std::string &input)
 {
     std::string output;
-    if ( pfnaudaddk_dodigest_sha256)
+    if (evp_crypto::isBulkPayload(input.size()))
+    {
+        output = evp_crypto::digestSHA256(input.c_str(), input.size());
+        if (output.empty())
+        {
+            Log::getInstance()->printf(Log::Error, " %s Failed to doDigestSHA256 on %lu bytes", __func__, (unsigned long)input.size());
+        }
+    }
+    else if ( pfnaudaddk_dodigest_sha256)
     {
         unsigned char* result = 0;
+        ddkg_lock();
         int res = pfnaudaddk_dodigest_sha256(input.c_str(), input.size(), &result);
         if (res >= 0)
         {
@@ -2115,6 +2382,7 @@ std::string DeviceAuthority::doDigestSHA256(const std::string &input)
         {
             Log::getInstance()->printf(Log::Error, " %s Failed to doDigestSHA256 error:%d", __func__, res);
         }
+        ddkg_unlock();
     }
     return output;
 }
@@ -2127,16 +2395,7 @@ std::string DeviceAuthority::identifyAndAuthoriseForEdge(const std::string& devi
 {
     Log *logger = Log::getInstance();
 
-#if defined(ENABLE_VERBOSE_LOG)
-    logger->printf(Log::Debug, "*****identifyAndAuthoriseForEdge(lock wait) called");
-#endif // #if defined(ENABLE_VERBOSE_LOG)
-
-    mutex_lock();
-
-#if defined(ENABLE_VERBOSE_LOG)
-    logger->printf(Log::Debug, "*****identifyAndAuthoriseForEdge(lock acquired) called");
-#endif // #if defined(ENABLE_VERBOSE_LOG)
-
+    const unsigned int registrations = m_registrations;
     std::string result;
     bool registered = true; // Assume true for now
     int status_code = 0;
@@ -2155,13 +2414,7 @@ std::string DeviceAuthority::identifyAndAuthoriseForEdge(const std::string& devi
         else
         {
             // Need to register first
-            logger->printf(Log::Information, "Device registration required");
-            if (mp_event_manager) 
-            {
-                mp_event_manager->notifyRegistrationRequired();
-            }
-
-            registered = registration(challenge, message, metadata);
+            registered = registerOnce(registrations, challenge, message, metadata);
             if (registered)
             {
                 if (!message.empty())
@@ -2172,8 +2425,6 @@ std::string DeviceAuthority::identifyAndAuthoriseForEdge(const std::string& devi
             }
         }
     }
-    
-    mutex_unlock();
 
 #if defined(ENABLE_VERBOSE_LOG)
     logger->printf(Log::Debug, "*****identifyAndAuthorise(lock released) called size:%d error:%s", result.size(), message.c_str());
@@ -2219,6 +2470,9 @@ std::string DeviceAuthority::getDeviceKeyForEdge(const std::string& edgeDeviceMe
     int result = kDDKStatusError;
     char *deviceKeyJSON = NULL;
 
+    // The DDKG is locked from generating the key until it is freed
+    ddkg_lock();
+
     if (!challengeID.empty())
     {
         //Log::getInstance()->printf(Log::Debug, " %s:%d", __func__, __LINE__);
@@ -2378,9 +2632,12 @@ std::string DeviceAuthority::getDeviceKeyForEdge(const std::string& edgeDeviceMe
         {
             result = pfnaudaddk_freedevicekey(&deviceKeyJSON);
         }
+        ddkg_unlock();
     } //if (result == kDDKStatusSuccess)
     else
     {
+        ddkg_unlock();
+
         ostringstream oss;
 
         Log::getInstance()->printf(Log::Information, " %s:%d Failed to generate device key: %d", __func__, __LINE__, result);
@@ -2426,10 +2683,11 @@ std::string DeviceAuthority::authorisationChallengeForEdge(const std::string& de
         std::string bodytext = "{\"userAgent\":\"" + m_user_agent + "\","
                                 "\"challengeType\":\"" + CHTYPEAUTH_TEXT + "\","
                                 "\"ddkgVersion\":\"" + m_version + "\",";
-        if (!m_user.empty())
+        const std::string user = getUserId();
+        if (!user.empty())
         {
             // Add userId to json string
-            bodytext += "\"userId\":\"" + m_user + "\",";
+            bodytext += "\"userId\":\"" + user + "\",";
         }
         if (!policyID.empty())
         {
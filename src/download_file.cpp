@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Destination file for downloads, hashing the content as it is received
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "download_file.hpp"
+
+DownloadFile::DownloadFile(const std::string &path)
+    : m_path(path), mp_file(nullptr), mp_digest_ctx(EVP_MD_CTX_create()), m_buffer(BUFFER_SIZE), mp_digested(nullptr),
+      m_written(0), m_write_failed(false), m_stream(this)
+{
+    if (!mp_digest_ctx)
+    {
+        throw std::runtime_error("Unable to create digest context for:" + m_path);
+    }
+    openFile();
+    resetDigest();
+}
+
+DownloadFile::~DownloadFile()
+{
+    if (mp_file)
+    {
+        fclose(mp_file);
+    }
+    EVP_MD_CTX_destroy(mp_digest_ctx);
+}
+
+std::ostream &DownloadFile::stream()
+{
+    return m_stream;
+}
+
+uint64_t DownloadFile::size() const
+{
+    return m_written + (uint64_t)(pptr() - pbase());
+}
+
+bool DownloadFile::commit()
+{
+    const bool written = sync() == 0;
+    m_stream.clear();
+    return written;
+}
+
+void DownloadFile::restart()
+{
+    if (mp_file)
+    {
+        fclose(mp_file);
+        mp_file = nullptr;
+    }
+    openFile();
+    resetDigest();
+    m_written = 0;
+    m_write_failed = false;
+    m_stream.clear();
+}
+
+const std::string DownloadFile::finish()
+{
+    if (!commit())
+    {
+        throw std::runtime_error("Unable to write response file:" + m_path);
+    }
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    EVP_DigestFinal_ex(mp_digest_ctx, digest, &digest_size);
+
+    const bool closed = fclose(mp_file) == 0;
+    mp_file = nullptr;
+    if (!closed)
+    {
+        throw std::runtime_error("Unable to write response file:" + m_path);
+    }
+
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0');
+    for (unsigned int i = 0; i < digest_size; ++i)
+    {
+        oss << std::setw(2) << (unsigned int)digest[i];
+    }
+    return oss.str();
+}
+
+DownloadFile::int_type DownloadFile::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        return traits_type::not_eof(ch);
+    }
+    if (!writeBuffer())
+    {
+        return traits_type::eof();
+    }
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize DownloadFile::xsputn(const char *p_data, std::streamsize size)
+{
+    if (m_write_failed)
+    {
+        return 0;
+    }
+
+    if (size > epptr() - pptr() && !writeBuffer())
+    {
+        return 0;
+    }
+    if (size <= epptr() - pptr())
+    {
+        memcpy(pptr(), p_data, (size_t)size);
+        pbump((int)size);
+        // Hashed while the block is still in cache, rather than when the buffer is written out
+        digestBuffered();
+    }
+    else if (fwrite(p_data, 1, (size_t)size, mp_file) == (size_t)size)
+    {
+        // Blocks larger than the buffer are written straight through
+        EVP_DigestUpdate(mp_digest_ctx, p_data, (size_t)size);
+        m_written += size;
+    }
+    else
+    {
+        m_write_failed = true;
+        return 0;
+    }
+    return size;
+}
+
+int DownloadFile::sync()
+{
+    return writeBuffer() && fflush(mp_file) == 0 ? 0 : -1;
+}
+
+void DownloadFile::openFile()
+{
+    mp_file = fopen(m_path.c_str(), "wb");
+    if (!mp_file)
+    {
+        throw std::runtime_error("Unable to open response file:" + m_path);
+    }
+    // Writes are already buffered in blocks of BUFFER_SIZE
+    setvbuf(mp_file, nullptr, _IONBF, 0);
+    resetBuffer();
+}
+
+void DownloadFile::resetDigest()
+{
+    if (1 != EVP_DigestInit_ex(mp_digest_ctx, EVP_sha256(), nullptr))
+    {
+        throw std::runtime_error("Unable to initialise digest for:" + m_path);
+    }
+}
+
+void DownloadFile::resetBuffer()
+{
+    setp(&m_buffer[0], &m_buffer[0] + m_buffer.size());
+    mp_digested = pbase();
+}
+
+void DownloadFile::digestBuffered()
+{
+    if (pptr() > mp_digested)
+    {
+        EVP_DigestUpdate(mp_digest_ctx, mp_digested, (size_t)(pptr() - mp_digested));
+        mp_digested = pptr();
+    }
+}
+
+bool DownloadFile::writeBuffer()
+{
+    if (m_write_failed || !mp_file)
+    {
+        return false;
+    }
+
+    digestBuffered();
+    const size_t pending = (size_t)(pptr() - pbase());
+    if (pending > 0 && fwrite(pbase(), 1, pending, mp_file) != pending)
+    {
+        m_write_failed = true;
+        return false;
+    }
+    m_written += pending;
+    resetBuffer();
+    return true;
+}
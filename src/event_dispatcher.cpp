@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Bounded queue and thread delivering event notifications to one event library
+ */
+
+#include <cstring>
+#include "event_dispatcher.hpp"
+#include "log.hpp"
+
+EventDispatcher::EventDispatcher(const std::string &name, const Deliver &deliver, size_t capacity)
+    : m_name(name), m_deliver(deliver), m_capacity(capacity > 0 ? capacity : 1), m_stopping(false), m_dropping(false)
+{
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_thread = std::thread(&EventDispatcher::run, this);
+}
+
+EventDispatcher::~EventDispatcher()
+{
+    stop();
+}
+
+bool EventDispatcher::post(const char *event_type, const char *notification_type, const char *p_context, size_t context_size)
+{
+    const Clock::time_point posted = Clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stopping)
+    {
+        m_statistics.dropped++;
+        return false;
+    }
+
+    const bool coalescable = isCoalescable(event_type);
+    if (coalescable)
+    {
+        for (auto iter = m_queue.begin(); iter != m_queue.end(); ++iter)
+        {
+            if (strcmp(iter->event_type, event_type) == 0 && strcmp(iter->notification_type, notification_type) == 0)
+            {
+                // Keep the time of the first so that the latency covers the whole wait
+                iter->context.assign(p_context, context_size);
+                m_statistics.coalesced++;
+                return true;
+            }
+        }
+    }
+
+    if (m_queue.size() >= m_capacity && (coalescable || !evictCoalescable()))
+    {
+        m_statistics.dropped++;
+        if (!m_dropping)
+        {
+            m_dropping = true;
+            Log::getInstance()->printf(Log::Warning, " %s Event queue of %s is full, dropping %s %s", __func__,
+                                       m_name.c_str(), event_type, notification_type);
+        }
+        return false;
+    }
+
+    m_dropping = false;
+    // The dispatch thread only waits on an empty queue
+    const bool wake = m_queue.empty();
+    m_queue.push_back(Event());
+    Event &event = m_queue.back();
+    event.event_type = event_type;
+    event.notification_type = notification_type;
+    event.context.assign(p_context, context_size);
+    event.posted = posted;
+    m_statistics.queued++;
+    lock.unlock();
+    if (wake)
+    {
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+void EventDispatcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+EventDispatcher::Statistics EventDispatcher::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+const std::string &EventDispatcher::name() const
+{
+    return m_name;
+}
+
+bool EventDispatcher::isCoalescable(const char *event_type)
+{
+    return strcmp(event_type, "Heartbeat") == 0;
+}
+
+bool EventDispatcher::evictCoalescable()
+{
+    for (auto iter = m_queue.begin(); iter != m_queue.end(); ++iter)
+    {
+        if (isCoalescable(iter->event_type))
+        {
+            m_queue.erase(iter);
+            m_statistics.dropped++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventDispatcher::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty())
+        {
+            // Only stopping once the queue has been delivered
+            return;
+        }
+
+        Event event = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        // The library is called without the lock so that events can be posted meanwhile
+        lock.unlock();
+        const bool accepted = m_deliver(event.event_type, event.notification_type, event.context);
+        const uint64_t latency_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - event.posted).count();
+        if (!accepted)
+        {
+            Log::getInstance()->printf(Log::Warning, " %s Event library %s failed to accept %s %s", __func__,
+                                       m_name.c_str(), event.event_type, event.notification_type);
+        }
+        lock.lock();
+
+        m_statistics.delivered++;
+        if (!accepted)
+        {
+            m_statistics.failed++;
+        }
+        m_statistics.total_latency_us += latency_us;
+        if (latency_us > m_statistics.max_latency_us)
+        {
+            m_statistics.max_latency_us = latency_us;
+        }
+    }
+}
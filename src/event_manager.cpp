@@ -9,19 +9,127 @@
 
 #include <cstring>
 #include <sstream>
-#include "rapidjson/document.h"
-#include "rapidjson/rapidjson.h"
-#include "rapidjson/stringbuffer.h"
-#include "rapidjson/writer.h"
+#include "configuration.hpp"
+#include "constants.hpp"
 #include "event_manager.hpp"
 #include "log.hpp"
 
+namespace
+{
+    const std::string JSON_TRUE = "true";
+    const std::string JSON_FALSE = "false";
+
+    /// @brief Writes the context of a notification as a JSON object of string attributes. The object is
+    /// built in a buffer on the stack, and only moves to the heap if it is unusually long.
+    class ContextWriter
+    {
+    public:
+        ContextWriter() : m_size(0), m_spilled(false)
+        {
+            put('{');
+        }
+
+        void add(const char *key, const std::string &value)
+        {
+            if (m_size > 1 || m_spilled)
+            {
+                put(',');
+            }
+            putString(key, strlen(key));
+            put(':');
+            putString(value.c_str(), value.size());
+        }
+
+        /// @brief Complete the object
+        void close()
+        {
+            put('}');
+        }
+
+        const char *data() const
+        {
+            return m_spilled ? m_spill.c_str() : m_buffer;
+        }
+
+        size_t size() const
+        {
+            return m_spilled ? m_spill.size() : m_size;
+        }
+
+    private:
+        static const size_t BUFFER_SIZE = 512;
+
+        char m_buffer[BUFFER_SIZE];
+        size_t m_size;
+        bool m_spilled;
+        std::string m_spill;
+
+        void put(char c)
+        {
+            if (m_spilled)
+            {
+                m_spill.push_back(c);
+            }
+            else if (m_size < BUFFER_SIZE)
+            {
+                m_buffer[m_size++] = c;
+            }
+            else
+            {
+                m_spill.reserve(2 * BUFFER_SIZE);
+                m_spill.assign(m_buffer, m_size);
+                m_spill.push_back(c);
+                m_spilled = true;
+            }
+        }
+
+        /// @brief Write a quoted string, escaped the same way as the rapidjson writer
+        void putString(const char *p_str, size_t size)
+        {
+            static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+            put('"');
+            for (size_t i = 0; i < size; ++i)
+            {
+                const unsigned char c = (unsigned char)p_str[i];
+                switch (c)
+                {
+                case '"': put('\\'); put('"'); break;
+                case '\\': put('\\'); put('\\'); break;
+                case '\b': put('\\'); put('b'); break;
+                case '\f': put('\\'); put('f'); break;
+                case '\n': put('\\'); put('n'); break;
+                case '\r': put('\\'); put('r'); break;
+                case '\t': put('\\'); put('t'); break;
+                default:
+                    if (c < 0x20)
+                    {
+                        put('\\');
+                        put('u');
+                        put('0');
+                        put('0');
+                        put(HEX_DIGITS[c >> 4]);
+                        put(HEX_DIGITS[c & 0xf]);
+                    }
+                    else
+                    {
+                        put((char)c);
+                    }
+                    break;
+                }
+            }
+            put('"');
+        }
+    };
+} // namespace
+
 EventManagerBase* EventManager::mp_instance = nullptr;
 
 bool EventManager::initialise(const std::string &event_library_names)
 {
     std::string event_library_name;
     std::istringstream iss(event_library_names);
+    const long queue_size = config.lookupAsLong(CFG_EVENT_QUEUE_SIZE);
 
     while (std::getline(iss, event_library_name, ','))
     {
@@ -43,6 +151,7 @@ bool EventManager::initialise(const std::string &event_library_names)
         }
         std::unique_ptr<EventLib> event_lib(new EventLib(event_library_name));
         event_lib->initialise();
+        EventLib *p_event_lib = event_lib.get();
 
 #if defined(USETHREADING)
         pthread_mutex_lock(&m_event_libs_mutex);
@@ -51,6 +160,15 @@ bool EventManager::initialise(const std::string &event_library_names)
 #if defined(USETHREADING)
         pthread_mutex_unlock(&m_event_libs_mutex);
 #endif // #if defined(USETHREADING)
+
+        // The library is called from the dispatch thread only, so that a slow one never holds up the agent
+        addDispatcher(
+            event_library_name,
+            [p_event_lib](const char *event_type, const char *notification_type, const std::string &context)
+            {
+                return p_event_lib->notify(event_type, notification_type, context);
+            },
+            queue_size > 0 ? (size_t)queue_size : 1);
     }
 
     return !m_event_libs.empty();
@@ -61,7 +179,29 @@ void EventManager::teardown()
 #if defined(USETHREADING)
     pthread_mutex_lock(&m_event_libs_mutex);
 #endif // #if defined(USETHREADING)
-	
+
+    m_has_dispatchers = false;
+
+    // Deliver the notifications still queued, such as the shutdown, before the libraries are shut down
+    for (auto dispatcher_iter = m_dispatchers.begin(); dispatcher_iter != m_dispatchers.end(); dispatcher_iter++)
+    {
+        EventDispatcher &dispatcher = *dispatcher_iter->second;
+        dispatcher.stop();
+        const EventDispatcher::Statistics stats = dispatcher.statistics();
+        Log::getInstance()->printf(
+            Log::Information,
+            "Event library %s: %llu queued, %llu delivered, %llu failed, %llu dropped, %llu coalesced, latency mean %llu us max %llu us",
+            dispatcher.name().c_str(),
+            (unsigned long long)stats.queued,
+            (unsigned long long)stats.delivered,
+            (unsigned long long)stats.failed,
+            (unsigned long long)stats.dropped,
+            (unsigned long long)stats.coalesced,
+            (unsigned long long)(stats.delivered > 0 ? stats.total_latency_us / stats.delivered : 0),
+            (unsigned long long)stats.max_latency_us);
+    }
+    m_dispatchers.clear();
+
     for (auto event_lib_iter = m_event_libs.begin(); event_lib_iter != m_event_libs.end(); event_lib_iter++)
     {
         event_lib_iter->second->teardown();
@@ -76,12 +216,12 @@ void EventManager::teardown()
 
 bool EventManager::notifyStartup(const std::string &udi)
 {
-    return notify("Startup", "Info", createJsonString("udi", udi));
+    return notify("Startup", "Info", {{"udi", udi}});
 }
 
 bool EventManager::notifyShutdown(const std::string &udi)
 {
-    return notify("Shutdown", "Info", createJsonString("udi", udi));
+    return notify("Shutdown", "Info", {{"udi", udi}});
 }
 
 bool EventManager::notifyHeartbeat()
@@ -101,7 +241,7 @@ bool EventManager::notifyRegistrationInProgress()
 
 bool EventManager::notifyRegistrationFailure(const std::string &error)
 {
-    return notify("Registration", "Failure", createJsonString("error", error));
+    return notify("Registration", "Failure", {{"error", error}});
 }
 
 bool EventManager::notifyRegistrationSuccess()
@@ -116,7 +256,7 @@ bool EventManager::notifyAuthorizationInProgress()
 
 bool EventManager::notifyAuthorizationFailure(const std::string &error)
 {
-    return notify("Authorization", "Failure", createJsonString("error", error));
+    return notify("Authorization", "Failure", {{"error", error}});
 }
 
 bool EventManager::notifyAuthorizationSuccess()
@@ -131,12 +271,12 @@ bool EventManager::notifyCertificateReceived()
 
 bool EventManager::notifyCertificateStored(const std::string &subject_name, const std::string &location, const std::string &provider_name, bool encrypted)
 {
-    return notify("Certificate", "Stored", createJsonString("subject_name", subject_name, "location", location, "provider", provider_name, "encrypted", encrypted ? "true" : "false"));
+    return notify("Certificate", "Stored", {{"subject_name", subject_name}, {"location", location}, {"provider", provider_name}, {"encrypted", encrypted ? JSON_TRUE : JSON_FALSE}});
 }
 
 bool EventManager::notifyCertificateFailure(const std::string &error)
 {
-    return notify("Certificate", "Failure", createJsonString("error", error));
+    return notify("Certificate", "Failure", {{"error", error}});
 }
 
 bool EventManager::notifyCertificateDataReceived()
@@ -156,12 +296,12 @@ bool EventManager::notifyPrivateKeyReceived()
 
 bool EventManager::notifyPrivateKeyStored(const std::string &key_id, const std::string &location, const std::string &provider_name, bool encrypted)
 {
-    return notify("PrivateKey", "Stored", createJsonString("key_id", key_id, "location", location, "provider", provider_name, "encrypted", encrypted ? "true" : "false"));
+    return notify("PrivateKey", "Stored", {{"key_id", key_id}, {"location", location}, {"provider", provider_name}, {"encrypted", encrypted ? JSON_TRUE : JSON_FALSE}});
 }
 
 bool EventManager::notifyPrivateKeyFailure(const std::string &error)
 {
-    return notify("PrivateKey", "Failure", createJsonString("error", error));
+    return notify("PrivateKey", "Failure", {{"error", error}});
 }
 
 bool EventManager::notifyCSRCreated()
@@ -176,22 +316,22 @@ bool EventManager::notifyCSRDelivered()
 
 bool EventManager::notifyCSRFailure(const std::string &error)
 {
-    return notify("CertificateSigningRequest", "Failure", createJsonString("error", error));
+    return notify("CertificateSigningRequest", "Failure", {{"error", error}});
 }
 
 bool EventManager::notifyAPMReceived(const std::string &username)
 {
-    return notify("APM", "Received", createJsonString("username", username));
+    return notify("APM", "Received", {{"username", username}});
 }
 
 bool EventManager::notifyAPMSuccess(const std::string &username)
 {
-    return notify("APM", "Success", createJsonString("username", username));
+    return notify("APM", "Success", {{"username", username}});
 }
 
 bool EventManager::notifyAPMFailure(const std::string &error)
 {
-    return notify("APM", "Failure", createJsonString("error", error));
+    return notify("APM", "Failure", {{"error", error}});
 }
 
 bool EventManager::notifySATReceived()
@@ -206,7 +346,7 @@ bool EventManager::notifySATSuccess()
 
 bool EventManager::notifySATFailure(const std::string &error)
 {
-    return notify("SecureAssetTransfer", "Failure", createJsonString("error", error));
+    return notify("SecureAssetTransfer", "Failure", {{"error", error}});
 }
 
 bool EventManager::notifyGroupMetadataReceived()
@@ -221,11 +361,11 @@ bool EventManager::notifyGroupMetadataSuccess()
 
 bool EventManager::notifyGroupMetadataFailure(const std::string &error)
 {
-    return notify("GroupMetadata", "Failure", createJsonString("error", error));
+    return notify("GroupMetadata", "Failure", {{"error", error}});
 }
 
 EventManager::EventManager()
-    : m_event_libs()
+    : m_event_libs(), m_dispatchers(), m_has_dispatchers(false)
 {
     #if defined(USETHREADING)
     m_event_libs_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -238,6 +378,8 @@ EventManager::~EventManager()
     pthread_mutex_lock(&m_event_libs_mutex);
 #endif // #if defined(USETHREADING)
 
+    // The dispatch threads call into the libraries, so they are stopped first
+    m_dispatchers.clear();
     m_event_libs.clear();
 
 #if defined(USETHREADING)
@@ -245,68 +387,52 @@ EventManager::~EventManager()
 #endif // #if defined(USETHREADING)
 }
 
-bool EventManager::notify(const std::string &event_type, const std::string &notification_type, const std::string &context)
+void EventManager::addDispatcher(const std::string &event_library_name, const EventDispatcher::Deliver &deliver, size_t queue_size)
 {
-    bool success = true;
-    
+    std::unique_ptr<EventDispatcher> dispatcher(new EventDispatcher(event_library_name, deliver, queue_size));
+
 #if defined(USETHREADING)
     pthread_mutex_lock(&m_event_libs_mutex);
 #endif // #if defined(USETHREADING)
-	
-    for (auto event_lib_iter = m_event_libs.begin(); event_lib_iter != m_event_libs.end(); event_lib_iter++)
-    {
-        success &= event_lib_iter->second->notify(event_type, notification_type, context);
-    }
-
+    m_dispatchers.emplace(std::pair<std::string, std::unique_ptr<EventDispatcher>>(event_library_name, std::move(dispatcher)));
+    m_has_dispatchers = true;
 #if defined(USETHREADING)
     pthread_mutex_unlock(&m_event_libs_mutex);
 #endif // #if defined(USETHREADING)
-
-    return success;
 }
 
-const std::string EventManager::createJsonString(
-    const std::string &key1, 
-    const std::string &value1, 
-    const std::string &key2, 
-    const std::string &value2,
-    const std::string &key3,
-    const std::string &value3,
-    const std::string &key4,
-    const std::string &value4)
+bool EventManager::notify(const char *event_type, const char *notification_type, std::initializer_list<Attribute> attributes)
 {
-    rapidjson::Document root_document;
-    root_document.SetObject();
-    rapidjson::Document::AllocatorType& allocator = root_document.GetAllocator();
-
-    if (!key1.empty() && !value1.empty())
-    {
-        root_document.AddMember(
-            rapidjson::StringRef(key1.c_str()), 
-            rapidjson::Value(value1.c_str(), allocator).Move(), allocator);
-    }
-    if (!key2.empty() && !value2.empty())
+    // Nothing is built when there is no library to notify
+    if (!m_has_dispatchers)
     {
-        root_document.AddMember(
-            rapidjson::StringRef(key2.c_str()), 
-            rapidjson::Value(value2.c_str(), allocator).Move(), allocator);
+        return true;
     }
-    if (!key3.empty() && !value3.empty())
+
+    ContextWriter context;
+    for (const Attribute &attribute : attributes)
     {
-        root_document.AddMember(
-            rapidjson::StringRef(key3.c_str()),
-            rapidjson::Value(value3.c_str(), allocator).Move(), allocator);
+        if (!attribute.value.empty())
+        {
+            context.add(attribute.key, attribute.value);
+        }
     }
-    if (!key4.empty() && !value4.empty())
+    context.close();
+
+    bool success = true;
+
+#if defined(USETHREADING)
+    pthread_mutex_lock(&m_event_libs_mutex);
+#endif // #if defined(USETHREADING)
+
+    for (auto dispatcher_iter = m_dispatchers.begin(); dispatcher_iter != m_dispatchers.end(); dispatcher_iter++)
     {
-        root_document.AddMember(
-            rapidjson::StringRef(key4.c_str()),
-            rapidjson::Value(value4.c_str(), allocator).Move(), allocator);
+        success &= dispatcher_iter->second->post(event_type, notification_type, context.data(), context.size());
     }
 
-    rapidjson::StringBuffer strbuf;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
-    root_document.Accept(writer);
+#if defined(USETHREADING)
+    pthread_mutex_unlock(&m_event_libs_mutex);
+#endif // #if defined(USETHREADING)
 
-    return std::string(strbuf.GetString());
+    return success;
 }
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Streaming AES and SHA-256 through the OpenSSL EVP interface, for bulk payloads
+ */
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "evp_crypto.hpp"
+#include "configuration.hpp"
+#include "constants.hpp"
+#include "log.hpp"
+
+namespace evp_crypto
+{
+
+namespace
+{
+    /// @brief The largest block passed to EVP in one call, as it takes int sizes
+    const size_t MAX_EVP_BLOCK = 1024 * 1024 * 1024;
+
+    /// @brief The size of the blocks read from a file being digested
+    const size_t FILE_BLOCK_SIZE = 64 * 1024;
+
+    bool cipherBlocks(EVP_CIPHER_CTX *p_ctx, const unsigned char *p_in, size_t size, unsigned char *p_out)
+    {
+        while (size > 0)
+        {
+            const int block = (int)(size < MAX_EVP_BLOCK ? size : MAX_EVP_BLOCK);
+            int out_len = 0;
+            if (1 != EVP_CipherUpdate(p_ctx, p_out, &out_len, p_in, block) || out_len != block)
+            {
+                return false;
+            }
+            p_in += block;
+            p_out += block;
+            size -= block;
+        }
+        return true;
+    }
+} // namespace
+
+bool isBulkPayload(size_t size)
+{
+    static const Configuration::Key minBytesKey = config.key(CFG_BULK_CRYPTO_MIN_BYTES);
+    const long min_bytes = config.lookupAsLong(minBytesKey);
+    return min_bytes > 0 && size >= (size_t)min_bytes;
+}
+
+bool isBulkCipher(size_t size, size_t key_size, size_t iv_size)
+{
+    return key_size == AES_KEY_BYTES && iv_size == AES_BLOCK_BYTES && isBulkPayload(size);
+}
+
+AesCfbCipher::AesCfbCipher()
+    : mp_ctx(EVP_CIPHER_CTX_new()), m_mode(CipherModeDecrypt), m_processed(0), m_tail_size(0)
+{
+}
+
+AesCfbCipher::~AesCfbCipher()
+{
+    EVP_CIPHER_CTX_free(mp_ctx);
+}
+
+bool AesCfbCipher::init(const char *key, size_t key_size, const char *iv, size_t iv_size, CipherMode mode)
+{
+    if (!mp_ctx || key_size != AES_KEY_BYTES || iv_size != AES_BLOCK_BYTES)
+    {
+        Log::getInstance()->printf(Log::Error, " %s Invalid key size %lu or IV size %lu", __func__, (unsigned long)key_size, (unsigned long)iv_size);
+        return false;
+    }
+
+    m_mode = mode;
+    m_processed = 0;
+    m_tail_size = 0;
+    // A context that is reused keeps its cipher, so that only the key and IV are set up again
+    const EVP_CIPHER *p_cipher = EVP_CIPHER_CTX_cipher(mp_ctx) ? nullptr : EVP_aes_256_cfb128();
+    return 1 == EVP_CipherInit_ex(mp_ctx, p_cipher, nullptr, (const unsigned char *)key, (const unsigned char *)iv,
+                                  mode == CipherModeEncrypt ? 1 : 0);
+}
+
+long AesCfbCipher::update(const unsigned char *p_in, size_t size, unsigned char *p_out)
+{
+    m_processed += size;
+    if (m_mode == CipherModeEncrypt)
+    {
+        return cipherBlocks(mp_ctx, p_in, size, p_out) ? (long)size : -1;
+    }
+
+    // Put the plaintext held back by the previous block in front of this one, then hold back the new last block
+    memcpy(p_out, m_tail, m_tail_size);
+    if (!cipherBlocks(mp_ctx, p_in, size, p_out + m_tail_size))
+    {
+        return -1;
+    }
+    const size_t total = m_tail_size + size;
+    m_tail_size = total < AES_BLOCK_BYTES ? total : AES_BLOCK_BYTES;
+    memcpy(m_tail, p_out + total - m_tail_size, m_tail_size);
+    return (long)(total - m_tail_size);
+}
+
+long AesCfbCipher::final(unsigned char *p_out)
+{
+    if (m_mode == CipherModeEncrypt)
+    {
+        const size_t padding = AES_BLOCK_BYTES - m_processed % AES_BLOCK_BYTES;
+        unsigned char pad_block[AES_BLOCK_BYTES];
+        memset(pad_block, (int)padding, padding);
+        return cipherBlocks(mp_ctx, pad_block, padding, p_out) ? (long)padding : -1;
+    }
+
+    if (m_tail_size == 0)
+    {
+        return 0;
+    }
+    const size_t padding = m_tail[m_tail_size - 1];
+    if (padding == 0 || padding > m_tail_size)
+    {
+        return -1;
+    }
+    for (size_t i = m_tail_size - padding; i < m_tail_size; ++i)
+    {
+        if (m_tail[i] != padding)
+        {
+            return -1;
+        }
+    }
+    memcpy(p_out, m_tail, m_tail_size - padding);
+    return (long)(m_tail_size - padding);
+}
+
+Sha256Digest::Sha256Digest() : mp_ctx(EVP_MD_CTX_create())
+{
+}
+
+Sha256Digest::~Sha256Digest()
+{
+    EVP_MD_CTX_destroy(mp_ctx);
+}
+
+bool Sha256Digest::init()
+{
+    return mp_ctx && 1 == EVP_DigestInit_ex(mp_ctx, EVP_sha256(), nullptr);
+}
+
+bool Sha256Digest::update(const void *p_data, size_t size)
+{
+    return 1 == EVP_DigestUpdate(mp_ctx, p_data, size);
+}
+
+bool Sha256Digest::final(std::string &digest)
+{
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_size = 0;
+    if (1 != EVP_DigestFinal_ex(mp_ctx, md, &md_size))
+    {
+        return false;
+    }
+    digest.assign((const char *)md, md_size);
+    return true;
+}
+
+bool cipherAES(const char *key, size_t key_size, const char *iv, size_t iv_size, const char *p_input, size_t input_size, CipherMode mode, std::string &output)
+{
+    AesCfbCipher cipher;
+    if (!cipher.init(key, key_size, iv, iv_size, mode))
+    {
+        return false;
+    }
+
+    output.resize(input_size + 2 * AES_BLOCK_BYTES);
+    unsigned char *p_out = (unsigned char *)&output[0];
+    const long updated = cipher.update((const unsigned char *)p_input, input_size, p_out);
+    const long finished = updated < 0 ? -1 : cipher.final(p_out + updated);
+    if (finished < 0)
+    {
+        output.clear();
+        return false;
+    }
+    output.resize((size_t)(updated + finished));
+    return true;
+}
+
+const std::string digestSHA256(const char *p_data, size_t size)
+{
+    Sha256Digest sha256;
+    std::string digest;
+    if (!sha256.init() || !sha256.update(p_data, size) || !sha256.final(digest))
+    {
+        digest.clear();
+    }
+    return digest;
+}
+
+bool digestFileSHA256(const std::string &path, std::string &digest, size_t *p_size)
+{
+    std::ifstream ifs(path.c_str(), std::ifstream::binary);
+    if (!ifs.is_open())
+    {
+        return false;
+    }
+
+    Sha256Digest sha256;
+    if (!sha256.init())
+    {
+        return false;
+    }
+    std::vector<char> block(FILE_BLOCK_SIZE);
+    size_t size = 0;
+    while (ifs)
+    {
+        ifs.read(&block[0], block.size());
+        if (ifs.gcount() > 0)
+        {
+            sha256.update(&block[0], (size_t)ifs.gcount());
+            size += (size_t)ifs.gcount();
+        }
+    }
+    if (p_size)
+    {
+        *p_size = size;
+    }
+    return ifs.eof() && sha256.final(digest);
+}
+
+} // namespace evp_crypto
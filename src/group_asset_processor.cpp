@@ -1,6 +1,7 @@
 #include <sstream>
 #include <fstream>
 #include "asset_processor.hpp"
+#include "base64.hpp"
 #include "deviceauthority.hpp"
 #include "event_manager.hpp"
 #include "group_asset_processor.hpp"
@@ -54,18 +55,15 @@ bool GroupAssetProcessor::sendReceipt(bool is_success, std::string &failure_reas
 
 bool GroupAssetProcessor::writeMetadataToFile(const std::string &metadata_file, const std::string &metadata_b64)
 {
-    unsigned int cbDecodedMetadata = 0;
-    std::vector<unsigned char> decoded_metadata(metadata_b64.length(), 0);
-
-    cbDecodedMetadata = base64Decode(metadata_b64.c_str(), decoded_metadata.data(), metadata_b64.length());
-    if (cbDecodedMetadata == 0)
+    std::string decoded_metadata;
+    if (base64::decodeAppend(metadata_b64, decoded_metadata) != base64::OK || decoded_metadata.empty())
     {
         Log::getInstance()->printf(Log::Error, "Failed to decode metadata");
         return false;
     }
 
     std::ofstream outfile(metadata_file.c_str(), std::ios::binary | std::ios::out);
-    outfile.write((char*)decoded_metadata.data(), cbDecodedMetadata);
+    outfile.write(decoded_metadata.data(), decoded_metadata.size());
     outfile.close();
     if (!outfile)
     {
@@ -5,13 +5,31 @@
  * Asset messenger for HTTP mode
  */
 
+#include <algorithm>
+#include <chrono>
 #include <string>
-#include "base64.h"
+#include <thread>
+#include "base64.hpp"
+#include "configuration.hpp"
+#include "constants.hpp"
 #include "deviceauthority.hpp"
+#include "download_file.hpp"
 #include "http_asset_messenger.hpp"
 #include "message_factory.hpp"
 #include "utils.hpp"
 
+namespace
+{
+    /// @brief Interval at which the progress of a download of unknown size is logged
+    const uint64_t PROGRESS_LOG_INTERVAL = 16 * 1024 * 1024;
+
+    /// @brief Delay before the first retry of a failed download, doubled for each further retry
+    const long RETRY_INITIAL_DELAY_MS = 250;
+
+    /// @brief Longest delay between retries of a failed download
+    const long RETRY_MAX_DELAY_MS = 8000;
+}
+
 HttpAssetMessenger::HttpAssetMessenger(const std::string &dest_url, DAHttpClientBase *p_http_client)
     : m_dest_url(dest_url), mp_http_client(p_http_client)
 {
@@ -111,12 +129,7 @@ bool HttpAssetMessenger::submitCSRForSigning(const std::string &auth_json, const
 
     // Base64 encode the CSR
     std::string base64_encoded_csr;
-    unsigned int encoded_block_length = generated_csr.length() * 2u;
-    char *encoded_block = new char[encoded_block_length];
-    base64Encode((const unsigned char *)generated_csr.c_str(), generated_csr.length(), encoded_block, encoded_block_length);
-    base64_encoded_csr.assign(encoded_block);
-    delete[] encoded_block;
-    encoded_block = nullptr;
+    base64::encodeAppend(generated_csr, base64_encoded_csr);
 
     const std::string da_json = "{\"auth\":" + auth_json + ",\"certificateId\":\"" + certificate_id + "\",\"csr\":\"" + base64_encoded_csr + "\",\"hash\":\"base64\"}";
     p_logger->printf(Log::Debug, " %s Certificate signing JSON request: %s", __func__, da_json.c_str());
@@ -196,7 +209,7 @@ bool HttpAssetMessenger::submitCSRForSigning(const std::string &auth_json, const
     return result;
 }
 
-bool HttpAssetMessenger::fetchFile(const std::string &apiurl, const std::string &response_file_path)
+bool HttpAssetMessenger::fetchFile(const std::string &apiurl, const std::string &response_file_path, std::string &sha256)
 {
     if (!mp_http_client)
     {
@@ -205,24 +218,70 @@ bool HttpAssetMessenger::fetchFile(const std::string &apiurl, const std::string
 
     Log::getInstance()->printf(Log::Debug, "Opening file: %s\n", response_file_path.c_str());
 
-    std::ofstream ofs(response_file_path, std::ofstream::trunc);
-    if (!ofs.is_open())
-    {
-        throw std::runtime_error("Unable to open response file:" + response_file_path);
-    }
+    DownloadFile file(response_file_path);
 
     Log::getInstance()->printf(Log::Information, "Fetching file:%s to %s\n", apiurl.c_str(), response_file_path.c_str());
 
-    DAErrorCode rc_http_client = mp_http_client->sendRequest(DAHttp::ReqType::eGET, apiurl, &ofs);
-    if (rc_http_client != ERR_OK)
+    // Logged every 10% of the file, or every PROGRESS_LOG_INTERVAL bytes when the size is not known
+    uint64_t next_progress_log = 0;
+    const DAHttp::ProgressCallback progress = [&apiurl, &next_progress_log](uint64_t received, uint64_t total)
+    {
+        if (received == 0 || received < next_progress_log)
+        {
+            return;
+        }
+        if (total > 0)
+        {
+            Log::getInstance()->printf(Log::Information, "Fetching file:%s %llu of %llu bytes\n", apiurl.c_str(),
+                                       (unsigned long long)received, (unsigned long long)total);
+            next_progress_log = received + (total / 10 > 0 ? total / 10 : 1);
+        }
+        else
+        {
+            Log::getInstance()->printf(Log::Information, "Fetching file:%s %llu bytes\n", apiurl.c_str(), (unsigned long long)received);
+            next_progress_log = received + PROGRESS_LOG_INTERVAL;
+        }
+    };
+
+    static const Configuration::Key maxRetriesKey = config.key(CFG_DOWNLOAD_MAX_RETRIES);
+    const long max_retries = config.lookupAsLong(maxRetriesKey);
+    DAErrorCode rc_http_client = ERR_OK;
+    long retry_delay_ms = RETRY_INITIAL_DELAY_MS;
+    for (long attempt = 0; ; ++attempt)
     {
-        ofs.close();
+        rc_http_client = mp_http_client->download(apiurl, &file.stream(), file.size(), progress);
+        if (!file.commit())
+        {
+            throw std::runtime_error("Unable to write response file:" + response_file_path);
+        }
+        if (rc_http_client == ERR_OK || attempt >= max_retries)
+        {
+            break;
+        }
 
+        if (rc_http_client == ERR_RANGE)
+        {
+            Log::getInstance()->printf(Log::Warning, "Fetching file:%s can not be resumed, restarting\n", apiurl.c_str());
+            file.restart();
+            next_progress_log = 0;
+        }
+        Log::getInstance()->printf(Log::Warning, "Fetching file:%s failed code:%d, retrying from %llu bytes in %ld ms (%ld of %ld)\n",
+                                   apiurl.c_str(), rc_http_client, (unsigned long long)file.size(), retry_delay_ms, attempt + 1, max_retries);
+        // Back off so that a server or link that is struggling is not retried at once
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_delay_ms));
+        retry_delay_ms = std::min(retry_delay_ms * 2, RETRY_MAX_DELAY_MS);
+    }
+
+    if (rc_http_client != ERR_OK)
+    {
         std::ostringstream oss;
         oss << "Unable to fetch file:" << apiurl << " code:" << rc_http_client;
         throw std::runtime_error(oss.str());
     }
-    ofs.close();
+
+    sha256 = file.finish();
+    Log::getInstance()->printf(Log::Information, "Fetched file:%s %llu bytes sha256:%s\n", apiurl.c_str(),
+                               (unsigned long long)file.size(), sha256.c_str());
 
     return true;
 }
@@ -5,7 +5,7 @@
  */
 
 #include "apm_asset_processor.hpp"
-#include "base64.h"
+#include "base64.hpp"
 #include "certificate_asset_processor.hpp"
 #include "certificate_data_asset_processor.hpp"
 #include "dahttpclient.hpp"
@@ -15,6 +15,7 @@
 #include "heartbeat_manager.hpp"
 #include "http_asset_messenger.hpp"
 #include "http_worker_loop.hpp"
+#include "json_arena.hpp"
 #include "script_asset_processor.hpp"
 #include "steady_timer.hpp"
 #include "timehelper.h"
@@ -51,6 +52,9 @@ void *credentialManagerLoop(void *param)
     AssetManager asset_manager;
     HeartbeatManager heartbeat_manager(config.lookupAsLong(CFG_HEARTBEAT_INTERVAL_S));
 
+    // The /auth response of each iteration is parsed into the same memory
+    JsonArena json_arena;
+
     steady_timer loop_timer;
     bool stuff_to_do = true;
     int64_t loop_duration_ms = 0;
@@ -88,14 +92,12 @@ void *credentialManagerLoop(void *param)
                 p_logger->printf(Log::Error, " %s sendRequest to KS failed with error code: %d", __func__, rc_http_client);
             }
 
-            rapidjson::Document json;
-            if (!json_response.empty())
+            // The response is parsed in place, so it can no longer be logged whole once parsed
+            rapidjson::Document &json = json_arena.parse(json_response);
+            if (!json_response.empty() && json.HasParseError())
             {
-                json.Parse<0>(json_response.c_str());
-                if (json.HasParseError())
-                {
-                    p_logger->printf(Log::Error, " %s Bad JSON response from KS %s", __func__, json_response.c_str());
-                }
+                p_logger->printf(Log::Error, " %s Bad JSON response from KS: error %d at offset %lu", __func__,
+                                 (int)json.GetParseError(), (unsigned long)json.GetErrorOffset());
             }
 
             if (!json.IsNull() && json.HasMember("statusCode"))
@@ -114,6 +116,7 @@ void *credentialManagerLoop(void *param)
                             if (!auth)
                             {
                                 p_logger->printf(Log::Error, " %s Authentication failed.", __func__);
+                                p_da_instance->invalidateSession();
                                 EventManager::getInstance()->notifyAuthorizationFailure("");
                             }
                             else
@@ -135,7 +138,8 @@ void *credentialManagerLoop(void *param)
                     // Implicit authentication success as we can't get a 5105 response without successfully having authenticated
                     // This code indicates we have a pending authorization response and must retry again in interval defined
                     // in the configuration under RETRY_AUTHORIZATION_INTERVAL_S.
-                    const long authorization_retry_interval_s = config.lookupAsLong(CFG_RETRY_AUTHORIZATION_INTERVAL_S);
+                    static const Configuration::Key retryIntervalKey = config.key(CFG_RETRY_AUTHORIZATION_INTERVAL_S);
+                    const long authorization_retry_interval_s = config.lookupAsLong(retryIntervalKey);
                     p_logger->printf(
                         Log::Information, 
                         " %s Authentication successful. Authorization in progress...", 
@@ -151,6 +155,7 @@ void *credentialManagerLoop(void *param)
                 else
                 {
                     p_logger->printf(Log::Critical, " %s Non zero status code received: %d.", __func__, status_code);
+                    p_da_instance->invalidateSession();
                     if (json.HasMember("errorMessage"))
                     {
                         const rapidjson::Value& err_msg_val = json["errorMessage"];
@@ -227,23 +232,16 @@ void *credentialManagerLoop(void *param)
             }
         }
 
-        // Calculate if we need to change the polling time
-        unsigned int polling_time_s = 0;
-        if (asset_manager.isWaitingForCertificate())
-        {
-            polling_time_s = p_worker_loop->m_requested_data_poll_time_s;
-        }
-        else
+        // Calculate if we need to change the polling time, again if the configuration is reloaded while sleeping
+        auto pollingTime = [&]() -> unsigned int
         {
-            if (overwrite_sleep)
+            if (asset_manager.isWaitingForCertificate())
             {
-                polling_time_s = sleep_period_s;
+                return p_worker_loop->m_requested_data_poll_time_s;
             }
-            else
-            {
-                polling_time_s = p_worker_loop->m_sleep_period_s;
-            }
-        }
+            return overwrite_sleep ? sleep_period_s : p_worker_loop->m_sleep_period_s;
+        };
+        unsigned int polling_time_s = pollingTime();
 
         // Update pending assets and heartbeat monitor
         asset_manager.update();
@@ -251,7 +249,7 @@ void *credentialManagerLoop(void *param)
 
 		// Sleep for required period but keep checking for interrupt every second
         const int64_t interval_ms = steady_timer::MILLISECONDS_IN_ONE_SECOND;
-        const int64_t polling_time_ms = (int64_t)polling_time_s * steady_timer::MILLISECONDS_IN_ONE_SECOND;
+        int64_t polling_time_ms = (int64_t)polling_time_s * steady_timer::MILLISECONDS_IN_ONE_SECOND;
         loop_duration_ms += loop_timer.get_elapsed_time_in_millseconds();
         while ((loop_duration_ms < polling_time_ms) && !p_worker_loop->isInterrupted())
         {
@@ -259,9 +257,15 @@ void *credentialManagerLoop(void *param)
             sleep_ms(std::min<int64_t>(interval_ms, polling_time_ms - loop_duration_ms));
             asset_manager.update();
             heartbeat_manager.update();
+            if (p_worker_loop->reloadConfigurationIfRequested())
+            {
+                heartbeat_manager.setInterval(config.lookupAsLong(CFG_HEARTBEAT_INTERVAL_S));
+                polling_time_s = pollingTime();
+                polling_time_ms = (int64_t)polling_time_s * steady_timer::MILLISECONDS_IN_ONE_SECOND;
+            }
             loop_duration_ms += loop_timer.get_elapsed_time_in_millseconds();
         }
-        loop_duration_ms %= polling_time_ms; // Retain remaining milliseconds to ensure we can correct any overshot of polling interval in next loop
+        loop_duration_ms %= polling_time_ms > 0 ? polling_time_ms : 1; // Retain remaining milliseconds to ensure we can correct any overshot of polling interval in next loop
 		stuff_to_do = (!p_worker_loop->isInterrupted());
     }
 
@@ -280,6 +284,12 @@ HttpWorkerLoop::HttpWorkerLoop(const std::string &api_url, const std::string &me
 
 }
 
+void HttpWorkerLoop::applyConfiguration()
+{
+    BaseWorkerLoop::applyConfiguration();
+    m_requested_data_poll_time_s = config.lookupAsLong(CFG_POLL_TIME_FOR_REQUESTED_DATA);
+}
+
 void HttpWorkerLoop::initialize()
 {
     DAHttpClient::init();
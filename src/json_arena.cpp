@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Reusable memory for parsing the JSON responses from KeyScaler
+ */
+
+#include <algorithm>
+#include "json_arena.hpp"
+
+namespace
+{
+    /// @brief The smallest block, leaving room for the allocator's chunk header
+    const size_t MIN_CAPACITY = 1024;
+
+    /// @brief Get the number of words in a block of a given size, within the limits
+    size_t blockWords(size_t capacity)
+    {
+        return (std::max(MIN_CAPACITY, std::min(capacity, JsonArena::MAX_CAPACITY)) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    }
+} // namespace
+
+const size_t JsonArena::DEFAULT_CAPACITY;
+const size_t JsonArena::MAX_CAPACITY;
+
+JsonArena::JsonArena(size_t capacity) : m_block(blockWords(capacity))
+{
+    create();
+}
+
+JsonArena::~JsonArena()
+{
+    // The document's values live in the allocator's memory
+    mp_document.reset();
+    mp_allocator.reset();
+}
+
+rapidjson::Document &JsonArena::parse(std::string &json)
+{
+    // Release the previous document, growing the block if it did not fit
+    mp_document->SetNull();
+    const size_t used = mp_allocator->Capacity();
+    if (used > capacity() && capacity() < MAX_CAPACITY)
+    {
+        mp_document.reset();
+        mp_allocator.reset();
+        m_block.assign(blockWords(used), 0);
+        create();
+    }
+    else
+    {
+        mp_allocator->Clear();
+    }
+
+    // The document is left null if the JSON cannot be parsed
+    mp_document->ParseInsitu(&json[0]);
+    return *mp_document;
+}
+
+size_t JsonArena::capacity() const
+{
+    return m_block.size() * sizeof(uint64_t);
+}
+
+void JsonArena::create()
+{
+    mp_allocator.reset(new rapidjson::MemoryPoolAllocator<>(&m_block[0], capacity()));
+    mp_document.reset(new rapidjson::Document(mp_allocator.get()));
+}
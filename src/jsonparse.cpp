@@ -5,935 +5,674 @@
  */
 
 #include "jsonparse.hpp"
-#include <sstream>
-#include <cassert>
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
-#define ALLOW_SPACES true
+#include <cstring>
+#include <iterator>
+#include <new>
 
 namespace cryptosoft
 {
 
-Json::~Json()
+/*
+ * Memory for the nodes and strings of a document, handed out from blocks that
+ * are only freed together. Each new block is at least twice the size of the
+ * last, and reset() keeps the largest block for the next document.
+ */
+class Json::Arena
 {
-    clearAndDestroy();
-}
+    public:
 
-bool Json::parseObject( std::istream& is )
-{
-    enum parseState
-    {
-        ERROR,
-        OPEN_CURLY,
-        READ_PAIR_OR_END,
-        READ_PAIR,
-        COLON,
-        VALUE,
-        COMMA_OR_END,
-        COMPLETE
-    };
-
-    parseState state = OPEN_CURLY;
-    std::string lhs = "";
-    Json* rhs = 0;
-    do
-    {
-        char c = is.get();
-        switch (c)
+        Arena() : head( 0 )
         {
-#ifdef ALLOW_SPACES
-            case ' ':
-            case '\n':
-                // Ignore spaces
-                break;
-#endif
-            case '{':
-                {
-                    if (state == OPEN_CURLY)
-                    {
-                        obj = new objType;
-                        lhs = "";
-                        state = READ_PAIR_OR_END;
-                    }
-                    else if (state == VALUE)
-                    {
-                        is.unget();
-                        rhs = new Json;
-                        if (rhs->parseObject( is ))
-                        {
-//                            obj->operator[](lhs) = rhs;
-                            obj->push_back(std::pair< std::string, Json* >(lhs, rhs));
-                            state = COMMA_OR_END;
-                        }
-                        else
-                        {
-                            state = ERROR;
-                            delete rhs;
-                            rhs = 0;
-                        }
-                    }
-                    else
-                        state = ERROR;
-                }
-                break;
-               
-            case '}':
-                {
-                    if (state == READ_PAIR_OR_END || state == COMMA_OR_END)
-                        state = COMPLETE;
-                    else
-                        state = ERROR;
-                }
-                break;
+        }
 
-            case ':':
-                {
-                    if (state == COLON)
-                    {
-                        rhs = 0;
-                        state = VALUE;
-                    }
-                    else
-                       state = ERROR;
-                }
-                break;
+        ~Arena()
+        {
+            while (head)
+            {
+                Block* previous = head->previous;
+                free( head );
+                head = previous;
+            }
+        }
 
-            case ',':
-                {
-                    if (state == COMMA_OR_END)
-                    {
-                        lhs = "";
-                        state = READ_PAIR;
-                    }
-                    else
-                       state = ERROR;
-                }
-                break;
+        void* allocate( size_t size )
+        {
+            size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            if (! head || head->capacity - head->used < size)
+                grow( size );
+            void* memory = (char*) head + HEADER + head->used;
+            head->used += size;
+            return memory;
+        }
 
-            default:
-                {
-                    is.unget();
-                    if (state == READ_PAIR || state == READ_PAIR_OR_END)
-                    {
-                        if (parseString( is, &lhs ))
-                            state = COLON;
-                        else
-                            state = ERROR;
-                    }
-                    else if (state == VALUE)
-                    {
-                        rhs = new Json;
-                        if (c == '"')
-                        {
-                            if (rhs->parseString( is ))
-                                state = COMMA_OR_END;
-                            else
-                                state = ERROR;
-                        }
-                        else if ((c >= '0' && c <= '9') || c == '-')
-                        {
-                            if (rhs->parseNumber( is ))
-                                state = COMMA_OR_END;
-                            else
-                                state = ERROR;
-                        }
-                        else if (c == '[')
-                        {
-                            if (rhs->parseArray( is ))
-                                state = COMMA_OR_END;
-                            else
-                                state = ERROR;
-                        }
-                        else if (c == 't' || c == 'f')
-                        {
-                            if (rhs->parseBool( is ))
-                                state = COMMA_OR_END;
-                            else
-                                state = ERROR;
-                        }
-                        else if (c == 'n')
-                        {
-                            if (rhs->parseNull( is ))
-                                state = COMMA_OR_END;
-                            else
-                                state = ERROR;
-                        }
-                        else
-                            state = ERROR;
-                        if (state == ERROR)
-                        {
-                            delete rhs;
-                            rhs = 0;
-                        }
-                        else
-//                            obj->operator[](lhs) = rhs;
-                            obj->push_back(std::pair< std::string, Json* >(lhs, rhs));
-                    }
-                    else
-                       state = ERROR;
-                }
-                break;
+        // Make sure the next allocations of up to size in total need no new block
+        void reserve( size_t size )
+        {
+            if (! head || head->capacity - head->used < size)
+                grow( size );
         }
-    } while (! is.eof() && state != COMPLETE && state != ERROR);
-    return state == COMPLETE;
+
+        // Copy into the arena, adding a terminating NUL
+        char* copy( const char* data, size_t length )
+        {
+            char* buffer = (char*) allocate( length + 1 );
+            memcpy( buffer, data, length );
+            buffer[length] = '\0';
+            return buffer;
+        }
+
+        // The children of the objects and arrays being parsed, kept for the next parse
+        std::vector< Json* > stack;
+
+        void reset( void )
+        {
+            if (! head) return;
+            while (head->previous)
+            {
+                Block* previous = head->previous->previous;
+                free( head->previous );
+                head->previous = previous;
+            }
+            head->used = 0;
+        }
+
+    private:
+
+        struct Block
+        {
+            Block* previous;
+            size_t capacity;
+            size_t used;
+        };
+
+        void grow( size_t size )
+        {
+            size_t capacity = head ? head->capacity * 2 : FIRST_BLOCK;
+            if (capacity < size) capacity = size;
+            Block* block = (Block*) malloc( HEADER + capacity );
+            if (! block) throw std::bad_alloc();
+            block->previous = head;
+            block->capacity = capacity;
+            block->used = 0;
+            head = block;
+        }
+
+        static const size_t ALIGNMENT = 8;
+        static const size_t HEADER = (sizeof( Block ) + 15) & ~(size_t) 15;
+        static const size_t FIRST_BLOCK = 4096;
+
+        Block* head;
+
+        Arena( const Arena& );
+        Arena& operator=( const Arena& );
+};
+
+namespace
+{
+
+// Bytes of arena per byte of input, enough for the nodes of most documents, but
+// no more than MAX_RESERVE beyond the input for a document of long strings
+const size_t RESERVE_FACTOR = 8;
+const size_t MAX_RESERVE = 1024 * 1024;
+
+// Paths of up to this many steps are looked up without allocating
+const size_t MAX_STACK_STEPS = 16;
+
+// Integers of up to this many digits are exact as doubles
+const int MAX_EXACT_DIGITS = 15;
+
+// The powers of ten that are exact as doubles
+const double POWERS_OF_TEN[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
 }
 
-bool Json::parseArray( std::istream& is )
+inline void skipSpace( Json::Cursor& c )
 {
-    enum parseState
+    while (c.pos != c.end && (*c.pos == ' ' || *c.pos == '\n' || *c.pos == '\r' || *c.pos == '\t'))
+        ++c.pos;
+}
+
+bool readHex4( const char* p, const char* end, unsigned long& value )
+{
+    if (end - p < 4) return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+            value |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            value |= c - 'A' + 10;
+        else
+            return false;
+    }
+    return true;
+}
+
+char* encodeUtf8( unsigned long code, char* out )
+{
+    if (code < 0x80)
+        *out++ = (char) code;
+    else if (code < 0x800)
+    {
+        *out++ = (char) (0xC0 | (code >> 6));
+        *out++ = (char) (0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
     {
-        ERROR,
-        OPEN_SQUARE,
-        VALUE_OR_END,
-        VALUE,
-        COMMA_OR_END,
-        COMPLETE
-    };
-
-    parseState state = OPEN_SQUARE;
-    Json* rhs = 0;
-    do
+        *out++ = (char) (0xE0 | (code >> 12));
+        *out++ = (char) (0x80 | ((code >> 6) & 0x3F));
+        *out++ = (char) (0x80 | (code & 0x3F));
+    }
+    else
     {
-        char c = is.get();
-        switch (c)
+        *out++ = (char) (0xF0 | (code >> 18));
+        *out++ = (char) (0x80 | ((code >> 12) & 0x3F));
+        *out++ = (char) (0x80 | ((code >> 6) & 0x3F));
+        *out++ = (char) (0x80 | (code & 0x3F));
+    }
+    return out;
+}
+
+void spoolString( std::ostream& os, const char* s, size_t length )
+{
+    os.put( '"' );
+    const char* run = s;
+    const char* end = s + length;
+    for (const char* p = s; p != end; ++p)
+    {
+        const char* escape = 0;
+        switch (*p)
         {
-#ifdef ALLOW_SPACES
-            case ' ':
-	    case '\n':
-                // Ignore spaces
-                break;
-#endif
-            case '[':
-                {
-                    if (state == OPEN_SQUARE)
-                    {
-                        arr = new arrType;
-                        rhs = 0;
-                        state = VALUE_OR_END;
-                    }
-                    else if (state == VALUE || state == VALUE_OR_END)
-                    {
-                        rhs = new Json;
-                        is.unget();
-                        if (rhs->parse( is ))
-                        {
-                            arr->push_back( rhs );
-                            state = COMMA_OR_END;
-                        }
-                        else
-                        {
-                            delete rhs;
-                            rhs = 0;
-                            state = ERROR;
-                        }
-                    }
-                    else
-                        state = ERROR;
-                }
-                break;
-               
-            case ']':
-                {
-                    if (state == VALUE_OR_END || state == COMMA_OR_END)
-                        state = COMPLETE;
-                    else
-                        state = ERROR;
-                }
+            case '"':  escape = "\\\""; break;
+            case '\\': escape = "\\\\"; break;
+            case '\b': escape = "\\b"; break;
+            case '\f': escape = "\\f"; break;
+            case '\n': escape = "\\n"; break;
+            case '\r': escape = "\\r"; break;
+            case '\t': escape = "\\t"; break;
+            default:
+                if ((unsigned char) *p >= 0x20) continue;
                 break;
+        }
+        os.write( run, p - run );
+        if (escape)
+            os << escape;
+        else
+        {
+            char hex[8];
+            snprintf( hex, sizeof( hex ), "\\u%04x", (unsigned int) (unsigned char) *p );
+            os << hex;
+        }
+        run = p + 1;
+    }
+    os.write( run, end - run );
+    os.put( '"' );
+}
 
-            case ',':
-                {
-                    if (state == COMMA_OR_END)
-                    {
-                        rhs = 0;
-                        state = VALUE;
-                    }
-                    else
-                       state = ERROR;
-                }
-                break;
+}
 
-            default:
+Json::XPath::XPath( const std::string& path ) : path( path )
+{
+    steps.resize( split( path, 0, 0 ) );
+    if (! steps.empty())
+        split( path, &steps[0], steps.size() );
+}
+
+size_t Json::XPath::split( const std::string& path, Step* steps, size_t capacity )
+{
+    // Skip the leading '/', a trailing '/' adds no step
+    size_t stepCount = 0;
+    size_t start = 1;
+    while (start < path.size())
+    {
+        size_t pos = path.find( '/', start );
+        if (pos == std::string::npos) pos = path.size();
+
+        if (stepCount < capacity)
+        {
+            Step& step = steps[stepCount];
+            const char* name = path.data() + start;
+            step.offset = start;
+            step.length = pos - start;
+            step.anyName = step.length == 1 && name[0] == '*';
+            step.isIndex = step.length >= 3 && name[0] == '[' && name[step.length - 1] == ']';
+            step.anyIndex = step.isIndex && step.length == 3 && name[1] == '*';
+            step.index = 0;
+            if (step.isIndex && ! step.anyIndex)
+            {
+                for (size_t i = 1; i < step.length - 1; ++i)
                 {
-                    is.unget();
-                    if (state == VALUE || state == VALUE_OR_END)
+                    if (! isDigit( name[i] ))
                     {
-                        rhs = new Json;
-                        if (c == '"')
-                        {
-                            rhs->parseString( is );
-                            state = COMMA_OR_END;
-                        }
-                        else if ((c >= '0' && c <= '9') || c == '-')
-                        {
-                            rhs->parseNumber( is );
-                            state = COMMA_OR_END;
-                        }
-                        else if (c == '{')
-                        {
-                            rhs->parseObject( is );
-                            state = COMMA_OR_END;
-                        }
-                        else if (c == 't' || c == 'f')
-                        {
-                            rhs->parseBool( is );
-                            state = COMMA_OR_END;
-                        }
-                        else if (c == 'n')
-                        {
-                            rhs->parseNull( is );
-                            state = COMMA_OR_END;
-                        }
-                        else
-                            state = ERROR;
-                        if (state == ERROR)
-                        {
-                            delete rhs;
-                            rhs = 0;
-                        }
-                        else
-                            arr->push_back( rhs );
+                        step.isIndex = false;
+                        break;
                     }
-                    else
-                       state = ERROR;
+                    step.index = step.index * 10 + (name[i] - '0');
                 }
-                break;
+            }
         }
-    } while (! is.eof() && state != COMPLETE && state != ERROR);
-    return state == COMPLETE;
+        ++stepCount;
+        start = pos + 1;
+    }
+    return stepCount;
 }
 
-bool Json::parseNull( std::istream& is )
+Json::Json() : type( NULL_TYPE ), ownsArena( false ), boolValue( false ), arena( 0 ), key( 0 ), keyLength( 0 ),
+    children( 0 ), count( 0 ), str( 0 ), strLength( 0 ), boolean( 0 ), num( 0 ), numValue( 0 )
 {
-    enum parseState
-    {
-        ERROR,
-        EN,
-        EU,
-        EL,
-        EL2,
-        COMPLETE
-    };
-
-    parseState state = EN;
-    assert( ! is.eof() );
-    do
+}
+
+Json::Json( Arena* arena ) : type( NULL_TYPE ), ownsArena( false ), boolValue( false ), arena( arena ), key( 0 ), keyLength( 0 ),
+    children( 0 ), count( 0 ), str( 0 ), strLength( 0 ), boolean( 0 ), num( 0 ), numValue( 0 )
+{
+}
+
+Json::~Json()
+{
+    // The nodes in the arena own nothing, so need no destruction
+    if (ownsArena)
+        delete arena;
+}
+
+Json::Arena& Json::getArena( void )
+{
+    if (! arena)
     {
-        char c = is.get();
-        switch (c)
-        {
-            case 'n':
-                if (state == EN)
-                    state = EU;
-                else
-                    state = ERROR;
-                break;
-            case 'u':
-                if (state == EU)
-                    state = EL;
-                else
-                    state = ERROR;
-                break;
-            case 'l':
-                if (state == EL)
-                    state = EL2;
-                else if (state == EL2)
-                {
-                    state = COMPLETE;
-                    // Nothing to do as node is null already.
-                }
-                else
-                    state = ERROR;
-                break;
-            default:
-                state = ERROR;
-                break;
-        }
-        if (state == ERROR) is.unget();
-    } while (! is.eof() && state != COMPLETE && state != ERROR);
-    return state == COMPLETE;
+        arena = new Arena;
+        ownsArena = true;
+    }
+    return *arena;
 }
 
-bool Json::parseBool( std::istream& is )
+Json* Json::newNode( void )
 {
-    enum parseState
+    Arena& nodes = getArena();
+    return new (nodes.allocate( sizeof( Json ) )) Json( &nodes );
+}
+
+// Move the children parsed since base from the stack into the arena
+void Json::endChildren( Cursor& c, size_t base )
+{
+    count = c.stack->size() - base;
+    if (count)
     {
-        ERROR,
-        TE_OR_EF,
-        AR,
-        EU,
-        EE,
-        AE,
-        EL,
-        ES,
-        COMPLETE
-    };
-
-    bool value = true;
-    parseState state = TE_OR_EF;
-    assert( ! is.eof() );
-    do
+        children = (Json**) getArena().allocate( count * sizeof( Json* ) );
+        memcpy( children, &(*c.stack)[base], count * sizeof( Json* ) );
+        c.stack->resize( base );
+    }
+}
+
+void Json::assign( const Json& other )
+{
+    type = other.type;
+    children = other.children;
+    count = other.count;
+    str = other.str;
+    strLength = other.strLength;
+    boolValue = other.boolValue;
+    numValue = other.numValue;
+    boolean = type == BOOL ? &boolValue : 0;
+    num = type == NUMBER ? &numValue : 0;
+}
+
+bool Json::parseObject( Cursor& c )
+{
+    ++c.pos; // '{'
+    type = OBJECT;
+    const size_t base = c.stack->size();
+    skipSpace( c );
+    if (c.pos != c.end && *c.pos == '}')
     {
-        char c = is.get();
-        switch (c)
+        ++c.pos;
+        return true;
+    }
+    for (;;)
+    {
+        if (c.pos == c.end || *c.pos != '"') return false;
+        Json* child = newNode();
+        if (! parseString( c, child->key, child->keyLength )) return false;
+        skipSpace( c );
+        if (c.pos == c.end || *c.pos != ':') return false;
+        ++c.pos;
+        skipSpace( c );
+        if (! child->parseValue( c )) return false;
+        c.stack->push_back( child );
+        skipSpace( c );
+        if (c.pos == c.end) return false;
+        if (*c.pos == '}')
         {
-            case 't':
-                if (state == TE_OR_EF)
-                {
-                    state = AR;
-                    value = true;
-                }
-                else
-                    state = ERROR;
-                break;
-            case 'r':
-                if (state == AR)
-                    state = EU;
-                else
-                    state = ERROR;
-                break;
-            case 'u':
-                if (state == EU)
-                    state = EE;
-                else
-                    state = ERROR;
-                break;
-            case 'e':
-                if (state == EE)
-                {
-                    state = COMPLETE;
-                    boolean = new bool( value );
-                }
-                else
-                    state = ERROR;
-                break;
-            case 'f':
-                if (state == TE_OR_EF)
-                {
-                    state = AE;
-                    value = false;
-                }
-                else
-                    state = ERROR;
-                break;
-            case 'a':
-                if (state == AE)
-                    state = EL;
-                else
-                    state = ERROR;
-                break;
-            case 'l':
-                if (state == EL)
-                    state = ES;
-                else
-                    state = ERROR;
-                break;
-            case 's':
-                if (state == ES)
-                    state = EE;
-                else
-                    state = ERROR;
-                break;
-            default:
-                state = ERROR;
-                break;
+            ++c.pos;
+            endChildren( c, base );
+            return true;
         }
-        if (state == ERROR) is.unget();
-    } while (! is.eof() && state != COMPLETE && state != ERROR);
-    return state == COMPLETE;
+        if (*c.pos != ',') return false;
+        ++c.pos;
+        skipSpace( c );
+    }
 }
 
-bool Json::parseNumber( std::istream& is )
+bool Json::parseArray( Cursor& c )
 {
-    enum parseState
-    {
-        ERROR,
-        MINUS_OR_DIGIT,
-        DIGIT_BEFORE_POINT,
-        DIGITS_BEFORE_POINT,
-        POINT_OR_OTHER,
-        DIGIT_AFTER_POINT,
-        DIGITS_AFTER_POINT,
-        PLUS_OR_MINUS,
-        DIGIT_AFTER_EE,
-        DIGITS_AFTER_EE,
-        COMPLETE
-    };
-
-    std::string value;
-    parseState state = MINUS_OR_DIGIT;
-    assert( ! is.eof() );
-    do
+    ++c.pos; // '['
+    type = ARRAY;
+    const size_t base = c.stack->size();
+    skipSpace( c );
+    if (c.pos != c.end && *c.pos == ']')
     {
-        char c = is.get();
-        switch (c)
+        ++c.pos;
+        return true;
+    }
+    for (;;)
+    {
+        Json* child = newNode();
+        if (! child->parseValue( c )) return false;
+        c.stack->push_back( child );
+        skipSpace( c );
+        if (c.pos == c.end) return false;
+        if (*c.pos == ']')
         {
-            case '-':
-                if (state == MINUS_OR_DIGIT)
-                    state = DIGIT_BEFORE_POINT;
-                else if (state == PLUS_OR_MINUS)
-                    state = DIGIT_AFTER_EE;
-                else
-                    state = ERROR;
-                if (state != ERROR) value.push_back( c );
-                break;
-            case '+':
-                if (state == PLUS_OR_MINUS)
-                    state = DIGIT_AFTER_EE;
-                else
-                    state = ERROR;
-                if (state != ERROR) value.push_back( c );
-                break;
-            case '0':
-                if (state == MINUS_OR_DIGIT)
-                    state = POINT_OR_OTHER;
-                else if (state == DIGIT_BEFORE_POINT)
-                    state = POINT_OR_OTHER;
-                else if (state == DIGITS_BEFORE_POINT)
-                    state = DIGITS_BEFORE_POINT;
-                else if (state == DIGIT_AFTER_POINT)
-                    state = DIGITS_AFTER_POINT;
-                else if (state == DIGITS_AFTER_POINT)
-                    state = DIGITS_AFTER_POINT;
-                else if (state == DIGITS_AFTER_EE)
-                    state = DIGITS_AFTER_EE;
-                else if (state == PLUS_OR_MINUS)
-                    state = DIGITS_AFTER_EE;
-                else if (state == DIGIT_AFTER_EE)
-                    state = DIGITS_AFTER_EE;
-                else
-                    state = ERROR;
-                if (state != ERROR) value.push_back( c );
-                break;
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-                if (state == MINUS_OR_DIGIT)
-                    state = DIGITS_BEFORE_POINT;
-                else if (state == DIGIT_BEFORE_POINT)
-                    state = DIGITS_BEFORE_POINT;
-                else if (state == DIGITS_BEFORE_POINT)
-                    state = DIGITS_BEFORE_POINT;
-                else if (state == DIGIT_AFTER_POINT)
-                    state = DIGITS_AFTER_POINT;
-                else if (state == DIGITS_AFTER_POINT)
-                    state = DIGITS_AFTER_POINT;
-                else if (state == PLUS_OR_MINUS)
-                    state = DIGITS_AFTER_EE;
-                else if (state == DIGIT_AFTER_EE)
-                    state = DIGITS_AFTER_EE;
-                else if (state == DIGITS_AFTER_EE)
-                    state = DIGITS_AFTER_EE;
-                else
-                    state = ERROR;
-                if (state != ERROR) value.push_back( c );
-                break;
-            case '.':
-                if (state == POINT_OR_OTHER)
-                    state = DIGIT_AFTER_POINT;
-                else if (state == DIGITS_BEFORE_POINT)
-                    state = DIGIT_AFTER_POINT;
-                else if (state == DIGIT_BEFORE_POINT)
-                    state = DIGIT_AFTER_POINT;
-                else
-                    state = ERROR;
-                if (state != ERROR) value.push_back( c );
-                break;
-            case 'e':
-            case 'E':
-                if (state == DIGIT_AFTER_POINT)
-                    state = PLUS_OR_MINUS;
-                else if (state == DIGITS_AFTER_POINT)
-                    state = PLUS_OR_MINUS;
-                else if (state == DIGIT_BEFORE_POINT)
-                    state = PLUS_OR_MINUS;
-                else if (state == DIGITS_BEFORE_POINT)
-                    state = PLUS_OR_MINUS;
-                else if (state == POINT_OR_OTHER)
-                    state = PLUS_OR_MINUS;
-                else
-                    state = ERROR;
-                if (state != ERROR) value.push_back( c );
-                break;
-            default:
-//                if (c == '}' || c == ']' || c == ',' || c == ':')
-                    is.unget();
-                    if (state == DIGITS_AFTER_EE || state == DIGITS_AFTER_POINT || state == POINT_OR_OTHER || state == DIGITS_BEFORE_POINT)
-                    {
-                        num = new double;
-                        *num = atof( value.c_str() );
-                        state = COMPLETE;
-                    }
-                    else
-                        state = ERROR;
-//                else
-//                    state = ERROR;
-                break;
+            ++c.pos;
+            endChildren( c, base );
+            return true;
         }
-        if (state == ERROR) is.unget();
-    } while (! is.eof() && state != COMPLETE && state != ERROR);
-    return state == COMPLETE;
+        if (*c.pos != ',') return false;
+        ++c.pos;
+        skipSpace( c );
+    }
+}
+
+bool Json::parseLiteral( Cursor& c, const char* literal, size_t length )
+{
+    if ((size_t) (c.end - c.pos) < length || memcmp( c.pos, literal, length ) != 0) return false;
+    c.pos += length;
+    return true;
 }
 
-bool Json::parseString( std::istream& is, std::string* useThis )
+bool Json::parseNumber( Cursor& c )
 {
-    enum parseState
+    char* p = c.pos;
+    const bool negative = p != c.end && *p == '-';
+    if (negative) ++p;
+    if (p == c.end) return false;
+
+    // Collect the digits, which give the exact value when there are few enough of them
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    bool exact = true;
+    if (*p == '0')
+        ++p;
+    else if (isDigit( *p ))
+    {
+        for (; p != c.end && isDigit( *p ); ++p, ++digits)
+            mantissa = mantissa * 10 + (*p - '0');
+    }
+    else
+        return false;
+    if (p != c.end && *p == '.')
+    {
+        ++p;
+        if (p == c.end || ! isDigit( *p )) return false;
+        for (; p != c.end && isDigit( *p ); ++p, ++digits, ++fractionDigits)
+            mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p != c.end && (*p == 'e' || *p == 'E'))
     {
-        ERROR,
-        QUOTE,
-        CHARS,
-        ESCAPE,
-        HEX1,
-        HEX2,
-        HEX3,
-        HEX4,
-        ENDSTRING,
-        COMPLETE
-    };
-
-    std::string hexNum;
-    std::string value;
-    parseState state = QUOTE;
-    assert( ! is.eof() );
-    do
+        exact = false;
+        ++p;
+        if (p != c.end && (*p == '+' || *p == '-')) ++p;
+        if (p == c.end || ! isDigit( *p )) return false;
+        while (p != c.end && isDigit( *p )) ++p;
+    }
+
+    if (exact && digits <= MAX_EXACT_DIGITS && fractionDigits < (int) (sizeof( POWERS_OF_TEN ) / sizeof( POWERS_OF_TEN[0] )))
     {
-        char c = is.get();
-        switch (c)
+        // Both are exact, so the division is correctly rounded like strtod
+        numValue = (double) mantissa / POWERS_OF_TEN[fractionDigits];
+        if (negative) numValue = -numValue;
+    }
+    else
+    {
+        // Terminate the number in place for strtod, the buffer has a NUL after its end
+        char following = *p;
+        *p = '\0';
+        numValue = strtod( c.pos, 0 );
+        *p = following;
+    }
+    c.pos = p;
+    type = NUMBER;
+    num = &numValue;
+    return true;
+}
+
+// Unescape a string in place, which never lengthens it, and NUL terminate it
+bool Json::parseString( Cursor& c, const char*& value, size_t& length )
+{
+    char* start = c.pos + 1; // '"'
+    char* r = start;
+
+    // Nothing moves until the first escape
+    while (r != c.end && *r != '"' && *r != '\\') ++r;
+    char* w = r;
+    for (;;)
+    {
+        if (r == c.end) return false;
+        if (*r == '"') break;
+        if (*r != '\\')
         {
-            case '\"':
-                if (state == QUOTE)
-                    state = CHARS;
-                else if (state == ESCAPE)
-                {
-                    value.push_back( c );
-                    state = CHARS;
-                }
-                else if (state == CHARS)
-                {
-                    state = ENDSTRING;
-                }
-                else
-                    state = ERROR;
-                break;
-            case '\\':
-                if (state == CHARS)
-                    state = ESCAPE;
-                else if (state == ESCAPE)
-                {
-                    value.push_back( c );
-                    state = CHARS;
-                }
-                else
-                    state = ERROR;
-                break;
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-            case 'a':
-            case 'c':
-            case 'd':
-            case 'e':
-            case 'A':
-            case 'B':
-            case 'C':
-            case 'D':
-            case 'E':
-            case 'F':
-                if (state == HEX1)
-                {
-                    hexNum.push_back( c );
-                    state = HEX2;
-                }
-                else if (state == HEX2)
-                {
-                    hexNum.push_back( c );
-                    state = HEX3;
-                }
-                else if (state == HEX3)
-                {
-                    hexNum.push_back( c );
-                    state = HEX4;
-                }
-                else if (state == HEX4)
-                {
-                    hexNum.push_back( c );
-                    state = CHARS;
-                }
-                else if (state == CHARS)
-                {
-                    value.push_back( c );
-                    state = CHARS;
-                }
-                else
-                    state = ERROR;
-                break;
-            case 'b':
-            case 'f':
-                if (state == HEX1)
-                {
-                    hexNum.push_back( c );
-                    state = HEX2;
-                }
-                else if (state == HEX2)
-                {
-                    hexNum.push_back( c );
-                    state = HEX3;
-                }
-                else if (state == HEX3)
-                {
-                    hexNum.push_back( c );
-                    state = HEX4;
-                }
-                else if (state == HEX4)
-                {
-                    hexNum.push_back( c );
-                    state = CHARS;
-                }
-                else if (state == ESCAPE)
-                {
-                    if (c == 'f')
-                        value.push_back('\f');
-                    else if (c == 'b')
-                        value.push_back('\b');
-                    state = CHARS;
-                }
-                else if (state == CHARS)
-                {
-                    value.push_back( c );
-                    state = CHARS;
-                }
-                else
-                    state = ERROR;
-                break;
-            case '/':
-            case 'n':
-            case 'r':
-            case 't':
-                if (state == ESCAPE)
-                {
-                    if (c == 't')
-                        value.push_back('\t');
-                    else if (c == 'r')
-                        value.push_back('\r');
-                    else if (c == 'n')
-                        value.push_back('\n');
-                    else if (c == '/')
-                        value.push_back('/');
-                    state = CHARS;
-                }
-                else if (state == CHARS)
-                {
-                    value.push_back( c );
-                    state = CHARS;
-                }
-                else
-                    state = ERROR;
-                break;
+            *w++ = *r++;
+            continue;
+        }
+        if (++r == c.end) return false;
+        switch (*r++)
+        {
+            case '"':  *w++ = '"'; break;
+            case '\\': *w++ = '\\'; break;
+            case '/':  *w++ = '/'; break;
+            case 'b':  *w++ = '\b'; break;
+            case 'f':  *w++ = '\f'; break;
+            case 'n':  *w++ = '\n'; break;
+            case 'r':  *w++ = '\r'; break;
+            case 't':  *w++ = '\t'; break;
             case 'u':
-                if (state == ESCAPE)
-                {
-                    hexNum.clear();
-                    state = HEX1;
-                }
-                else if (state == CHARS)
-                {
-                    value.push_back( c );
-                    state = CHARS;
-                }
-                else
-                    state = ERROR;
-                break;
-            default:
-                if (state == ENDSTRING)
                 {
-//                    if (c == '}' || c == ']' || c == ',' || c == ':')
+                    unsigned long code;
+                    if (! readHex4( r, c.end, code )) return false;
+                    r += 4;
+                    unsigned long low;
+                    if (code >= 0xD800 && code <= 0xDBFF && c.end - r >= 6 && r[0] == '\\' && r[1] == 'u' &&
+                        readHex4( r + 2, c.end, low ) && low >= 0xDC00 && low <= 0xDFFF)
                     {
-                        is.unget();
-                        if (useThis)
-                            *useThis = value;
-                        else
-                            val = new std::string( value );
-                        state = COMPLETE;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        r += 6;
                     }
-//                    else
-//                        state = ERROR;
+                    else if (code >= 0xD800 && code <= 0xDFFF)
+                    {
+                        // A surrogate without its pair has no UTF-8 encoding
+                        code = 0xFFFD;
+                    }
+                    w = encodeUtf8( code, w );
                 }
-                else if (state == CHARS)
-                    value.push_back( c );
-                else
-                    state = ERROR;
                 break;
+            default:
+                return false;
         }
-        if (state == ERROR) is.unget();
-    } while (! is.eof() && state != COMPLETE && state != ERROR);
-    return state == COMPLETE;
+    }
+    value = start;
+    length = w - start;
+    *w = '\0';
+    c.pos = r + 1;
+    return true;
 }
 
-bool Json::parse( std::istream& is, bool allowValues )
+bool Json::parseValue( Cursor& c )
 {
-    bool result = false;
-    if (! is.eof())
+    if (c.pos == c.end) return false;
+    switch (*c.pos)
+    {
+        case '{':
+            return parseObject( c );
+        case '[':
+            return parseArray( c );
+        case '"':
+            if (! parseString( c, str, strLength )) return false;
+            type = STRING;
+            return true;
+        case 't':
+        case 'f':
+            {
+                const bool value = *c.pos == 't';
+                if (! (value ? parseLiteral( c, "true", 4 ) : parseLiteral( c, "false", 5 ))) return false;
+                type = BOOL;
+                boolValue = value;
+                boolean = &boolValue;
+                return true;
+            }
+        case 'n':
+            return parseLiteral( c, "null", 4 );
+        default:
+            return parseNumber( c );
+    }
+}
+
+bool Json::parseBuffer( const char* data, size_t length, bool allowValues )
+{
+    // Parsing again releases the previous document of a root
+    // and makes room for the copy and the nodes of a typical document
+    Arena& nodes = getArena();
+    if (ownsArena)
     {
-        char c = is.get();
-        is.unget();
-        if (c == '{')
-            result = parseObject( is );
-        else if (c == '[')
-            result = parseArray( is );
-        else if (allowValues && c == '"')
-            result = parseString( is );
-        else if (allowValues && ((c >= '0' && c <= '9') || c == '-'))
-            result = parseNumber( is );
-        else if (allowValues && (c == 't' || c == 'f'))
-            result = parseBool( is );
-        else if (allowValues && c == 'n')
-            result = parseNull( is );
-    } 
-    return result;
+        nodes.reset();
+        nodes.reserve( std::min( length * RESERVE_FACTOR, length + MAX_RESERVE ) );
+    }
+    setNull();
+
+    Cursor c;
+    c.pos = nodes.copy( data, length );
+    c.end = c.pos + length;
+    c.stack = &nodes.stack;
+    c.stack->clear();
+    skipSpace( c );
+    if (c.pos == c.end) return false;
+    if (! allowValues && *c.pos != '{' && *c.pos != '[') return false;
+
+    // Anything after the value is ignored
+    if (parseValue( c )) return true;
+    c.stack->clear();
+    setNull();
+    return false;
+}
+
+bool Json::parse( std::istream& is, bool allowValues )
+{
+    const std::string ss( (std::istreambuf_iterator< char >( is )), std::istreambuf_iterator< char >() );
+    return parseBuffer( ss.data(), ss.size(), allowValues );
 }
 
 bool Json::parse( const std::string& ss, bool allowValues )
 {
-    std::istringstream iss( ss );
-    return parse( iss, allowValues );
+    return parseBuffer( ss.data(), ss.size(), allowValues );
 }
 
-Json* Json::atXPath( const std::string& path )
+Json* Json::match( const char* path, const XPath::Step* steps, size_t stepCount, size_t step, std::vector< Json* >* result )
 {
-    if (path.empty() || path == "/") return this;
-    if (obj)
+    if (step == stepCount)
     {
-        if (path.empty()) return 0;
-        size_t pos = path.find_first_of( '/', 1 );
-        std::string level = path.substr( 1, pos-1 );
-        for (objType::iterator i = obj->begin(); i != obj->end(); ++i)
-        {
-            if (level == i->first)
-            {
-                if (pos == std::string::npos)
-                    return i->second->atXPath( "" );
-                else
-                    return i->second->atXPath( path.substr(pos) );
-            }
-        }
-        return 0;
+        if (result) result->push_back( this );
+        return this;
     }
-    else
-    {
-        if (path.length() < 4) return 0;
-        if (path[1] != '[') return 0;
-        size_t pos = path.find_first_of( ']' );
-        if (pos == std::string::npos) return 0;
-        std::string level = path.substr( 2, pos-2 );
-        int num = atoi( level.c_str() );
-        assert( num >= 0 );
-        if ((unsigned int) num >= arr->size()) return 0;
-        return arr->operator[](num)->atXPath( path.substr(pos+1) );
-    }
-}
 
-void Json::allAtXPath( const std::string& path, std::vector< Json* >& result )
-{
-    if (path.empty() || path == "/") result.push_back( this );
-    else if (obj)
+    const XPath::Step& s = steps[step];
+    Json* found = 0;
+    if (type == OBJECT)
     {
-        std::string tempPath = path;
-        if (tempPath.empty()) tempPath = "/*";
-        size_t pos = tempPath.find_first_of( '/', 1 );
-        std::string level = tempPath.substr( 1, pos-1 );
-        for (objType::iterator i = obj->begin(); i != obj->end(); ++i)
+        for (size_t i = 0; i < count; ++i)
         {
-            if (level == i->first || level == "*")
+            Json* child = children[i];
+            if (s.anyName || (child->keyLength == s.length && memcmp( child->key, path + s.offset, s.length ) == 0))
             {
-                if (pos == std::string::npos)
-                    i->second->allAtXPath( "", result );
-                else
-                    i->second->allAtXPath( tempPath.substr(pos), result );
+                Json* matched = child->match( path, steps, stepCount, step + 1, result );
+                if (matched && ! found)
+                {
+                    found = matched;
+                    if (! result) break;
+                }
             }
         }
     }
-    else if (arr)
+    else if (type == ARRAY && s.isIndex)
     {
-        std::string tempPath = path;
-        if (tempPath.empty()) tempPath = "/[*]"; // Match all
-        if (tempPath.length() < 4) return;
-        if (tempPath[1] != '[') return;
-        size_t pos = tempPath.find_first_of( ']' );
-        if (pos == std::string::npos) return;
-        std::string level = tempPath.substr( 2, pos-2 );
-        if (level == "*")
+        if (s.anyIndex)
         {
-            for (arrType::iterator i = arr->begin(); i != arr->end(); ++i)
+            for (size_t i = 0; i < count; ++i)
             {
-                (*i)->allAtXPath( tempPath.substr(pos+1), result );
+                Json* matched = children[i]->match( path, steps, stepCount, step + 1, result );
+                if (matched && ! found)
+                {
+                    found = matched;
+                    if (! result) break;
+                }
             }
         }
-        else
-        {
-            int num = atoi( level.c_str() );
-            assert( num >= 0 );
-            if ((unsigned int) num >= arr->size()) return;
-            arr->operator[](num)->allAtXPath( tempPath.substr(pos+1), result );
-        }
+        else if (s.index < count)
+            found = children[s.index]->match( path, steps, stepCount, step + 1, result );
     }
+    return found;
 }
 
-bool Json::replaceWith( const std::string& replacement )
+Json* Json::atXPath( const XPath& path )
 {
-    Json newbit;
-    if (newbit.parse( replacement, true ))
-    {
-        clearAndDestroy(); // Remove what is there already;
-        *this = newbit;
-        newbit.clear(); // So that memory is not deleted.
-        return true;
-    }
-    return false;
+    return match( path.path.data(), path.steps.empty() ? 0 : &path.steps[0], path.steps.size(), 0, 0 );
 }
 
-void Json::clear( void )
+Json* Json::atXPath( const std::string& path )
 {
-    obj = 0;
-    arr = 0;
-    val = 0;
-    boolean = 0;
-    num = 0;
+    // Short paths are split on the stack rather than into an XPath
+    XPath::Step steps[MAX_STACK_STEPS];
+    const size_t stepCount = XPath::split( path, steps, MAX_STACK_STEPS );
+    if (stepCount > MAX_STACK_STEPS)
+        return atXPath( XPath( path ) );
+    return match( path.data(), steps, stepCount, 0, 0 );
 }
 
-void Json::clearAndDestroy( void )
+void Json::allAtXPath( const XPath& path, std::vector< Json* >& result )
 {
-    if (obj)
-    {
-        for (objType::const_iterator i = obj->begin(); i != obj->end(); ++i)
-            delete i->second;
-    }
-    delete obj;
-    obj = 0;
-    if (arr)
+    match( path.path.data(), path.steps.empty() ? 0 : &path.steps[0], path.steps.size(), 0, &result );
+}
+
+void Json::allAtXPath( const std::string& path, std::vector< Json* >& result )
+{
+    XPath::Step steps[MAX_STACK_STEPS];
+    const size_t stepCount = XPath::split( path, steps, MAX_STACK_STEPS );
+    if (stepCount > MAX_STACK_STEPS)
+        allAtXPath( XPath( path ), result );
+    else
+        match( path.data(), steps, stepCount, 0, &result );
+}
+
+bool Json::replaceWith( const std::string& replacement )
+{
+    Json* newbit = newNode();
+    if (newbit->parse( replacement, true ))
     {
-        for (arrType::const_iterator i = arr->begin(); i != arr->end(); ++i)
-            delete *i;
+        assign( *newbit ); // Keeps the member name and position
+        return true;
     }
-    delete arr;
-    arr = 0;
-    delete val;
-    val = 0;
-    delete num;
-    num = 0;
-    delete boolean;
-    boolean = 0;
+    return false;
 }
 
 bool Json::replaceAllAtXPath( const std::string& path, const std::string& replacement )
@@ -990,91 +729,83 @@ void Json::replaceNullAtXPath( const std::string& path )
 
 void Json::spool( std::ostream& os ) const
 {
-    if (obj)
-    {
-        bool skipComma = true;
-        os << "{";
-        for (objType::const_iterator i = obj->begin(); i != obj->end(); ++i)
-        {
-            if (skipComma)
-                skipComma = false;
-            else
-                os << ",";
-            os << "\"" << i->first << "\"";
-            os << ":";
-            i->second->spool( os );
-        }
-        os << "}";
-    }
-    else if (arr)
+    switch (type)
     {
-        bool skipComma = true;
-        os << "[";
-        for (arrType::const_iterator i = arr->begin(); i != arr->end(); ++i)
-        {
-            if (skipComma)
-                skipComma = false;
-            else
-                os << ",";
-            (*i)->spool( os );
-        }
-        os << "]";
-    }
-    else if (val)
-    {
-        os << "\"" << *val << "\"";
-    }
-    else if (boolean)
-    {
-        os << (*boolean?"true":"false");
-    }
-    else if (num)
-    {
-        os << *num;
-    }
-    else
-    {
-        os << "null";
+        case OBJECT:
+            os << "{";
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Json* child = children[i];
+                if (i)
+                    os << ",";
+                spoolString( os, child->key, child->keyLength );
+                os << ":";
+                child->spool( os );
+            }
+            os << "}";
+            break;
+        case ARRAY:
+            os << "[";
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i)
+                    os << ",";
+                children[i]->spool( os );
+            }
+            os << "]";
+            break;
+        case STRING:
+            spoolString( os, str, strLength );
+            break;
+        case BOOL:
+            os << (boolValue?"true":"false");
+            break;
+        case NUMBER:
+            os << numValue;
+            break;
+        default:
+            os << "null";
+            break;
     }
 }
 
 bool Json::isNull( void ) const
 {
-    return (! obj && ! arr && ! val && ! boolean && ! num);
+    return type == NULL_TYPE;
 }
 
 void Json::setString( const std::string& value )
 {
-    if (val) *val = value;
-    else
-    {
-        clearAndDestroy();
-        val = new std::string( value );
-    }
+    setNull();
+    str = getArena().copy( value.data(), value.size() );
+    strLength = value.size();
+    type = STRING;
 }
 
 void Json::setBool( bool value )
 {
-    if (boolean) *boolean = value;
-    else
-    {
-        clearAndDestroy();
-        boolean = new bool( value );
-    }
+    setNull();
+    boolValue = value;
+    boolean = &boolValue;
+    type = BOOL;
 }
 
 void Json::setNumber( double value )
 {
-    if (num) *num = value;
-    else
-    {
-        clearAndDestroy();
-        num = new double( value );
-    }
+    setNull();
+    numValue = value;
+    num = &numValue;
+    type = NUMBER;
 }
 
 void Json::setNull( void )
 {
-    clearAndDestroy();
+    type = NULL_TYPE;
+    children = 0;
+    count = 0;
+    str = 0;
+    strLength = 0;
+    boolean = 0;
+    num = 0;
 }
 }
@@ -6,6 +6,9 @@
  */
 #include "jsonparse.hpp"
 #include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
 #include <string>
 
 using namespace cryptosoft;
@@ -1151,3 +1154,162 @@ TEST(CryptosoftJSONParse, ThreadsAreSafe)
     ASSERT_EQ( (10000ul * 20) + (10000ul * 5) + (10000ul * 9) + (10000ul * 30), total );
 }
 #endif
+
+TEST(CryptosoftJSONParseStrings, GoodEmbeddedUnicode)
+{
+    const char* json = "[\"caf\\u00e9 \\ud83d\\ude00\"]";
+    Json n;
+    EXPECT_TRUE( n.parse( json ) );
+    std::ostringstream oss;
+    n.spool( oss );
+    EXPECT_STREQ( "[\"caf\xc3\xa9 \xf0\x9f\x98\x80\"]", oss.str().c_str() );
+}
+
+TEST(CryptosoftJSONParseStrings, LoneSurrogates)
+{
+    const char* json = "[\"\\ud800 \\udc00\\u0041\"]";
+    Json n;
+    EXPECT_TRUE( n.parse( json ) );
+    std::ostringstream oss;
+    n.spool( oss );
+    EXPECT_STREQ( "[\"\xef\xbf\xbd \xef\xbf\xbd" "A\"]", oss.str().c_str() );
+}
+
+TEST(CryptosoftJSONParse, ValueWithAllowValues)
+{
+    Json n;
+    EXPECT_FALSE( n.parse( "\"hello\"" ) );
+    EXPECT_TRUE( n.parse( "\"hello\"", true ) );
+    EXPECT_EQ( Json::STRING, n.type );
+    EXPECT_STREQ( "hello", n.str );
+}
+
+TEST(CryptosoftJSONParse, Buffer)
+{
+    const char data[] = "[1,2]garbage";
+    Json n;
+    EXPECT_TRUE( n.parseBuffer( data, 5 ) );
+    EXPECT_FALSE( n.parseBuffer( data + 5, 7 ) );
+    EXPECT_TRUE( n.parseBuffer( "\"hello\"", 7, true ) );
+}
+
+TEST(CryptosoftJSONParseOutput, EscapedStrings)
+{
+    const char* json = "{\"quote\\\"d\":\"str\\\"ing\\\\\\n\"}";
+    Json n;
+    EXPECT_TRUE( n.parse( json ) );
+    std::ostringstream oss;
+    n.spool( oss );
+    EXPECT_STREQ( json, oss.str().c_str() );
+}
+
+TEST(CryptosoftJSONParse, ParseAgain)
+{
+    Json n;
+    EXPECT_TRUE( n.parse( "[{\"name\":\"fred\"}]" ) );
+    EXPECT_FALSE( n.parse( "[{\"name\":}]" ) );
+    EXPECT_TRUE( n.isNull() );
+    EXPECT_TRUE( n.parse( "{\"age\":20}" ) );
+    EXPECT_EQ( (Json*) 0, n.atXPath( "/[0]/name" ) );
+    Json* result = n.atXPath( "/age" );
+    ASSERT_NE( (Json*) 0, result );
+    EXPECT_EQ( 20, *(result->num) );
+}
+
+TEST(CryptosoftJSONParseMatching, PrecompiledPath)
+{
+    const Json::XPath path( "/[*]/children/[1]/age" );
+    const char* json = "[{\"name\":\"fred\",\"age\":20,\"children\":[{\"name\":\"amy\",\"age\":5},{\"name\":\"john\",\"age\":9}]},{\"name\":\"greg\",\"age\":30,\"children\":[{\"name\":\"petra\",\"age\":11},{\"name\":\"lorna\",\"age\":16}]}]";
+    for (int i = 0; i < 2; ++i)
+    {
+        Json n;
+        EXPECT_TRUE( n.parse( json ) );
+        std::vector< Json* > result;
+        n.allAtXPath( path, result );
+        ASSERT_EQ( 2u, result.size() );
+        EXPECT_EQ( 9, *(result[0]->num) );
+        EXPECT_EQ( 16, *(result[1]->num) );
+        ASSERT_EQ( result[0], n.atXPath( path ) );
+    }
+}
+
+TEST(CryptosoftJSONParseMatching, DeepPath)
+{
+    std::string json;
+    std::string path;
+    for (int i = 0; i < 20; ++i)
+    {
+        json.append( "{\"a\":" );
+        path.append( "/a" );
+    }
+    json.append( "42" );
+    json.append( 20, '}' );
+
+    Json n;
+    EXPECT_TRUE( n.parse( json ) );
+    Json* result = n.atXPath( path );
+    ASSERT_TRUE( result != 0 );
+    EXPECT_EQ( 42, *(result->num) );
+    EXPECT_TRUE( n.atXPath( path + "/a" ) == 0 );
+}
+
+TEST(CryptosoftJSONParseNumbers, ExactAndRounded)
+{
+    const char* json = "[0.1,-2.5,123456789012345678,1e3,0.000001,-0,3.14159265358979323846]";
+    Json n;
+    EXPECT_TRUE( n.parse( json ) );
+    EXPECT_EQ( 0.1, *(n.atXPath( "/[0]" )->num) );
+    EXPECT_EQ( -2.5, *(n.atXPath( "/[1]" )->num) );
+    EXPECT_EQ( 123456789012345678.0, *(n.atXPath( "/[2]" )->num) );
+    EXPECT_EQ( 1000, *(n.atXPath( "/[3]" )->num) );
+    EXPECT_EQ( 0.000001, *(n.atXPath( "/[4]" )->num) );
+    EXPECT_EQ( 0, *(n.atXPath( "/[5]" )->num) );
+    EXPECT_EQ( 3.14159265358979323846, *(n.atXPath( "/[6]" )->num) );
+}
+
+// Parse and lookup throughput, run with --gtest_also_run_disabled_tests
+TEST(CryptosoftJSONParseBenchmark, DISABLED_ParseAndMatch)
+{
+    std::string json = "[";
+    for (int i = 0; i < 200; ++i)
+    {
+        std::ostringstream person;
+        person << (i ? "," : "") << "{\"name\":\"person " << i << "\",\"age\":" << 20 + i % 50
+               << ",\"married\":" << (i % 2 ? "true" : "false") << ",\"note\":\"line one\\nline \\\"two\\\"\""
+               << ",\"children\":[{\"name\":\"amy\",\"age\":5},{\"name\":\"john\",\"age\":9}],\"spouse\":null}";
+        json.append( person.str() );
+    }
+    json.append( "]" );
+
+    const int parses = 2000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < parses; ++i)
+    {
+        Json n;
+        ASSERT_TRUE( n.parse( json ) );
+    }
+    double elapsed_s = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    printf( "parse:               %8.1f MB/s\n", parses * json.size() / elapsed_s / 1e6 );
+
+    Json n;
+    ASSERT_TRUE( n.parse( json ) );
+    const int lookups = 200000;
+    double total = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; ++i)
+    {
+        total += *(n.atXPath( "/[150]/children/[1]/age" )->num);
+    }
+    elapsed_s = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    printf( "atXPath:             %8.0f lookups/s\n", lookups / elapsed_s );
+
+    const Json::XPath path( "/[150]/children/[1]/age" );
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; ++i)
+    {
+        total += *(n.atXPath( path )->num);
+    }
+    elapsed_s = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    printf( "precompiled atXPath: %8.0f lookups/s\n", lookups / elapsed_s );
+    EXPECT_EQ( 9.0 * 2 * lookups, total );
+}
@@ -5,63 +5,89 @@
  */
 
 #include "jsonpath.hpp"
-#include <cassert>
 #include <cstdlib>
+#include <cstring>
 
 namespace rapidjson
 {
 
-void allAtXPath( Value* value, const std::string& path, std::vector< Value* >& result )
+XPath::XPath( const std::string& path )
 {
-    if ( path.empty() || path == "/" )
+    // Each level is the text up to the next '/', and the path ends at "" or a trailing "/"
+    size_t start = 0;
+    while ( start < path.size() && !( start + 1 == path.size() && path[start] == '/' ) )
     {
-    	result.push_back( value );
+        size_t pos = path.find_first_of( '/', start + 1 );
+        if ( pos == std::string::npos ){ pos = path.size(); }
+
+        Instruction instruction;
+        instruction.name = path.substr( start + 1, pos - start - 1 );
+        instruction.anyName = instruction.name == "*";
+        instruction.isIndex = instruction.name.size() >= 2 && instruction.name[0] == '[' && instruction.name[instruction.name.size() - 1] == ']';
+        instruction.anyIndex = instruction.name == "[*]";
+        instruction.validIndex = false;
+        instruction.index = 0;
+        if ( instruction.isIndex && !instruction.anyIndex )
+        {
+            int num = atoi( instruction.name.c_str() + 1 );
+            instruction.validIndex = num >= 0;
+            instruction.index = instruction.validIndex ? (SizeType)num : 0;
+        }
+        instructions_.push_back( instruction );
+        start = pos;
     }
-    else if ( value->IsObject() )
-    {
-        std::string tempPath = path;
-        if ( tempPath.empty() ){ tempPath = "/*"; };
+}
+
+void XPath::allAt( Value* value, std::vector< Value* >& result ) const
+{
+    match( value, 0, result );
+}
 
-        size_t pos = tempPath.find_first_of( '/', 1 );
-        std::string level = tempPath.substr( 1, pos-1 );
+void XPath::match( Value* value, size_t step, std::vector< Value* >& result ) const
+{
+    if ( step == instructions_.size() )
+    {
+        result.push_back( value );
+        return;
+    }
 
+    const Instruction& instruction = instructions_[step];
+    if ( value->IsObject() )
+    {
         for ( Value::MemberIterator itr = value->MemberBegin(); itr != value->MemberEnd(); ++itr )
         {
-        	if ( level == itr->name.GetString() || level == "*" )
+            if ( instruction.anyName ||
+                 ( itr->name.GetStringLength() == instruction.name.size() &&
+                   memcmp( itr->name.GetString(), instruction.name.data(), instruction.name.size() ) == 0 ) )
             {
-        		std::string p( tempPath, pos == std::string::npos ? tempPath.size() : pos );
-        		allAtXPath( &itr->value, p, result );
+                match( &itr->value, step + 1, result );
             }
         }
     }
-    else if ( value->IsArray() )
+    else if ( value->IsArray() && instruction.isIndex )
     {
-        std::string tempPath = path;
-
-        if ( tempPath.empty() ){ tempPath = "/[*]"; } // Match all
-
-        if (tempPath.length() < 4 || tempPath[1] != '[' ){ return; }
-
-        size_t pos = tempPath.find_first_of( ']' );
-        if ( pos == std::string::npos ){ return; }
-
-        std::string level = tempPath.substr( 2, pos-2 );
-        if ( level == "*" )
+        if ( instruction.anyIndex )
         {
-        	for ( Value::ValueIterator itr = value->Begin(); itr != value->End(); ++itr )
-        	{
-        		allAtXPath( itr, tempPath.substr(pos+1), result );
-        	}
+            for ( Value::ValueIterator itr = value->Begin(); itr != value->End(); ++itr )
+            {
+                match( itr, step + 1, result );
+            }
         }
-        else
+        else if ( instruction.validIndex && instruction.index < value->Size() )
         {
-            int num = atoi( level.c_str() );
-            assert( num >= 0 );
-            if ( (unsigned int)num >= value->Size() ){ return; }
-
-            allAtXPath( &(*value)[num], tempPath.substr(pos+1), result );
+            match( &(*value)[instruction.index], step + 1, result );
         }
     }
 }
 
+void allAtXPath( Value* value, const std::string& path, std::vector< Value* >& result )
+{
+    XPath( path ).allAt( value, result );
+}
+
+void allAtXPath( Value* value, const XPath& path, std::vector< Value* >& result )
+{
+    path.allAt( value, result );
+}
+
 } //end rapidjson
@@ -8,6 +8,9 @@
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
 #include <string>
 
 using namespace rapidjson;
@@ -74,3 +77,97 @@ TEST(JSONPathMatching, AllSecondChildFields)
     EXPECT_STREQ( "\"john\" 9 \"lorna\" 16 ", buffer.GetString() );
 }
 
+
+TEST(JSONPathMatching, PrecompiledPathReused)
+{
+    const char* json = "[{\"name\":\"fred\",\"age\":20,\"children\":[{\"name\":\"amy\",\"age\":5},{\"name\":\"john\",\"age\":9}]},{\"name\":\"greg\",\"age\":30,\"children\":[{\"name\":\"petra\",\"age\":11},{\"name\":\"lorna\",\"age\":16}]}]";
+    const XPath path( "/[*]/children/[1]/age" );
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        Document parser;
+        EXPECT_FALSE( parser.Parse( json ).HasParseError() );
+        std::vector< Value* > result;
+        allAtXPath( &parser, path, result );
+
+        ASSERT_EQ( 2u, result.size() );
+        EXPECT_EQ( 9, result[0]->GetInt() );
+        EXPECT_EQ( 16, result[1]->GetInt() );
+    }
+}
+
+TEST(JSONPathMatching, RootAndMissing)
+{
+    const char* json = "{\"a\":[{\"b\":1},{\"b\":2}],\"[0]\":3}";
+
+    Document parser;
+    EXPECT_FALSE( parser.Parse( json ).HasParseError() );
+    std::vector< Value* > result;
+    allAtXPath( &parser, "/", result );
+    ASSERT_EQ( 1u, result.size() );
+    EXPECT_EQ( &parser, result[0] );
+
+    result.clear();
+    allAtXPath( &parser, "/a/[1]/b/", result );
+    ASSERT_EQ( 1u, result.size() );
+    EXPECT_EQ( 2, result[0]->GetInt() );
+
+    result.clear();
+    allAtXPath( &parser, "/a/[2]/b", result );
+    allAtXPath( &parser, "/a/b", result );
+    allAtXPath( &parser, "/c", result );
+    EXPECT_TRUE( result.empty() );
+
+    // In an object an index is just a member name
+    allAtXPath( &parser, "/[0]", result );
+    ASSERT_EQ( 1u, result.size() );
+    EXPECT_EQ( 3, result[0]->GetInt() );
+}
+
+// Path throughput over an object of 10k members, run with --gtest_also_run_disabled_tests
+TEST(JSONPathBenchmark, DISABLED_TenThousandMembers)
+{
+    std::string json = "{";
+    for ( int i = 0; i < 10000; ++i )
+    {
+        std::ostringstream member;
+        member << ( i ? "," : "" ) << "\"member" << i << "\":{\"id\":" << i << ",\"value\":\"v" << i << "\"}";
+        json.append( member.str() );
+    }
+    json.append( "}" );
+
+    Document parser;
+    ASSERT_FALSE( parser.Parse( json.c_str() ).HasParseError() );
+
+    const char* paths[] = { "/*/value", "/member9999/value" };
+    const int runs = 200;
+    for ( size_t p = 0; p < sizeof( paths ) / sizeof( paths[0] ); ++p )
+    {
+        std::vector< Value* > result;
+        result.reserve( 10000 );
+
+        // The path string is parsed again on every evaluation
+        const std::string pathString( paths[p] );
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < runs; ++i )
+        {
+            result.clear();
+            allAtXPath( &parser, pathString, result );
+        }
+        double elapsed_s = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+        printf( "%-20s path string: %10.0f evaluations/s\n", paths[p], runs / elapsed_s );
+        const size_t matches = result.size();
+
+        // The path is compiled once, and only evaluated in the loop
+        const XPath compiled( pathString );
+        start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < runs; ++i )
+        {
+            result.clear();
+            allAtXPath( &parser, compiled, result );
+        }
+        elapsed_s = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+        printf( "%-20s precompiled: %10.0f evaluations/s\n", paths[p], runs / elapsed_s );
+        EXPECT_EQ( matches, result.size() );
+    }
+}
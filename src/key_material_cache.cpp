@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Cache of the keys fetched from KeyScaler to decrypt DA encrypted files
+ */
+
+#include <cstring>
+#if defined(WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // #if defined(WIN32)
+#include <openssl/crypto.h>
+#include "key_material_cache.hpp"
+#include "log.hpp"
+
+namespace
+{
+    /// @brief Allocate whole pages for the secrets, locked in memory and left out of core dumps where possible
+    void *allocateLocked(size_t &size)
+    {
+#if defined(WIN32)
+        SYSTEM_INFO system_info;
+        GetSystemInfo(&system_info);
+        const size_t page_size = system_info.dwPageSize;
+        size = (size + page_size - 1) / page_size * page_size;
+        void *p_block = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (p_block != nullptr && !VirtualLock(p_block, size))
+        {
+            Log::getInstance()->printf(Log::Warning, " %s Unable to lock the key cache in memory", __func__);
+        }
+#else
+        const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        size = (size + page_size - 1) / page_size * page_size;
+        void *p_block = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p_block == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        if (mlock(p_block, size) != 0)
+        {
+            Log::getInstance()->printf(Log::Warning, " %s Unable to lock the key cache in memory", __func__);
+        }
+#if defined(MADV_DONTDUMP)
+        madvise(p_block, size, MADV_DONTDUMP);
+#endif // #if defined(MADV_DONTDUMP)
+#endif // #if defined(WIN32)
+        return p_block;
+    }
+
+    void freeLocked(void *p_block, size_t size)
+    {
+        OPENSSL_cleanse(p_block, size);
+#if defined(WIN32)
+        VirtualUnlock(p_block, size);
+        VirtualFree(p_block, 0, MEM_RELEASE);
+#else
+        munlock(p_block, size);
+        munmap(p_block, size);
+#endif // #if defined(WIN32)
+    }
+} // namespace
+
+const size_t KeyMaterialCache::CAPACITY;
+const size_t KeyMaterialCache::MAX_SECRET_BYTES;
+
+KeyMaterialCache *KeyMaterialCache::getInstance()
+{
+    static KeyMaterialCache instance;
+    return &instance;
+}
+
+KeyMaterialCache::KeyMaterialCache() : mp_secrets(nullptr), m_secrets_size(sizeof(Secret) * CAPACITY)
+{
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        m_entries[i].in_use = false;
+        m_entries[i].mtime = 0;
+    }
+    mp_secrets = (Secret *)allocateLocked(m_secrets_size);
+    if (mp_secrets == nullptr)
+    {
+        Log::getInstance()->printf(Log::Error, " %s Unable to allocate the key cache, keys will not be cached", __func__);
+    }
+}
+
+KeyMaterialCache::~KeyMaterialCache()
+{
+    if (mp_secrets != nullptr)
+    {
+        freeLocked(mp_secrets, m_secrets_size);
+    }
+}
+
+bool KeyMaterialCache::lookup(const std::string &path, time_t mtime, const std::string &key_id, std::string &key, std::string &iv)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        Entry &entry = m_entries[i];
+        if (!entry.in_use)
+        {
+            continue;
+        }
+        if (entry.expires <= now)
+        {
+            evict(i);
+            continue;
+        }
+        if (entry.mtime == mtime && entry.path == path && entry.key_id == key_id)
+        {
+            const Secret &secret = mp_secrets[i];
+            key.assign((const char *)secret.key, secret.key_size);
+            iv.assign((const char *)secret.iv, secret.iv_size);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool KeyMaterialCache::insert(const std::string &path, time_t mtime, const std::string &key_id, const std::string &key, const std::string &iv, unsigned int ttl_seconds)
+{
+    if (ttl_seconds == 0 || key.size() > MAX_SECRET_BYTES || iv.size() > MAX_SECRET_BYTES)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (mp_secrets == nullptr)
+    {
+        return false;
+    }
+
+    // Reuse the entry of the same file, otherwise a free one, otherwise the one closest to expiry
+    size_t index = CAPACITY;
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        const Entry &entry = m_entries[i];
+        if (entry.in_use && entry.path == path)
+        {
+            index = i;
+            break;
+        }
+        if (index == CAPACITY || (m_entries[index].in_use && (!entry.in_use || entry.expires < m_entries[index].expires)))
+        {
+            index = i;
+        }
+    }
+    evict(index);
+
+    Entry &entry = m_entries[index];
+    entry.in_use = true;
+    entry.path = path;
+    entry.mtime = mtime;
+    entry.key_id = key_id;
+    entry.expires = std::chrono::steady_clock::now() + std::chrono::seconds(ttl_seconds);
+
+    Secret &secret = mp_secrets[index];
+    memcpy(secret.key, key.c_str(), key.size());
+    secret.key_size = key.size();
+    memcpy(secret.iv, iv.c_str(), iv.size());
+    secret.iv_size = iv.size();
+    return true;
+}
+
+void KeyMaterialCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        evict(i);
+    }
+}
+
+size_t KeyMaterialCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = 0;
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        if (m_entries[i].in_use)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void KeyMaterialCache::evict(size_t index)
+{
+    Entry &entry = m_entries[index];
+    if (!entry.in_use)
+    {
+        return;
+    }
+    if (mp_secrets != nullptr)
+    {
+        OPENSSL_cleanse(&mp_secrets[index], sizeof(Secret));
+    }
+    entry.in_use = false;
+    entry.path.clear();
+    entry.key_id.clear();
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Pool of key pairs generated in the background, ready for CSRs
+ */
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // #if defined(__linux__)
+#include <openssl/crypto.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include "evp_crypto.hpp"
+#include "key_pool.hpp"
+#include "log.hpp"
+
+namespace
+{
+    const size_t SEAL_KEY_BYTES = 32;
+
+    void cleanse(std::string &secret)
+    {
+        if (!secret.empty())
+        {
+            OPENSSL_cleanse(&secret[0], secret.size());
+        }
+        secret.clear();
+    }
+
+    bool randomBytes(size_t size, std::string &bytes)
+    {
+        bytes.resize(size);
+        return RAND_bytes((unsigned char *)&bytes[0], (int)size) == 1;
+    }
+} // namespace
+
+KeyPool *KeyPool::getInstance()
+{
+    static KeyPool instance;
+    return &instance;
+}
+
+KeyPool::KeyPool() : m_size(0), m_stopping(false)
+{
+}
+
+KeyPool::~KeyPool()
+{
+    stop();
+}
+
+bool KeyPool::start(const std::vector<KeySpec> &specs, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (specs.empty() || size == 0 || m_thread.joinable())
+    {
+        return false;
+    }
+    if (!randomBytes(SEAL_KEY_BYTES, m_seal_key))
+    {
+        Log::getInstance()->printf(Log::Error, " %s Failed to generate the pool key", __func__);
+        return false;
+    }
+
+    for (auto spec_iter = specs.begin(); spec_iter != specs.end(); ++spec_iter)
+    {
+        m_keys[*spec_iter];
+        Log::getInstance()->printf(Log::Information, " %s Keeping %lu %s keys ready", __func__, (unsigned long)size, spec_iter->name().c_str());
+    }
+    m_size = size;
+    m_stopping = false;
+    m_thread = std::thread(&KeyPool::run, this);
+    return true;
+}
+
+void KeyPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys.clear();
+    cleanse(m_seal_key);
+}
+
+bool KeyPool::take(const KeySpec &spec, std::string &private_key, EVP_PKEY **pp_key)
+{
+    SealedKey sealed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto keys_iter = m_keys.find(spec);
+        if (keys_iter == m_keys.end() || keys_iter->second.empty())
+        {
+            return false;
+        }
+        sealed = std::move(keys_iter->second.front());
+        keys_iter->second.pop_front();
+    }
+    // Replace the key taken
+    m_wake.notify_one();
+
+    std::string pem;
+    if (!unseal(sealed, pem))
+    {
+        Log::getInstance()->printf(Log::Error, " %s Failed to decrypt a pooled %s key", __func__, spec.name().c_str());
+        return false;
+    }
+
+    BIO *p_bio = BIO_new_mem_buf((void *)pem.c_str(), (int)pem.size());
+    EVP_PKEY *p_key = p_bio ? PEM_read_bio_PrivateKey(p_bio, nullptr, nullptr, nullptr) : nullptr;
+    BIO_free_all(p_bio);
+    if (p_key == nullptr)
+    {
+        Log::getInstance()->printf(Log::Error, " %s Failed to read a pooled %s key", __func__, spec.name().c_str());
+        cleanse(pem);
+        return false;
+    }
+
+    *pp_key = p_key;
+    private_key.swap(pem);
+    return true;
+}
+
+size_t KeyPool::available(const KeySpec &spec) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto keys_iter = m_keys.find(spec);
+    return keys_iter == m_keys.end() ? 0 : keys_iter->second.size();
+}
+
+bool KeyPool::findShortfall(KeySpec &spec) const
+{
+    for (auto keys_iter = m_keys.begin(); keys_iter != m_keys.end(); ++keys_iter)
+    {
+        if (keys_iter->second.size() < m_size)
+        {
+            spec = keys_iter->first;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool KeyPool::seal(const std::string &private_key, SealedKey &sealed) const
+{
+    return randomBytes(evp_crypto::AES_BLOCK_BYTES, sealed.iv) &&
+           evp_crypto::cipherAES(m_seal_key.c_str(), m_seal_key.size(), sealed.iv.c_str(), sealed.iv.size(),
+                                 private_key.c_str(), private_key.size(), CipherModeEncrypt, sealed.ciphertext);
+}
+
+bool KeyPool::unseal(const SealedKey &sealed, std::string &private_key) const
+{
+    std::string seal_key;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        seal_key = m_seal_key;
+    }
+    const bool unsealed = evp_crypto::cipherAES(seal_key.c_str(), seal_key.size(), sealed.iv.c_str(), sealed.iv.size(),
+                                                sealed.ciphertext.c_str(), sealed.ciphertext.size(), CipherModeDecrypt, private_key);
+    cleanse(seal_key);
+    return unsealed;
+}
+
+void KeyPool::run()
+{
+#if defined(__linux__)
+    // Keys are generated when nothing else wants the CPU
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif // #if defined(__linux__)
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        KeySpec spec = DEFAULT_CSR_KEY_SPEC;
+        m_wake.wait(lock, [this, &spec]() { return m_stopping || findShortfall(spec); });
+        if (m_stopping)
+        {
+            return;
+        }
+
+        lock.unlock();
+        std::string private_key;
+        SealedKey sealed;
+        EVP_PKEY *p_key = SSLWrapper::generatePrivateKey(spec);
+        const bool generated = p_key != nullptr && SSLWrapper::writePrivateKey(p_key, private_key) && seal(private_key, sealed);
+        EVP_PKEY_free(p_key);
+        cleanse(private_key);
+        lock.lock();
+
+        if (!generated)
+        {
+            // Callers generate their own keys from now on
+            Log::getInstance()->printf(Log::Error, " %s Failed to generate a %s key, no more keys will be pooled", __func__, spec.name().c_str());
+            return;
+        }
+        m_keys[spec].push_back(std::move(sealed));
+    }
+}
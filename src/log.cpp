@@ -106,7 +106,8 @@ Log::Log(bool _verbose) : m_verbose(_verbose)
     m_full_filename = full_path_of_file;
     m_file_size = 0;
     m_max_file_size = MAX_FILE_SIZE;
-    initialise(m_process_name, full_path_of_file, m_max_file_size, syslog_host, syslog_port);
+    // Already holding the lock taken by getInstance()
+    open(m_process_name, full_path_of_file, m_max_file_size, syslog_host, syslog_port);
 }
 
 Log::~Log()
@@ -124,6 +125,16 @@ Log::~Log()
 }
 
 bool Log::initialise(const std::string& processName, const std::string& fullPathOfFile, unsigned long maxFileSize, std::string syslogHost, unsigned int syslogPort)
+{
+    // Called again on a configuration reload, while other threads are logging
+    lock();
+    const bool initialised = open(processName, fullPathOfFile, maxFileSize, syslogHost, syslogPort);
+    unlock();
+
+    return initialised;
+}
+
+bool Log::open(const std::string& processName, const std::string& fullPathOfFile, unsigned long maxFileSize, const std::string& syslogHost, unsigned int syslogPort)
 {
     m_max_file_size = maxFileSize;
     m_process_name = processName;
@@ -218,9 +229,14 @@ void Log::checkAndRotateLogFile(void)
     }
 }
 
+bool Log::isEnabled(Severity level) const
+{
+    return (level < Debug) || WRITE_DEBUG || m_verbose;
+}
+
 void Log::printf(Severity level, const char *text, ...)
 {
-    if ((level < Debug) || WRITE_DEBUG || m_verbose)
+    if (isEnabled(level))
     {
         Log::lock();
 
@@ -18,7 +18,9 @@
 #include "win_cert_store_factory.hpp"
 #else
 #include <getopt.h>
+#include <limits.h>
 #include <netinet/in.h>
+#include <stdlib.h>
 #include <unistd.h>
 #endif // #if defined(WIN32)
 #include <pthread.h>
@@ -31,6 +33,7 @@
 #include "http_worker_loop.hpp"
 #include "event_manager.hpp"
 #include "app_utils.hpp"
+#include "key_pool.hpp"
 #include "ssl_wrapper.hpp"
 
 #ifndef DISABLE_MQTT
@@ -108,6 +111,15 @@ void signal_callback_handler(int signum)
         mp_worker_loop->interrupt();
     }
 }
+
+// Called on SIGHUP, the worker loop reads the configuration file again when it next wakes
+void reload_signal_handler(int signum)
+{
+    if (mp_worker_loop)
+    {
+        mp_worker_loop->requestReload();
+    }
+}
 #endif // #ifndef WIN32
 
 static int showUsage(char *argv0)
@@ -128,36 +140,6 @@ static int showUsage(char *argv0)
     return 0;
 }
 
-/// @brief Initialise the logger
-/// @param p_logger The logger to initialise
-/// @param config Container of the configuration file parameters
-/// @return True if configured to use a file, else false
-bool initialise_logger(Log *p_logger, const Configuration &config)
-{
-    // Empty string means logging is off
-    std::string log_file_name;
-    // Empty string means syslog logging is off
-    std::string syslog_host;
-    // 514 is default syslog port
-    unsigned int syslog_port = 514;
-
-    if (config.exists(CFG_SYSLOGHOST))
-    {
-        syslog_host.append(config.lookup(CFG_SYSLOGHOST));
-    }
-    if (config.exists(CFG_SYSLOGPORT))
-    {
-        syslog_port = config.lookupAsLong(CFG_SYSLOGPORT);
-    }
-    if (config.exists(CFG_LOGFILENAME))
-    {
-        log_file_name.append(config.lookup(CFG_LOGFILENAME));
-    }
-
-    unsigned long max_log_size = config.lookupAsLong(CFG_ROTATELOGAFTER);
-    return p_logger->initialise(std::string("credentialmanager"), log_file_name, max_log_size, syslog_host, syslog_port);
-}
-
 int main(int argc, char *argv[])
 {
     // By default will run as a daemon
@@ -327,6 +309,15 @@ int main(int argc, char *argv[])
     }
 #endif // #if defined(WIN32)
 
+#ifndef WIN32
+    // Keep the full path, as a daemon changes its working directory and the file is read again on a reload
+    char full_path[PATH_MAX];
+    if (realpath(config_filename_arg.c_str(), full_path))
+    {
+        config_filename_arg.assign(full_path);
+    }
+#endif // #ifndef WIN32
+
     // Read in the configuration
     // Configuration file is provided in the command argument
     if (!config.parse(config_filename_arg.c_str()))
@@ -362,7 +353,7 @@ int main(int argc, char *argv[])
     }
 
     // If running as a daemon, can't log to stdout as it will be closed
-    if (!initialise_logger(p_logger, config) && daemonise)
+    if (!app_utils::initialise_logger(p_logger, config) && daemonise)
     {
         std::cerr << "No log setup, please check configuration." << std::endl;
 
@@ -459,6 +450,10 @@ int main(int argc, char *argv[])
 #else
         // Ignore SIGPIPE signals
         signal(SIGPIPE, SIG_IGN);
+
+        // Reload the configuration on SIGHUP or when the file changes
+        signal(SIGHUP, reload_signal_handler);
+        mp_worker_loop->watchConfiguration(config.path());
 #endif // #if defined(WIN32)
 
         p_logger->printf(Log::Debug, "Created DeviceAuthority instance.");
@@ -484,10 +479,15 @@ int main(int argc, char *argv[])
             p_event_manager->notifyStartup(p_da_instance->getUDI());
         }
 
+        // Keep key pairs ready for CSRs when configured to
+        app_utils::start_key_pool(p_logger, config);
+
         mp_worker_loop->initialize();
         mp_worker_loop->run();
         mp_worker_loop->terminate();
 
+        KeyPool::getInstance()->stop();
+
         // Teardown EventManager
         p_event_manager->notifyShutdown(p_da_instance->getUDI());
         p_da_instance->setEventManager(nullptr);
@@ -9,6 +9,8 @@
 #include <string>
 #include "json_utils.hpp"
 #include "message_factory.hpp"
+#include "script_result_writer.hpp"
+#include "script_utils.hpp"
 #include "utils.hpp"
 
 const std::string MessageFactory::buildAcknowledgeMessage(const std::string &asset_id, bool success, const std::string &failure_reason)
@@ -104,40 +106,9 @@ const std::string MessageFactory::buildAuthenticationMessage(const std::string &
 
 const std::string MessageFactory::buildScriptResultMessage(const std::string &logs_type, bool compress, const std::string &script_output)
 {
-    rapidjson::Document root_document;
-    root_document.SetObject();
-    rapidjson::Document::AllocatorType& allocator = root_document.GetAllocator();
-
-    // Add sub-object containing base64 encoded data
-    std::string data_b64;
-    {
-        rapidjson::Document data;
-        data.SetObject();
-        data.AddMember("device_info", "", allocator);
-
-        const std::string script_output_json = buildScriptOutputJson(script_output);
-
-        rapidjson::Document device_logs;
-        data.AddMember("device_logs", device_logs.Parse<0>(script_output_json.c_str()), allocator);
-
-        rapidjson::StringBuffer strbuf;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
-        data.Accept(writer);
-
-        data_b64 = utils::toBase64(compress ? utils::deflate(strbuf.GetString()) : strbuf.GetString());
-    }
-
-    rapidjson::Value device_logs(rapidjson::kObjectType);
-    device_logs.AddMember("type", rapidjson::StringRef(logs_type.c_str()), allocator);
-    device_logs.AddMember("compression", rapidjson::StringRef(compress ? "zlib" : "none"), allocator);
-    device_logs.AddMember("data", rapidjson::StringRef(data_b64.c_str()), allocator);
-    root_document.AddMember("device_logs", device_logs, allocator);
-
-    rapidjson::StringBuffer strbuf;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
-    root_document.Accept(writer);
-
-    return std::string(strbuf.GetString());
+    ScriptResultWriter writer(logs_type, compress, script_utils::configuredLimits().max_output_bytes);
+    writer.append(script_output.data(), script_output.size());
+    return writer.finish();
 }
 
 const std::string MessageFactory::buildScriptOutputJson(const std::string &script_output)
@@ -275,142 +246,103 @@ const std::string MessageFactory::generateMqttPayload(
         const char *csr,
         const char *keyId)
 {
-    std::stringstream ss;
-    // Begin JSON message
-    std::string payload = "{";
-    std::string reqIdKey = "\"reqId\":\"" + utils::generateUUID() + "\",";
-#ifdef WIN32
-    std::time_t t = std::time(0);
-#else
-    time_t t = time(0);
-#endif // #ifdef WIN32
-
-    ss << t;
-
-    std::string tsKey = "\"ts\":" + ss.str() + ",";
-    std::string udiKey = "\"device\":\"" + udi + "\",";
-    std::string opKey = "\"op\":\"" + op + "\",";
-    std::string userAgentKey = "\"userAgent\":\"" + user_agent + "\",";
-    std::string userIdKey = "\"userId\":\"" + user_id + "\",";
-    // Begin "req" key
-    std::string reqKey = "\"req\":{";
-
-    payload += reqIdKey + tsKey + udiKey + opKey + reqKey;
-
-    std::string policyId = "";
-    std::string keyID = "";
-    std::string type = "\"type\":";
+    rapidjson::StringBuffer strbuf(nullptr, MQTT_PAYLOAD_CAPACITY);
+    rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
+
+    writer.StartObject();
+    JsonUtils::writeMember(writer, "reqId", utils::generateUUID());
+    writer.Key("ts");
+    writer.Int64((int64_t)time(0));
+    JsonUtils::writeMember(writer, "device", udi);
+    JsonUtils::writeMember(writer, "op", op);
 
+    writer.Key("req");
+    writer.StartObject();
     if (op.compare("ch") == 0)
     {
-        type = type + "\"challenge\",";
-        payload += type;
-        payload += userAgentKey;
-
-        std::string chTypeKey = "\"challengeType\":";
-
-        chTypeKey += "\"" + challenge_type + "\",";
-        payload += chTypeKey;
-        payload += userIdKey;
+        JsonUtils::writeMember(writer, "type", "challenge");
+        JsonUtils::writeMember(writer, "userAgent", user_agent);
+        JsonUtils::writeMember(writer, "challengeType", challenge_type);
+        JsonUtils::writeMember(writer, "userId", user_id);
         // Request challenge with generic IdKey or DDK
-        payload += "\"deviceKey\":\"";
-        payload += (utils::isNull(deviceKey)? "" : deviceKey);
-        payload += "\",";
+        JsonUtils::writeMember(writer, "deviceKey", deviceKey);
         if (challenge_type.compare("auth") == 0)
         {
             // Request challenge with TID
-            payload += "\"tid\":\"";
-            payload += (utils::isNull(data)? "" : data);
-            payload += "\",";
+            JsonUtils::writeMember(writer, "tid", data);
         }
-
-        std::string encryptPolicyIdKey = "\"encryptPolicyId\":\"" + policyId + "\"";
-
-        payload += encryptPolicyIdKey;
+        JsonUtils::writeMember(writer, "encryptPolicyId", "");
     }
     else if (op.compare("register") == 0)
     {
-        type = type + "\"register\",";
-        payload += type;
-        payload += userAgentKey;
-        payload += userIdKey;
-        payload += "\"deviceKey\":\"";
-        payload += (utils::isNull(deviceKey)? "" : deviceKey);
-        payload += "\",";
-        payload += "\"displayName\":\"" + udi + "\"";
+        JsonUtils::writeMember(writer, "type", "register");
+        JsonUtils::writeMember(writer, "userAgent", user_agent);
+        JsonUtils::writeMember(writer, "userId", user_id);
+        JsonUtils::writeMember(writer, "deviceKey", deviceKey);
+        JsonUtils::writeMember(writer, "displayName", udi);
     }
     else if (op.compare("auth") == 0)
     {
-        if (challenge_type.compare("auth-get-key") == 0)
+        // Auth & Get key, otherwise Auth Basic
+        const bool get_key = challenge_type.compare("auth-get-key") == 0;
+        JsonUtils::writeMember(writer, "type", get_key ? "auth-get-key" : "auth");
+        JsonUtils::writeMember(writer, "userAgent", user_agent);
+        JsonUtils::writeMember(writer, "userId", user_id);
+        JsonUtils::writeMember(writer, "deviceKey", deviceKey);
+        if (get_key)
         {
-            // Auth & Get key
-            type = type + "\"auth-get-key\",";
+            JsonUtils::writeMember(writer, "keyId", keyId);
         }
-        else
+    }
+    else if (op.compare("asset-status") == 0)
+    {
+        JsonUtils::writeMember(writer, "type", "asset-status");
+        writeDFactorAuthentication(writer, user_agent, user_id, deviceKey);
+
+        // The members of the receipt are added to the request
+        rapidjson::Document receipt_document;
+        receipt_document.Parse<0>(utils::isNull(data) ? "{}" : data);
+        if (!receipt_document.HasParseError() && receipt_document.IsObject())
         {
-            // Auth Basic
-            type = type + "\"auth\",";
+            for (auto itr = receipt_document.MemberBegin(); itr != receipt_document.MemberEnd(); ++itr)
+            {
+                writer.Key(itr->name.GetString(), itr->name.GetStringLength());
+                itr->value.Accept(writer);
+            }
         }
-        payload += type;
-        payload += userAgentKey;
-        payload += userIdKey;
-        payload += "\"deviceKey\":\"";
-        payload += (utils::isNull(deviceKey)? "" : deviceKey);
-        payload += "\"";
-        if (challenge_type == "auth-get-key")
+        else
         {
-            payload += ",";
-            payload += "\"keyId\":\"";
-            payload += (utils::isEmpty(keyId)? "" : keyId);
-            payload += "\"";
+            Log::getInstance()->printf(Log::Error, " %s Ignoring bad JSON in asset status data: %s", __func__, data);
         }
     }
-    else if (op.compare("asset-status") == 0)
-    {
-        type = type + "\"asset-status\",";
-        payload += type;
-
-        std::string dfactor_auth = "\"dFactorAuthentication\":{";
-
-        payload += dfactor_auth;
-        payload += userIdKey;
-        payload += "\"deviceKey\":\"";
-        payload += (utils::isNull(deviceKey)? "" : deviceKey);
-        payload += "\",";
-        payload += "\"domainPublicIP\":\"\",";
-        payload += userAgentKey;
-        payload += "},";
-        payload += data;
-    }
     else if (op.compare("device-csr") == 0)
     {
-        type = type + "\"csr\",";
-        payload += type;
-
-        std::string dfactor_auth = "\"dFactorAuthentication\":{";
-
-        payload += dfactor_auth;
-        payload += userIdKey;
-        payload += "\"deviceKey\":\"";
-        payload += (utils::isNull(deviceKey)? "" : deviceKey);
-        payload += "\",";
-        payload += "\"domainPublicIP\":\"\",";
-        payload += userAgentKey;
-        payload += "},";
-        // End of dFactorAuthentication
-        payload += "\"certificateId\":\"";
-        payload.append(assetId);
-        payload += "\",";
-        payload += "\"csr\":\"";
-        payload.append(csr);
-        payload += "\"";
+        JsonUtils::writeMember(writer, "type", "csr");
+        writeDFactorAuthentication(writer, user_agent, user_id, deviceKey);
+        JsonUtils::writeMember(writer, "certificateId", assetId);
+        JsonUtils::writeMember(writer, "csr", csr);
     }
-    payload += "},";
-    // End "req" key
-    payload += "\"tenant\":\"tenant\"";
-    payload += "}";
+    writer.EndObject();
 
-    return payload;
+    JsonUtils::writeMember(writer, "tenant", "tenant");
+    writer.EndObject();
+
+    return std::string(strbuf.GetString(), strbuf.GetSize());
+}
+
+void MessageFactory::writeDFactorAuthentication(
+    rapidjson::Writer<rapidjson::StringBuffer> &writer,
+    const std::string &user_agent,
+    const std::string &user_id,
+    const char *deviceKey)
+{
+    writer.Key("dFactorAuthentication");
+    writer.StartObject();
+    JsonUtils::writeMember(writer, "userId", user_id);
+    JsonUtils::writeMember(writer, "deviceKey", deviceKey);
+    JsonUtils::writeMember(writer, "domainPublicIP", "");
+    JsonUtils::writeMember(writer, "userAgent", user_agent);
+    writer.EndObject();
 }
 
 void MessageFactory::mergeDocuments(rapidjson::Value &target, rapidjson::Value &source, rapidjson::Value::AllocatorType &allocator)
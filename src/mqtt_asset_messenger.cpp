@@ -8,7 +8,7 @@
 #ifndef DISABLE_MQTT
 
 #include <string>
-#include "base64.h"
+#include "base64.hpp"
 #include "configuration.hpp"
 #include "constants.hpp"
 #include "deviceauthority.hpp"
@@ -48,8 +48,9 @@ bool MqttAssetMessenger::acknowledgeReceipt(const std::string &receipt_json, std
     }
 
     const std::string tid = p_da_instance->getDeviceTid();
-    const std::string udi = config.lookup(CFG_UDI);
-    const std::string user_agent = p_da_instance->userAgentString();
+    static const Configuration::Key udiKey = config.key(CFG_UDI);
+    const std::string udi = config.lookup(udiKey);
+    const std::string &user_agent = p_da_instance->userAgentString();
     const std::string user_id = p_da_instance->getUserId();
     const std::string json_request = MessageFactory::generateMqttPayload("asset-status", udi, user_agent, user_id, "", nullptr, receipt_json.c_str());
 
@@ -72,8 +73,9 @@ bool MqttAssetMessenger::submitCSRForSigning(
     }
 
     const std::string tid = p_da_instance->getDeviceTid();
-    const std::string udi = config.lookup(CFG_UDI);
-    const std::string user_agent = p_da_instance->userAgentString();
+    static const Configuration::Key udiKey = config.key(CFG_UDI);
+    const std::string udi = config.lookup(udiKey);
+    const std::string &user_agent = p_da_instance->userAgentString();
     const std::string user_id = p_da_instance->getUserId();
     const std::string json_request = MessageFactory::generateMqttPayload("ch", udi, user_agent, user_id, "auth", "", (char*)tid.c_str(), certificate_id.c_str(), generated_csr.c_str());
 
@@ -82,7 +84,7 @@ bool MqttAssetMessenger::submitCSRForSigning(
     return true;
 }
 
-bool MqttAssetMessenger::fetchFile(const std::string &apiurl, const std::string &response_file_path)
+bool MqttAssetMessenger::fetchFile(const std::string &apiurl, const std::string &response_file_path, std::string &sha256)
 {
     Log *p_logger = Log::getInstance();
     p_logger->printf(Log::Error, "fetchFile not supported using MQTT protocol");
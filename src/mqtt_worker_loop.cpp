@@ -7,6 +7,7 @@
 #ifndef DISABLE_MQTT
 
 #include <list>
+#include <mutex>
 #include <queue>
 #include "asset_manager.hpp"
 #include "certificate_asset_processor.hpp"
@@ -14,6 +15,7 @@
 #include "configuration.hpp"
 #include "damqttclient.hpp"
 #include "deviceauthority.hpp"
+#include "json_arena.hpp"
 #include "message_factory.hpp"
 #include "mosquitto.h"
 #include "mqtt_asset_messenger.hpp"
@@ -51,9 +53,20 @@ struct ScriptData
     }
 };
 
+/// @brief Get the topic specific to the device, hashing its TID only when the TID has changed
 static const std::string getDeviceSpecificTopic(const std::string &tid)
 {
-    return SSLWrapper::md5hashstring(tid);
+    static std::mutex topic_mutex;
+    static std::string topic_tid;
+    static std::string topic;
+
+    std::lock_guard<std::mutex> lock(topic_mutex);
+    if (topic.empty() || tid != topic_tid)
+    {
+        topic_tid = tid;
+        topic = SSLWrapper::md5hashstring(tid);
+    }
+    return topic;
 }
 
 static void subscribeForScripts(DAMqttClientBase *p_mqtt_client)
@@ -248,6 +261,10 @@ void *mqttCredentialManagerLoop(void *p_param)
 
     WorkerState state = CH_AUTH;
 
+    // Each message is copied into the same buffer and parsed in place into the same memory
+    JsonArena json_arena;
+    std::string json_buffer;
+
     bool running = true;
     while (running)
     {
@@ -258,8 +275,8 @@ void *mqttCredentialManagerLoop(void *p_param)
 
             p_logger->printf(Log::Debug, "MQTT JSON response: %s", p_mqtt_message->m_msg.c_str());
 
-            rapidjson::Document json;
-            json.Parse(p_mqtt_message->m_msg.c_str());
+            json_buffer.assign(p_mqtt_message->m_msg);
+            rapidjson::Document &json = json_arena.parse(json_buffer);
             if (json.HasParseError())
             {
                 p_logger->printf(Log::Error, "Bad JSON response");
@@ -472,6 +489,7 @@ void *mqttCredentialManagerLoop(void *p_param)
                             p_logger->printf(Log::Information, "Device registration successful");
 
                             // reload TID as it will have changed post-registration
+                            p_da_instance->invalidateIdentity();
                             p_mqtt_client->setTid(p_da_instance->getDeviceTid());
 
                             if (!p_mqtt_client->isSubscribedForScripts())
@@ -548,6 +566,7 @@ void *mqttCredentialManagerLoop(void *p_param)
                     sleep_ms(interval);
                     total_sleep += interval;
                     asset_manager.update();
+                    p_worker_loop->reloadConfigurationIfRequested();
                 }
             }
 
@@ -571,6 +590,7 @@ void *mqttCredentialManagerLoop(void *p_param)
                 sleep_ms(interval);
                 total_sleep += interval;
                 asset_manager.update();
+                p_worker_loop->reloadConfigurationIfRequested();
 
                 if (p_mqtt_client->isMessageQueued())
                 {
@@ -10,13 +10,19 @@
 #include "configuration.hpp"
 #include "log.hpp"
 #include "constants.hpp"
+#include "evp_crypto.hpp"
+#include "json_arena.hpp"
+#include "rapidjson/writer.h"
 #include <sstream>
 #include <cassert>
+#include <cctype>
 #include <cstdlib>
 #include <vector>
 
 
 POLICYMAP PolicyStore::policies_;
+std::string PolicyStore::policyVersion_;
+std::string PolicyStore::policiesDigest_;
 #if defined(USETHREADING)
 #if !defined(PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP)
 pthread_mutex_t PolicyStore::mutex_ = PTHREAD_MUTEX_INITIALIZER;
@@ -28,6 +34,26 @@ time_t PolicyStore::timestamp_ = 0;
 bool PolicyStore::forceStale_ = true;
 PolicyStore *PolicyStore::gPolicyStoreInstance = NULL;
 
+namespace
+{
+    // Whether the string can be put in a query string as it is
+    bool isUrlSafe(const std::string& value)
+    {
+        if (value.empty())
+        {
+            return false;
+        }
+        for (std::string::const_iterator i = value.begin(); i != value.end(); ++i)
+        {
+            if (!isalnum((unsigned char)*i) && (*i != '-') && (*i != '.') && (*i != '_') && (*i != '~'))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
 PolicyStore *PolicyStore::getPolicyStoreInstance(const std::string& protocol, bool loadPolicies)
 {
 #if defined(USETHREADING)
@@ -94,7 +120,7 @@ void PolicyStore::clear(void)
 #if defined(USETHREADING)
     pthread_mutex_lock(&mutex_);
 #endif // #if defined(USETHREADING)
-    policies_.clear();
+    forgetPolicies();
 #if defined(USETHREADING)
     pthread_mutex_unlock(&mutex_);
 #endif // #if defined(USETHREADING)
@@ -706,18 +732,18 @@ bool PolicyStore::processPolicy(const rapidjson::Value& jsonPolicy, std::string&
 
 bool PolicyStore::processCryptoPolicies(std::string cryptoPolicies, std::string& error)
 {
-    rapidjson::Document json;
     Log* logger = Log::getInstance();
 
-    json.Parse<0>(cryptoPolicies.c_str());
+    // The policies are parsed in place, their copy is logged first
+    logger->printf(Log::Debug, " %s: JSON string %s", __func__, cryptoPolicies.c_str());
+    const rapidjson::Document &json = jsonArena_.parse(cryptoPolicies);
     if (json.HasParseError())
     {
-        logger->printf(Log::Error, " %s: Bad JSON string %s", __func__, cryptoPolicies.c_str());
+        logger->printf(Log::Error, " %s: Bad JSON string: error %d at offset %lu", __func__,
+                       (int)json.GetParseError(), (unsigned long)json.GetErrorOffset());
 
         return false;
     }
-    logger->printf(Log::Debug, " %s: JSON string %s", __func__, cryptoPolicies.c_str());
-    policies_.clear();
     if (json.HasMember(JSON_STATUS_CODE))
     {
         const rapidjson::Value& statusCodeVal = json[JSON_STATUS_CODE];
@@ -725,6 +751,7 @@ bool PolicyStore::processCryptoPolicies(std::string cryptoPolicies, std::string&
 
         if (statusCode != 0)
         {
+            forgetPolicies();
             if (json.HasMember(JSON_MESSAGE))
             {
                 const rapidjson::Value& msgVal = json[JSON_MESSAGE];
@@ -744,325 +771,473 @@ bool PolicyStore::processCryptoPolicies(std::string cryptoPolicies, std::string&
 
     bool rc = false;
 
+    // Reset the timestamp first, so that a delta which is rejected below can still make the store stale
+    logger->printf(Log::Debug, " %s: Reset the timestamp", __func__);
+    reset();
     if (json.HasMember(JSON_MESSAGE))
     {
         const rapidjson::Value& msgVal = json[JSON_MESSAGE];
+        std::string version;
 
-        if (msgVal.HasMember(JSON_POLICIES))
+        if (msgVal.IsObject() && msgVal.HasMember(JSON_POLICY_VERSION) && msgVal[JSON_POLICY_VERSION].IsString())
+        {
+            version = msgVal[JSON_POLICY_VERSION].GetString();
+        }
+        if (msgVal.IsObject() && msgVal.HasMember(JSON_POLICIES))
         {
             const rapidjson::Value& policiesVal = msgVal[JSON_POLICIES];
-            unsigned int elementCount = policiesVal.Size();
 
-            // For every policy
-            for (unsigned int c = 0; c < elementCount; ++c)
+            // The complete set, which only needs to be rebuilt when it differs from the one in use
+            const std::string digest = digestPolicies(policiesVal);
+            if (!policies_.empty() && !digest.empty() && (digest == policiesDigest_))
+            {
+                logger->printf(Log::Debug, " %s: Policies unchanged, keeping %d policies", __func__, policies_.size());
+                rc = true;
+            }
+            else
             {
-                //char arrayString[200];
-                std::string operationStr;
-                std::string id;
-                std::string name;
-                std::string domain;
-                OpType operation = NOTHING;
-                const rapidjson::Value& policyVal = policiesVal[c];
-
-                if (policyVal.IsNull())
+                POLICYMAP policies;
+
+                rc = parseCryptoPolicies(policiesVal, policies, error);
+                policies_.swap(policies);
+                // A set that failed to parse must not be taken as unchanged when it is sent again
+                if (rc)
                 {
-                    logger->printf(Log::Critical, " %s: JSON policy value is NULL, continuing", __func__);
-                    continue;
+                    policiesDigest_ = digest;
                 }
-                // Gateway Crypto Operation
-                if (policyVal.HasMember(JSON_GATEWAYCRYPTOOPERATION))
+                else
                 {
-                    const rapidjson::Value& gtwyCryptoOprVal = policyVal[JSON_GATEWAYCRYPTOOPERATION];
-
-                    if (!gtwyCryptoOprVal.IsNull())
-                    {
-                        operationStr = gtwyCryptoOprVal.GetString();
-                        if (operationStr == CRYPTO_OP_ENCRYPT)
-                        {
-                            operation = ENCRYPT;
-                        }
-                        else
-                        {
-                            operation = DECRYPT;
-                        }
-                    }
+                    policiesDigest_.clear();
                 }
-                if (operationStr.empty())
+                logger->printf(Log::Debug, " %s: policies size: %d", __func__, policies_.size());
+                if (policies_.empty())
                 {
-                    logger->printf(Log::Critical, " %s: No crypto operation returned from API (was expected)", __func__);
-                    error.assign("No crypto operation returned from API (was expected).");
-                    break;
+                    logger->printf(Log::Warning, " %s: No valid crypto policies returned from API", __func__);
                 }
-                // Policy Id
-                if (policyVal.HasMember(JSON_ID))
+            }
+            policyVersion_ = version;
+        }
+        else if (!version.empty())
+        {
+            rc = applyPolicyDelta(msgVal, version, error);
+        }
+        else
+        {
+            forgetPolicies();
+            if (msgVal.IsObject() && msgVal.HasMember(JSON_ERRORMESSAGE))
+            {
+                const rapidjson::Value& errMsgVal = msgVal[JSON_ERRORMESSAGE];
+
+                if (!errMsgVal.IsNull())
                 {
-                    const rapidjson::Value& idVal = policyVal[JSON_ID];
+                    std::string errorMsg = errMsgVal.GetString();
 
-                    if (!idVal.IsNull())
-                    {
-                        id =  idVal.GetString();
-                    }
+                    error.assign(errorMsg);
                 }
-                if (id.empty())
+            }
+        }
+    }
+    else
+    {
+        forgetPolicies();
+    }
+
+    return rc;
+}
+
+bool PolicyStore::applyPolicyDelta(const rapidjson::Value& msgVal, const std::string& version, std::string& error)
+{
+    Log* logger = Log::getInstance();
+
+    // A delta is relative to the version sent with the request, without one the complete set is needed
+    if (policyVersion_.empty())
+    {
+        logger->printf(Log::Error, " %s: Policy delta to version %s without a base version", __func__, version.c_str());
+        error.assign("Policy delta returned from API without a base version.");
+        forgetPolicies();
+        makeStale();
+
+        return false;
+    }
+    if (!msgVal.HasMember(JSON_POLICIES_ADDED) && !msgVal.HasMember(JSON_POLICIES_CHANGED) && !msgVal.HasMember(JSON_POLICIES_REMOVED))
+    {
+        logger->printf(Log::Debug, " %s: Policies unchanged at version %s", __func__, version.c_str());
+        policyVersion_ = version;
+
+        return true;
+    }
+
+    POLICYMAP updated;
+    const char *const updateMembers[] = { JSON_POLICIES_ADDED, JSON_POLICIES_CHANGED };
+    for (size_t i = 0; i < sizeof(updateMembers) / sizeof(updateMembers[0]); ++i)
+    {
+        if (!msgVal.HasMember(updateMembers[i]))
+        {
+            continue;
+        }
+        const rapidjson::Value& updateVal = msgVal[updateMembers[i]];
+        std::string updateError;
+
+        // An entry that fails to parse stops the rest of the array, with the error set
+        if ((!parseCryptoPolicies(updateVal, updated, updateError) && !(updateVal.IsArray() && updateVal.Empty())) || !updateError.empty())
+        {
+            // Applying the rest would leave policies that match no version, so keep those in use and
+            // ask for the complete set next time
+            logger->printf(Log::Error, " %s: Invalid %s policies in delta to version %s, rejecting it", __func__, updateMembers[i], version.c_str());
+            error.assign(updateError.empty() ? "Invalid policies in delta returned from API." : updateError);
+            policyVersion_.clear();
+            policiesDigest_.clear();
+            makeStale();
+
+            return false;
+        }
+    }
+
+    if (msgVal.HasMember(JSON_POLICIES_REMOVED))
+    {
+        const rapidjson::Value& removedVal = msgVal[JSON_POLICIES_REMOVED];
+
+        if (removedVal.IsArray())
+        {
+            for (rapidjson::Value::ConstValueIterator itr = removedVal.Begin(); itr != removedVal.End(); ++itr)
+            {
+                if (itr->IsString())
                 {
-                    logger->printf(Log::Critical, " %s: No id returned from API (was expected)", __func__);
-                    error.assign("No id returned from API (was expected).");
-                    break;
+                    policies_.erase(itr->GetString());
                 }
-                // Policy Name
-                if (policyVal.HasMember(JSON_NAME))
-                {
-                    const rapidjson::Value& nameVal = policyVal[JSON_NAME];
+            }
+        }
+    }
+    for (POLICYMAP::const_iterator i = updated.begin(); i != updated.end(); ++i)
+    {
+        // Policy has no assignment, so a changed policy is replaced
+        policies_.erase(i->first);
+        policies_.insert(*i);
+    }
+    logger->printf(Log::Debug, " %s: Applied delta to version %s, policies size: %d", __func__, version.c_str(), policies_.size());
+    policyVersion_ = version;
+    // The digest was of a complete set, which no longer matches the policies in use
+    policiesDigest_.clear();
 
-                    if (!nameVal.IsNull())
-                    {
-                        name = nameVal.GetString();
-                    }
-                }
-                if (name.empty())
+    return true;
+}
+
+void PolicyStore::forgetPolicies()
+{
+    policies_.clear();
+    policyVersion_.clear();
+    policiesDigest_.clear();
+}
+
+const std::string PolicyStore::digestPolicies(const rapidjson::Value& policiesVal) const
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+    policiesVal.Accept(writer);
+    return evp_crypto::digestSHA256(buffer.GetString(), buffer.GetSize());
+}
+
+bool PolicyStore::parseCryptoPolicies(const rapidjson::Value& policiesVal, POLICYMAP& policies, std::string& error) const
+{
+    Log* logger = Log::getInstance();
+    bool rc = false;
+
+    if (!policiesVal.IsArray())
+    {
+        logger->printf(Log::Error, " %s: Policies are not an array", __func__);
+        error.assign("Policies returned from API are not an array.");
+
+        return false;
+    }
+    unsigned int elementCount = policiesVal.Size();
+
+    // For every policy
+    for (unsigned int c = 0; c < elementCount; ++c)
+    {
+        //char arrayString[200];
+        std::string operationStr;
+        std::string id;
+        std::string name;
+        std::string domain;
+        OpType operation = NOTHING;
+        const rapidjson::Value& policyVal = policiesVal[c];
+
+        if (policyVal.IsNull())
+        {
+            logger->printf(Log::Critical, " %s: JSON policy value is NULL, continuing", __func__);
+            continue;
+        }
+        // Gateway Crypto Operation
+        if (policyVal.HasMember(JSON_GATEWAYCRYPTOOPERATION))
+        {
+            const rapidjson::Value& gtwyCryptoOprVal = policyVal[JSON_GATEWAYCRYPTOOPERATION];
+
+            if (!gtwyCryptoOprVal.IsNull())
+            {
+                operationStr = gtwyCryptoOprVal.GetString();
+                if (operationStr == CRYPTO_OP_ENCRYPT)
                 {
-                    logger->printf(Log::Critical, " %s: No name returned from API (was expected)", __func__);
-                    error.assign("No name returned from API (was expected).");
-                    break;
+                    operation = ENCRYPT;
                 }
-                // Policy Domain
-                if (policyVal.HasMember(JSON_DOMAIN))
+                else
                 {
-                    const rapidjson::Value& domainVal = policyVal[JSON_DOMAIN];
-
-                    if (!domainVal.IsNull())
-                    {
-                        domain = domainVal.GetString();
-                    }
+                    operation = DECRYPT;
                 }
-                if (domain.empty())
+            }
+        }
+        if (operationStr.empty())
+        {
+            logger->printf(Log::Critical, " %s: No crypto operation returned from API (was expected)", __func__);
+            error.assign("No crypto operation returned from API (was expected).");
+            break;
+        }
+        // Policy Id
+        if (policyVal.HasMember(JSON_ID))
+        {
+            const rapidjson::Value& idVal = policyVal[JSON_ID];
+
+            if (!idVal.IsNull())
+            {
+                id =  idVal.GetString();
+            }
+        }
+        if (id.empty())
+        {
+            logger->printf(Log::Critical, " %s: No id returned from API (was expected)", __func__);
+            error.assign("No id returned from API (was expected).");
+            break;
+        }
+        // Policy Name
+        if (policyVal.HasMember(JSON_NAME))
+        {
+            const rapidjson::Value& nameVal = policyVal[JSON_NAME];
+
+            if (!nameVal.IsNull())
+            {
+                name = nameVal.GetString();
+            }
+        }
+        if (name.empty())
+        {
+            logger->printf(Log::Critical, " %s: No name returned from API (was expected)", __func__);
+            error.assign("No name returned from API (was expected).");
+            break;
+        }
+        // Policy Domain
+        if (policyVal.HasMember(JSON_DOMAIN))
+        {
+            const rapidjson::Value& domainVal = policyVal[JSON_DOMAIN];
+
+            if (!domainVal.IsNull())
+            {
+                domain = domainVal.GetString();
+            }
+        }
+        if (domain.empty())
+        {
+            logger->printf(Log::Critical, " %s: No domain returned from API (was expected)", __func__);
+            error.assign("No domain returned from API (was expected).");
+            break;
+        }
+
+        std::string urlPattern;
+        std::string cryptionPath;
+        std::string payloadType = "PLAIN";
+        DirectionType direction = BOTH;
+        MethodType method = NA;
+
+        if (protocol_ != PROTO_ALWAYSON)
+        {
+            // AlwaysOn Protocol
+            // URL Pattern
+            if (policyVal.HasMember(JSON_URLPATTERN))
+            {
+                const rapidjson::Value& urlPatternVal = policyVal[JSON_URLPATTERN];
+
+                if (!urlPatternVal.IsNull())
                 {
-                    logger->printf(Log::Critical, " %s: No domain returned from API (was expected)", __func__);
-                    error.assign("No domain returned from API (was expected).");
-                    break;
+                    urlPattern = urlPatternVal.GetString();
                 }
+            }
+            if (urlPattern.empty())
+            {
+                logger->printf(Log::Critical, " %s: No URL pattern returned from API (was expected)", __func__);
+                error.assign("No URL pattern returned from API (was expected).");
+                break;
+            }
+            // Gateway Data Direction
+            if (policyVal.HasMember(JSON_GATEWAYDATADIRECTION))
+            {
+                const rapidjson::Value& gtwyDataDirVal = policyVal[JSON_GATEWAYDATADIRECTION];
 
-                std::string urlPattern;
-                std::string cryptionPath;
-                std::string payloadType = "PLAIN";
-                DirectionType direction = BOTH;
-                MethodType method = NA;
-
-                if (protocol_ != PROTO_ALWAYSON)
+                if (!gtwyDataDirVal.IsNull())
                 {
-                    // AlwaysOn Protocol
-                    // URL Pattern
-                    if (policyVal.HasMember(JSON_URLPATTERN))
-                    {
-                        const rapidjson::Value& urlPatternVal = policyVal[JSON_URLPATTERN];
+                    std::string directionStr = gtwyDataDirVal.GetString();
 
-                        if (!urlPatternVal.IsNull())
-                        {
-                            urlPattern = urlPatternVal.GetString();
-                        }
-                    }
-                    if (urlPattern.empty())
+                    if (directionStr == DATADIR_C2S)
                     {
-                        logger->printf(Log::Critical, " %s: No URL pattern returned from API (was expected)", __func__);
-                        error.assign("No URL pattern returned from API (was expected).");
-                        break;
+                        direction = C2S;
                     }
-                    // Gateway Data Direction
-                    if (policyVal.HasMember(JSON_GATEWAYDATADIRECTION))
+                    else if (directionStr == DATADIR_S2C)
                     {
-                        const rapidjson::Value& gtwyDataDirVal = policyVal[JSON_GATEWAYDATADIRECTION];
-
-                        if (!gtwyDataDirVal.IsNull())
-                        {
-                            std::string directionStr = gtwyDataDirVal.GetString();
-
-                            if (directionStr == DATADIR_C2S)
-                            {
-                                direction = C2S;
-                            }
-                            else if (directionStr == DATADIR_S2C)
-                            {
-                                direction = S2C;
-                            }
-                            else
-                            {
-                                // == "BOTH"
-                                direction = BOTH;
-                            }
-                        }
+                        direction = S2C;
                     }
                     else
                     {
-                        logger->printf(Log::Critical, " %s: No direction returned from API (was expected)", __func__);
-                        error.assign("No direction returned from API (was expected).");
-                        break;
+                        // == "BOTH"
+                        direction = BOTH;
                     }
+                }
+            }
+            else
+            {
+                logger->printf(Log::Critical, " %s: No direction returned from API (was expected)", __func__);
+                error.assign("No direction returned from API (was expected).");
+                break;
+            }
 
-                    bool hasMethod = false;
+            bool hasMethod = false;
 
-                    // Gateway Method Type
-                    if (policyVal.HasMember(JSON_GATEWAYMETHODTYPE))
-                    {
-                        const rapidjson::Value& gtwyMethodTypeVal = policyVal[JSON_GATEWAYMETHODTYPE];
-
-                        if (!gtwyMethodTypeVal.IsNull())
-                        {
-                            std::string gwMethod = gtwyMethodTypeVal.GetString();
-
-                            if (gwMethod == METHOD_POST)
-                            {
-                                method = POST;
-                            }
-                            else if (gwMethod == METHOD_GET)
-                            {
-                                method = GET;
-                            }
-                            else
-                            {
-                                method = NA;
-                            }
-                            hasMethod = true;
-                        }
-                    }
-                    if (!hasMethod)
-                    {
-                        logger->printf(Log::Critical, " %s: No method returned from API (was expected)", __func__);
-                        error.assign("No method returned from API (was expected).");
-                        break;
-                    }
-                    // Payload Type
-                    if (policyVal.HasMember(JSON_PAYLOADTYPE))
-                    {
-                        const rapidjson::Value& payloadTypeVal = policyVal[JSON_PAYLOADTYPE];
+            // Gateway Method Type
+            if (policyVal.HasMember(JSON_GATEWAYMETHODTYPE))
+            {
+                const rapidjson::Value& gtwyMethodTypeVal = policyVal[JSON_GATEWAYMETHODTYPE];
 
-                        if (!payloadTypeVal.IsNull())
-                        {
-                            payloadType = payloadTypeVal.GetString();
-                        }
-                    }
-                    if (payloadType.empty())
+                if (!gtwyMethodTypeVal.IsNull())
+                {
+                    std::string gwMethod = gtwyMethodTypeVal.GetString();
+
+                    if (gwMethod == METHOD_POST)
                     {
-                        logger->printf(Log::Critical, " %s: No payload type returned from API (was expected)", __func__);
-                        error.assign("No  payload type returned from API (was expected).");
-                        break;
+                        method = POST;
                     }
-                    // Cryption Path
-                    if (policyVal.HasMember(JSON_CRYPTIONPATH))
+                    else if (gwMethod == METHOD_GET)
                     {
-                        const rapidjson::Value& cryptionPathVal = policyVal[JSON_CRYPTIONPATH];
-
-                        if (!cryptionPathVal.IsNull())
-                        {
-                            cryptionPath = cryptionPathVal.GetString();
-                        }
+                        method = GET;
                     }
-                    if (cryptionPath.empty())
+                    else
                     {
-                        logger->printf(Log::Critical, " %s: No cryption path returned from API (was expected)", __func__);
-                        error.assign("No cryption path returned from API (was expected).");
-                        break;
+                        method = NA;
                     }
+                    hasMethod = true;
                 }
-                // Get property names for alwaysOn
-                if ((protocol_ == PROTO_ALWAYSON) && policyVal.HasMember(JSON_PROPERTYNAMES))
+            }
+            if (!hasMethod)
+            {
+                logger->printf(Log::Critical, " %s: No method returned from API (was expected)", __func__);
+                error.assign("No method returned from API (was expected).");
+                break;
+            }
+            // Payload Type
+            if (policyVal.HasMember(JSON_PAYLOADTYPE))
+            {
+                const rapidjson::Value& payloadTypeVal = policyVal[JSON_PAYLOADTYPE];
+
+                if (!payloadTypeVal.IsNull())
                 {
-                    const rapidjson::Value& propNamesVal = policyVal[JSON_PROPERTYNAMES];
+                    payloadType = payloadTypeVal.GetString();
+                }
+            }
+            if (payloadType.empty())
+            {
+                logger->printf(Log::Critical, " %s: No payload type returned from API (was expected)", __func__);
+                error.assign("No  payload type returned from API (was expected).");
+                break;
+            }
+            // Cryption Path
+            if (policyVal.HasMember(JSON_CRYPTIONPATH))
+            {
+                const rapidjson::Value& cryptionPathVal = policyVal[JSON_CRYPTIONPATH];
 
-                    if (!propNamesVal.IsNull())
+                if (!cryptionPathVal.IsNull())
+                {
+                    cryptionPath = cryptionPathVal.GetString();
+                }
+            }
+            if (cryptionPath.empty())
+            {
+                logger->printf(Log::Critical, " %s: No cryption path returned from API (was expected)", __func__);
+                error.assign("No cryption path returned from API (was expected).");
+                break;
+            }
+        }
+        // Get property names for alwaysOn
+        if ((protocol_ == PROTO_ALWAYSON) && policyVal.HasMember(JSON_PROPERTYNAMES))
+        {
+            const rapidjson::Value& propNamesVal = policyVal[JSON_PROPERTYNAMES];
+
+            if (!propNamesVal.IsNull())
+            {
+                cryptionPath = propNamesVal.GetString();
+            }
+            if (cryptionPath.empty())
+            {
+                logger->printf(Log::Critical, " %s: No property names names were returned from API (was expected)", __func__);
+                error.assign("No property names names were returned from API (was expected).");
+                break;
+            }
+        }
+        if (operation == ENCRYPT)
+        {
+            // Encryption operation requires Crypto Key Rotation Policy
+            // Crypto Key Rotation Policy
+            if (policyVal.HasMember(JSON_CRYPTOKEYROTATIONPOLICY))
+            {
+                const rapidjson::Value& keyRotationPolicyVal = policyVal[JSON_CRYPTOKEYROTATIONPOLICY];
+
+                if (!keyRotationPolicyVal.IsNull())
+                {
+                    std::string ckrT;
+                    int64_t ckrSchd = 0;
+                    int64_t ckrUpd = 0;
+                    int64_t ckrRtry = 0;
+
+                    if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_T))
                     {
-                        cryptionPath = propNamesVal.GetString();
+                        const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_T];
+
+                        ckrT = val.GetString();
                     }
-                    if (cryptionPath.empty())
+                    if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_SCHEDULE))
                     {
-                        logger->printf(Log::Critical, " %s: No property names names were returned from API (was expected)", __func__);
-                        error.assign("No property names names were returned from API (was expected).");
-                        break;
+                        const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_SCHEDULE];
+
+                        ckrSchd = val.GetInt64();
                     }
-                }
-                if (operation == ENCRYPT)
-                {
-                    // Encryption operation requires Crypto Key Rotation Policy
-                    // Crypto Key Rotation Policy
-                    if (policyVal.HasMember(JSON_CRYPTOKEYROTATIONPOLICY))
+                    if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_UPDATE))
                     {
-                        const rapidjson::Value& keyRotationPolicyVal = policyVal[JSON_CRYPTOKEYROTATIONPOLICY];
-
-                        if (!keyRotationPolicyVal.IsNull())
-                        {
-                            std::string ckrT;
-                            int64_t ckrSchd = 0;
-                            int64_t ckrUpd = 0;
-                            int64_t ckrRtry = 0;
-
-                            if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_T))
-                            {
-                                const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_T];
-
-                                ckrT = val.GetString();
-                            }
-                            if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_SCHEDULE))
-                            {
-                                const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_SCHEDULE];
-
-                                ckrSchd = val.GetInt64();
-                            }
-                            if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_UPDATE))
-                            {
-                                const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_UPDATE];
-
-                                ckrUpd = val.GetInt64();
-                            }
-                            if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_RETRY))
-                            {
-                                const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_RETRY];
-
-                                ckrRtry = val.GetInt64();
-                            }
-                            policies_.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method, ckrSchd, ckrUpd, ckrRtry)));
-                        }
-                        else
-                        {
-                            logger->printf(Log::Error, " %s: Key Rotation Policy not found", __func__);
-                            policies_.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method)));
-                        }
+                        const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_UPDATE];
+
+                        ckrUpd = val.GetInt64();
                     }
-                    else
+                    if (keyRotationPolicyVal.HasMember(JSON_ROTATIONPOLICY_RETRY))
                     {
-                        logger->printf(Log::Error, " %s: Key Rotation Policy not found", __func__);
-                        policies_.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method)));
+                        const rapidjson::Value& val = keyRotationPolicyVal[JSON_ROTATIONPOLICY_RETRY];
+
+                        ckrRtry = val.GetInt64();
                     }
+                    policies.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method, ckrSchd, ckrUpd, ckrRtry)));
                 }
                 else
                 {
-                    // Decryption operation
-                    policies_.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method)));
+                    logger->printf(Log::Error, " %s: Key Rotation Policy not found", __func__);
+                    policies.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method)));
                 }
-                rc = true;
-            } //end of for loop
-            logger->printf(Log::Debug, " %s: policies size: %d", __func__, policies_.size());
-            if (policies_.empty())
+            }
+            else
             {
-                logger->printf(Log::Warning, " %s: No valid crypto policies returned from API", __func__);
+                logger->printf(Log::Error, " %s: Key Rotation Policy not found", __func__);
+                policies.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method)));
             }
         }
         else
         {
-            if (msgVal.HasMember(JSON_ERRORMESSAGE))
-            {
-                const rapidjson::Value& errMsgVal = msgVal[JSON_ERRORMESSAGE];
-
-                if (!errMsgVal.IsNull())
-                {
-                    std::string errorMsg = errMsgVal.GetString();
-
-                    error.assign(errorMsg);
-                }
-            }
+            // Decryption operation
+            policies.insert(std::make_pair(id, Policy(name, id, operation, domain, direction, urlPattern, payloadType, cryptionPath, method)));
         }
-    }
-    // Finally reset the timestamp
-    logger->printf(Log::Debug, " %s: Reset the timestamp", __func__);
-    reset();
+        rc = true;
+    } //end of for loop
 
     return rc;
 }
@@ -1085,9 +1260,9 @@ bool PolicyStore::getPoliciesFromSAC(std::string& error)
         return rc;
     }
 
-    static const std::string DAUser = config.lookup(CFG_DAUSERID);
-    static const std::string DAAPIURL = config.lookup(CFG_DAAPIURL);
-    static const std::string deviceName = config.lookup(CFG_DEVICENAME);
+    // Looked up on each call, so that a reloaded configuration is used
+    static const Configuration::Key daApiUrlKey = config.key(CFG_DAAPIURL);
+    const std::string DAAPIURL = config.lookup(daApiUrlKey);
     std::string keyid;
     std::string key;
     std::string iv;
@@ -1118,6 +1293,11 @@ bool PolicyStore::getPoliciesFromSAC(std::string& error)
     rapidjson::Document json;
     std::string jsonResponse;
     std::string apiurl = DAAPIURL + "/policies/" + protocol_;
+    if (isUrlSafe(policyVersion_))
+    {
+        // Ask for the changes since the version in use, the SAC may still reply with the complete set
+        apiurl += "?" JSON_POLICY_VERSION "=" + policyVersion_;
+    }
     DAErrorCode rcHttpClient = ERR_OK;
 
     //logger->printf(Log::Debug, " %s:%d: API URL: %s", __func__, __LINE__, apiurl.c_str());
@@ -1125,6 +1305,7 @@ bool PolicyStore::getPoliciesFromSAC(std::string& error)
     if ((rcHttpClient != ERR_OK) || jsonResponse.empty())
     {
         logger->printf(Log::Error, " %s: Failed to obtain policies from SAC..updating policy refresh time with retry value from KRP", __func__);
+        daInstance->invalidateSession();
         logger->printf(Log::Debug, " %s: Updating policy refreshTime to %d", __func__, refreshRetryTime_);
         refreshTime_ = refreshRetryTime_;
 
@@ -99,16 +99,16 @@ void SatAssetProcessor::onUpdate()
 
 int SatAssetProcessor::decryptKeyIv(const std::string &key, const std::string &iv, const std::string &data, char **out)
 {
-    std::vector<unsigned char> data_buf(data.size());
-    unsigned int data_size = base64Decode(data.c_str(), &data_buf[0], data_buf.size());
+    std::string data_buf;
+    base64::decodeAppend(data, data_buf);
 
-    std::vector<unsigned char> key_buf(key.size());
-    unsigned int key_size = base64Decode(key.c_str(), &key_buf[0], key_buf.size());
+    std::string key_buf;
+    base64::decodeAppend(key, key_buf);
 
-    std::vector<unsigned char> iv_buf(iv.size());
-    unsigned int iv_size = base64Decode(iv.c_str(), &iv_buf[0], iv_buf.size());
+    std::string iv_buf;
+    base64::decodeAppend(iv, iv_buf);
 
-    return DeviceAuthority::getInstance()->doCipherAES((const char *)&key_buf[0], key_size, (const char *)&iv_buf[0], iv_size, (const char *)&data_buf[0], data_size, CipherModeDecrypt, out);
+    return DeviceAuthority::getInstance()->doCipherAES(key_buf.data(), key_buf.size(), iv_buf.data(), iv_buf.size(), data_buf.data(), data_buf.size(), CipherModeDecrypt, out);
 }
 
 std::string SatAssetProcessor::decryptScript(const char *key, const int key_size, const char *iv, const int iv_size, const std::string &data) const
@@ -116,15 +116,15 @@ std::string SatAssetProcessor::decryptScript(const char *key, const int key_size
     Log *p_logger = Log::getInstance();
 
     char *out = nullptr;
-    std::vector<unsigned char> data_buf(data.size());
-    unsigned int data_size = base64Decode(data.c_str(), &data_buf[0], data_buf.size());
+    std::string data_buf;
+    const size_t data_size = base64::decodeAppend(data, data_buf) == base64::OK ? data_buf.size() : 0;
     if (data_size <= 0)
     {
         p_logger->printf(Log::Error, "Failed to decode data");
     }
     else
     {
-        DeviceAuthority::getInstance()->doCipherAES(key, key_size, iv, iv_size, (const char *)&data_buf[0], data_size, CipherModeDecrypt, &out);
+        DeviceAuthority::getInstance()->doCipherAES(key, key_size, iv, iv_size, data_buf.data(), data_size, CipherModeDecrypt, &out);
     }
 
     std::string script = "";
@@ -149,8 +149,8 @@ std::string SatAssetProcessor::encryptScriptOutput(const char *key, const int ke
 
 std::string SatAssetProcessor::charPbase64(const char *data, const unsigned int dataSize) const
 {
-    std::vector<char> buf(dataSize * 2, 0);
-    unsigned int sz = base64Encode((unsigned char *)data, (unsigned int)dataSize, &buf[0], (unsigned int)buf.size());
+    std::string text;
+    base64::encodeAppend(data, dataSize, text);
 
-    return std::string(buf.begin(), buf.begin() + sz);
+    return text;
 }
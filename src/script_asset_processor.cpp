@@ -16,7 +16,7 @@
 #include <functional>
 #include <iomanip>
 #include <memory>
-#include "base64.h"
+#include "base64.hpp"
 #include "async_exec_script.hpp"
 #include "asset_processor.hpp"
 #include "deviceauthority.hpp"
@@ -25,6 +25,7 @@
 #include "script_asset_processor.hpp"
 #include "utils.hpp"
 #include "json_utils.hpp"
+#include "script_result_writer.hpp"
 #include "script_utils.hpp"
 #include "message_factory.hpp"
 #include "utils.hpp"
@@ -33,6 +34,7 @@ const char *const BLOB_URL = "fileLink";
 const char *const LOG_FILE_PATH_STR = "LOGFILEPATH";
 const char *const CONFIG_FILE_PATH_STR = "CONFIGFILEPATH";
 const char *const DATA_FILE_PATH_STR = "DATAFILEPATH";
+const char *const DATA_FILE_SHA256_STR = "DATAFILESHA256";
 
 ScriptAssetProcessor::ScriptAssetProcessor(const std::string &asset_id, AssetMessenger *p_asset_messenger, const RSAPtr public_key)
 	: AssetProcessor(asset_id, p_asset_messenger), m_data_file_path(nullptr), m_public_key(public_key)
@@ -78,8 +80,10 @@ void ScriptAssetProcessor::handleAsset(
         {
             m_data_file_path.reset(new std::string(tmpFilepath(utils::getFileNameFromPath(blob_url))), [this](std::string *s)
                                { removeFile(s); delete s; });
-            fetchFile(blob_url, *m_data_file_path);
+            // The digest is computed during the download, so the recipe does not need to read the file to verify it
+            const std::string data_file_sha256 = fetchFile(blob_url, *m_data_file_path);
             setEnv(DATA_FILE_PATH_STR, *m_data_file_path);
+            setEnv(DATA_FILE_SHA256_STR, data_file_sha256);
         }
         else if (m_asset_type == "code_signing")
         {
@@ -93,7 +97,17 @@ void ScriptAssetProcessor::handleAsset(
             setEnv(LOG_FILE_PATH_STR, config.lookup(CFG_LOGFILENAME));
         }
 
-        m_script_future.reset(new AsyncExecScript(fixLineEndings(utils::fromBase64(device_recipe_b64))));
+        // Stream the script output straight into the result message, the writer is shared with the script
+        // thread so that it outlives this processor if the script is still running when it is destroyed
+        std::shared_ptr<ScriptResultWriter> result_writer(new ScriptResultWriter(
+            logsType(), RecipeResultsParser().isCompressRequested(), script_utils::configuredLimits().max_output_bytes));
+        m_result_writer = result_writer;
+        m_script_future.reset(new AsyncExecScript(fixLineEndings(utils::fromBase64(device_recipe_b64)),
+            [result_writer](const char *p_data, size_t size)
+            {
+                result_writer->append(p_data, size);
+                return true;
+            }));
     }
     catch (const std::exception &e)
     {
@@ -118,28 +132,34 @@ void ScriptAssetProcessor::onUpdate()
     std::string device_log_json;
     if (m_success)
     {
-        device_log_json = MessageFactory::buildScriptResultMessage(
-            m_asset_type == "code_signing" ? "asset-device-data-codesigning" : "asset-device-data-logs",
-            RecipeResultsParser().isCompressRequested(),
-            script_output);
+        // The output beyond the limit was discarded before it reached the writer
+        if (m_script_future->isTruncated())
+        {
+            m_result_writer->markTruncated();
+        }
+        device_log_json = m_result_writer->finish();
         Log::getInstance()->printf(Log::Information, " %s:%d Successfully processed recipe", __func__, __LINE__);
         EventManager::getInstance()->notifySATSuccess();
     }
     else
     {
         m_error_message = "Script returned failure. Script output: " + script_output;
-        device_log_json = MessageFactory::buildScriptResultMessage(
-            m_asset_type == "code_signing" ? "asset-device-data-codesigning" : "asset-device-data-logs",
-            false,
-            m_error_message);
+        device_log_json = MessageFactory::buildScriptResultMessage(logsType(), false, m_error_message);
         Log::getInstance()->printf(Log::Error, " %s:%d %s", __func__, __LINE__, m_error_message.c_str());
         EventManager::getInstance()->notifySATFailure(m_error_message);
     }
 
+    m_result_writer.reset();
+
     sendReceipt(m_success, device_log_json, m_error_message);
     m_complete = true;
 }
 
+const char *ScriptAssetProcessor::logsType() const
+{
+    return m_asset_type == "code_signing" ? "asset-device-data-codesigning" : "asset-device-data-logs";
+}
+
 bool ScriptAssetProcessor::sendReceipt(bool is_success, const std::string &json_payload, std::string &failure_reason)
 {
     const std::string json_receipt = MessageFactory::buildAcknowledgeMessage(m_asset_id, is_success, failure_reason);
@@ -188,12 +208,14 @@ const std::string ScriptAssetProcessor::digest(const std::string &data) const
     return DeviceAuthority::getInstance()->doDigestSHA256(data);
 }
 
-void ScriptAssetProcessor::fetchFile(const std::string &apiurl, const std::string &response_file_path) const
+const std::string ScriptAssetProcessor::fetchFile(const std::string &apiurl, const std::string &response_file_path) const
 {
+    std::string sha256;
     if (!apiurl.empty())
     {
-        mp_asset_messenger->fetchFile(apiurl, response_file_path);
+        mp_asset_messenger->fetchFile(apiurl, response_file_path, sha256);
     }
+    return sha256;
 }
 
 void ScriptAssetProcessor::removeFile(const std::string *p_filepath) const
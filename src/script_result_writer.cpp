@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Streaming builder of the script result message returned to the KeyScaler
+ */
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "base64.hpp"
+#include "rapidjson/writer.h"
+#include "script_result_writer.hpp"
+
+ScriptResultWriter::ScriptResultWriter(const std::string &logs_type, bool compress, size_t max_output_bytes)
+#if defined(ALLOW_COMPRESSION)
+    : m_compress(compress),
+#else
+    : m_compress(false),
+#endif // #if defined(ALLOW_COMPRESSION)
+      m_max_output_bytes(max_output_bytes), m_output_bytes(0), m_truncated(false), m_finished(false),
+      m_line_count(0), m_b64_remainder_size(0)
+{
+#if defined(ALLOW_COMPRESSION)
+    if (m_compress)
+    {
+        memset(&m_zstream, 0, sizeof(m_zstream));
+        if (Z_OK != deflateInit(&m_zstream, Z_DEFAULT_COMPRESSION))
+        {
+            throw std::runtime_error("Zlib compression failed");
+        }
+    }
+#else
+    (void)compress;
+#endif // #if defined(ALLOW_COMPRESSION)
+
+    // {"device_logs":{"type":<type>,"compression":<compression>,"data":"<base64 of the device_logs JSON>"}}
+    m_message = "{\"device_logs\":{\"type\":";
+    {
+        rapidjson::Writer<rapidjson::StringBuffer> writer(m_line_json);
+        writer.String(logs_type.c_str(), (rapidjson::SizeType)logs_type.size());
+    }
+    m_message.append(m_line_json.GetString(), m_line_json.GetSize());
+    m_message += m_compress ? ",\"compression\":\"zlib\"" : ",\"compression\":\"none\"";
+    m_message += ",\"data\":\"";
+
+    const char data_prefix[] = "{\"device_info\":\"\",\"device_logs\":[";
+    writeData(data_prefix, sizeof(data_prefix) - 1);
+}
+
+ScriptResultWriter::~ScriptResultWriter()
+{
+#if defined(ALLOW_COMPRESSION)
+    if (m_compress && !m_finished)
+    {
+        deflateEnd(&m_zstream);
+    }
+#endif // #if defined(ALLOW_COMPRESSION)
+}
+
+bool ScriptResultWriter::append(const char *p_data, size_t size)
+{
+    if (m_finished || m_truncated)
+    {
+        return false;
+    }
+    if (m_max_output_bytes != 0 && m_output_bytes + size > m_max_output_bytes)
+    {
+        size = m_max_output_bytes - m_output_bytes;
+        m_truncated = true;
+    }
+    m_output_bytes += size;
+
+    const char *p_end = p_data + size;
+    while (p_data < p_end)
+    {
+        const char *p_newline = (const char *)memchr(p_data, '\n', p_end - p_data);
+        if (!p_newline)
+        {
+            m_line.append(p_data, p_end - p_data);
+            break;
+        }
+        if (m_line.empty())
+        {
+            writeLine(p_data, p_newline - p_data);
+        }
+        else
+        {
+            m_line.append(p_data, p_newline - p_data);
+            writeLine(m_line.data(), m_line.size());
+            m_line.clear();
+        }
+        p_data = p_newline + 1;
+    }
+
+    return !m_truncated;
+}
+
+void ScriptResultWriter::markTruncated()
+{
+    m_truncated = true;
+}
+
+const std::string ScriptResultWriter::finish()
+{
+    if (m_finished)
+    {
+        throw std::runtime_error("Script result message already finished");
+    }
+
+    if (!m_line.empty())
+    {
+        writeLine(m_line.data(), m_line.size());
+        m_line.clear();
+    }
+    if (m_truncated)
+    {
+        std::stringstream ss;
+        ss << "[output truncated after " << m_max_output_bytes << " bytes]";
+        const std::string notice = ss.str();
+        writeLine(notice.data(), notice.size());
+    }
+
+    const char data_suffix[] = "]}";
+    writeData(data_suffix, sizeof(data_suffix) - 1);
+#if defined(ALLOW_COMPRESSION)
+    if (m_compress)
+    {
+        compressData(nullptr, 0, Z_FINISH);
+        deflateEnd(&m_zstream);
+    }
+#endif // #if defined(ALLOW_COMPRESSION)
+    encodeBase64Final();
+    m_finished = true;
+
+    m_message += "\"}}";
+    return m_message;
+}
+
+bool ScriptResultWriter::isTruncated() const
+{
+    return m_truncated;
+}
+
+void ScriptResultWriter::writeLine(const char *p_line, size_t size)
+{
+    m_line_json.Clear();
+    if (m_line_count > 0)
+    {
+        m_line_json.Put(',');
+    }
+
+    rapidjson::Writer<rapidjson::StringBuffer> writer(m_line_json);
+    writer.StartObject();
+    writer.Key("line");
+    writer.Uint(++m_line_count);
+    writer.Key("description");
+    writer.String(p_line, (rapidjson::SizeType)size);
+    writer.EndObject();
+
+    writeData(m_line_json.GetString(), m_line_json.GetSize());
+}
+
+void ScriptResultWriter::writeData(const char *p_data, size_t size)
+{
+#if defined(ALLOW_COMPRESSION)
+    if (m_compress)
+    {
+        compressData(p_data, size, Z_NO_FLUSH);
+        return;
+    }
+#endif // #if defined(ALLOW_COMPRESSION)
+    encodeBase64((const unsigned char *)p_data, size);
+}
+
+#if defined(ALLOW_COMPRESSION)
+void ScriptResultWriter::compressData(const char *p_data, size_t size, int flush)
+{
+    unsigned char chunk[CHUNK_SIZE];
+
+    m_zstream.next_in = (Bytef *)p_data;
+    m_zstream.avail_in = (uInt)size;
+    do
+    {
+        m_zstream.next_out = chunk;
+        m_zstream.avail_out = sizeof(chunk);
+        if (Z_STREAM_ERROR == deflate(&m_zstream, flush))
+        {
+            throw std::runtime_error("Zlib compression failed");
+        }
+        encodeBase64(chunk, sizeof(chunk) - m_zstream.avail_out);
+    } while (m_zstream.avail_out == 0);
+}
+#endif // #if defined(ALLOW_COMPRESSION)
+
+void ScriptResultWriter::encodeBase64(const unsigned char *p_data, size_t size)
+{
+    // Complete the group left over from the previous chunk
+    if (m_b64_remainder_size > 0)
+    {
+        while (m_b64_remainder_size < 3 && size > 0)
+        {
+            m_b64_remainder[m_b64_remainder_size++] = *p_data++;
+            --size;
+        }
+        if (m_b64_remainder_size < 3)
+        {
+            return;
+        }
+        base64::encodeAppend(m_b64_remainder, 3, m_message);
+        m_b64_remainder_size = 0;
+    }
+
+    // Encode the whole groups, so that no padding is written part way through
+    const size_t whole = size / 3 * 3;
+    if (whole > 0)
+    {
+        base64::encodeAppend(p_data, whole, m_message);
+    }
+    m_b64_remainder_size = size - whole;
+    memcpy(m_b64_remainder, p_data + whole, m_b64_remainder_size);
+}
+
+void ScriptResultWriter::encodeBase64Final()
+{
+    if (m_b64_remainder_size > 0)
+    {
+        base64::encodeAppend(m_b64_remainder, m_b64_remainder_size, m_message);
+        m_b64_remainder_size = 0;
+    }
+}
@@ -8,37 +8,339 @@
 #include "asset-win.hpp"
 #else
 #include "asset-linux.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif // #if defined(WIN32)
 
+#include <vector>
+#include "configuration.hpp"
+#include "constants.hpp"
 #include "log.hpp"
 #include "script_utils.hpp"
+#include "steady_timer.hpp"
+
+#if !defined(WIN32)
+extern char **environ;
+#endif // #if !defined(WIN32)
 
 namespace script_utils
 {
 
-bool execScript(const std::string &script, std::string& log_output)
+namespace
 {
-    FILE *pipe = popen(script.c_str(), "r");
+#if !defined(WIN32)
+    /// @brief Longest interval between checks on a script that closed stdout but has not exited, within its timeout
+    const int REAP_MAX_INTERVAL_MS = 100;
+
+    /// @brief Get the milliseconds remaining until the script times out, -1 if there is no timeout
+    int remainingMilliseconds(const ExecLimits &limits, const steady_timer &timer)
+    {
+        if (limits.timeout_s == 0)
+        {
+            return -1;
+        }
+        const int64_t remaining = (int64_t)limits.timeout_s * steady_timer::MILLISECONDS_IN_ONE_SECOND - timer.get_elapsed_time_in_millseconds();
+        return remaining > 0 ? (int)remaining : 0;
+    }
+#endif // #if !defined(WIN32)
+
+    /// @brief Pass a block to the sink, applying the output limit
+    /// @return False if the sink requested that reading stops
+    bool consume(const OutputSink &sink, const ExecLimits &limits, size_t &total, bool &truncated, const char *p_data, size_t size)
+    {
+        if (limits.max_output_bytes != 0 && total + size > limits.max_output_bytes)
+        {
+            truncated = true;
+            size = limits.max_output_bytes - total;
+        }
+        total += size;
+        return size == 0 || sink(p_data, size);
+    }
+
+    /// @brief Build and log the failure message for a script
+    const std::string failureMessage(const ScriptProcess &process, const std::string &output)
+    {
+        std::stringstream ss;
+        ss << "Script exited with err:" << process.getExitStatus();
+        if (process.isTimedOut())
+        {
+            ss << " (timed out)";
+        }
+        ss << " results:\n" << output << std::endl;
+        Log::getInstance()->printf(Log::Error, "%s", ss.str().c_str());
+        return ss.str();
+    }
+} // namespace
+
+ExecLimits configuredLimits()
+{
+    ExecLimits limits;
+    static const Configuration::Key maxOutputBytesKey = config.key(CFG_SCRIPT_MAX_OUTPUT_BYTES);
+    static const Configuration::Key timeoutKey = config.key(CFG_SCRIPT_TIMEOUT_S);
+    const long max_output_bytes = config.lookupAsLong(maxOutputBytesKey);
+    const long timeout_s = config.lookupAsLong(timeoutKey);
+    limits.max_output_bytes = max_output_bytes > 0 ? (size_t)max_output_bytes : 0;
+    limits.timeout_s = timeout_s > 0 ? (unsigned int)timeout_s : 0;
+    return limits;
+}
+
+ScriptProcess::ScriptProcess(const std::string &script, const ExecLimits &limits)
+    : m_script(script), m_limits(limits), m_exit_status(-1), m_timed_out(false), m_truncated(false),
+#if defined(WIN32)
+      mp_pipe(nullptr),
+#else
+      m_pid(0),
+#endif // #if defined(WIN32)
+      m_killed(false)
+{
+    pthread_mutex_init(&m_pid_lock, NULL);
+}
+
+ScriptProcess::~ScriptProcess()
+{
+    pthread_mutex_destroy(&m_pid_lock);
+}
+
+#if defined(WIN32)
+bool ScriptProcess::run(const OutputSink &sink)
+{
+    pthread_mutex_lock(&m_pid_lock);
+    mp_pipe = m_killed ? nullptr : popen(m_script.c_str(), "r");
+    FILE *pipe = mp_pipe;
+    pthread_mutex_unlock(&m_pid_lock);
     if (!pipe)
     {
-        log_output = "";
         return false;
     }
 
-    std::string buf;
-    for (int c = getc(pipe); c != EOF; c = getc(pipe))
+    // The timeout can not be enforced through popen, only the output limit applies here
+    std::vector<char> block(OUTPUT_BLOCK_SIZE);
+    size_t total = 0;
+    bool reading = true;
+    for (size_t n = fread(&block[0], 1, block.size(), pipe); n > 0; n = fread(&block[0], 1, block.size(), pipe))
+    {
+        if (reading)
+        {
+            reading = consume(sink, m_limits, total, m_truncated, &block[0], n);
+        }
+    }
+
+    pthread_mutex_lock(&m_pid_lock);
+    mp_pipe = nullptr;
+    pthread_mutex_unlock(&m_pid_lock);
+
+    m_exit_status = pclose(pipe);
+    return m_exit_status == 0;
+}
+
+void ScriptProcess::kill()
+{
+    pthread_mutex_lock(&m_pid_lock);
+    m_killed = true;
+    pthread_mutex_unlock(&m_pid_lock);
+}
+#else
+bool ScriptProcess::run(const OutputSink &sink)
+{
+    // Neither end may leak into a script spawned concurrently by another thread, or the pipe never reports EOF.
+    // The dup2 onto stdout clears close-on-exec for the script's own copy.
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+    {
+        Log::getInstance()->printf(Log::Error, " %s Failed to create script output pipe, errno %d", __func__, errno);
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    // Run the script as the leader of a new process group so that a timeout kills everything it started.
+    // SIGPIPE is ignored by the credential manager, give the script the default behaviour back.
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t default_signals;
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGPIPE);
+    sigset_t no_signals;
+    sigemptyset(&no_signals);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setsigdefault(&attr, &default_signals);
+    posix_spawnattr_setsigmask(&attr, &no_signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    char *const argv[] = { (char *)"/bin/sh", (char *)"-c", (char *)m_script.c_str(), nullptr };
+
+    pthread_mutex_lock(&m_pid_lock);
+    pid_t pid = 0;
+    int err = m_killed ? ECANCELED : posix_spawn(&pid, "/bin/sh", &actions, &attr, argv, environ);
+    if (err == 0)
     {
-        buf.push_back(c);
+        m_pid = pid;
     }
+    pthread_mutex_unlock(&m_pid_lock);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
 
-    int err = pclose(pipe);
     if (err != 0)
     {
-        std::stringstream ss;
-        ss << "Script exited with err:" << err << " results:\n"
-            << buf << std::endl;
-        log_output = ss.str();
-        Log::getInstance()->printf(Log::Error, "%s", log_output.c_str());
+        Log::getInstance()->printf(Log::Error, " %s Failed to spawn script, error %d", __func__, err);
+        close(fds[0]);
+        return false;
+    }
+
+    steady_timer timer;
+    std::vector<char> block(OUTPUT_BLOCK_SIZE);
+    size_t total = 0;
+    bool reading = true;
+    while (true)
+    {
+        const int remaining_ms = remainingMilliseconds(m_limits, timer);
+        if (remaining_ms == 0)
+        {
+            m_timed_out = true;
+            break;
+        }
+
+        struct pollfd pfd = { fds[0], POLLIN, 0 };
+        const int ready = poll(&pfd, 1, remaining_ms);
+        if (ready < 0 && errno != EINTR)
+        {
+            Log::getInstance()->printf(Log::Error, " %s Failed polling script output, errno %d", __func__, errno);
+            kill();
+            break;
+        }
+        if (ready <= 0)
+        {
+            continue; // timeout is re-evaluated at the top of the loop
+        }
+
+        const ssize_t n = read(fds[0], &block[0], block.size());
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break; // EOF, the script and its children have closed stdout
+        }
+        if (reading)
+        {
+            reading = consume(sink, m_limits, total, m_truncated, &block[0], (size_t)n);
+            if (!reading)
+            {
+                kill();
+                break;
+            }
+        }
+    }
+    close(fds[0]);
+
+    if (m_timed_out)
+    {
+        Log::getInstance()->printf(Log::Error, " %s Script timed out after %u seconds, killing process group %d", __func__, m_limits.timeout_s, (int)pid);
+        kill();
+    }
+    if (m_truncated)
+    {
+        Log::getInstance()->printf(Log::Warning, " %s Script output exceeded %lu bytes and was truncated", __func__, (unsigned long)m_limits.max_output_bytes);
+    }
+
+    // Reap the script. With no timeout left to honour this blocks until it exits, otherwise a script that closed
+    // stdout without exiting is checked on with a growing interval until it exits or times out.
+    int status = 0;
+    int interval_ms = 1;
+    while (true)
+    {
+        const int remaining_ms = m_timed_out ? -1 : remainingMilliseconds(m_limits, timer);
+        const pid_t res = waitpid(pid, &status, remaining_ms < 0 ? 0 : WNOHANG);
+        if (res == pid || (res < 0 && errno != EINTR))
+        {
+            break;
+        }
+        if (res != 0)
+        {
+            continue; // EINTR
+        }
+        if (remaining_ms == 0)
+        {
+            m_timed_out = true;
+            Log::getInstance()->printf(Log::Error, " %s Script timed out after %u seconds, killing process group %d", __func__, m_limits.timeout_s, (int)pid);
+            kill();
+            continue;
+        }
+        usleep((interval_ms < remaining_ms ? interval_ms : remaining_ms) * 1000);
+        interval_ms = interval_ms * 2 < REAP_MAX_INTERVAL_MS ? interval_ms * 2 : REAP_MAX_INTERVAL_MS;
+    }
+
+    pthread_mutex_lock(&m_pid_lock);
+    m_pid = 0;
+    const bool killed = m_killed;
+    pthread_mutex_unlock(&m_pid_lock);
+
+    m_exit_status = status;
+    return !killed && status == 0;
+}
+
+void ScriptProcess::kill()
+{
+    pthread_mutex_lock(&m_pid_lock);
+    m_killed = true;
+    if (m_pid > 0)
+    {
+        // The pid is only cleared after reaping, so it can not have been recycled yet
+        killpg(m_pid, SIGKILL);
+    }
+    pthread_mutex_unlock(&m_pid_lock);
+}
+#endif // #if defined(WIN32)
+
+int ScriptProcess::getExitStatus() const
+{
+    return m_exit_status;
+}
+
+bool ScriptProcess::isTimedOut() const
+{
+    return m_timed_out;
+}
+
+bool ScriptProcess::isTruncated() const
+{
+    return m_truncated;
+}
+
+bool execScript(const std::string &script, std::string& log_output)
+{
+    return execScript(script, configuredLimits(), log_output);
+}
+
+bool execScript(const std::string &script, const ExecLimits &limits, std::string& log_output)
+{
+    ScriptProcess process(script, limits);
+    return execScript(process, log_output);
+}
+
+bool execScript(ScriptProcess &process, std::string& log_output)
+{
+    std::string buf;
+    const bool success = process.run([&buf](const char *p_data, size_t size)
+    {
+        buf.append(p_data, size);
+        return true;
+    });
+
+    if (!success)
+    {
+        log_output = failureMessage(process, buf);
         return false;
     }
 
@@ -46,4 +348,21 @@ bool execScript(const std::string &script, std::string& log_output)
 	return true;
 }
 
+bool execScript(ScriptProcess &process, const OutputSink &sink, std::string& log_output)
+{
+    std::string tail;
+    const bool success = process.run([&tail, &sink](const char *p_data, size_t size)
+    {
+        tail.append(p_data, size);
+        if (tail.size() > OUTPUT_TAIL_SIZE)
+        {
+            tail.erase(0, tail.size() - OUTPUT_TAIL_SIZE);
+        }
+        return sink(p_data, size);
+    });
+
+    log_output = success ? "" : failureMessage(process, tail);
+    return success;
+}
+
 } // namespace script_utils
@@ -23,6 +23,7 @@
 #include "log.hpp"
 #include "utils.hpp"
 #include "ssl_wrapper.hpp"
+#include "key_pool.hpp"
 #include "dasslcompat.h"
 
 bool SSLWrapper::m_use_custom_storage_provider{false};
@@ -70,6 +71,18 @@ void SSLWrapper::freeAll(void *x509_req, void *pKey, void *bne, void *r, void *b
     }
 }
 
+/// @brief Get the digest to sign with a key, none for Ed25519 which hashes the message itself
+static const EVP_MD* signingDigest(EVP_PKEY* p_key)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (EVP_PKEY_id(p_key) == EVP_PKEY_ED25519)
+    {
+        return nullptr;
+    }
+#endif // #if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    return EVP_sha256();
+}
+
 int add_ext_csr(STACK_OF(X509_EXTENSION)* sk, X509_REQ* req, int nid, char* value) {
 
     X509_EXTENSION* ex = nullptr;
@@ -89,7 +102,7 @@ bool SSLWrapper::generateCSR(const CsrInstructions& csr_info, const std::string&
 {
     std::string priv_str;
     EVP_PKEY *p_public_key = nullptr;
-    if (!generateKeyPair(key, iv, priv_str, &p_public_key))
+    if (!generateKeyPair(csr_info.getKeySpec(), key, iv, priv_str, &p_public_key))
     {
         Log::getInstance()->printf(Log::Error, " %s Failed to generate private key", __func__);
         return false;
@@ -101,73 +114,132 @@ bool SSLWrapper::generateCSR(const CsrInstructions& csr_info, const std::string&
     return createX509Request(csr_info, p_public_key, csr);
 } //end of generateCSR
 
-bool SSLWrapper::generateKeyPair(const std::string& key, const std::string& iv, std::string &private_key, EVP_PKEY** p_public_key)
+bool SSLWrapper::generateKeyPair(const KeySpec& spec, const std::string& key, const std::string& iv, std::string &private_key, EVP_PKEY** p_public_key)
 {
-    Log *p_logger = Log::getInstance();
+    // Generating an RSA key takes a while, so one generated in the background is used when there is one
+    if (KeyPool::getInstance()->take(spec, private_key, p_public_key))
+    {
+        return true;
+    }
 
-    const unsigned long e = RSA_F4;
-    const int bits = 2048;
+    Log *p_logger = Log::getInstance();
 
     /*Seed the Random number generator.*/
     const std::string rand_str = key + iv;
-
     RAND_seed(rand_str.c_str(), rand_str.size());
-    BIGNUM *bne = BN_new();
-    if (!BN_set_word(bne, e))
-    {
-        p_logger->printf(Log::Error, " %s BN_set_word failed", __func__);
-        freeAll(nullptr, nullptr, bne, nullptr, nullptr, nullptr);
 
-        return false;
-    }
-    // Generate RSA key pair
-    RSA *p_rsa = RSA_new();
-    if ((p_rsa == NULL) || !RSA_generate_key_ex(p_rsa, bits, bne, NULL))
+    *p_public_key = generatePrivateKey(spec);
+    if (*p_public_key == nullptr)
     {
-        p_logger->printf(Log::Error, " %s Generation of RSA key pair failed", __func__);
-        freeAll(nullptr, nullptr, bne, p_rsa, nullptr, nullptr);
-
+        p_logger->printf(Log::Error, " %s Generation of %s key pair failed", __func__, spec.name().c_str());
         return false;
     }
-    // Get RSA private key in the memory
-    BIO *key_p = BIO_new(BIO_s_mem());
-    if (!PEM_write_bio_RSAPrivateKey(key_p, p_rsa, NULL, NULL, 0, NULL, NULL))
+    if (!writePrivateKey(*p_public_key, private_key))
     {
-        p_logger->printf(Log::Error, " %s Writing of RSA private key to the memory failed", __func__);
-        freeAll(nullptr, nullptr, bne, p_rsa, key_p, nullptr);
+        p_logger->printf(Log::Error, " %s Writing of private key to the memory failed", __func__);
+        freeAll(nullptr, *p_public_key, nullptr, nullptr, nullptr, nullptr);
+        *p_public_key = nullptr;
 
         return false;
     }
 
-    // Get public key of x509 req
-    *p_public_key = EVP_PKEY_new();
-    if (!EVP_PKEY_assign_RSA(*p_public_key, p_rsa))
-    {
-        p_logger->printf(Log::Error, " %s Failed getting public key from RSA pair", __func__);
-        p_rsa = nullptr; // p_key owns p_rsa now
-        freeAll(nullptr, *p_public_key, bne, p_rsa, key_p, nullptr);
+    return true;
+}
 
-        return false;
+EVP_PKEY *SSLWrapper::generatePrivateKey(const KeySpec &spec)
+{
+    EVP_PKEY *p_key = nullptr;
+    if (spec.algorithm == KeySpec::RSA)
+    {
+        // The public exponent defaults to RSA_F4
+        EVP_PKEY_CTX *p_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+        if (p_ctx == nullptr ||
+            EVP_PKEY_keygen_init(p_ctx) <= 0 ||
+            EVP_PKEY_CTX_set_rsa_keygen_bits(p_ctx, spec.bits) <= 0 ||
+            EVP_PKEY_keygen(p_ctx, &p_key) <= 0)
+        {
+            p_key = nullptr;
+        }
+        EVP_PKEY_CTX_free(p_ctx);
+    }
+    else if (spec.algorithm == KeySpec::ED25519)
+    {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+        EVP_PKEY_CTX *p_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, nullptr);
+        if (p_ctx == nullptr || EVP_PKEY_keygen_init(p_ctx) <= 0 || EVP_PKEY_keygen(p_ctx, &p_key) <= 0)
+        {
+            p_key = nullptr;
+        }
+        EVP_PKEY_CTX_free(p_ctx);
+#endif // #if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    }
+    else
+    {
+        // The curve is set up as parameters first, which every OpenSSL version supports
+        const int nid = spec.bits == 384 ? NID_secp384r1 : NID_X9_62_prime256v1;
+        EVP_PKEY *p_params = nullptr;
+        EVP_PKEY_CTX *p_param_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (p_param_ctx != nullptr &&
+            EVP_PKEY_paramgen_init(p_param_ctx) > 0 &&
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(p_param_ctx, nid) > 0 &&
+            EVP_PKEY_CTX_set_ec_param_enc(p_param_ctx, OPENSSL_EC_NAMED_CURVE) > 0 &&
+            EVP_PKEY_paramgen(p_param_ctx, &p_params) > 0)
+        {
+            EVP_PKEY_CTX *p_ctx = EVP_PKEY_CTX_new(p_params, nullptr);
+            if (p_ctx == nullptr || EVP_PKEY_keygen_init(p_ctx) <= 0 || EVP_PKEY_keygen(p_ctx, &p_key) <= 0)
+            {
+                p_key = nullptr;
+            }
+            EVP_PKEY_CTX_free(p_ctx);
+        }
+        EVP_PKEY_free(p_params);
+        EVP_PKEY_CTX_free(p_param_ctx);
     }
-    p_rsa = nullptr; // p_key owns p_rsa now
-
-    // Encrypt and Store
-    size_t pri_len = BIO_pending(key_p);
-    char *pri_key = new char[pri_len + 1];
 
-    BIO_read(key_p, pri_key, pri_len);
-    pri_key[pri_len] = '\0';
+    return p_key;
+}
 
-    // Set out value to private key
-    private_key = std::string(pri_key);
+bool SSLWrapper::writePrivateKey(EVP_PKEY *p_key, std::string &private_key)
+{
+    BIO *p_bio = BIO_new(BIO_s_mem());
+    if (p_bio == nullptr)
+    {
+        return false;
+    }
 
-    // No longer need the buffer
-    delete [] pri_key;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    // Ed25519 has no traditional format
+    const bool written = EVP_PKEY_id(p_key) == EVP_PKEY_ED25519
+        ? PEM_write_bio_PrivateKey(p_bio, p_key, nullptr, nullptr, 0, nullptr, nullptr) == 1
+        : PEM_write_bio_PrivateKey_traditional(p_bio, p_key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+#elif OPENSSL_VERSION_NUMBER >= 0x10100000L
+    const bool written = PEM_write_bio_PrivateKey_traditional(p_bio, p_key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+#else
+    // Before 1.1.0 the generic writer uses PKCS#8, so the traditional format is written by type
+    bool written = false;
+    if (EVP_PKEY_id(p_key) == EVP_PKEY_RSA)
+    {
+        RSA *p_rsa = EVP_PKEY_get1_RSA(p_key);
+        written = PEM_write_bio_RSAPrivateKey(p_bio, p_rsa, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        RSA_free(p_rsa);
+    }
+    else if (EVP_PKEY_id(p_key) == EVP_PKEY_EC)
+    {
+        EC_KEY *p_ec = EVP_PKEY_get1_EC_KEY(p_key);
+        written = PEM_write_bio_ECPrivateKey(p_bio, p_ec, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        EC_KEY_free(p_ec);
+    }
+#endif // #if OPENSSL_VERSION_NUMBER >= 0x10101000L
 
-    // Tidy up
-    freeAll(nullptr, nullptr, bne, nullptr, key_p, nullptr);
+    if (written)
+    {
+        char *p_data = nullptr;
+        const long size = BIO_get_mem_data(p_bio, &p_data);
+        private_key.assign(p_data, (size_t)size);
+    }
+    BIO_free_all(p_bio);
 
-    return true;
+    return written;
 }
 
 bool SSLWrapper::createX509Request(const CsrInstructions& csr_info, EVP_PKEY* public_key, std::string &csr_out_str)
@@ -227,7 +299,7 @@ bool SSLWrapper::createX509Request(const CsrInstructions& csr_info, EVP_PKEY* pu
 
         return false;
     }
-    if (!X509_REQ_sign(x509_req, public_key, EVP_sha256()))
+    if (!X509_REQ_sign(x509_req, public_key, signingDigest(public_key)))
     {
         p_logger->printf(Log::Error, " %s Failed signing of CSR", __func__);
         freeAll(x509_req, public_key, nullptr, nullptr, nullptr, nullptr);
@@ -257,6 +329,41 @@ bool SSLWrapper::createX509Request(const CsrInstructions& csr_info, EVP_PKEY* pu
     return true;
 }
 
+bool KeySpec::parse(const std::string &name, KeySpec &spec)
+{
+    const std::string upper = utils::toUpper(name);
+    if (upper == "RSA-2048" || upper == "RSA-3072" || upper == "RSA-4096")
+    {
+        spec.algorithm = RSA;
+        spec.bits = atoi(upper.c_str() + 4);
+        return true;
+    }
+    if (upper == "EC-P256" || upper == "EC-P384")
+    {
+        spec.algorithm = EC;
+        spec.bits = atoi(upper.c_str() + 4);
+        return true;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (upper == "ED25519")
+    {
+        spec.algorithm = ED25519;
+        spec.bits = 256;
+        return true;
+    }
+#endif // #if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    return false;
+}
+
+const std::string KeySpec::name() const
+{
+    if (algorithm == ED25519)
+    {
+        return "ED25519";
+    }
+    return (algorithm == RSA ? "RSA-" : "EC-P") + std::to_string(bits);
+}
+
 bool IsNullString(const char * s)
 {
     return (s == 0 ? true : false);
@@ -286,7 +393,7 @@ const std::string SSLWrapper::md5hashstring(const std::string& md5_hash)
     return value;
 }
 
-RSA* createRsaFromPrivateKey(const std::string &key)
+EVP_PKEY* createKeyFromPrivateKey(const std::string &key)
 {
     BIO* p_keybio = BIO_new_mem_buf((void*)key.c_str(), -1);
     if (p_keybio == nullptr)
@@ -295,7 +402,10 @@ RSA* createRsaFromPrivateKey(const std::string &key)
         return nullptr;
     }
 
-    return PEM_read_bio_RSAPrivateKey(p_keybio, nullptr, nullptr, nullptr);
+    // Reads RSA, EC and PKCS#8 keys alike
+    EVP_PKEY* p_key = PEM_read_bio_PrivateKey(p_keybio, nullptr, nullptr, nullptr);
+    BIO_free(p_keybio);
+    return p_key;
 }
 
 X509* createX509FromCertificate(const std::string &cert)
@@ -345,7 +455,7 @@ X509* generate_x509(const std::string &common_name, EVP_PKEY* pkey)
     }
 
     X509_set_issuer_name(x509, name);
-    X509_sign(x509, pkey, EVP_sha256());
+    X509_sign(x509, pkey, signingDigest(pkey));
 
     return x509;
 }
@@ -354,16 +464,13 @@ const std::string SSLWrapper::createSelfSignedCert(
     const std::string &private_key,
     const std::string &common_name)
 {
-    RSA* p_rsa = createRsaFromPrivateKey(private_key);
-    if (p_rsa == nullptr)
+    EVP_PKEY* p_pkey = createKeyFromPrivateKey(private_key);
+    if (p_pkey == nullptr)
     {
         Log* p_logger = Log::getInstance();
         p_logger->printf(Log::Error, "Failed to create private key");
     }
 
-    EVP_PKEY* p_pkey = EVP_PKEY_new();
-    EVP_PKEY_assign_RSA(p_pkey, p_rsa);
-
     BIO* p_bio = BIO_new(BIO_s_mem());
     if (p_bio == nullptr)
     {
@@ -412,20 +519,13 @@ bool SSLWrapper::writePrivateKeyToStorageProvider(const std::string &private_key
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
     Log::getInstance()->printf(Log::Debug, "%s Writing private key to storage provider. Id: %s", __func__, key_id.c_str());
 
-    RSA* p_rsa = createRsaFromPrivateKey(private_key);
-    if (!p_rsa)
+    EVP_PKEY* p_private_key = createKeyFromPrivateKey(private_key);
+    if (!p_private_key)
     {
-        Log::getInstance()->printf(Log::Error, "Failed to create RSA object from private key");
+        Log::getInstance()->printf(Log::Error, "Failed to create EVP_PKEY object from private key");
         return false;
     }
 
-    EVP_PKEY* p_private_key = EVP_PKEY_new();
-    if (!EVP_PKEY_assign_RSA(p_private_key, p_rsa))
-    {
-        Log::getInstance()->printf(Log::Error, "Failed to generate EVP_PKEY from RSA object");
-        return false;
-    }            
-
     BIO *p_bio = BIO_new(BIO_s_mem());    
     if (!PEM_write_bio_PrivateKey(p_bio, p_private_key, nullptr, (unsigned char *)"", 0, nullptr, (char *)""))
     {
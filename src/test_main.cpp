@@ -9,17 +9,30 @@
 #include "wincrypt_cert_store_unittest.hpp"
 #else // #ifdef _WIN32
 #include "asset_manager_unittest.hpp"
+#include "tpm_job_queue_unittest.hpp"
 #include "tpm_wrapper_unittest.hpp"
 #endif // #ifdef _WIN32
 #include "apm_asset_processor_unittest.hpp"
+#include "asset_decoder_unittest.hpp"
 #include "certificate_asset_processor_unittest.hpp"
 #include "certificate_data_asset_processor_unittest.hpp"
+#include "deviceauthority_unittest.hpp"
+#include "download_file_unittest.hpp"
+#include "event_dispatcher_unittest.hpp"
+#include "event_manager_unittest.hpp"
+#include "evp_crypto_unittest.hpp"
 #include "group_asset_processor_unittest.hpp"
+#include "json_arena_unittest.hpp"
+#include "key_material_cache_unittest.hpp"
+#include "key_pool_unittest.hpp"
 #include "message_factory_unittest.hpp"
+#include "policystore_unittest.hpp"
 #include "rsa_utils_unittest.hpp"
 #include "sat_asset_processor_unittest.hpp"
 #include "script_asset_processor_unittest.hpp"
+#include "script_result_writer_unittest.hpp"
 #include "script_utils_unittest.hpp"
+#include "ssl_wrapper_unittest.hpp"
 #include "utils_unittest.hpp"
 
 int main(int argc, char *argv[])
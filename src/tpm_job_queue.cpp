@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024 Device Authority. - All rights reserved. - www.deviceauthority.com
+ *
+ * Runs the operations of a TPM wrapper one at a time on a worker thread
+ */
+
+#include "tpm_job_queue.hpp"
+
+TpmJobQueue::TpmJobQueue(TpmWrapperBase *p_tpm) : mp_tpm(p_tpm), m_running(0), m_coalesced(0), m_stopping(false)
+{
+    m_initialised = mp_tpm->initialised();
+    m_host_has_tpm = mp_tpm->isTpmAvailable();
+    m_thread = std::thread(&TpmJobQueue::work, this);
+}
+
+TpmJobQueue::~TpmJobQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    delete mp_tpm;
+}
+
+bool TpmJobQueue::getRandom(size_t num_bytes, std::vector<char> &random_str) const
+{
+    std::shared_ptr<Job> p_job = std::make_shared<Job>();
+    p_job->kind = Job::GetRandom;
+    p_job->num_bytes = num_bytes;
+    const bool success = run(p_job);
+    random_str.swap(p_job->data);
+    return success;
+}
+
+bool TpmJobQueue::createSeal(const std::string &path, const std::vector<char> &data, bool overwrite)
+{
+    std::shared_ptr<Job> p_job = std::make_shared<Job>();
+    p_job->kind = Job::CreateSeal;
+    p_job->path = path;
+    p_job->data = data;
+    p_job->overwrite = overwrite;
+    return run(p_job);
+}
+
+bool TpmJobQueue::unseal(const std::string &path, std::vector<char> &data)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::shared_ptr<Job> p_job;
+    auto unseal_iter = m_unseals.find(path);
+    if (unseal_iter != m_unseals.end())
+    {
+        // Share the result of the unseal already queued
+        p_job = unseal_iter->second;
+        ++m_coalesced;
+    }
+    else
+    {
+        p_job = std::make_shared<Job>();
+        p_job->kind = Job::Unseal;
+        p_job->path = path;
+        m_unseals[path] = p_job;
+        m_jobs.push_back(p_job);
+        m_wake.notify_one();
+    }
+
+    const bool success = wait(lock, p_job);
+    data = p_job->data;
+    return success;
+}
+
+bool TpmJobQueue::deleteKey(const std::string &path)
+{
+    std::shared_ptr<Job> p_job = std::make_shared<Job>();
+    p_job->kind = Job::DeleteKey;
+    p_job->path = path;
+    return run(p_job);
+}
+
+size_t TpmJobQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.size() + m_running;
+}
+
+size_t TpmJobQueue::coalescedUnseals() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_coalesced;
+}
+
+bool TpmJobQueue::run(const std::shared_ptr<Job> &p_job) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (p_job->kind == Job::CreateSeal || p_job->kind == Job::DeleteKey)
+    {
+        // Unseals queued from now on must run after this, rather than join one queued before it
+        m_unseals.erase(p_job->path);
+    }
+    m_jobs.push_back(p_job);
+    m_wake.notify_one();
+    return wait(lock, p_job);
+}
+
+bool TpmJobQueue::wait(std::unique_lock<std::mutex> &lock, const std::shared_ptr<Job> &p_job) const
+{
+    m_done.wait(lock, [&p_job]() { return p_job->done; });
+    return p_job->success;
+}
+
+void TpmJobQueue::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+        if (m_jobs.empty())
+        {
+            // Stopping, with everything queued finished
+            return;
+        }
+
+        std::shared_ptr<Job> p_job = m_jobs.front();
+        m_jobs.pop_front();
+        ++m_running;
+        lock.unlock();
+
+        bool success = false;
+        switch (p_job->kind)
+        {
+        case Job::GetRandom:
+            success = mp_tpm->getRandom(p_job->num_bytes, p_job->data);
+            break;
+        case Job::CreateSeal:
+            success = mp_tpm->createSeal(p_job->path, p_job->data, p_job->overwrite);
+            break;
+        case Job::Unseal:
+            success = mp_tpm->unseal(p_job->path, p_job->data);
+            break;
+        case Job::DeleteKey:
+            success = mp_tpm->deleteKey(p_job->path);
+            break;
+        }
+
+        lock.lock();
+        --m_running;
+        if (p_job->kind == Job::Unseal)
+        {
+            auto unseal_iter = m_unseals.find(p_job->path);
+            if (unseal_iter != m_unseals.end() && unseal_iter->second == p_job)
+            {
+                m_unseals.erase(unseal_iter);
+            }
+        }
+        p_job->success = success;
+        p_job->done = true;
+        m_done.notify_all();
+    }
+}
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include "tpm_wrapper.hpp"
+#include "tpm_job_queue.hpp"
 #include "utils.hpp"
 
 TpmWrapperBase* TpmWrapper::m_instance = nullptr;
@@ -15,7 +16,12 @@ TpmWrapperBase* TpmWrapper::getInstance()
 {
     if (!m_instance)
     {
+#ifndef DISABLE_TPM
+        // The FAPI context is only ever used by the queue's worker thread
+        m_instance = new TpmJobQueue(new TpmWrapper());
+#else
         m_instance = new TpmWrapper();
+#endif // DISABLE_TPM
     }
 
     return m_instance;
@@ -108,8 +114,15 @@ bool TpmWrapper::createSeal(const std::string &path, const std::vector<char> &da
             return false;
         }
 
-        // Set overwrite to false to ensure that we don't get stuck repeatedly overwriting and failing to create seal
-        return createSeal(path, data, false);
+        // Create the seal once more with the keystore path already derived, without overwriting again
+        rc = Fapi_CreateSeal(
+            mp_context,
+            keystore_path.c_str(),
+            "noda,system",
+            data.size(),
+            nullptr,
+            nullptr,
+            (uint8_t*)&data[0]);
     }
 
     return rc == TSS2_RC_SUCCESS;
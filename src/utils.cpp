@@ -30,8 +30,9 @@
 #else
 #include <ctime>
 #endif // #if __cplusplus > 199711L
-#include "base64.h"
+#include "base64.hpp"
 #include "dacryptor.hpp"
+#include "evp_crypto.hpp"
 #include "log.hpp"
 #include "utils.hpp"
 #include "deviceauthority.hpp"
@@ -47,6 +48,40 @@
 namespace utils
 {
 
+    namespace
+    {
+        /**
+         * @brief Lends the calling thread its dacryptor for one operation, so that the cipher context and
+         * buffers are reused by each encryption block, and wipes it afterwards
+         */
+        class ThreadCryptor
+        {
+        public:
+            ThreadCryptor() : m_cryptor(instance())
+            {
+            }
+
+            ~ThreadCryptor()
+            {
+                m_cryptor.clear();
+            }
+
+            dacryptor &get()
+            {
+                return m_cryptor;
+            }
+
+        private:
+            dacryptor &m_cryptor;
+
+            static dacryptor &instance()
+            {
+                static thread_local dacryptor cryptor;
+                return cryptor;
+            }
+        };
+    } // namespace
+
     bool stringEndsWith(std::string const &src, std::string const &ending)
     {
         if (src.length() >= ending.length())
@@ -164,26 +199,23 @@ namespace utils
     bool base64DecodeKeyIV(std::string &key, std::string &iv)
     {
         Log *logger = Log::getInstance();
-        static const int BUFLEN = 1024;
-        unsigned char decodedData[BUFLEN] = {0};
-        unsigned int decodedLength = base64Decode(key.c_str(), decodedData, sizeof(decodedData));
+        std::string decoded;
 
-        if (decodedLength == 0)
+        if (base64::decodeAppend(key, decoded) != base64::OK || decoded.empty())
         {
-            logger->printf(Log::Error, " %s Unable to encode Key (E)..", __func__);
+            logger->printf(Log::Error, " %s Unable to decode Key (E)..", __func__);
 
             return false;
         }
-        key.assign((const char *)decodedData, decodedLength);
-        memset(decodedData, 0, BUFLEN);
-        decodedLength = base64Decode(iv.c_str(), decodedData, BUFLEN);
-        if (decodedLength == 0)
+        key.swap(decoded);
+        decoded.clear();
+        if (base64::decodeAppend(iv, decoded) != base64::OK || decoded.empty())
         {
-            logger->printf(Log::Error, " %s Unable to encode IV (E)..", __func__);
+            logger->printf(Log::Error, " %s Unable to decode IV (E)..", __func__);
 
             return false;
         }
-        iv.assign((const char *)decodedData, decodedLength);
+        iv.swap(decoded);
 
         return true;
     }
@@ -191,37 +223,23 @@ namespace utils
     bool base64EncodeKeyIV(std::string &key, std::string &iv)
     {
         Log *logger = Log::getInstance();
-        unsigned int encodedBlockLength = ((unsigned int)key.length()) * 2u;
-        char *encodedBlock = new char[encodedBlockLength];
-
-        memset(encodedBlock, 0, encodedBlockLength);
+        std::string encoded;
 
-        int ret = base64Encode((const unsigned char *)key.c_str(), (unsigned int)key.length(), encodedBlock, encodedBlockLength);
-        if (ret == 0)
+        if (key.empty() || base64::encodeAppend(key, encoded) != base64::OK)
         {
             logger->printf(Log::Error, " %s Unable to encode Key (E)..", __func__);
-            delete[] encodedBlock;
-            encodedBlock = NULL;
 
             return false;
         }
-        key.assign(encodedBlock, ret);
-        delete[] encodedBlock;
-        encodedBlockLength = ((unsigned int)iv.length()) * 2u;
-        encodedBlock = new char[encodedBlockLength];
-        memset(encodedBlock, 0, encodedBlockLength);
-        ret = base64Encode((const unsigned char *)iv.c_str(), (unsigned int)iv.length(), encodedBlock, encodedBlockLength);
-        if (ret == 0)
+        key.swap(encoded);
+        encoded.clear();
+        if (iv.empty() || base64::encodeAppend(iv, encoded) != base64::OK)
         {
             logger->printf(Log::Error, " %s Unable to encode IV (E)..", __func__);
-            delete[] encodedBlock;
-            encodedBlock = NULL;
 
             return false;
         }
-        iv.assign(encodedBlock, ret);
-        delete[] encodedBlock;
-        encodedBlock = NULL;
+        iv.swap(encoded);
 
         return true;
     }
@@ -262,16 +280,16 @@ namespace utils
 
     const std::string toBase64(const std::string &data)
     {
-        std::vector<char> buf(data.size() * 2, 0);
-        unsigned int sz = base64Encode((unsigned char *)data.c_str(), (unsigned int)data.size(), &buf[0], (unsigned int)buf.size());
-        return std::string(buf.begin(), buf.begin() + sz);
+        std::string text;
+        base64::encodeAppend(data, text);
+        return text;
     }
 
     const std::string fromBase64(const std::string &data)
     {
-        std::vector<unsigned char> buf(data.size());
-        unsigned int sz = base64Decode(data.c_str(), &buf[0], buf.size());
-        return std::string(buf.begin(), buf.begin() + sz);
+        std::string decoded;
+        base64::decodeAppend(data, decoded);
+        return decoded;
     }
 
     /*
@@ -502,15 +520,8 @@ namespace utils
         else
         {
             // Couldn't find the key-id so perhaps the data is base64 encoded, decode and try again
-            size_t s = data.size();
-            char *decoded_block = new char[s];
-
-            memset(decoded_block, 0, s);
-
-            int dataLen = base64Decode(data.c_str(), (unsigned char *)decoded_block, (unsigned int)s);
-
-            json_str.assign(decoded_block, dataLen);
-            delete[] decoded_block;
+            json_str.clear();
+            base64::decodeAppend(data, json_str);
             document.Parse(json_str.c_str());
             if (document.HasParseError())
             {
@@ -602,10 +613,15 @@ namespace utils
 
             if (!iv_b64_val.IsNull())
             {
-                const std::string iv_b64 = iv_b64_val.GetString();
-                std::vector<unsigned char> iv_buf(json.size() * 2);
-                unsigned int buf_size = base64Decode(iv_b64.c_str(), &iv_buf[0], iv_buf.size());
-                iv = std::vector<char>(iv_buf.begin(), iv_buf.begin() + buf_size);
+                const char *p_iv_b64 = iv_b64_val.GetString();
+                const size_t iv_b64_length = iv_b64_val.GetStringLength();
+                size_t iv_size = 0;
+                iv.resize(base64::decodedSize(p_iv_b64, iv_b64_length));
+                if (base64::decode(p_iv_b64, iv_b64_length, iv.data(), iv.size(), iv_size) != base64::OK)
+                {
+                    iv_size = 0;
+                }
+                iv.resize(iv_size);
             }
         }
 
@@ -709,7 +725,8 @@ namespace utils
                 p_logger->printf(Log::Debug, " %s Key and IV not encoded", __func__);
             }
 
-            dacryptor component;
+            ThreadCryptor cryptor;
+            dacryptor &component = cryptor.get();
             component.setInitVector(base64_decoded_iv);
             component.setCryptionKey(base64_decoded_key);
             component.setInputData(cipher_text);
@@ -769,7 +786,8 @@ namespace utils
             return false;
         }
 
-        dacryptor component;
+        ThreadCryptor cryptor;
+        dacryptor &component = cryptor.get();
         component.setCryptionKey(key);
         component.setInitVector(iv);
         component.setInputData(ciphertext);
@@ -818,7 +836,8 @@ namespace utils
 
         if (!data.empty())
         {
-            dacryptor component;
+            ThreadCryptor cryptor;
+            dacryptor &component = cryptor.get();
 
             if (key_iv_base64_encoded)
             {
@@ -889,10 +908,8 @@ namespace utils
 
         root_document.AddMember("ciphertext", rapidjson::StringRef(ciphertext.c_str()), allocator);
 
-        std::vector<char> buf(iv.size() * 2, 0);
-        unsigned int sz = base64Encode((unsigned char*)&iv[0], (unsigned int)iv.size(), &buf[0], (unsigned int)buf.size());
-
-        const std::string iv_b64 = std::string(buf.begin(), buf.end());
+        std::string iv_b64;
+        base64::encodeAppend(iv.data(), iv.size(), iv_b64);
         root_document.AddMember("iv", rapidjson::StringRef(iv_b64.c_str()), allocator);
 
         rapidjson::StringBuffer strbuf;
@@ -923,7 +940,8 @@ namespace utils
             return false;
         }
 
-        dacryptor component;
+        ThreadCryptor cryptor;
+        dacryptor &component = cryptor.get();
         component.setCryptionKey(key);
         component.setInitVector(iv);
         component.setInputData(data);
@@ -1006,25 +1024,22 @@ namespace utils
      */
     bool sha256AndEncode(const std::string &input, bool isFile, bool encode, std::string &hashedVal)
     {
-        std::string data = input;
         hashedVal.clear();
 
         if (isFile)
         {
-            std::ifstream ifs(input.c_str());
-            std::stringstream buffer;
-            buffer << ifs.rdbuf();
-            data = buffer.str();
-            if (data.empty())
+            // Files such as whole executables are hashed in blocks rather than read into memory, an empty file is an error
+            size_t file_size = 0;
+            if (!evp_crypto::digestFileSHA256(input, hashedVal, &file_size) || hashedVal.empty() || file_size == 0)
             {
+                hashedVal.clear();
                 Log::getInstance()->printf(Log::Error, "%s Unable to read data from %s", __func__, input.c_str());
                 return false;
             }
         }
-
-        if (DeviceAuthorityBase *da = DeviceAuthority::getInstance())
+        else if (DeviceAuthorityBase *da = DeviceAuthority::getInstance())
         {
-            hashedVal = da->doDigestSHA256(data);
+            hashedVal = da->doDigestSHA256(input);
             if (hashedVal.empty())
             {
                 return false;
@@ -1038,10 +1053,9 @@ namespace utils
 
         if (encode)
         {
-            unsigned int encodedBlockLength = ((unsigned int)hashedVal.size()) * 2u;
-            std::vector<char> encodedBlock(encodedBlockLength);
-            int len = base64Encode((const unsigned char *)hashedVal.c_str(), (unsigned int)hashedVal.length(), &encodedBlock[0], encodedBlockLength);
-            hashedVal.assign(&encodedBlock[0], len);
+            std::string encoded;
+            base64::encodeAppend(hashedVal, encoded);
+            hashedVal.swap(encoded);
         }
 
         return true;
@@ -1149,7 +1163,7 @@ namespace utils
     const std::string deflate(const std::string &data)
     {
         uLong sz = compressBound((uLong)data.size());
-        std::vector<Bytef> buf(data.size() + 1, 0);
+        std::vector<Bytef> buf(sz, 0);
 
         if (Z_OK != compress(&buf[0], &sz, (const unsigned char *)data.c_str(), (uLong)data.size()))
         {
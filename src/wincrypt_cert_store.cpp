@@ -453,30 +453,20 @@ int WincryptCertStore::exportPrivateKeyPfxFromStore(const std::string subject_na
                         BIO_free(bo);
 
                         private_key = pem;
+                        free(pem);
 
-                        unsigned char *rsa_private_key_char = (unsigned char *)private_key.c_str();
-
-                        BIO *p_rsa_private_bio = BIO_new_mem_buf(rsa_private_key_char, -1);
-                        RSA *p_rsa_private_key = NULL;
-                        PEM_read_bio_RSAPrivateKey(p_rsa_private_bio, &p_rsa_private_key, nullptr, nullptr);
-                        BIO *p_key = BIO_new(BIO_s_mem());
-                        if (!PEM_write_bio_RSAPrivateKey(p_key, p_rsa_private_key, nullptr, nullptr, 0, nullptr, nullptr))
+                        // Rewrite the PKCS#8 key in the format the agent writes keys of its type in
+                        BIO *p_private_bio = BIO_new_mem_buf((void *)private_key.c_str(), -1);
+                        EVP_PKEY *p_private_key = PEM_read_bio_PrivateKey(p_private_bio, nullptr, nullptr, nullptr);
+                        BIO_free(p_private_bio);
+                        std::string converted_key;
+                        const bool converted = p_private_key && SSLWrapper::writePrivateKey(p_private_key, converted_key);
+                        EVP_PKEY_free(p_private_key);
+                        if (!converted)
                         {
                             return false;
                         }
-                        else
-                        {
-                            char *key_buffer = (char *)malloc(BIO_number_written(p_key) + 1);
-                            if (nullptr == key_buffer)
-                            {
-                                BIO_free(p_key);
-                            }
-                            memset(key_buffer, 0, BIO_number_written(p_key) + 1);
-                            BIO_read(p_key, key_buffer, BIO_number_written(p_key));
-                            BIO_free(p_key);
-                            private_key = key_buffer;
-                        }
-                        free(pem);
+                        private_key = converted_key;
                     }
                 }
             }